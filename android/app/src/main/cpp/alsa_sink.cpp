@@ -0,0 +1,123 @@
+#include "alsa_sink.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <utility>
+
+#include "native_log.h"
+#include "thread_config.h"
+
+namespace {
+constexpr unsigned int kDefaultLatencyUs = 20000;
+
+std::string defaultDevice() {
+  const char* device = std::getenv("SLOWREVERB_ALSA_DEVICE");
+  return device && *device ? device : "default";
+}
+}  // namespace
+
+AlsaSink::AlsaSink() : device_(defaultDevice()) {}
+
+AlsaSink::AlsaSink(std::string device) : device_(std::move(device)) {}
+
+AlsaSink::~AlsaSink() { close(); }
+
+bool AlsaSink::open(const AudioSinkConfig& config,
+                    AudioSinkCallback* callback) {
+  close();
+  int err = snd_pcm_open(&pcm_, device_.c_str(), SND_PCM_STREAM_PLAYBACK, 0);
+  if (err < 0) {
+    loge("Failed to open ALSA device %s: %s", device_.c_str(),
+         snd_strerror(err));
+    pcm_ = nullptr;
+    return false;
+  }
+  // Ask for roughly four bursts of buffering when a burst size is given.
+  const unsigned int latencyUs =
+      config.framesPerBurst > 0
+          ? static_cast<unsigned int>(4000000LL * config.framesPerBurst /
+                                      config.sampleRate)
+          : kDefaultLatencyUs;
+  err = snd_pcm_set_params(pcm_, SND_PCM_FORMAT_FLOAT,
+                           SND_PCM_ACCESS_RW_INTERLEAVED,
+                           static_cast<unsigned int>(config.channelCount),
+                           static_cast<unsigned int>(config.sampleRate),
+                           1 /* soft resample */, latencyUs);
+  if (err < 0) {
+    loge("Failed to configure ALSA device: %s", snd_strerror(err));
+    close();
+    return false;
+  }
+  snd_pcm_uframes_t bufferSize = 0;
+  snd_pcm_uframes_t periodSize = 0;
+  snd_pcm_get_params(pcm_, &bufferSize, &periodSize);
+
+  callback_ = callback;
+  sampleRate_ = config.sampleRate;
+  channelCount_ = config.channelCount;
+  framesPerBurst_ = periodSize > 0 ? static_cast<int32_t>(periodSize) : 256;
+  maxCallbackFrames_ = framesPerBurst_;
+  buffer_.assign(static_cast<size_t>(maxCallbackFrames_) * channelCount_,
+                 0.0f);
+  xruns_.store(0);
+  return true;
+}
+
+bool AlsaSink::start() {
+  if (!pcm_ || running_.load()) return false;
+  const int err = snd_pcm_prepare(pcm_);
+  if (err < 0) {
+    loge("Failed to prepare ALSA device: %s", snd_strerror(err));
+    return false;
+  }
+  running_.store(true);
+  thread_ = std::thread(&AlsaSink::renderLoop, this);
+  return true;
+}
+
+void AlsaSink::stop() {
+  running_.store(false);
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+  if (pcm_) snd_pcm_drop(pcm_);
+}
+
+void AlsaSink::close() {
+  stop();
+  if (pcm_) {
+    snd_pcm_close(pcm_);
+    pcm_ = nullptr;
+  }
+  callback_ = nullptr;
+}
+
+void AlsaSink::renderLoop() {
+  applyThreadRole(ThreadRole::kAudio, "sr-alsa");
+  while (running_.load()) {
+    const bool keepGoing = callback_->onRender(buffer_.data(), framesPerBurst_);
+    const float* data = buffer_.data();
+    snd_pcm_sframes_t remaining = framesPerBurst_;
+    while (remaining > 0 && running_.load()) {
+      const snd_pcm_sframes_t written = snd_pcm_writei(pcm_, data, remaining);
+      if (written >= 0) {
+        data += written * channelCount_;
+        remaining -= written;
+        continue;
+      }
+      if (written == -EPIPE) {
+        xruns_.fetch_add(1);
+      }
+      const int err = snd_pcm_recover(pcm_, static_cast<int>(written), 1);
+      if (err < 0) {
+        loge("ALSA write failed: %s", snd_strerror(err));
+        callback_->onSinkError(snd_strerror(err));
+        running_.store(false);
+        return;
+      }
+    }
+    if (!keepGoing) break;
+  }
+  if (running_.load()) snd_pcm_drain(pcm_);
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <alsa/asoundlib.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "audio_sink.h"
+
+// Blocking ALSA playback on its own thread. The device defaults to
+// "default"; SLOWREVERB_ALSA_DEVICE overrides it (e.g. "null" on headless
+// CI machines).
+class AlsaSink : public AudioSink {
+ public:
+  AlsaSink();
+  explicit AlsaSink(std::string device);
+  ~AlsaSink() override;
+
+  bool open(const AudioSinkConfig& config,
+            AudioSinkCallback* callback) override;
+  bool start() override;
+  void stop() override;
+  void close() override;
+
+  const char* name() const override { return "alsa"; }
+  int32_t xrunCount() const override { return xruns_.load(); }
+
+ private:
+  void renderLoop();
+
+  std::string device_;
+  snd_pcm_t* pcm_ = nullptr;
+  AudioSinkCallback* callback_ = nullptr;
+  std::vector<float> buffer_;
+  std::thread thread_;
+  std::atomic<bool> running_{false};
+  std::atomic<int32_t> xruns_{0};
+};
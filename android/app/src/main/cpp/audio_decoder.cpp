@@ -0,0 +1,19 @@
+#include "audio_decoder.h"
+
+#ifdef __ANDROID__
+#include "ndk_decoder.h"
+#else
+#include "wav_decoder.h"
+#endif
+
+std::unique_ptr<AudioDecoder> createAudioDecoder(const std::string& path) {
+#ifdef __ANDROID__
+  std::unique_ptr<AudioDecoder> decoder = std::make_unique<NdkDecoder>();
+#else
+  std::unique_ptr<AudioDecoder> decoder = std::make_unique<WavDecoder>();
+#endif
+  if (!decoder->open(path)) {
+    return nullptr;
+  }
+  return decoder;
+}
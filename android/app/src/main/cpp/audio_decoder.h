@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+struct AudioFormatInfo {
+  int32_t sampleRate = 48000;
+  int32_t channelCount = 2;
+  int64_t durationUs = 0;
+};
+
+// Pull-based decoder producing interleaved float frames in [-1, 1].
+class AudioDecoder {
+ public:
+  virtual ~AudioDecoder() = default;
+
+  virtual bool open(const std::string& path) = 0;
+  // Positions the decoder so the next read starts at (or just after)
+  // positionUs.
+  virtual bool seekToUs(int64_t positionUs) = 0;
+  // Decodes up to maxFrames frames into dst. Returns the number of frames
+  // written, 0 when nothing is ready yet (check isEndOfStream()), or -1 on a
+  // decoder error.
+  virtual int32_t read(float* dst, int32_t maxFrames) = 0;
+
+  const AudioFormatInfo& format() const { return format_; }
+  bool isEndOfStream() const { return endOfStream_; }
+
+ protected:
+  AudioFormatInfo format_;
+  bool endOfStream_ = false;
+};
+
+// Creates and opens the platform decoder for path: MediaCodec on Android,
+// the built-in WAV reader elsewhere. Returns nullptr if the file cannot be
+// opened.
+std::unique_ptr<AudioDecoder> createAudioDecoder(const std::string& path);
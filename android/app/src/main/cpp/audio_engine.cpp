@@ -1,42 +1,79 @@
 #include "audio_engine.h"
 
-#include <android/log.h>
-#include <media/NdkMediaCodec.h>
-#include <media/NdkMediaExtractor.h>
-
 #include <algorithm>
 #include <chrono>
 #include <cmath>
-#include <cstdarg>
 #include <cstring>
+#include <utility>
+
+#include "audio_decoder.h"
+#include "denormals.h"
+#include "format_converter.h"
+#include "memory_usage.h"
+#include "native_log.h"
+#include "thread_config.h"
+#include "trace.h"
 
 namespace {
-constexpr char kTag[] = "SlowReverbEngine";
+// How long the decoder waits before retrying when the ring is full or the
+// source has ended.
+constexpr auto kDecodeBackoff = std::chrono::milliseconds(5);
+// Upper bound on opening the decoder and decoding the pre-roll.
+constexpr auto kDecoderStartTimeout = std::chrono::milliseconds(3000);
+// Anything quieter is treated as silence by the first-audio metric.
+constexpr float kAudibleThreshold = 1e-5f;
+// Bounds of the source audio held per deck. Within them a ring covers a
+// decoder stall of kRingStallSeconds plus a decode block, grown as the
+// decoder's margin over realtime shrinks, since it then refills slowly.
+constexpr double kMinRingSeconds = 0.5;
+constexpr double kMaxRingSeconds = 2.0;
+constexpr double kRingStallSeconds = 0.25;
+// Frames the decoder reads at a time.
+constexpr int32_t kDecodeFrames = 4096;
+// Weight of each decode block in the decoding speed average.
+constexpr float kDecodeSpeedSmoothing = 0.1f;
+// The fade starts once the outgoing track's last frame is in its ring, so
+// it has to fit in the ring with room for a decode block.
+constexpr float kMaxCrossfadeMs = 1500.0f;
+constexpr float kHalfPi = 1.57079632679f;
+constexpr float kMaxMonitorFadeMs = 1000.0f;
+// Position error, in source frames, the A/B follower branch tolerates
+// before skipping or padding; stays under SoundTouch's own jitter.
+constexpr double kAlignToleranceFrames = 256.0;
+// How long setImpulseResponse() waits for the audio thread to take a new
+// convolution reverb before leaving the old one to the next change.
+constexpr int kConvolutionInstallPolls = 40;
+// A replacement device can take a moment to appear after a route change.
+constexpr int kRecoveryAttempts = 10;
+constexpr auto kRecoveryBackoff = std::chrono::milliseconds(200);
 
-void loge(const char* fmt, ...) {
-  va_list args;
-  va_start(args, fmt);
-  __android_log_vprint(ANDROID_LOG_ERROR, kTag, fmt, args);
-  va_end(args);
+int64_t nanosSince(std::chrono::steady_clock::time_point origin) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now() - origin)
+      .count();
 }
 
-void logi(const char* fmt, ...) {
-  va_list args;
-  va_start(args, fmt);
-  __android_log_vprint(ANDROID_LOG_INFO, kTag, fmt, args);
-  va_end(args);
+int64_t steadyNanos() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
 }
 }  // namespace
 
-AudioEngine::AudioEngine() {
-  soundTouch_.setSetting(SETTING_USE_AA_FILTER, 1);
-  soundTouch_.setSetting(SETTING_USE_QUICKSEEK, 1);
-}
+AudioEngine::AudioEngine() : AudioEngine(AudioSinkType::kDefault) {}
+
+AudioEngine::AudioEngine(AudioSinkType sinkType)
+    : sink_(createAudioSink(sinkType)) {}
+
+AudioEngine::AudioEngine(std::unique_ptr<AudioSink> sink)
+    : sink_(std::move(sink)) {}
 
 AudioEngine::~AudioEngine() { stop(); }
 
 void AudioEngine::setTempo(double tempo) {
-  const float safe = std::clamp(static_cast<float>(tempo), 0.5f, 1.5f);
+  const float safe =
+      std::clamp(static_cast<float>(tempo), ProcessingChain::kMinTempo,
+                 ProcessingChain::kMaxTempo);
   targetTempo_.store(safe);
 }
 
@@ -64,429 +101,970 @@ void AudioEngine::setEcho(double echoMs) {
   targetEcho_.store(std::max(0.0f, static_cast<float>(echoMs)));
 }
 
+void AudioEngine::setWidth(double width) {
+  targetWidth_.store(std::clamp(static_cast<float>(width), 0.0f, 1.0f));
+}
+
+void AudioEngine::setStretchMode(StretchMode mode) {
+  stretchMode_.store(mode);
+}
+
+void AudioEngine::setPrerollMs(double prerollMs) {
+  prerollMs_.store(std::clamp(static_cast<float>(prerollMs), 0.0f, 1000.0f));
+}
+
+void AudioEngine::setMemoryBudget(int64_t bytes) {
+  memoryBudget_.store(std::max<int64_t>(0, bytes));
+}
+
+void AudioEngine::setRingFormat(RingSampleFormat format) {
+  ringFormat_.store(format);
+}
+
+void AudioEngine::seekToMs(double positionMs) {
+  seekRequestUs_.store(
+      static_cast<int64_t>(std::max(0.0, positionMs) * 1000.0));
+}
+
+void AudioEngine::setCrossfadeMs(double crossfadeMs) {
+  crossfadeMs_.store(
+      std::clamp(static_cast<float>(crossfadeMs), 0.0f, kMaxCrossfadeMs));
+}
+
+void AudioEngine::enqueue(const std::string& path) {
+  std::lock_guard<std::mutex> lock(queueMutex_);
+  queue_.push_back(path);
+  queuedTracks_.store(static_cast<int32_t>(queue_.size()));
+}
+
+void AudioEngine::clearQueue() {
+  std::lock_guard<std::mutex> lock(queueMutex_);
+  queue_.clear();
+  queuedTracks_.store(0);
+}
+
+void AudioEngine::setCompare(bool enabled, bool tempoMatched) {
+  compareTempoMatched_.store(tempoMatched);
+  if (enabled) {
+    std::lock_guard<std::mutex> lock(lifecycleMutex_);
+    // The audio thread leaves the dry branch alone until dryReady_ is set,
+    // so it can be built here while the stream runs.
+    if (running_.load() && sink_ && !dryReady_.load()) {
+      configureDryChain(sink_->sampleRate());
+    }
+  }
+  compareEnabled_.store(enabled);
+}
+
+void AudioEngine::configureDryChain(int32_t outputRate) {
+  dryChain_.configure(sampleRate_, outputRate, channelCount_, dryParameters());
+  dryChain_.prewarm(kRingChunkFrames);
+  dryBuffer_.resize(tempBuffer_.size());
+  recordDryChainMemory();
+  dryReady_.store(true, std::memory_order_release);
+}
+
+bool AudioEngine::setImpulseResponse(const std::string& path) {
+  std::shared_ptr<const ImpulseResponse> impulse;
+  if (!path.empty()) {
+    impulse = loadImpulseResponse(path);
+    if (!impulse) {
+      loge("Cannot read impulse response %s", path.c_str());
+      return false;
+    }
+  }
+  std::lock_guard<std::mutex> lock(lifecycleMutex_);
+  impulse_ = std::move(impulse);
+  if (running_.load() && sink_) {
+    delete pendingConvolution_.exchange(
+        makeConvolution(sink_->sampleRate()).release());
+    // Wait a few callbacks so the instance being replaced can be freed here
+    // rather than at the next change.
+    for (int poll = 0; poll < kConvolutionInstallPolls &&
+                       pendingConvolution_.load() != nullptr;
+         ++poll) {
+      std::this_thread::sleep_for(kDecodeBackoff);
+    }
+  }
+  delete retiredConvolution_.exchange(nullptr);
+  return true;
+}
+
+std::unique_ptr<ConvolutionReverb> AudioEngine::makeConvolution(
+    int32_t outputRate) {
+  auto convolution = std::make_unique<ConvolutionReverb>();
+  if (impulse_) {
+    convolution->configure(*impulse_, outputRate, channelCount_, true);
+  }
+  convolutionMemory_.store(static_cast<int64_t>(convolution->memoryBytes()));
+  return convolution;
+}
+
+void AudioEngine::installPendingConvolution() {
+  if (retiredConvolution_.load(std::memory_order_acquire) != nullptr) return;
+  ConvolutionReverb* next =
+      pendingConvolution_.exchange(nullptr, std::memory_order_acq_rel);
+  if (!next) return;
+  retiredConvolution_.store(
+      chain_.swapConvolution(std::unique_ptr<ConvolutionReverb>(next))
+          .release(),
+      std::memory_order_release);
+}
+
+void AudioEngine::releaseConvolutions() {
+  delete pendingConvolution_.exchange(nullptr);
+  delete retiredConvolution_.exchange(nullptr);
+}
+
+void AudioEngine::setMonitorDry(bool dry, double fadeMs) {
+  monitorFadeMs_.store(
+      std::clamp(static_cast<float>(fadeMs), 0.0f, kMaxMonitorFadeMs));
+  monitorDry_.store(dry);
+}
+
+bool AudioEngine::takeQueuedPath(std::string* path) {
+  std::lock_guard<std::mutex> lock(queueMutex_);
+  if (queue_.empty()) return false;
+  *path = std::move(queue_.front());
+  queue_.pop_front();
+  return true;
+}
+
 bool AudioEngine::start(const std::string& path) {
-  stop();
+  std::lock_guard<std::mutex> lock(lifecycleMutex_);
+  stopLocked();
+  startedAt_ = std::chrono::steady_clock::now();
+  startNs_.store(-1);
+  firstAudioNs_.store(-1);
+  startError_.store(StartError::kNone);
+  streamLost_.store(false);
+  streamRecoveries_.store(0);
+  recoveryNs_.store(-1);
   running_.store(true);
-  decoderReady_.store(false);
   playedFrames_.store(0);
   durationUs_.store(0);
-  decodeThread_ = std::thread(&AudioEngine::decodingLoop, this, path);
-  // wait for decoder to initialize sample rate
-  const auto timeout = std::chrono::steady_clock::now() +
-                       std::chrono::milliseconds(1500);
-  while (!decoderReady_.load() &&
-         std::chrono::steady_clock::now() < timeout) {
-    std::this_thread::sleep_for(std::chrono::milliseconds(20));
-  }
-  if (!decoderReady_.load()) {
+  callbackStats_.reset();
+  governor_.reset();
+  seekRequestUs_.store(-1);
+  seekRingMark_.store(-1);
+  activeDeck_.store(0);
+  trackIndex_.store(0);
+  inputFlushed_ = false;
+  endReported_ = false;
+  fading_ = false;
+  dryArmed_ = false;
+  monitorMix_ = 0.0f;
+  // The decoder fulfils the promise once the format is known and the
+  // pre-roll is in the ring, or as soon as it fails.
+  std::promise<bool> decoderReady;
+  std::future<bool> ready = decoderReady.get_future();
+  decks_[0].thread = std::thread(&AudioEngine::deckLoop, this, 0, path,
+                                 std::move(decoderReady));
+  if (ready.wait_for(kDecoderStartTimeout) != std::future_status::ready ||
+      !ready.get()) {
     loge("Decoder failed to initialize");
-    stop();
+    stopLocked();
+    startError_.store(StartError::kDecoder);
     return false;
   }
+  // Started only now so it sees the format the first track established.
+  decks_[1].thread = std::thread(&AudioEngine::deckLoop, this, 1,
+                                 std::string(), std::promise<bool>());
   if (!openStream(sampleRate_, channelCount_)) {
-    stop();
+    stopLocked();
+    startError_.store(StartError::kOutputStream);
     return false;
   }
-  reverb_.configure(sampleRate_, channelCount_);
-  wetMix_ = targetWet_.load();
-  decaySeconds_ = targetDecay_.load();
-  toneBalance_ = targetTone_.load();
-  roomSize_ = targetRoom_.load();
-  echoMs_ = targetEcho_.load();
-  reverb_.setParameters(wetMix_, decaySeconds_, toneBalance_, roomSize_,
-                        echoMs_);
-  currentTempo_ = targetTempo_.load();
-  pitchSemi_ = targetPitch_.load();
-  soundTouch_.setTempo(currentTempo_);
-  soundTouch_.setPitchSemiTones(pitchSemi_);
+  startNs_.store(nanosSince(startedAt_));
   return true;
 }
 
+void AudioEngine::setEndedListener(std::function<void()> listener) {
+  std::lock_guard<std::mutex> lock(lifecycleMutex_);
+  endedListener_ = std::move(listener);
+}
+
 void AudioEngine::stop() {
+  std::lock_guard<std::mutex> lock(lifecycleMutex_);
+  stopLocked();
+}
+
+void AudioEngine::stopLocked() {
   running_.store(false);
-  if (decodeThread_.joinable()) {
-    decodeThread_.join();
+  // Close the sink first: once it returns no callback is reading the ring
+  // or the chain, so both can be torn down.
+  closeStream();
+  for (Deck& deck : decks_) {
+    if (deck.thread.joinable()) deck.thread.join();
   }
+  telemetry_.reset();
+  ended_.store(false);
   playedFrames_.store(0);
   durationUs_.store(0);
-  ringWriteIndex_.store(0, std::memory_order_release);
-  ringReadIndex_.store(0, std::memory_order_release);
-  ringCapacityFrames_ = 0;
-  decodeRing_.clear();
-  closeStream();
-  soundTouch_.clear();
+  // Keep the rings' storage: the next start() with the same format reuses
+  // it.
+  for (Deck& deck : decks_) {
+    deck.ring.reset();
+    deck.finished.store(false);
+    deck.state.store(kDeckIdle);
+  }
+  clearQueue();
+  chain_.clear();
+  dryChain_.clear();
+  releaseConvolutions();
+}
+
+void AudioEngine::prepare(int32_t sampleRate, int32_t channelCount) {
+  std::lock_guard<std::mutex> lock(lifecycleMutex_);
+  if (running_.load()) return;
+  // The chain first, so the rings are sized against its memory.
+  chain_.configure(sampleRate, sampleRate, channelCount, targetParameters());
+  chain_.prewarm(kRingChunkFrames);
+  recordChainMemory();
+  initRingBuffers(sampleRate, channelCount);
+}
+
+void AudioEngine::restoreDefaults() {
+  const ChainParameters defaults;
+  targetTempo_.store(defaults.tempo);
+  targetPitch_.store(defaults.pitchSemi);
+  targetWet_.store(defaults.wet);
+  targetDecay_.store(defaults.decay);
+  targetTone_.store(defaults.tone);
+  targetRoom_.store(defaults.room);
+  targetEcho_.store(defaults.echoMs);
+  targetWidth_.store(defaults.width);
+  stretchMode_.store(defaults.stretch);
+  governor_.pin(QualityGovernor::kAuto);
+  prerollMs_.store(kDefaultPrerollMs);
+  memoryBudget_.store(0);
+  ringFormat_.store(RingSampleFormat::kFloat32);
+  crossfadeMs_.store(0.0f);
+  compareEnabled_.store(false);
+  compareTempoMatched_.store(true);
+  monitorDry_.store(false);
+  monitorFadeMs_.store(0.0f);
+  std::lock_guard<std::mutex> lock(lifecycleMutex_);
+  impulse_.reset();
+  endedListener_ = nullptr;
 }
 
 bool AudioEngine::openStream(int32_t sampleRate, int32_t channelCount) {
-  oboe::AudioStreamBuilder builder;
-  builder.setDirection(oboe::Direction::Output)
-      .setPerformanceMode(oboe::PerformanceMode::LowLatency)
-      .setSharingMode(oboe::SharingMode::Exclusive)
-      .setFormat(oboe::AudioFormat::Float)
-      .setSampleRate(sampleRate)
-      .setChannelCount(channelCount)
-      .setCallback(this)
-      .setErrorCallback(this);
-
-  oboe::AudioStream* stream = nullptr;
-  const auto result = builder.openStream(&stream);
-  if (result != oboe::Result::OK) {
-    loge("Failed to open audio stream: %s", oboe::convertToText(result));
+  if (!sink_) {
+    loge("No audio sink available on this platform");
     return false;
   }
-  stream_.reset(stream);
-  if (stream_->requestStart() != oboe::Result::OK) {
-    loge("Failed to start audio stream");
+  AudioSinkConfig config;
+  config.sampleRate = sampleRate;
+  config.channelCount = channelCount;
+  if (!sink_->open(config, this)) {
+    return false;
+  }
+  // Everything the callback touches is configured and primed here, before
+  // the sink starts, so the first callback already has processed audio.
+  const int32_t outputRate = sink_->sampleRate();
+  outputSampleRate_.store(outputRate);
+  chain_.configure(sampleRate, outputRate, channelCount, targetParameters());
+  chain_.prewarm(kRingChunkFrames);
+  if (impulse_) {
+    chain_.swapConvolution(makeConvolution(outputRate));
+  } else {
+    chain_.swapConvolution(nullptr);
+    convolutionMemory_.store(0);
+  }
+  tempBuffer_.resize(static_cast<size_t>(channelCount) *
+                     sink_->maxCallbackFrames());
+  recordChainMemory();
+  // Only built when compare is in use; setCompare() builds it later
+  // otherwise. Armed before the pre-roll so both branches start from the
+  // first frame.
+  dryReady_.store(false);
+  if (compareEnabled_.load()) {
+    configureDryChain(outputRate);
+    dryArmed_ = true;
+    restartDryChain();
+  }
+  feedChain(std::max(sink_->framesPerBurst(), sink_->maxCallbackFrames()));
+  if (!sink_->start()) {
+    loge("Failed to start %s sink", sink_->name());
     return false;
   }
-  tempBuffer_.resize(channelCount * stream_->getBufferCapacityInFrames());
   return true;
 }
 
-void AudioEngine::closeStream() {
-  if (stream_) {
-    stream_->stop();
-    stream_->close();
-    stream_.reset();
-  }
-}
-
-oboe::DataCallbackResult AudioEngine::onAudioReady(
-    oboe::AudioStream* stream,
-    void* audioData,
-    int32_t numFrames) {
-  float* out = static_cast<float*>(audioData);
-  int32_t framesRemaining = numFrames;
-  updateSmoothedParameters();
-
-  const int kChunk = 1024;
-  if (ringCapacityFrames_ > 0) {
-    ringScratch_.resize(static_cast<size_t>(kChunk) *
-                        static_cast<size_t>(channelCount_));
-    while (true) {
-      const int pulled =
-          popFromRing(ringScratch_.data(), kChunk);
-      if (pulled <= 0) break;
-      soundTouch_.putSamples(ringScratch_.data(), pulled);
-      if (pulled < kChunk) break;
+void AudioEngine::feedChain(int32_t outputFrames) {
+  // Feed SoundTouch only what the buffer needs so its FIFOs stay within the
+  // capacity reserved by ProcessingChain::prewarm(). The branch being
+  // switched to sets the pace.
+  const ProcessingChain& leader =
+      dryArmed_ && monitorDry_.load(std::memory_order_relaxed) ? dryChain_
+                                                               : chain_;
+  while (leader.availableFrames() < outputFrames) {
+    Deck& active = decks_[activeDeck_.load(std::memory_order_relaxed)];
+    if (active.ring.availableFrames() == 0 &&
+        active.finished.load(std::memory_order_acquire)) {
+      // Track boundary: the chain keeps its state, so the join is gapless
+      // and the reverb tail carries into the next track.
+      if (advanceDeck()) continue;
+      break;
     }
+    maybeStartCrossfade();
+    const int pulled = active.ring.pop(ringScratch_.data(), kRingChunkFrames);
+    if (pulled <= 0) break;
+    if (fading_) mixCrossfade(pulled);
+    putInput(ringScratch_.data(), pulled);
+  }
+  // The decoder only signals the end; flushing here keeps SoundTouch
+  // confined to the audio thread.
+  const Deck& active = decks_[activeDeck_.load(std::memory_order_relaxed)];
+  if (!inputFlushed_ && active.finished.load(std::memory_order_acquire) &&
+      active.ring.availableFrames() == 0 && !nextTrackPending()) {
+    chain_.flush();
+    if (dryArmed_) dryChain_.flush();
+    inputFlushed_ = true;
   }
+}
 
-  while (framesRemaining > 0) {
-    const int32_t received = soundTouch_.receiveSamples(
-        tempBuffer_.data(), framesRemaining);
-    if (received <= 0) {
-      std::fill(out, out + framesRemaining * channelCount_, 0.0f);
-      break;
-    }
-    reverb_.process(tempBuffer_.data(), received);
-    std::memcpy(out, tempBuffer_.data(),
-                sizeof(float) * received * channelCount_);
-    out += received * channelCount_;
-    framesRemaining -= received;
+void AudioEngine::putInput(const float* frames, int32_t count) {
+  // Both branches read the same decoded block.
+  chain_.putSamples(frames, count);
+  if (dryArmed_) dryChain_.putSamples(frames, count);
+}
+
+bool AudioEngine::nextTrackPending() const {
+  const Deck& next = decks_[1 - activeDeck_.load(std::memory_order_relaxed)];
+  // The queue count first: a deck takes a path before the count drops.
+  return queuedTracks_.load() > 0 || next.state.load() != kDeckIdle;
+}
+
+void AudioEngine::maybeStartCrossfade() {
+  if (fading_) return;
+  const float crossfadeMs = crossfadeMs_.load(std::memory_order_relaxed);
+  if (crossfadeMs <= 0.0f) return;
+  const int active = activeDeck_.load(std::memory_order_relaxed);
+  const Deck& outgoing = decks_[active];
+  if (!outgoing.finished.load(std::memory_order_acquire)) return;
+  if (decks_[1 - active].state.load(std::memory_order_acquire) !=
+      kDeckReady) {
+    return;
   }
+  const int64_t remaining =
+      static_cast<int64_t>(outgoing.ring.availableFrames());
+  const int64_t fadeFrames =
+      static_cast<int64_t>(crossfadeMs * sampleRate_ / 1000.0f);
+  if (remaining == 0 || remaining > fadeFrames) return;
+  // If the next track became ready late, fade over what is left.
+  fading_ = true;
+  fadeFrames_ = remaining;
+  fadePosition_ = 0;
+}
 
-  playedFrames_.fetch_add(numFrames);
-  return oboe::DataCallbackResult::Continue;
+void AudioEngine::mixCrossfade(int32_t frames) {
+  Deck& incoming = decks_[1 - activeDeck_.load(std::memory_order_relaxed)];
+  const int pulled = std::max(0, incoming.ring.pop(fadeScratch_.data(), frames));
+  // A decoder that falls behind leaves a short hole, not a stall.
+  std::fill(fadeScratch_.begin() + static_cast<size_t>(pulled) * channelCount_,
+            fadeScratch_.begin() + static_cast<size_t>(frames) * channelCount_,
+            0.0f);
+  const float step = 1.0f / static_cast<float>(fadeFrames_);
+  for (int32_t frame = 0; frame < frames; ++frame) {
+    const float t = std::min(
+        1.0f, (static_cast<float>(fadePosition_ + frame) + 0.5f) * step);
+    // Equal power: the gains' squares sum to one across the fade.
+    const float outGain = std::cos(t * kHalfPi);
+    const float inGain = std::sin(t * kHalfPi);
+    float* out = ringScratch_.data() + static_cast<size_t>(frame) * channelCount_;
+    const float* in =
+        fadeScratch_.data() + static_cast<size_t>(frame) * channelCount_;
+    for (int32_t ch = 0; ch < channelCount_; ++ch) {
+      out[ch] = out[ch] * outGain + in[ch] * inGain;
+    }
+  }
+  fadePosition_ += frames;
 }
 
-void AudioEngine::onErrorAfterClose(oboe::AudioStream*,
-                                    oboe::Result error) {
-  loge("Stream error: %s", oboe::convertToText(error));
+bool AudioEngine::advanceDeck() {
+  const int active = activeDeck_.load(std::memory_order_relaxed);
+  Deck& next = decks_[1 - active];
+  if (next.state.load(std::memory_order_acquire) != kDeckReady) return false;
+  // The faded-in part of the next track has already played.
+  const int64_t playedSourceFrames = fading_ ? fadePosition_ : 0;
+  fading_ = false;
+  inputFlushed_ = false;
+  endReported_ = false;
+  decks_[active].state.store(kDeckDone, std::memory_order_release);
+  activeDeck_.store(1 - active, std::memory_order_release);
+  durationUs_.store(next.durationUs);
+  playedFrames_.store(playedSourceFrames *
+                      outputSampleRate_.load(std::memory_order_relaxed) /
+                      sampleRate_);
+  trackIndex_.fetch_add(1);
+  return true;
 }
 
-double AudioEngine::currentPositionMs() const {
-  const int64_t frames = playedFrames_.load();
-  if (sampleRate_ <= 0) return 0.0;
-  return static_cast<double>(frames) * 1000.0 /
-         static_cast<double>(sampleRate_);
+void AudioEngine::closeStream() {
+  if (sink_) sink_->close();
 }
 
-double AudioEngine::durationMs() const {
-  return static_cast<double>(durationUs_.load()) / 1000.0;
+void AudioEngine::onSinkError(const char* message) {
+  // Oboe reports from its own thread once the stream is closed, ALSA from
+  // its render thread just before it exits; neither may reopen the stream
+  // itself.
+  if (!running_.load() || streamLost_.exchange(true)) return;
+  lostAtNs_.store(steadyNanos());
+  loge("Output stream lost (%s), reopening", message ? message : "");
+  recovery_.post([this] { recoverStream(); });
 }
 
-float AudioEngine::smoothTowards(float current, float target, float factor) {
-  const float delta = target - current;
-  if (std::fabs(delta) < 1e-4f) {
-    return target;
-  }
-  return current + delta * factor;
-}
-
-void AudioEngine::updateSmoothedParameters() {
-  constexpr float kTempoSmooth = 0.12f;
-  constexpr float kReverbSmooth = 0.08f;
-
-  const float tempoTarget = targetTempo_.load();
-  const float pitchTarget = targetPitch_.load();
-  const float tempoNext =
-      smoothTowards(currentTempo_, tempoTarget, kTempoSmooth);
-  const float pitchNext =
-      smoothTowards(pitchSemi_, pitchTarget, kTempoSmooth);
-  const bool tempoChanged = std::fabs(tempoNext - currentTempo_) > 5e-4f;
-  const bool pitchChanged = std::fabs(pitchNext - pitchSemi_) > 5e-4f;
-  if (tempoChanged || pitchChanged) {
-    std::lock_guard<std::mutex> lock(soundTouchMutex_);
-    if (tempoChanged) {
-      soundTouch_.setTempo(tempoNext);
-      currentTempo_ = tempoNext;
-    } else {
-      currentTempo_ = tempoNext;
+void AudioEngine::recoverStream() {
+  for (int attempt = 0; attempt < kRecoveryAttempts; ++attempt) {
+    if (attempt > 0) std::this_thread::sleep_for(kRecoveryBackoff);
+    // Retaken per attempt so stop() is never held up by the backoff.
+    std::lock_guard<std::mutex> lock(lifecycleMutex_);
+    if (!running_.load() || !streamLost_.load()) return;
+    if (reopenStream()) {
+      const int64_t recoveryNs = steadyNanos() - lostAtNs_.load();
+      recoveryNs_.store(recoveryNs);
+      streamRecoveries_.fetch_add(1);
+      streamLost_.store(false);
+      logi("Output stream reopened at %d Hz after %.1f ms",
+           outputSampleRate_.load(), recoveryNs / 1e6);
+      return;
     }
-    if (pitchChanged) {
-      soundTouch_.setPitchSemiTones(pitchNext);
-      pitchSemi_ = pitchNext;
-    } else {
-      pitchSemi_ = pitchNext;
+  }
+  loge("Could not reopen the output stream");
+}
+
+bool AudioEngine::reopenStream() {
+  // The sink may still hold the dead stream.
+  closeStream();
+  AudioSinkConfig config;
+  config.sampleRate = sampleRate_;
+  config.channelCount = channelCount_;
+  if (!sink_ || !sink_->open(config, this)) return false;
+  // No callback runs until the sink starts, so the audio thread's state
+  // can be adjusted here.
+  const int32_t previousRate = outputSampleRate_.load();
+  const int32_t outputRate = sink_->sampleRate();
+  if (outputRate != previousRate) {
+    chain_.setOutputRate(outputRate);
+    if (dryReady_.load()) dryChain_.setOutputRate(outputRate);
+    if (impulse_) {
+      delete pendingConvolution_.exchange(nullptr);
+      chain_.swapConvolution(makeConvolution(outputRate));
     }
+    playedFrames_.store(playedFrames_.load() * outputRate / previousRate);
+    outputSampleRate_.store(outputRate);
+  }
+  const size_t callbackSamples =
+      static_cast<size_t>(channelCount_) * sink_->maxCallbackFrames();
+  if (tempBuffer_.size() < callbackSamples) {
+    tempBuffer_.resize(callbackSamples);
+    if (dryReady_.load()) dryBuffer_.resize(callbackSamples);
+  }
+  recordChainMemory();
+  if (dryReady_.load()) recordDryChainMemory();
+  if (!sink_->start()) {
+    loge("Failed to restart %s sink", sink_->name());
+    return false;
+  }
+  return true;
+}
+
+bool AudioEngine::onRender(float* out, int32_t numFrames) {
+  SLOWREVERB_TRACE_SCOPE("AudioEngine::onRender");
+  const auto callbackStart = std::chrono::steady_clock::now();
+  const ScopedFlushDenormals flushDenormals;
+  float* const buffer = out;
+  const int64_t bypassedBefore = chain_.bypassedFrames();
+  installPendingConvolution();
+  chain_.setTargets(targetParameters());
+  chain_.setQualityTier(governor_.tier());
+  updateCompare();
+  applyPendingSeek();
+
+  const Deck& active = decks_[activeDeck_.load(std::memory_order_relaxed)];
+  if (active.ring.capacityFrames() > 0) feedChain(numFrames);
+
+  int32_t framesRemaining = 0;
+  if (!dryArmed_) {
+    framesRemaining = renderBranch(chain_, out, numFrames);
   } else {
-    currentTempo_ = tempoNext;
-    pitchSemi_ = pitchNext;
-  }
-
-  const float wetNext = smoothTowards(wetMix_, targetWet_.load(), kReverbSmooth);
-  const float decayNext =
-      smoothTowards(decaySeconds_, targetDecay_.load(), kReverbSmooth);
-  const float toneNext =
-      smoothTowards(toneBalance_, targetTone_.load(), kReverbSmooth);
-  const float roomNext =
-      smoothTowards(roomSize_, targetRoom_.load(), kReverbSmooth);
-  const float echoNext =
-      smoothTowards(echoMs_, targetEcho_.load(), kReverbSmooth);
-
-  const bool reverbNeedsUpdate =
-      std::fabs(wetNext - wetMix_) > 5e-4f ||
-      std::fabs(decayNext - decaySeconds_) > 5e-4f ||
-      std::fabs(toneNext - toneBalance_) > 5e-4f ||
-      std::fabs(roomNext - roomSize_) > 5e-4f ||
-      std::fabs(echoNext - echoMs_) > 5e-4f;
-
-  if (reverbNeedsUpdate) {
-    wetMix_ = wetNext;
-    decaySeconds_ = decayNext;
-    toneBalance_ = toneNext;
-    roomSize_ = roomNext;
-    echoMs_ = echoNext;
-    reverb_.setParameters(wetMix_, decaySeconds_, toneBalance_, roomSize_,
-                          echoMs_);
-  }
-}
-
-void AudioEngine::initRingBuffer(int32_t sampleRate, int32_t channels) {
-  ringCapacityFrames_ = static_cast<size_t>(sampleRate) * 2;  // ~2 seconds
-  const size_t samples = ringCapacityFrames_ * static_cast<size_t>(channels);
-  decodeRing_.assign(samples, 0.0f);
-  ringScratch_.clear();
-  decoderScratch_.clear();
-  ringWriteIndex_.store(0, std::memory_order_release);
-  ringReadIndex_.store(0, std::memory_order_release);
-}
-
-void AudioEngine::writeFrames(int64_t frameIndex,
-                              const float* src,
-                              int frames) {
-  if (frames <= 0 || ringCapacityFrames_ == 0) return;
-  const size_t capacity = ringCapacityFrames_;
-  const size_t channels = static_cast<size_t>(channelCount_);
-  size_t head = static_cast<size_t>(frameIndex % static_cast<int64_t>(capacity));
-  size_t framesToEnd = capacity - head;
-  int firstFrames = std::min<int>(frames, static_cast<int>(framesToEnd));
-  size_t samplesFirst = static_cast<size_t>(firstFrames) * channels;
-  std::memcpy(
-      decodeRing_.data() + head * channels, src,
-      samplesFirst * sizeof(float));
-  int remainingFrames = frames - firstFrames;
-  if (remainingFrames > 0) {
-    std::memcpy(
-        decodeRing_.data(),
-        src + samplesFirst,
-        static_cast<size_t>(remainingFrames) * channels * sizeof(float));
-  }
-}
-
-void AudioEngine::readFrames(int64_t frameIndex,
-                             float* dst,
-                             int frames) {
-  if (frames <= 0 || ringCapacityFrames_ == 0) return;
-  const size_t capacity = ringCapacityFrames_;
-  const size_t channels = static_cast<size_t>(channelCount_);
-  size_t tail = static_cast<size_t>(frameIndex % static_cast<int64_t>(capacity));
-  size_t framesToEnd = capacity - tail;
-  int firstFrames = std::min<int>(frames, static_cast<int>(framesToEnd));
-  size_t samplesFirst = static_cast<size_t>(firstFrames) * channels;
-  std::memcpy(
-      dst,
-      decodeRing_.data() + tail * channels,
-      samplesFirst * sizeof(float));
-  int remainingFrames = frames - firstFrames;
-  if (remainingFrames > 0) {
-    std::memcpy(
-        dst + samplesFirst,
-        decodeRing_.data(),
-        static_cast<size_t>(remainingFrames) * channels * sizeof(float));
-  }
-}
-
-int AudioEngine::pushToRing(const float* data, int frames) {
-  if (ringCapacityFrames_ == 0 || frames <= 0) return 0;
-  const size_t capacity = ringCapacityFrames_;
-  if (frames > static_cast<int>(capacity)) {
-    const int skip = frames - static_cast<int>(capacity);
-    data += skip * channelCount_;
-    frames = static_cast<int>(capacity);
-  }
-  auto write = ringWriteIndex_.load(std::memory_order_relaxed);
-  auto read = ringReadIndex_.load(std::memory_order_acquire);
-  size_t used = static_cast<size_t>(write - read);
-  const size_t freeSpace = capacity > used ? capacity - used : 0;
-  if (static_cast<size_t>(frames) > freeSpace) {
-    const size_t drop = static_cast<size_t>(frames) - freeSpace;
-    ringReadIndex_.fetch_add(static_cast<int64_t>(drop),
-                             std::memory_order_acq_rel);
-    read += static_cast<int64_t>(drop);
-    used -= std::min(used, drop);
-  }
-  writeFrames(write, data, frames);
-  ringWriteIndex_.store(write + frames, std::memory_order_release);
-  return frames;
-}
-
-int AudioEngine::popFromRing(float* dst, int maxFrames) {
-  if (ringCapacityFrames_ == 0 || maxFrames <= 0) return 0;
-  auto write = ringWriteIndex_.load(std::memory_order_acquire);
-  auto read = ringReadIndex_.load(std::memory_order_relaxed);
-  int64_t available = write - read;
-  if (available <= 0) return 0;
-  const int frames = std::min<int>(maxFrames, static_cast<int>(available));
-  readFrames(read, dst, frames);
-  ringReadIndex_.fetch_add(frames, std::memory_order_release);
-  return frames;
-}
-
-void AudioEngine::decodingLoop(const std::string& path) {
-  AMediaExtractor* extractor = AMediaExtractor_new();
-  if (!extractor) {
-    loge("Failed to create extractor");
-    return;
+    // The branch being switched to leads; the other follows its position.
+    const bool dryLeads = monitorDry_.load(std::memory_order_relaxed);
+    ProcessingChain& leader = dryLeads ? dryChain_ : chain_;
+    ProcessingChain& follower = dryLeads ? chain_ : dryChain_;
+    float* const dry = dryBuffer_.data();
+    const double leaderSource = branchSource(leader);
+    framesRemaining = renderBranch(leader, dryLeads ? dry : out, numFrames);
+    renderFollower(follower, leaderSource, dryLeads ? out : dry, numFrames);
+    mixMonitor(out, numFrames, dryLeads);
   }
-  if (AMediaExtractor_setDataSource(extractor, path.c_str()) != AMEDIA_OK) {
-    loge("Failed to set data source %s", path.c_str());
-    AMediaExtractor_delete(extractor);
-    return;
+
+  playedFrames_.fetch_add(numFrames);
+  // The chain has run dry after its final flush: nothing is queued.
+  if (inputFlushed_ && framesRemaining > 0 && !endReported_) {
+    endReported_ = true;
+    ended_.store(true, std::memory_order_release);
   }
-  AMediaCodec* codec = nullptr;
-  const char* mime = nullptr;
-  int32_t channels = 2;
-  int32_t sampleRate = 48000;
-
-  const size_t trackCount = AMediaExtractor_getTrackCount(extractor);
-  for (size_t i = 0; i < trackCount; ++i) {
-    AMediaFormat* format = AMediaExtractor_getTrackFormat(extractor, i);
-    const char* formatMime = nullptr;
-    if (AMediaFormat_getString(format, AMEDIAFORMAT_KEY_MIME,
-                               &formatMime) &&
-        strncmp(formatMime, "audio/", 6) == 0) {
-      AMediaExtractor_selectTrack(extractor, i);
-      mime = formatMime;
-      AMediaFormat_getInt32(format, AMEDIAFORMAT_KEY_CHANNEL_COUNT, &channels);
-      AMediaFormat_getInt32(format, AMEDIAFORMAT_KEY_SAMPLE_RATE, &sampleRate);
-      int64_t durationValue = 0;
-      if (AMediaFormat_getInt64(format, AMEDIAFORMAT_KEY_DURATION,
-                                &durationValue)) {
-        durationUs_.store(durationValue);
-      }
-      codec = AMediaCodec_createDecoderByType(mime);
-      if (codec &&
-          AMediaCodec_configure(codec, format, nullptr, nullptr, 0) ==
-              AMEDIA_OK) {
-        AMediaCodec_start(codec);
-        AMediaFormat_delete(format);
+  const int32_t outputRate = outputSampleRate_.load(std::memory_order_relaxed);
+  telemetry_.update(out, numFrames, channelCount_, outputRate,
+                    chain_.reverbEnergy(), currentPositionMs(), durationMs());
+  if (firstAudioNs_.load(std::memory_order_relaxed) < 0) {
+    const int32_t samples = (numFrames - framesRemaining) * channelCount_;
+    for (int32_t i = 0; i < samples; ++i) {
+      if (std::fabs(buffer[i]) > kAudibleThreshold) {
+        firstAudioNs_.store(nanosSince(startedAt_), std::memory_order_relaxed);
         break;
       }
-      if (codec) {
-        AMediaCodec_delete(codec);
-        codec = nullptr;
-      }
     }
-    AMediaFormat_delete(format);
   }
+  const int64_t elapsedNs =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now() - callbackStart)
+          .count();
+  if (outputRate > 0) {
+    governor_.update(elapsedNs, numFrames * 1000000000LL / outputRate);
+  }
+  // Silence after the flushed tail is the end of the track, not an underflow.
+  callbackStats_.record(elapsedNs, numFrames, outputRate,
+                        inputFlushed_ ? 0 : framesRemaining,
+                        static_cast<int32_t>(
+                            decks_[activeDeck_.load(std::memory_order_relaxed)]
+                                .ring.availableFrames()),
+                        chain_.availableFrames(),
+                        static_cast<int32_t>(chain_.bypassedFrames() -
+                                             bypassedBefore));
+  return true;
+}
+
+int32_t AudioEngine::renderBranch(ProcessingChain& chain,
+                                  float* out,
+                                  int32_t numFrames) {
+  // The chain serves any block size from its quanta, so this takes all it
+  // has in one call.
+  const int32_t received = chain.receiveSamples(out, numFrames);
+  std::fill(out + received * channelCount_, out + numFrames * channelCount_,
+            0.0f);
+  return numFrames - received;
+}
+
+void AudioEngine::renderFollower(ProcessingChain& chain,
+                                  double leaderSource,
+                                  float* out,
+                                  int32_t numFrames) {
+  const double sourcePerOutput = 1.0 / chain.outputFramesPerInputFrame();
+  const double lead = branchSource(chain) - leaderSource;
+  int32_t padding = 0;
+  if (lead < -kAlignToleranceFrames) {
+    // Behind: drop output, through the reverb so its state keeps up.
+    const int32_t scratchFrames =
+        static_cast<int32_t>(tempBuffer_.size()) / channelCount_;
+    int32_t skip = static_cast<int32_t>(-lead / sourcePerOutput);
+    while (skip > 0) {
+      const int32_t received = chain.receiveSamples(
+          tempBuffer_.data(), std::min(skip, scratchFrames));
+      if (received <= 0) break;
+      skip -= received;
+    }
+  } else if (lead > kAlignToleranceFrames) {
+    // Ahead: hold output back until the leader catches up.
+    padding = std::min(numFrames, static_cast<int32_t>(lead / sourcePerOutput));
+    std::fill(out, out + static_cast<size_t>(padding) * channelCount_, 0.0f);
+  }
+  renderBranch(chain, out + static_cast<size_t>(padding) * channelCount_,
+               numFrames - padding);
+}
 
-  if (!codec) {
-    loge("Failed to initialize decoder for %s", path.c_str());
-    AMediaExtractor_delete(extractor);
+void AudioEngine::mixMonitor(float* out, int32_t numFrames, bool dryLeads) {
+  const float target = dryLeads ? 1.0f : 0.0f;
+  if (monitorMix_ == target && target == 0.0f) return;
+  if (monitorMix_ == target) {
+    std::memcpy(out, dryBuffer_.data(),
+                sizeof(float) * numFrames * channelCount_);
     return;
   }
+  const float fadeFrames = monitorFadeMs_.load(std::memory_order_relaxed) *
+                           outputSampleRate_.load(std::memory_order_relaxed) /
+                           1000.0f;
+  const float step = fadeFrames >= 1.0f ? 1.0f / fadeFrames : 1.0f;
+  for (int32_t frame = 0; frame < numFrames; ++frame) {
+    monitorMix_ = dryLeads ? std::min(1.0f, monitorMix_ + step)
+                           : std::max(0.0f, monitorMix_ - step);
+    // Equal power, as for the track crossfade.
+    const float processedGain = std::cos(monitorMix_ * kHalfPi);
+    const float dryGain = std::sin(monitorMix_ * kHalfPi);
+    float* frameOut = out + static_cast<size_t>(frame) * channelCount_;
+    const float* dry =
+        dryBuffer_.data() + static_cast<size_t>(frame) * channelCount_;
+    for (int32_t ch = 0; ch < channelCount_; ++ch) {
+      frameOut[ch] = frameOut[ch] * processedGain + dry[ch] * dryGain;
+    }
+  }
+}
+
+double AudioEngine::branchSource(const ProcessingChain& chain) const {
+  const double origin = &chain == &dryChain_ ? dryOrigin_ : 0.0;
+  return origin + chain.nextOutputSourceFrame();
+}
+
+void AudioEngine::updateCompare() {
+  const bool enabled = compareEnabled_.load(std::memory_order_relaxed) &&
+                       dryReady_.load(std::memory_order_acquire);
+  if (enabled && !dryArmed_) {
+    dryArmed_ = true;
+    restartDryChain();
+  } else if (!enabled && dryArmed_) {
+    dryArmed_ = false;
+    monitorMix_ = 0.0f;
+  }
+  if (dryArmed_) {
+    dryChain_.setTargets(dryParameters());
+    dryChain_.setQualityTier(chain_.qualityTier());
+  }
+}
+
+void AudioEngine::restartDryChain() {
+  dryChain_.clear();
+  ChainParameters params = dryParameters();
+  if (compareTempoMatched_.load(std::memory_order_relaxed)) {
+    params.tempo = chain_.current().tempo;
+  }
+  dryChain_.setParameters(params);
+  // Its first output is the next decoded frame, which chain_ plays only
+  // after what it already holds; renderFollower() pads for the difference.
+  dryOrigin_ = chain_.inputFrames();
+}
+
+void AudioEngine::applyPendingSeek() {
+  const int64_t mark = seekRingMark_.exchange(-1, std::memory_order_acq_rel);
+  if (mark < 0) return;
+  const int active = activeDeck_.load(std::memory_order_relaxed);
+  // A seek taken just before a track change belongs to the old track.
+  if (seekDeck_.load(std::memory_order_relaxed) != active) return;
+  decks_[active].ring.discardUntil(mark);
+  chain_.clear();
+  if (dryArmed_) restartDryChain();
+  inputFlushed_ = false;
+  endReported_ = false;
+  fading_ = false;
+  const int64_t positionUs = seekPositionUs_.load(std::memory_order_relaxed);
+  playedFrames_.store(positionUs *
+                      outputSampleRate_.load(std::memory_order_relaxed) /
+                      1000000);
+}
+
+EngineStats AudioEngine::stats() const {
+  std::lock_guard<std::mutex> lock(lifecycleMutex_);
+  EngineStats stats;
+  stats.callback = callbackStats_.snapshot();
+  stats.xrunCount = sink_ ? sink_->xrunCount() : -1;
+  stats.framesPerBurst = sink_ ? sink_->framesPerBurst() : 0;
+  stats.sampleRate = outputSampleRate_.load();
+  stats.ringCapacityFrames = decks_[0].ringFrames.load();
+  stats.qualityTier = governor_.tier();
+  const int64_t startNs = startNs_.load();
+  const int64_t firstAudioNs = firstAudioNs_.load();
+  stats.startMs = startNs >= 0 ? startNs / 1e6 : -1.0;
+  stats.firstAudioMs = firstAudioNs >= 0 ? firstAudioNs / 1e6 : -1.0;
+  stats.streamRecoveries = streamRecoveries_.load();
+  const int64_t recoveryNs = recoveryNs_.load();
+  stats.recoveryMs = recoveryNs >= 0 ? recoveryNs / 1e6 : -1.0;
+  stats.decodeNice = decodeNice_.load();
+  stats.decodePrioritized = decodePrioritized_.load();
+  stats.decodePinned = decodePinned_.load();
+  stats.performanceCores = performanceCores();
+  stats.pinToPerformanceCores = pinToPerformanceCores();
+  return stats;
+}
+
+EngineMemory AudioEngine::memory() const {
+  EngineMemory memory;
+  memory.budgetBytes = memoryBudget_.load();
+  for (const Deck& deck : decks_) memory.ringBytes += deck.ringBytes.load();
+  memory.chainBytes = chainMemory();
+  memory.totalBytes = memory.ringBytes + memory.chainBytes;
+  const Deck& active = decks_[activeDeck_.load()];
+  memory.ringFrames = active.ringFrames.load();
+  memory.ringFormat = active.ringFormat.load();
+  memory.ringMs = active.ringMs.load();
+  memory.decodeSpeed = decodeSpeed_.load();
+  for (const ProcessingChain* chain : {&chain_, &dryChain_}) {
+    const DspArena& arena = chain->arena();
+    memory.arenaBytes += static_cast<int64_t>(arena.capacityBytes());
+    memory.arenaPeakBytes += static_cast<int64_t>(arena.peakBytes());
+    memory.arenaOverflows += arena.overflows();
+  }
+  return memory;
+}
+
+void AudioEngine::recordChainMemory() {
+  chainMemory_.store(static_cast<int64_t>(
+      chain_.memoryBytes() + vectorBytes(tempBuffer_) +
+      vectorBytes(ringScratch_) + vectorBytes(fadeScratch_)));
+}
+
+void AudioEngine::recordDryChainMemory() {
+  dryChainMemory_.store(static_cast<int64_t>(dryChain_.memoryBytes() +
+                                             vectorBytes(dryBuffer_)));
+}
+
+int64_t AudioEngine::chainMemory() const {
+  return chainMemory_.load() + dryChainMemory_.load() +
+         convolutionMemory_.load();
+}
+
+double AudioEngine::currentPositionMs() const {
+  const int64_t frames = playedFrames_.load();
+  const int32_t rate = outputSampleRate_.load();
+  if (rate <= 0) return 0.0;
+  return static_cast<double>(frames) * 1000.0 / static_cast<double>(rate);
+}
+
+double AudioEngine::durationMs() const {
+  return static_cast<double>(durationUs_.load()) / 1000.0;
+}
+
+ChainParameters AudioEngine::targetParameters() const {
+  ChainParameters params;
+  params.tempo = targetTempo_.load();
+  params.pitchSemi = targetPitch_.load();
+  params.wet = targetWet_.load();
+  params.decay = targetDecay_.load();
+  params.tone = targetTone_.load();
+  params.room = targetRoom_.load();
+  params.echoMs = targetEcho_.load();
+  params.width = targetWidth_.load();
+  params.stretch = stretchMode_.load();
+  return params;
+}
+
+ChainParameters AudioEngine::dryParameters() const {
+  ChainParameters params;
+  // Smoothed towards the same target as chain_, so once aligned the two
+  // follow the same tempo curve.
+  params.tempo = compareTempoMatched_.load(std::memory_order_relaxed)
+                     ? targetTempo_.load(std::memory_order_relaxed)
+                     : 1.0f;
+  params.pitchSemi = 0.0f;
+  params.wet = 0.0f;
+  // Same stretcher, so a tempo-matched dry branch covers the same range.
+  params.stretch = stretchMode_.load(std::memory_order_relaxed);
+  return params;
+}
+
+void AudioEngine::initRingBuffers(int32_t sampleRate, int32_t channels) {
+  for (Deck& deck : decks_) configureRing(deck, sampleRate, channels);
+  ringScratch_.assign(static_cast<size_t>(kRingChunkFrames) * channels, 0.0f);
+  fadeScratch_.assign(ringScratch_.size(), 0.0f);
+}
+
+void AudioEngine::configureRing(Deck& deck,
+                                int32_t sampleRate,
+                                int32_t channels) {
+  const double blockSeconds = static_cast<double>(kDecodeFrames) / sampleRate;
+  const double floorSeconds = std::min(
+      kMaxRingSeconds,
+      std::max({kMinRingSeconds,
+                crossfadeMs_.load() / 1000.0 + blockSeconds,
+                prerollMs_.load() / 1000.0 + blockSeconds}));
+  const float speed = decodeSpeed_.load();
+  double seconds = kMaxRingSeconds;
+  if (speed > 1.0f) {
+    seconds = kRingStallSeconds * speed / (speed - 1.0f) + blockSeconds;
+  }
+  seconds = std::clamp(seconds, floorSeconds, kMaxRingSeconds);
+  size_t frames = static_cast<size_t>(std::ceil(seconds * sampleRate));
+  RingSampleFormat format = ringFormat_.load();
+  const int64_t budget = memoryBudget_.load();
+  if (budget > 0) {
+    // Split evenly: either deck may hold the longer track.
+    const size_t deckBytes =
+        static_cast<size_t>(std::max<int64_t>(0, budget - chainMemory()) / 2);
+    const auto fitting = [&](RingSampleFormat candidate) {
+      return deckBytes / (static_cast<size_t>(channels) *
+                          DecodeRing::bytesPerSample(candidate));
+    };
+    if (format == RingSampleFormat::kFloat32 &&
+        fitting(format) < frames) {
+      format = RingSampleFormat::kFloat16;
+    }
+    const size_t floorFrames =
+        static_cast<size_t>(std::ceil(floorSeconds * sampleRate));
+    frames = std::max(floorFrames, std::min(frames, fitting(format)));
+  }
+  if (deck.ring.capacityFrames() != frames ||
+      deck.ring.channelCount() != channels || deck.ring.format() != format) {
+    deck.ring.configure(frames, channels, format);
+  }
+  deck.ringBytes.store(static_cast<int64_t>(deck.ring.memoryBytes()));
+  deck.ringFrames.store(static_cast<int32_t>(frames));
+  deck.ringFormat.store(format);
+  deck.ringMs.store(static_cast<float>(frames * 1000.0 / sampleRate));
+}
 
-  channelCount_ = std::max(1, channels);
-  sampleRate_ = std::max(8000, sampleRate);
-  soundTouch_.setChannels(channelCount_);
-  soundTouch_.setSampleRate(sampleRate_);
-  soundTouch_.setTempo(currentTempo_);
-  soundTouch_.setPitchSemiTones(pitchSemi_);
-  initRingBuffer(sampleRate_, channelCount_);
-  decoderReady_.store(true);
+void AudioEngine::deckLoop(int index,
+                           std::string path,
+                           std::promise<bool> ready) {
+  const ThreadPlacement placement = applyThreadRole(
+      ThreadRole::kDecode, index == 0 ? "sr-decode-0" : "sr-decode-1");
+  decodeNice_.store(placement.nice);
+  decodePrioritized_.store(placement.prioritized);
+  decodePinned_.store(placement.pinned);
+  const ScopedFlushDenormals flushDenormals;
+  Deck& deck = decks_[index];
+  // Only the start() track signals; deck 1 gets an empty path.
+  bool signalled = path.empty();
+  std::unique_ptr<AudioDecoder> decoder;
+  FormatConverter converter;
+  size_t prerollFrames = 0;
 
-  const size_t bufferCapacity = 4096 * channelCount_;
-  std::vector<float> floatBuffer(bufferCapacity);
+  std::vector<float> floatBuffer;
+  const float* pending = nullptr;
+  int32_t pendingFrames = 0;
+  int32_t pushedFrames = 0;
+  bool endOfStream = false;
 
-  AMediaCodecBufferInfo info;
-  bool extractorEos = false;
+  // The ring applies back-pressure: the decoder waits for the callback to
+  // make room instead of overwriting audio it may be reading.
   while (running_.load()) {
-    if (!extractorEos) {
-      const ssize_t inputIndex = AMediaCodec_dequeueInputBuffer(codec, 10000);
-      if (inputIndex >= 0) {
-        size_t bufSize = 0;
-        auto* buffer = AMediaCodec_getInputBuffer(codec, inputIndex, &bufSize);
-        const int sampleSize =
-            AMediaExtractor_readSampleData(extractor, buffer, bufSize);
-        const int64_t presentationTimeUs =
-            AMediaExtractor_getSampleTime(extractor);
-        if (sampleSize < 0) {
-          extractorEos = true;
-          AMediaCodec_queueInputBuffer(
-              codec, inputIndex, 0, 0, 0,
-              AMEDIACODEC_BUFFER_FLAG_END_OF_STREAM);
-        } else {
-          AMediaCodec_queueInputBuffer(codec, inputIndex, 0, sampleSize,
-                                       presentationTimeUs, 0);
-          AMediaExtractor_advance(extractor);
-        }
+    if (ended_.load(std::memory_order_relaxed) &&
+        ended_.exchange(false, std::memory_order_acquire) && endedListener_) {
+      endedListener_();
+    }
+    const int state = deck.state.load(std::memory_order_acquire);
+    if (state == kDeckDone) {
+      // The audio thread has moved to the other deck and no longer reads
+      // this ring.
+      decoder.reset();
+      deck.ring.reset();
+      deck.finished.store(false);
+      pendingFrames = 0;
+      pushedFrames = 0;
+      endOfStream = false;
+      deck.state.store(kDeckIdle, std::memory_order_release);
+      continue;
+    }
+    if (state == kDeckIdle) {
+      if (path.empty() && !takeQueuedPath(&path)) {
+        std::this_thread::sleep_for(kDecodeBackoff);
+        continue;
+      }
+      deck.state.store(kDeckLoading);
+      {
+        std::lock_guard<std::mutex> lock(queueMutex_);
+        queuedTracks_.store(static_cast<int32_t>(queue_.size()));
+      }
+      decoder = createAudioDecoder(path);
+      if (!decoder) {
+        loge("Failed to initialize decoder for %s", path.c_str());
+        path.clear();
+        deck.state.store(kDeckIdle);
+        if (!signalled) break;
+        continue;
+      }
+      const AudioFormatInfo& format = decoder->format();
+      if (!signalled) {
+        // The first track fixes the format every later track is
+        // converted to.
+        durationUs_.store(format.durationUs);
+        channelCount_ = format.channelCount;
+        sampleRate_ = format.sampleRate;
+        initRingBuffers(sampleRate_, channelCount_);
+        prerollFrames = std::min(
+            deck.ring.capacityFrames(),
+            static_cast<size_t>(prerollMs_.load() * sampleRate_ / 1000.0f));
+      } else {
+        configureRing(deck, sampleRate_, channelCount_);
+      }
+      converter.configure(format, sampleRate_, channelCount_);
+      if (!converter.isPassthrough()) {
+        logi("Converting %s from %d Hz/%d ch", path.c_str(),
+             format.sampleRate, format.channelCount);
       }
+      floatBuffer.resize(static_cast<size_t>(kDecodeFrames) *
+                         std::max(1, format.channelCount));
+      deck.durationUs = format.durationUs;
+      pendingFrames = 0;
+      pushedFrames = 0;
+      endOfStream = false;
+      path.clear();
+      deck.state.store(kDeckReady, std::memory_order_release);
+      continue;
     }
+    if (state != kDeckReady) continue;
 
-    const ssize_t outputIndex =
-        AMediaCodec_dequeueOutputBuffer(codec, &info, 10000);
-    if (outputIndex >= 0) {
-      size_t outSize = 0;
-      auto* buffer = AMediaCodec_getOutputBuffer(codec, outputIndex, &outSize);
-      if (info.size > 0 && buffer) {
-        const int frameCount =
-            info.size / (sizeof(int16_t) * channelCount_);
-        if (static_cast<size_t>(frameCount * channelCount_) >
-            floatBuffer.size()) {
-          floatBuffer.resize(frameCount * channelCount_);
-        }
-        const int16_t* src = reinterpret_cast<int16_t*>(buffer);
-        for (int i = 0; i < frameCount * channelCount_; ++i) {
-          floatBuffer[i] = static_cast<float>(src[i]) / 32768.0f;
+    if (!signalled && (endOfStream || deck.ring.freeFrames() == 0 ||
+                       deck.ring.availableFrames() >= prerollFrames)) {
+      ready.set_value(true);
+      signalled = true;
+    }
+    if (index == activeDeck_.load(std::memory_order_acquire)) {
+      const int64_t seekUs = seekRequestUs_.exchange(-1);
+      if (seekUs >= 0) {
+        if (decoder->seekToUs(seekUs)) {
+          converter.clear();
+          pendingFrames = 0;
+          pushedFrames = 0;
+          endOfStream = false;
+          deck.finished.store(false, std::memory_order_release);
+          seekPositionUs_.store(seekUs, std::memory_order_relaxed);
+          seekDeck_.store(index, std::memory_order_relaxed);
+          seekRingMark_.store(deck.ring.totalWritten(),
+                              std::memory_order_release);
+        } else {
+          loge("Seek to %lld us failed", static_cast<long long>(seekUs));
         }
-        pushToRing(floatBuffer.data(), frameCount);
+        continue;
       }
-      AMediaCodec_releaseOutputBuffer(
-          codec, outputIndex, info.size != 0);
-
-      if (info.flags & AMEDIACODEC_BUFFER_FLAG_END_OF_STREAM) {
+    }
+    if (pushedFrames < pendingFrames) {
+      const int pushed = deck.ring.tryPush(
+          pending + static_cast<size_t>(pushedFrames) * channelCount_,
+          pendingFrames - pushedFrames);
+      pushedFrames += pushed;
+      if (pushed == 0) std::this_thread::sleep_for(kDecodeBackoff);
+      continue;
+    }
+    if (endOfStream) {
+      if (!deck.finished.load(std::memory_order_relaxed)) {
         logi("Decoder reached end of stream");
-        std::lock_guard<std::mutex> lock(soundTouchMutex_);
-        soundTouch_.flush();
-        break;
+        deck.finished.store(true, std::memory_order_release);
       }
+      // Stay alive so a later seek can restart decoding.
+      std::this_thread::sleep_for(kDecodeBackoff);
+      continue;
+    }
+    const auto decodeStart = std::chrono::steady_clock::now();
+    int32_t frameCount;
+    {
+      SLOWREVERB_TRACE_SCOPE("AudioEngine::decode");
+      frameCount = decoder->read(floatBuffer.data(), kDecodeFrames);
+    }
+    if (frameCount < 0) {
+      // Treat a broken file as ended so a queued track can follow it.
+      loge("Decoder error; ending track");
+      pendingFrames = 0;
+      endOfStream = true;
+      continue;
+    }
+    endOfStream = decoder->isEndOfStream();
+    pendingFrames =
+        converter.process(floatBuffer.data(), frameCount, endOfStream,
+                          &pending);
+    pushedFrames = 0;
+    const int64_t decodeNs = nanosSince(decodeStart);
+    if (frameCount > 0 && decodeNs > 0) {
+      const float speed = static_cast<float>(
+          frameCount * 1e9 / (static_cast<double>(decodeNs) *
+                              decoder->format().sampleRate));
+      const float average = decodeSpeed_.load(std::memory_order_relaxed);
+      decodeSpeed_.store(
+          average > 0.0f ? average + kDecodeSpeedSmoothing * (speed - average)
+                         : speed,
+          std::memory_order_relaxed);
     }
   }
-
-  AMediaCodec_stop(codec);
-  AMediaCodec_delete(codec);
-  AMediaExtractor_delete(extractor);
+  if (!signalled) ready.set_value(false);
   logi("Decoder thread exit");
 }
@@ -1,28 +1,150 @@
 #pragma once
 
 #include <atomic>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <future>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <thread>
 #include <vector>
 
-#include "oboe/Oboe.h"
+#include "audio_sink.h"
+#include "callback_stats.h"
+#include "convolution_reverb.h"
+#include "decode_ring.h"
+#include "engine_telemetry.h"
+#include "lifecycle_worker.h"
+#include "processing_chain.h"
+#include "quality_governor.h"
 
-#define SOUNDTOUCH_FLOAT_SAMPLES 1
-#include "SoundTouch.h"
+struct EngineStats {
+  CallbackStatsSnapshot callback;
+  int32_t xrunCount = -1;
+  int32_t framesPerBurst = 0;
+  int32_t sampleRate = 0;
+  int32_t ringCapacityFrames = 0;
+  // The chain's current ProcessingChain quality tier.
+  int32_t qualityTier = 0;
+  // Time spent in the last start() call, -1 before it returned.
+  double startMs = -1.0;
+  // From entering start() to the first rendered sample above silence, -1
+  // until one has played. Leading silence in the source counts as delay.
+  double firstAudioMs = -1.0;
+  // Output streams reopened since start() after the device went away.
+  int32_t streamRecoveries = 0;
+  // From the last stream error to the reopened stream starting, -1 before
+  // any recovery.
+  double recoveryMs = -1.0;
+  // How the decoder threads were scheduled when they last started; see
+  // ThreadPlacement.
+  int32_t decodeNice = 0;
+  bool decodePrioritized = false;
+  bool decodePinned = false;
+  // Process-wide; see performanceCores() and setPinToPerformanceCores().
+  uint64_t performanceCores = 0;
+  bool pinToPerformanceCores = false;
+};
+
+// Heap held by an engine's buffers. The ring fields describe the active
+// deck's ring.
+struct EngineMemory {
+  // 0 when unlimited.
+  int64_t budgetBytes = 0;
+  // Both decks' decode rings.
+  int64_t ringBytes = 0;
+  // The processing and dry chains, the convolution reverb and the callback
+  // buffers, as measured when they were last configured.
+  int64_t chainBytes = 0;
+  int64_t totalBytes = 0;
+  int32_t ringFrames = 0;
+  RingSampleFormat ringFormat = RingSampleFormat::kFloat32;
+  double ringMs = 0.0;
+  // Decoding speed as a multiple of realtime, 0 until measured.
+  double decodeSpeed = 0.0;
+  // The chains' arenas, part of chainBytes: bytes reserved, the most their
+  // buffers needed at once, and allocations that did not fit and went to
+  // the heap.
+  int64_t arenaBytes = 0;
+  int64_t arenaPeakBytes = 0;
+  int64_t arenaOverflows = 0;
+};
 
-#include "simple_reverb.h"
+// Why the last AudioEngine::start() failed.
+enum class StartError : int32_t {
+  kNone = 0,
+  // The source could not be opened, or its pre-roll not decoded in time.
+  kDecoder,
+  // The output stream could not be opened or started.
+  kOutputStream,
+};
 
-class AudioEngine : public oboe::AudioStreamDataCallback,
-                    public oboe::AudioStreamErrorCallback {
+class AudioEngine : public AudioSinkCallback {
  public:
   AudioEngine();
+  explicit AudioEngine(AudioSinkType sinkType);
+  explicit AudioEngine(std::unique_ptr<AudioSink> sink);
   ~AudioEngine();
 
+  // start() and stop() may be called from any thread; they serialize
+  // against each other and against stats().
   bool start(const std::string& path);
   void stop();
   bool isRunning() const { return running_.load(); }
+  // kNone after a successful start().
+  StartError startError() const { return startError_.load(); }
+  // Called on a decoder thread, never the audio thread, once playback has
+  // run past the end of the last track. Set it while stopped.
+  void setEndedListener(std::function<void()> listener);
+  // Audio decoded ahead before the sink is started; read by start().
+  void setPrerollMs(double prerollMs);
+  // Sizes the decode ring and the chain's buffers for a source format ahead
+  // of start(), so starting a track of that format does not allocate them.
+  // Ignored while running.
+  void prepare(int32_t sampleRate, int32_t channelCount);
+  // Puts every parameter back to its construction-time value, for engines
+  // handed out again by EnginePool.
+  void restoreDefaults();
+  // Moves playback to positionMs in the source. Applied asynchronously by
+  // the decoder thread; the last request wins. A seek during a crossfade
+  // cancels the fade.
+  void seekToMs(double positionMs);
 
+  // Playlist mode: queued tracks follow the one passed to start() without
+  // stopping the sink. The next track is opened and decoded ahead on a
+  // second decoder thread, converted to the first track's format, and fed
+  // through the same chain, so the reverb tail rings across the boundary.
+  // start() and stop() empty the queue, so enqueue after start().
+  void enqueue(const std::string& path);
+  // Drops tracks not yet opened; one already decoding ahead still plays.
+  void clearQueue();
+  // Length of the equal-power crossfade between queued tracks; 0 joins them
+  // gaplessly.
+  void setCrossfadeMs(double crossfadeMs);
+  // 0 for the track passed to start(), then one more per transition.
+  int32_t currentTrackIndex() const { return trackIndex_.load(); }
+
+  // A/B compare: while enabled, a dry branch (no reverb, no pitch shift) is
+  // fed from the same decoded frames as the processed chain. tempoMatched
+  // plays it at the processed tempo, otherwise at the original tempo. The
+  // branch not being switched to skips or pads its output to stay at the
+  // other's source position, so either can take over within a callback.
+  void setCompare(bool enabled, bool tempoMatched);
+  // Selects the branch heard, switching at the next callback or with an
+  // equal-power crossfade of fadeMs. Ignored while compare is disabled.
+  void setMonitorDry(bool dry, double fadeMs);
+
+  // Switches the reverb stage to convolution with the impulse response WAV
+  // at path, or back to the built-in reverb for an empty path. The file is
+  // decoded on the calling thread; while running, the new reverb takes over
+  // at the next callback. Returns false if the file cannot be read. Decay,
+  // room and echo do not apply to convolution.
+  bool setImpulseResponse(const std::string& path);
+
+  // Tempo is clamped to the chain's range; SoundTouch stops at
+  // ProcessingChain::kMinSoundTouchTempo.
   void setTempo(double tempo);
   void setPitchSemiTones(double semi);
   void setWet(double wet);
@@ -30,52 +152,214 @@ class AudioEngine : public oboe::AudioStreamDataCallback,
   void setTone(double tone);
   void setRoomSize(double room);
   void setEcho(double echoMs);
+  // Stereo spread of the built-in reverb's wet signal, 0 (mono) to 1.
+  void setWidth(double width);
+  // Time stretcher used from the next start() or prepare().
+  void setStretchMode(StretchMode mode);
+  // Holds the chain at a quality tier, 0 (cheapest) to
+  // ProcessingChain::kQualityTiers - 1, or with QualityGovernor::kAuto lets
+  // the governor follow the callback load, which is the default.
+  void setQualityTier(int32_t tier) { governor_.pin(tier); }
+  int32_t qualityTier() const { return governor_.tier(); }
+
+  // Decode rings are sized per track from the measured decoding speed:
+  // long enough to ride out a decoder stall, the crossfade and the
+  // pre-roll, and at most two seconds. With a budget, in bytes, the rings
+  // get what the chains leave: they shrink towards that floor and a float
+  // ring drops to kFloat16 first. 0 is no budget. Both apply from the next
+  // track or start().
+  void setMemoryBudget(int64_t bytes);
+  void setRingFormat(RingSampleFormat format);
+  EngineMemory memory() const;
 
-  oboe::DataCallbackResult onAudioReady(oboe::AudioStream* stream,
-                                        void* audioData,
-                                        int32_t numFrames) override;
-  void onErrorAfterClose(oboe::AudioStream* stream,
-                         oboe::Result error) override;
+  bool onRender(float* out, int32_t numFrames) override;
+  // The stream died under the engine, e.g. the headset was unplugged; it is
+  // reopened on the default device from a worker thread, resuming where it
+  // stopped.
+  void onSinkError(const char* message) override;
+  AudioSink* sink() const { return sink_.get(); }
+
+  EngineStats stats() const;
+  void resetStats() { callbackStats_.reset(); }
 
   double currentPositionMs() const;
   double durationMs() const;
+  // Position, output meters and spectrum, published by the audio callback.
+  // Same address for the engine's lifetime.
+  const TelemetryBlock* telemetry() const { return telemetry_.block(); }
 
  private:
-  void updateSmoothedParameters();
-  static float smoothTowards(float current, float target, float factor);
-
-  void initRingBuffer(int32_t sampleRate, int32_t channelCount);
-  int pushToRing(const float* data, int frames);
-  int popFromRing(float* dst, int maxFrames);
-  void writeFrames(int64_t frameIndex, const float* src, int frames);
-  void readFrames(int64_t frameIndex, float* dst, int frames);
+  // Decoded frames moved from the ring into SoundTouch per pop.
+  static constexpr int32_t kRingChunkFrames = 1024;
+  static constexpr float kDefaultPrerollMs = 200.0f;
+
+  enum DeckState : int {
+    kDeckIdle,
+    // The decoder thread is opening a track; the ring is not readable.
+    kDeckLoading,
+    // The ring is being filled and may be read by the audio thread.
+    kDeckReady,
+    // The audio thread is done with the track; the decoder thread resets
+    // the deck and goes back to idle.
+    kDeckDone,
+  };
+
+  // One track's decoder thread and the ring it fills. The audio thread reads
+  // the active deck while the other one decodes the next queued track.
+  struct Deck {
+    DecodeRing ring;
+    std::thread thread;
+    // Written by the decoder thread before it publishes kDeckReady.
+    int64_t durationUs = 0;
+    std::atomic<int> state{kDeckIdle};
+    // The decoder has pushed the last frame of the track.
+    std::atomic<bool> finished{false};
+    // Published after each configure of the ring, for other threads.
+    std::atomic<int64_t> ringBytes{0};
+    std::atomic<int32_t> ringFrames{0};
+    std::atomic<RingSampleFormat> ringFormat{RingSampleFormat::kFloat32};
+    std::atomic<float> ringMs{0.0f};
+  };
+
+  ChainParameters targetParameters() const;
+  // Dry branch parameters following the processed chain's current tempo.
+  ChainParameters dryParameters() const;
+  // Audio thread: arms or disarms the dry branch and moves the monitor mix.
+  void updateCompare();
+  // Sizes and prewarms the dry branch for the current source format.
+  void configureDryChain(int32_t outputRate);
+  // A convolution reverb for the current impulse response at outputRate;
+  // one without an impulse when none is set. Records its memory.
+  std::unique_ptr<ConvolutionReverb> makeConvolution(int32_t outputRate);
+  // Audio thread: swaps in pendingConvolution_ once the previous swap's
+  // instance has been released.
+  void installPendingConvolution();
+  // Frees convolution reverbs handed over but no longer in the chain.
+  void releaseConvolutions();
+  // Audio thread: restarts the dry branch from the next input frame.
+  void restartDryChain();
+  // Source frame of the branch's next output, on chain_'s input count.
+  double branchSource(const ProcessingChain& chain) const;
+  void putInput(const float* frames, int32_t count);
+  // Audio thread: receives up to numFrames from chain, zero-filling the
+  // rest. Returns the frames that were missing.
+  int32_t renderBranch(ProcessingChain& chain, float* out, int32_t numFrames);
+  // Audio thread: renders numFrames from the branch that is not leading,
+  // dropping or zero-padding output so it lines up with leaderSource.
+  void renderFollower(ProcessingChain& chain,
+                      double leaderSource,
+                      float* out,
+                      int32_t numFrames);
+  // Audio thread: blends dryBuffer_ into out by the monitor mix.
+  void mixMonitor(float* out, int32_t numFrames, bool dryLeads);
+  void stopLocked();
+  // Moves decoded frames into the chain until it holds outputFrames.
+  void feedChain(int32_t outputFrames);
+  // Audio thread: drops pre-seek audio once the decoder has repositioned.
+  void applyPendingSeek();
+  // Audio thread: starts fading into the next deck once the active track's
+  // remaining frames fit the crossfade.
+  void maybeStartCrossfade();
+  // Audio thread: mixes the incoming track under `frames` outgoing frames
+  // in ringScratch_.
+  void mixCrossfade(int32_t frames);
+  // Audio thread: makes the next deck active if its track is ready.
+  bool advanceDeck();
+  // Whether another track will follow the active one.
+  bool nextTrackPending() const;
+
+  void initRingBuffers(int32_t sampleRate, int32_t channelCount);
+  // Sizes deck's ring as setMemoryBudget() describes, reallocating only
+  // when the size or format changes. Nothing else may use the ring.
+  void configureRing(Deck& deck, int32_t sampleRate, int32_t channels);
+  // Records chain_'s memory and the callback buffers'; not while the
+  // callback runs.
+  void recordChainMemory();
+  // Same for dryChain_, before the callback uses it.
+  void recordDryChainMemory();
+  int64_t chainMemory() const;
   bool openStream(int32_t sampleRate, int32_t channelCount);
   void closeStream();
-  void decodingLoop(const std::string& path);
+  // Recovery worker: retries reopenStream() until it succeeds or the
+  // engine stops.
+  void recoverStream();
+  // Opens the sink again for a running engine, keeping the rings, the
+  // chains and the position, and re-targets the chains if the new device
+  // runs at another rate. Called under lifecycleMutex_.
+  bool reopenStream();
+  bool takeQueuedPath(std::string* path);
+  // Decoder thread of decks_[index]. The first deck starts with the path
+  // given to start() and fulfils `ready`; both then take tracks from the
+  // queue whenever their deck is idle.
+  void deckLoop(int index, std::string path, std::promise<bool> ready);
 
   std::atomic<bool> running_{false};
-  std::atomic<bool> decoderReady_{false};
-  std::unique_ptr<oboe::AudioStream> stream_;
-  std::thread decodeThread_;
+  // Requested source position, -1 when none; taken by the decoder thread of
+  // the active deck.
+  std::atomic<int64_t> seekRequestUs_{-1};
+  // Ring write position at which the decoder resumed after a seek, -1 when
+  // none; taken by the audio thread together with seekPositionUs_ and
+  // seekDeck_.
+  std::atomic<int64_t> seekRingMark_{-1};
+  std::atomic<int64_t> seekPositionUs_{0};
+  std::atomic<int> seekDeck_{0};
+  std::atomic<StartError> startError_{StartError::kNone};
+  // Raised by the audio thread when the output runs dry after the last
+  // track, and taken by a decoder thread to call endedListener_.
+  std::atomic<bool> ended_{false};
+  std::function<void()> endedListener_;
+  // Audio thread only.
+  bool inputFlushed_ = false;
+  bool endReported_ = false;
+  bool fading_ = false;
+  int64_t fadeFrames_ = 0;
+  int64_t fadePosition_ = 0;
+  mutable std::mutex lifecycleMutex_;
+  std::unique_ptr<AudioSink> sink_;
+
+  Deck decks_[2];
+  // Written by start() before the sink runs, then by the audio thread only.
+  std::atomic<int> activeDeck_{0};
+  std::atomic<int32_t> trackIndex_{0};
+  std::mutex queueMutex_;
+  std::deque<std::string> queue_;
+  // Mirrors queue_.size() for the audio thread, which must not lock.
+  std::atomic<int32_t> queuedTracks_{0};
+  std::atomic<float> crossfadeMs_{0.0f};
+  std::atomic<bool> compareEnabled_{false};
+  std::atomic<bool> compareTempoMatched_{true};
+  std::atomic<bool> monitorDry_{false};
+  std::atomic<float> monitorFadeMs_{0.0f};
+  // dryChain_ is configured for the running stream.
+  std::atomic<bool> dryReady_{false};
+  // Audio thread only. monitorMix_ runs from 0 (processed) to 1 (dry).
+  bool dryArmed_ = false;
+  float monitorMix_ = 0.0f;
+  // chain_.inputFrames() when the dry branch was last restarted.
+  int64_t dryOrigin_ = 0;
+
+  // Set by setImpulseResponse() under lifecycleMutex_; null for the built-in
+  // reverb.
+  std::shared_ptr<const ImpulseResponse> impulse_;
+  // Built for a running stream and taken by the audio thread, which parks
+  // the instance it replaces in retiredConvolution_ instead of freeing it.
+  std::atomic<ConvolutionReverb*> pendingConvolution_{nullptr};
+  std::atomic<ConvolutionReverb*> retiredConvolution_{nullptr};
 
-  soundtouch::SoundTouch soundTouch_;
-  SimpleReverb reverb_;
+  ProcessingChain chain_;
+  ProcessingChain dryChain_;
+  CallbackStats callbackStats_;
+  EngineTelemetry telemetry_;
+  QualityGovernor governor_{ProcessingChain::kQualityTiers,
+                            ProcessingChain::kDefaultQualityTier};
 
   std::vector<float> tempBuffer_;
   std::vector<float> ringScratch_;
-  std::vector<float> decodeRing_;
+  std::vector<float> fadeScratch_;
+  std::vector<float> dryBuffer_;
   int32_t channelCount_ = 2;
   int32_t sampleRate_ = 48000;
-  float wetMix_ = 0.25f;
-  float decaySeconds_ = 6.0f;
-  float toneBalance_ = 0.6f;
-  float roomSize_ = 0.8f;
-  float echoMs_ = 0.0f;
-  size_t ringCapacityFrames_ = 0;
-  std::atomic<int64_t> ringWriteIndex_{0};
-  std::atomic<int64_t> ringReadIndex_{0};
-  float currentTempo_ = 1.0f;
-  float pitchSemi_ = 0.0f;
+  std::atomic<int32_t> outputSampleRate_{48000};
   std::atomic<float> targetTempo_{1.0f};
   std::atomic<float> targetPitch_{0.0f};
   std::atomic<float> targetWet_{0.25f};
@@ -83,6 +367,34 @@ class AudioEngine : public oboe::AudioStreamDataCallback,
   std::atomic<float> targetTone_{0.6f};
   std::atomic<float> targetRoom_{0.8f};
   std::atomic<float> targetEcho_{0.0f};
+  std::atomic<float> targetWidth_{1.0f};
+  std::atomic<StretchMode> stretchMode_{StretchMode::kSoundTouch};
+  std::atomic<float> prerollMs_{kDefaultPrerollMs};
+  std::atomic<int64_t> memoryBudget_{0};
+  std::atomic<RingSampleFormat> ringFormat_{RingSampleFormat::kFloat32};
+  // Realtime multiple averaged over decode blocks; both decoder threads
+  // update it, and a lost update only drops one block's sample.
+  std::atomic<float> decodeSpeed_{0.0f};
+  // Measured at configure points; see EngineMemory::chainBytes.
+  std::atomic<int64_t> chainMemory_{0};
+  std::atomic<int64_t> dryChainMemory_{0};
+  std::atomic<int64_t> convolutionMemory_{0};
+  std::chrono::steady_clock::time_point startedAt_;
+  std::atomic<int64_t> startNs_{-1};
+  std::atomic<int64_t> firstAudioNs_{-1};
   std::atomic<int64_t> playedFrames_{0};
   std::atomic<int64_t> durationUs_{0};
+  // Set by onSinkError() until the stream is back; lostAtNs_ is when, on
+  // the steady clock.
+  std::atomic<bool> streamLost_{false};
+  std::atomic<int64_t> lostAtNs_{0};
+  std::atomic<int32_t> streamRecoveries_{0};
+  std::atomic<int64_t> recoveryNs_{-1};
+  // Written by each decoder thread as it starts.
+  std::atomic<int32_t> decodeNice_{0};
+  std::atomic<bool> decodePrioritized_{false};
+  std::atomic<bool> decodePinned_{false};
+  // Declared last so it finishes any recovery before the rest of the
+  // engine is destroyed. Its thread starts with the first stream error.
+  LifecycleWorker recovery_;
 };
@@ -0,0 +1,38 @@
+#include "audio_sink.h"
+
+#include "offline_sink.h"
+
+#if defined(__ANDROID__)
+#include "oboe_sink.h"
+#endif
+#if defined(SLOWREVERB_HAVE_ALSA)
+#include "alsa_sink.h"
+#endif
+
+std::unique_ptr<AudioSink> createAudioSink(AudioSinkType type) {
+  switch (type) {
+    case AudioSinkType::kDefault:
+#if defined(__ANDROID__)
+      return std::make_unique<OboeSink>();
+#elif defined(SLOWREVERB_HAVE_ALSA)
+      return std::make_unique<AlsaSink>();
+#else
+      return nullptr;
+#endif
+    case AudioSinkType::kOboe:
+#if defined(__ANDROID__)
+      return std::make_unique<OboeSink>();
+#else
+      return nullptr;
+#endif
+    case AudioSinkType::kAlsa:
+#if defined(SLOWREVERB_HAVE_ALSA)
+      return std::make_unique<AlsaSink>();
+#else
+      return nullptr;
+#endif
+    case AudioSinkType::kOffline:
+      return std::make_unique<OfflineSink>();
+  }
+  return nullptr;
+}
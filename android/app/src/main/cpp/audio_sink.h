@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+
+// Receives render requests from an AudioSink. onRender runs on the sink's
+// audio thread and must fill exactly `frames` interleaved frames.
+class AudioSinkCallback {
+ public:
+  virtual ~AudioSinkCallback() = default;
+  // Return false to stop the sink after this buffer.
+  virtual bool onRender(float* interleaved, int32_t frames) = 0;
+  virtual void onSinkError(const char* /*message*/) {}
+};
+
+struct AudioSinkConfig {
+  int32_t sampleRate = 48000;
+  int32_t channelCount = 2;
+  // 0 lets the backend pick its native burst size.
+  int32_t framesPerBurst = 0;
+};
+
+enum class AudioSinkType : int32_t {
+  kDefault = 0,  // Oboe on Android, ALSA on Linux when available.
+  kOboe = 1,
+  kAlsa = 2,
+  kOffline = 3,
+};
+
+// Output device abstraction used by AudioEngine. Implementations own their
+// audio thread; open() negotiates the format, start()/stop() control
+// callbacks, and close() releases the device.
+class AudioSink {
+ public:
+  virtual ~AudioSink() = default;
+
+  virtual bool open(const AudioSinkConfig& config,
+                    AudioSinkCallback* callback) = 0;
+  virtual bool start() = 0;
+  virtual void stop() = 0;
+  virtual void close() = 0;
+
+  virtual const char* name() const = 0;
+  int32_t sampleRate() const { return sampleRate_; }
+  int32_t channelCount() const { return channelCount_; }
+  int32_t framesPerBurst() const { return framesPerBurst_; }
+  // Largest frame count a single onRender call can ask for.
+  int32_t maxCallbackFrames() const { return maxCallbackFrames_; }
+  // Backend-reported underruns, or -1 when the backend cannot tell.
+  virtual int32_t xrunCount() const { return -1; }
+
+ protected:
+  int32_t sampleRate_ = 0;
+  int32_t channelCount_ = 0;
+  int32_t framesPerBurst_ = 0;
+  int32_t maxCallbackFrames_ = 0;
+};
+
+// Returns nullptr when the requested backend is not compiled in.
+std::unique_ptr<AudioSink> createAudioSink(AudioSinkType type);
@@ -0,0 +1,165 @@
+// Benchmark entry point. Accepts every Google Benchmark flag plus:
+//   --save_baseline=FILE   write each benchmark's realtime multiple to FILE
+//   --baseline=FILE        compare against a saved baseline; exits non-zero
+//                          when any benchmark got slower than allowed
+//   --max_regression=F     allowed slowdown as a fraction (default 0.10)
+// Use --benchmark_format=json or --benchmark_out=FILE for machine-readable
+// results; the baseline summary is written to stderr so it never mixes with
+// them.
+
+#include <benchmark/benchmark.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+using Results = std::map<std::string, double>;
+
+// Forwards to the normal display reporter while keeping each benchmark's
+// realtime multiple. Medians replace individual repetitions when present.
+template <typename Base>
+class RecordingReporter : public Base {
+ public:
+  explicit RecordingReporter(Results* results) : results_(results) {}
+
+  void ReportRuns(const std::vector<benchmark::BenchmarkReporter::Run>& runs)
+      override {
+    for (const auto& run : runs) {
+      if (run.error_occurred) continue;
+      const auto counter = run.counters.find("x_realtime");
+      if (counter == run.counters.end()) continue;
+      const bool isMedian =
+          run.run_type == benchmark::BenchmarkReporter::Run::RT_Aggregate &&
+          run.aggregate_name == "median";
+      if (run.run_type ==
+              benchmark::BenchmarkReporter::Run::RT_Iteration ||
+          isMedian) {
+        (*results_)[run.run_name.str()] = counter->second.value;
+      }
+    }
+    Base::ReportRuns(runs);
+  }
+
+ private:
+  Results* results_;
+};
+
+bool takeFlag(const char* arg, const char* name, std::string* value) {
+  const size_t length = std::strlen(name);
+  if (std::strncmp(arg, name, length) != 0 || arg[length] != '=') {
+    return false;
+  }
+  *value = arg + length + 1;
+  return true;
+}
+
+bool saveBaseline(const std::string& path, const Results& results) {
+  std::ofstream out(path);
+  if (!out) return false;
+  out.precision(6);
+  for (const auto& entry : results) {
+    out << entry.first << '\t' << entry.second << '\n';
+  }
+  return static_cast<bool>(out);
+}
+
+bool loadBaseline(const std::string& path, Results* results) {
+  std::ifstream in(path);
+  if (!in) return false;
+  std::string line;
+  while (std::getline(in, line)) {
+    const size_t tab = line.rfind('\t');
+    if (tab == std::string::npos) continue;
+    (*results)[line.substr(0, tab)] = std::atof(line.c_str() + tab + 1);
+  }
+  return true;
+}
+
+// Returns the number of regressions.
+int compareToBaseline(const Results& baseline,
+                      const Results& current,
+                      double maxRegression) {
+  int regressions = 0;
+  std::fprintf(stderr, "\n%-60s %12s %12s %8s\n", "benchmark",
+               "baseline(x)", "current(x)", "change");
+  for (const auto& entry : current) {
+    const auto base = baseline.find(entry.first);
+    if (base == baseline.end() || base->second <= 0.0) {
+      std::fprintf(stderr, "%-60s %12s %12.1f %8s\n", entry.first.c_str(),
+                   "-", entry.second, "new");
+      continue;
+    }
+    const double change = entry.second / base->second - 1.0;
+    const bool regressed = change < -maxRegression;
+    regressions += regressed ? 1 : 0;
+    std::fprintf(stderr, "%-60s %12.1f %12.1f %+7.1f%%%s\n",
+                 entry.first.c_str(), base->second, entry.second,
+                 change * 100.0, regressed ? "  REGRESSION" : "");
+  }
+  return regressions;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::string savePath;
+  std::string baselinePath;
+  std::string maxRegressionArg;
+  bool json = false;
+  std::vector<char*> args;
+  for (int i = 0; i < argc; ++i) {
+    if (i > 0 && (takeFlag(argv[i], "--save_baseline", &savePath) ||
+                  takeFlag(argv[i], "--baseline", &baselinePath) ||
+                  takeFlag(argv[i], "--max_regression", &maxRegressionArg))) {
+      continue;
+    }
+    if (std::strcmp(argv[i], "--benchmark_format=json") == 0) json = true;
+    args.push_back(argv[i]);
+  }
+  const double maxRegression =
+      maxRegressionArg.empty() ? 0.10 : std::atof(maxRegressionArg.c_str());
+
+  int benchArgc = static_cast<int>(args.size());
+  benchmark::Initialize(&benchArgc, args.data());
+  if (benchmark::ReportUnrecognizedArguments(benchArgc, args.data())) {
+    return 1;
+  }
+
+  Results results;
+  RecordingReporter<benchmark::ConsoleReporter> console(&results);
+  RecordingReporter<benchmark::JSONReporter> jsonReporter(&results);
+  if (json) {
+    benchmark::RunSpecifiedBenchmarks(&jsonReporter);
+  } else {
+    benchmark::RunSpecifiedBenchmarks(&console);
+  }
+  benchmark::Shutdown();
+
+  if (!savePath.empty() && !saveBaseline(savePath, results)) {
+    std::fprintf(stderr, "Could not write baseline %s\n", savePath.c_str());
+    return 1;
+  }
+  if (!baselinePath.empty()) {
+    Results baseline;
+    if (!loadBaseline(baselinePath, &baseline)) {
+      std::fprintf(stderr, "Could not read baseline %s\n",
+                   baselinePath.c_str());
+      return 1;
+    }
+    const int regressions =
+        compareToBaseline(baseline, results, maxRegression);
+    if (regressions > 0) {
+      std::fprintf(stderr, "%d benchmark(s) regressed by more than %.0f%%\n",
+                   regressions, maxRegression * 100.0);
+      return 2;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <benchmark/benchmark.h>
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace bench {
+
+constexpr int32_t kSampleRate = 48000;
+constexpr int32_t kChannels = 2;
+constexpr double kPi = 3.14159265358979323846;
+
+// A deterministic music-like test signal: two detuned partials plus a
+// little noise, so SoundTouch's correlation search has real work to do.
+inline std::vector<float> makeSignal(int32_t frames,
+                                     int32_t channels = kChannels) {
+  std::vector<float> out(static_cast<size_t>(frames) * channels);
+  uint32_t noise = 0x12345678u;
+  for (int32_t i = 0; i < frames; ++i) {
+    const double t = static_cast<double>(i) / kSampleRate;
+    const double tone = 0.4 * std::sin(2.0 * kPi * 220.0 * t) +
+                        0.2 * std::sin(2.0 * kPi * 331.0 * t);
+    for (int32_t ch = 0; ch < channels; ++ch) {
+      noise = noise * 1664525u + 1013904223u;
+      const double n = (static_cast<double>(noise >> 8) / (1u << 24)) - 0.5;
+      out[static_cast<size_t>(i) * channels + ch] =
+          static_cast<float>(tone + 0.05 * n);
+    }
+  }
+  return out;
+}
+
+// Reports throughput both as frames/s and as a realtime multiple: seconds of
+// audio processed per second of wall time. Baseline comparison uses the
+// latter, so every benchmark in the suite is measured in the same unit.
+inline void reportRealtime(benchmark::State& state,
+                           int64_t framesPerIteration,
+                           int32_t sampleRate = kSampleRate) {
+  const int64_t frames =
+      static_cast<int64_t>(state.iterations()) * framesPerIteration;
+  state.SetItemsProcessed(frames);
+  state.counters["x_realtime"] = benchmark::Counter(
+      static_cast<double>(frames) / sampleRate, benchmark::Counter::kIsRate);
+}
+
+}  // namespace bench
@@ -0,0 +1,253 @@
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "audio_decoder.h"
+#include "bench_util.h"
+#include "processing_chain.h"
+
+namespace {
+
+struct ChainPreset {
+  const char* name;
+  ChainParameters params;
+};
+
+ChainPreset makePreset(const char* name,
+                       float tempo,
+                       float pitch,
+                       float wet,
+                       float decay,
+                       float room,
+                       float echoMs) {
+  ChainPreset preset{name, {}};
+  preset.params.tempo = tempo;
+  preset.params.pitchSemi = pitch;
+  preset.params.wet = wet;
+  preset.params.decay = decay;
+  preset.params.room = room;
+  preset.params.echoMs = echoMs;
+  return preset;
+}
+
+const ChainPreset& presetAt(int64_t index) {
+  static const ChainPreset kPresets[] = {
+      makePreset("chill", 0.85f, -1.5f, 0.40f, 6.0f, 0.80f, 0.0f),
+      makePreset("dreamy", 0.80f, -2.0f, 0.55f, 9.0f, 0.95f, 40.0f),
+      makePreset("extreme", 0.75f, -3.0f, 0.65f, 11.0f, 1.00f, 60.0f),
+  };
+  return kPresets[index];
+}
+
+void writeLe(FILE* file, uint32_t value, int bytes) {
+  for (int i = 0; i < bytes; ++i) {
+    std::fputc(static_cast<int>((value >> (8 * i)) & 0xFF), file);
+  }
+}
+
+// Writes the benchmark signal as 16-bit PCM, the format the app transcodes
+// to before native rendering.
+std::string writeTestWav(int32_t seconds) {
+  const std::string path =
+      (std::filesystem::temp_directory_path() / "slowreverb_bench.wav")
+          .string();
+  const int32_t frames = seconds * bench::kSampleRate;
+  const std::vector<float> signal = bench::makeSignal(frames);
+  FILE* file = std::fopen(path.c_str(), "wb");
+  if (!file) return std::string();
+  const uint32_t dataBytes =
+      static_cast<uint32_t>(signal.size() * sizeof(int16_t));
+  std::fwrite("RIFF", 1, 4, file);
+  writeLe(file, 36 + dataBytes, 4);
+  std::fwrite("WAVEfmt ", 1, 8, file);
+  writeLe(file, 16, 4);
+  writeLe(file, 1, 2);
+  writeLe(file, bench::kChannels, 2);
+  writeLe(file, bench::kSampleRate, 4);
+  writeLe(file, bench::kSampleRate * bench::kChannels * 2, 4);
+  writeLe(file, bench::kChannels * 2, 2);
+  writeLe(file, 16, 2);
+  std::fwrite("data", 1, 4, file);
+  writeLe(file, dataBytes, 4);
+  for (float sample : signal) {
+    const int16_t value = static_cast<int16_t>(sample * 32767.0f);
+    writeLe(file, static_cast<uint16_t>(value), 2);
+  }
+  std::fclose(file);
+  return path;
+}
+
+// Arg: preset index. Stretch + reverb on in-memory audio, in the engine's
+// 4096-frame decode chunks.
+void BM_ProcessingChain(benchmark::State& state) {
+  constexpr int32_t kBlock = 4096;
+  const ChainPreset& preset = presetAt(state.range(0));
+  state.SetLabel(preset.name);
+  ProcessingChain chain;
+  chain.configure(bench::kSampleRate, bench::kSampleRate, bench::kChannels,
+                  preset.params);
+  const std::vector<float> input = bench::makeSignal(kBlock);
+  std::vector<float> output(input.size() * 2);
+  for (auto _ : state) {
+    chain.putSamples(input.data(), kBlock);
+    while (chain.receiveSamples(output.data(), kBlock * 2) > 0) {
+    }
+    benchmark::DoNotOptimize(output.data());
+  }
+  bench::reportRealtime(state, kBlock);
+}
+BENCHMARK(BM_ProcessingChain)->ArgName("preset")->DenseRange(0, 2);
+
+// Args: preset index, quality tier. BM_ProcessingChain held at each of the
+// tiers the realtime engine's governor chooses between.
+void BM_ProcessingChainTier(benchmark::State& state) {
+  constexpr int32_t kBlock = 4096;
+  const ChainPreset& preset = presetAt(state.range(0));
+  state.SetLabel(preset.name);
+  ProcessingChain chain;
+  chain.setQualityTier(static_cast<int32_t>(state.range(1)));
+  chain.configure(bench::kSampleRate, bench::kSampleRate, bench::kChannels,
+                  preset.params);
+  const std::vector<float> input = bench::makeSignal(kBlock);
+  std::vector<float> output(input.size() * 2);
+  for (auto _ : state) {
+    chain.putSamples(input.data(), kBlock);
+    while (chain.receiveSamples(output.data(), kBlock * 2) > 0) {
+    }
+    benchmark::DoNotOptimize(output.data());
+  }
+  bench::reportRealtime(state, kBlock);
+}
+BENCHMARK(BM_ProcessingChainTier)
+    ->ArgNames({"preset", "tier"})
+    ->ArgsProduct({{0, 2}, {0, 1, 2, 3}});
+
+// Arg: preset index. Like BM_ProcessingChain on digital silence, after the
+// stretcher and reverb have gone idle.
+void BM_ProcessingChainSilence(benchmark::State& state) {
+  constexpr int32_t kBlock = 4096;
+  const ChainPreset& preset = presetAt(state.range(0));
+  state.SetLabel(preset.name);
+  ProcessingChain chain;
+  chain.configure(bench::kSampleRate, bench::kSampleRate, bench::kChannels,
+                  preset.params);
+  const std::vector<float> input(
+      static_cast<size_t>(kBlock) * bench::kChannels, 0.0f);
+  std::vector<float> output(input.size() * 2);
+  const auto run = [&]() {
+    chain.putSamples(input.data(), kBlock);
+    while (chain.receiveSamples(output.data(), kBlock * 2) > 0) {
+    }
+  };
+  // Long enough for the longest reverb tail to decay.
+  for (int32_t i = 0; i < 20 * bench::kSampleRate / kBlock; ++i) run();
+  for (auto _ : state) {
+    run();
+    benchmark::DoNotOptimize(output.data());
+  }
+  bench::reportRealtime(state, kBlock);
+}
+BENCHMARK(BM_ProcessingChainSilence)->ArgName("preset")->DenseRange(0, 2);
+
+// Arg: output burst in frames. The default preset pulled a device burst at
+// a time, fed as the engine feeds it; the chain works in its own quanta, so
+// the cost per frame should hardly depend on the burst.
+void BM_ChainBurst(benchmark::State& state) {
+  constexpr int32_t kBlock = 4096;
+  const int32_t burst = static_cast<int32_t>(state.range(0));
+  ProcessingChain chain;
+  chain.configure(bench::kSampleRate, bench::kSampleRate, bench::kChannels,
+                  presetAt(0).params);
+  const std::vector<float> input = bench::makeSignal(kBlock);
+  std::vector<float> output(static_cast<size_t>(burst) * bench::kChannels);
+  for (auto _ : state) {
+    while (chain.availableFrames() < burst) {
+      chain.putSamples(input.data(), kBlock);
+    }
+    chain.receiveSamples(output.data(), burst);
+    benchmark::DoNotOptimize(output.data());
+  }
+  bench::reportRealtime(state, burst);
+}
+BENCHMARK(BM_ChainBurst)
+    ->ArgName("burst")
+    ->Arg(96)
+    ->Arg(192)
+    ->Arg(240)
+    ->Arg(1024);
+
+// Arg: stretch mode. A new chain configured and prewarmed for a 44.1 kHz
+// source on a 48 kHz device, as an engine's first start does, then torn
+// down. Reports the arena it reserved and the most of it prewarming used.
+void BM_ChainSetup(benchmark::State& state) {
+  constexpr int32_t kSourceRate = 44100;
+  constexpr int32_t kPrewarmFrames = 1024;
+  ChainParameters params = presetAt(0).params;
+  params.stretch = static_cast<StretchMode>(state.range(0));
+  size_t arenaBytes = 0;
+  size_t peakBytes = 0;
+  for (auto _ : state) {
+    ProcessingChain chain;
+    chain.configure(kSourceRate, bench::kSampleRate, bench::kChannels,
+                    params);
+    chain.prewarm(kPrewarmFrames);
+    arenaBytes = chain.arena().capacityBytes();
+    peakBytes = chain.arena().peakBytes();
+  }
+  state.counters["arena_kib"] = static_cast<double>(arenaBytes) / 1024.0;
+  state.counters["peak_kib"] = static_cast<double>(peakBytes) / 1024.0;
+}
+BENCHMARK(BM_ChainSetup)
+    ->ArgName("stretch")
+    ->DenseRange(0, 1)
+    ->Unit(benchmark::kMillisecond);
+
+// Arg: preset index. Decode -> stretch -> reverb over a whole file, measured
+// in source-audio seconds per wall second.
+void BM_FullChainFromFile(benchmark::State& state) {
+  constexpr int32_t kSeconds = 10;
+  constexpr int32_t kBlock = 4096;
+  static const std::string path = writeTestWav(kSeconds);
+  if (path.empty()) {
+    state.SkipWithError("could not write test WAV");
+    return;
+  }
+  const ChainPreset& preset = presetAt(state.range(0));
+  state.SetLabel(preset.name);
+  std::vector<float> input(static_cast<size_t>(kBlock) * bench::kChannels);
+  std::vector<float> output(input.size() * 2);
+  int64_t decodedFrames = 0;
+  for (auto _ : state) {
+    auto decoder = createAudioDecoder(path);
+    if (!decoder) {
+      state.SkipWithError("could not open test WAV");
+      return;
+    }
+    const AudioFormatInfo& format = decoder->format();
+    ProcessingChain chain;
+    chain.configure(format.sampleRate, format.sampleRate, format.channelCount,
+                    preset.params);
+    decodedFrames = 0;
+    while (true) {
+      const int32_t decoded = decoder->read(input.data(), kBlock);
+      if (decoded <= 0) break;
+      decodedFrames += decoded;
+      chain.putSamples(input.data(), decoded);
+      while (chain.receiveSamples(output.data(), kBlock * 2) > 0) {
+      }
+    }
+    chain.flush();
+    while (chain.receiveSamples(output.data(), kBlock * 2) > 0) {
+    }
+    benchmark::DoNotOptimize(output.data());
+  }
+  bench::reportRealtime(state, decodedFrames);
+}
+BENCHMARK(BM_FullChainFromFile)
+    ->ArgName("preset")
+    ->DenseRange(0, 2)
+    ->Unit(benchmark::kMillisecond);
+
+}  // namespace
@@ -0,0 +1,181 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+#include "bench_util.h"
+#include "convolution_reverb.h"
+#include "decode_ring.h"
+#include "engine_telemetry.h"
+#include "simple_reverb.h"
+
+namespace {
+
+// Args: room size (percent), echo delay (ms).
+void BM_SimpleReverb(benchmark::State& state) {
+  constexpr int32_t kBlock = 512;
+  SimpleReverb reverb;
+  reverb.configure(bench::kSampleRate, bench::kChannels);
+  reverb.setParameters(0.45f, 7.5f, 0.55f, state.range(0) / 100.0f,
+                       static_cast<float>(state.range(1)), 1.0f);
+  const std::vector<float> input = bench::makeSignal(kBlock);
+  std::vector<float> buffer(input.size());
+  for (auto _ : state) {
+    buffer = input;
+    reverb.process(buffer.data(), kBlock);
+    benchmark::DoNotOptimize(buffer.data());
+  }
+  bench::reportRealtime(state, kBlock);
+}
+BENCHMARK(BM_SimpleReverb)
+    ->ArgNames({"room", "echo_ms"})
+    ->Args({20, 0})
+    ->Args({80, 0})
+    ->Args({100, 0})
+    ->Args({80, 40})
+    ->Args({100, 60})
+    ->Args({100, 180});
+
+// Arg: channel count. The network runs once over the mid signal, so cost
+// should grow only by the per-channel taps and all-pass.
+void BM_SimpleReverbChannels(benchmark::State& state) {
+  constexpr int32_t kBlock = 512;
+  const int32_t channels = static_cast<int32_t>(state.range(0));
+  SimpleReverb reverb;
+  reverb.configure(bench::kSampleRate, channels);
+  reverb.setParameters(0.45f, 7.5f, 0.55f, 0.8f, 0.0f, 1.0f);
+  const std::vector<float> input = bench::makeSignal(kBlock, channels);
+  std::vector<float> buffer(input.size());
+  for (auto _ : state) {
+    buffer = input;
+    reverb.process(buffer.data(), kBlock);
+    benchmark::DoNotOptimize(buffer.data());
+  }
+  bench::reportRealtime(state, kBlock);
+}
+BENCHMARK(BM_SimpleReverbChannels)->ArgName("channels")->Arg(1)->Arg(2)->Arg(
+    6);
+
+// A stereo impulse response of exponentially decaying noise, about -60 dB
+// at its end.
+ImpulseResponse makeImpulse(int32_t seconds) {
+  ImpulseResponse ir;
+  ir.sampleRate = bench::kSampleRate;
+  ir.channelCount = bench::kChannels;
+  const int32_t frames = seconds * bench::kSampleRate;
+  ir.frames.resize(static_cast<size_t>(frames) * ir.channelCount);
+  uint32_t noise = 0x2468aceu;
+  for (size_t i = 0; i < ir.frames.size(); ++i) {
+    noise = noise * 1664525u + 1013904223u;
+    const double n = (static_cast<double>(noise >> 8) / (1u << 24)) - 0.5;
+    const double t = static_cast<double>(i / ir.channelCount) / frames;
+    ir.frames[i] = static_cast<float>(n * std::pow(10.0, -3.0 * t));
+  }
+  return ir;
+}
+
+constexpr int32_t kConvolutionBlock = 480;
+
+// Arg: IR length (s). Tail partitions computed inline, as offline rendering
+// does.
+void BM_ConvolutionReverb(benchmark::State& state) {
+  const ImpulseResponse ir =
+      makeImpulse(static_cast<int32_t>(state.range(0)));
+  ConvolutionReverb reverb;
+  reverb.setParameters(0.45f, 0.6f);
+  reverb.configure(ir, bench::kSampleRate, bench::kChannels, false);
+  const std::vector<float> input = bench::makeSignal(kConvolutionBlock);
+  std::vector<float> buffer(input.size());
+  for (auto _ : state) {
+    buffer = input;
+    reverb.process(buffer.data(), kConvolutionBlock);
+    benchmark::DoNotOptimize(buffer.data());
+  }
+  bench::reportRealtime(state, kConvolutionBlock);
+}
+BENCHMARK(BM_ConvolutionReverb)->ArgName("ir_s")->Arg(1)->Arg(4)->Arg(8);
+
+// Arg: IR length (s). Tail partitions on the worker thread, with callbacks
+// paced to realtime so the worker has the time it would on a device; five
+// seconds of audio reach the last stage of every IR. The time is the
+// callback's share alone, without the worker's FFTs, so there is no
+// realtime multiple and the rows stay out of baseline comparisons.
+// missed_deadlines counts tail partitions the worker had not finished in
+// time.
+void BM_ConvolutionReverbWorker(benchmark::State& state) {
+  using Clock = std::chrono::steady_clock;
+  const ImpulseResponse ir =
+      makeImpulse(static_cast<int32_t>(state.range(0)));
+  ConvolutionReverb reverb;
+  reverb.setParameters(0.45f, 0.6f);
+  reverb.configure(ir, bench::kSampleRate, bench::kChannels, true);
+  const std::vector<float> input = bench::makeSignal(kConvolutionBlock);
+  std::vector<float> buffer(input.size());
+  const auto period = std::chrono::duration_cast<Clock::duration>(
+      std::chrono::duration<double>(static_cast<double>(kConvolutionBlock) /
+                                    bench::kSampleRate));
+  double slowest = 0.0;
+  Clock::time_point next = Clock::now();
+  for (auto _ : state) {
+    buffer = input;
+    const Clock::time_point begin = Clock::now();
+    reverb.process(buffer.data(), kConvolutionBlock);
+    const double seconds =
+        std::chrono::duration<double>(Clock::now() - begin).count();
+    benchmark::DoNotOptimize(buffer.data());
+    state.SetIterationTime(seconds);
+    slowest = std::max(slowest, seconds);
+    next += period;
+    std::this_thread::sleep_until(next);
+  }
+  state.counters["callback_max_us"] = slowest * 1e6;
+  state.counters["missed_deadlines"] =
+      static_cast<double>(reverb.missedDeadlines());
+}
+BENCHMARK(BM_ConvolutionReverbWorker)
+    ->ArgName("ir_s")
+    ->Arg(1)
+    ->Arg(4)
+    ->Arg(8)
+    ->UseManualTime()
+    ->Iterations(5 * bench::kSampleRate / kConvolutionBlock);
+
+// Args: block size in frames, RingSampleFormat (0 float, 1 int16, 2 half).
+void BM_DecodeRingPushPop(benchmark::State& state) {
+  const int32_t block = static_cast<int32_t>(state.range(0));
+  DecodeRing ring;
+  ring.configure(static_cast<size_t>(bench::kSampleRate) * 2,
+                 bench::kChannels,
+                 static_cast<RingSampleFormat>(state.range(1)));
+  const std::vector<float> input = bench::makeSignal(block);
+  std::vector<float> output(input.size());
+  for (auto _ : state) {
+    ring.tryPush(input.data(), block);
+    benchmark::DoNotOptimize(ring.pop(output.data(), block));
+  }
+  bench::reportRealtime(state, block);
+}
+BENCHMARK(BM_DecodeRingPushPop)
+    ->ArgNames({"frames", "format"})
+    ->ArgsProduct({{64, 256, 1024, 4096}, {0, 1, 2}});
+
+// Arg: callback size in frames. Metering, spectrum and publishing, as the
+// engine runs them at the end of each callback.
+void BM_EngineTelemetry(benchmark::State& state) {
+  const int32_t block = static_cast<int32_t>(state.range(0));
+  EngineTelemetry telemetry;
+  telemetry.reset();
+  const std::vector<float> input = bench::makeSignal(block);
+  double positionMs = 0.0;
+  for (auto _ : state) {
+    positionMs += block * 1000.0 / bench::kSampleRate;
+    telemetry.update(input.data(), block, bench::kChannels, bench::kSampleRate,
+                     0.01f, positionMs, 0.0);
+  }
+  benchmark::DoNotOptimize(telemetry.block());
+  bench::reportRealtime(state, block);
+}
+BENCHMARK(BM_EngineTelemetry)->ArgName("frames")->Arg(96)->Arg(256)->Arg(1024);
+
+}  // namespace
@@ -0,0 +1,56 @@
+#include <memory>
+
+#include "audio_engine.h"
+#include "bench_util.h"
+#include "engine_pool.h"
+#include "engine_table.h"
+#include "offline_sink.h"
+
+namespace {
+
+// A handle lookup plus a setter, which is what every Dart parameter call
+// costs. Run with several threads to see contention on the slot.
+void BM_EngineTableAcquire(benchmark::State& state) {
+  static EngineTable table;
+  static intptr_t handle = 0;
+  if (state.thread_index() == 0) {
+    handle = table.insert(std::make_unique<AudioEngine>(), false);
+  }
+  for (auto _ : state) {
+    auto engine = table.acquire(handle);
+    engine->setTempo(0.85);
+    benchmark::DoNotOptimize(engine.get());
+  }
+  if (state.thread_index() == 0) {
+    table.remove(handle, nullptr);
+  }
+}
+BENCHMARK(BM_EngineTableAcquire)->ThreadRange(1, 4);
+
+// Building an engine from scratch and sizing it for a 44.1 kHz stereo track.
+void BM_EngineCreateFresh(benchmark::State& state) {
+  for (auto _ : state) {
+    auto engine =
+        std::make_unique<AudioEngine>(std::make_unique<OfflineSink>());
+    engine->prepare(44100, bench::kChannels);
+    benchmark::DoNotOptimize(engine.get());
+  }
+}
+BENCHMARK(BM_EngineCreateFresh)->Unit(benchmark::kMicrosecond);
+
+// The same through the pool: create, register, dispose, recycle.
+void BM_EnginePoolCycle(benchmark::State& state) {
+  EnginePool pool;
+  EngineTable table;
+  auto warm = std::make_unique<AudioEngine>(std::make_unique<OfflineSink>());
+  warm->prepare(44100, bench::kChannels);
+  pool.recycle(std::move(warm));
+  for (auto _ : state) {
+    const intptr_t handle = table.insert(pool.take(), true);
+    bool pooled = false;
+    pool.recycle(table.remove(handle, &pooled));
+  }
+}
+BENCHMARK(BM_EnginePoolCycle)->Unit(benchmark::kMicrosecond);
+
+}  // namespace
@@ -0,0 +1,142 @@
+#include <memory>
+#include <vector>
+
+#include "AAFilter.h"
+#include "FIFOSampleBuffer.h"
+#include "FIRFilter.h"
+#include "RateTransposer.h"
+#include "SoundTouch.h"
+#include "bench_util.h"
+#include "phase_vocoder.h"
+
+using namespace soundtouch;
+
+namespace {
+
+struct StretchPreset {
+  const char* name;
+  double tempo;
+  double pitchSemi;
+};
+
+// The tempo/pitch combinations the app's sliders spend most time at.
+constexpr StretchPreset kPresets[] = {
+    {"neutral", 1.0, 0.0},
+    {"slowed", 0.85, -1.5},
+    {"deep_slowed", 0.75, -3.0},
+    {"sped_up", 1.25, 2.0},
+    // The floor of SoundTouch's range in the app, where WSOLA echoes most.
+    {"half_speed", 0.5, -4.0},
+};
+
+// Args: preset index, quickseek flag.
+void BM_SoundTouchPreset(benchmark::State& state) {
+  constexpr int32_t kBlock = 4096;
+  const StretchPreset& preset = kPresets[state.range(0)];
+  state.SetLabel(preset.name);
+  SoundTouch stretch;
+  stretch.setSampleRate(bench::kSampleRate);
+  stretch.setChannels(bench::kChannels);
+  stretch.setSetting(SETTING_USE_AA_FILTER, 1);
+  stretch.setSetting(SETTING_USE_QUICKSEEK, static_cast<int>(state.range(1)));
+  stretch.setTempo(preset.tempo);
+  stretch.setPitchSemiTones(preset.pitchSemi);
+  const std::vector<float> input = bench::makeSignal(kBlock);
+  std::vector<float> output(input.size() * 2);
+  for (auto _ : state) {
+    stretch.putSamples(input.data(), kBlock);
+    while (stretch.receiveSamples(output.data(), kBlock * 2) > 0) {
+    }
+    benchmark::DoNotOptimize(output.data());
+  }
+  bench::reportRealtime(state, kBlock);
+}
+BENCHMARK(BM_SoundTouchPreset)
+    ->ArgNames({"preset", "quickseek"})
+    ->ArgsProduct({{0, 1, 2, 3, 4}, {0, 1}});
+
+// Args: preset index, threads. The same work as BM_SoundTouchPreset with the
+// phase vocoder in place of TDStretch; more threads is the offline mode.
+void BM_PhaseVocoderPreset(benchmark::State& state) {
+  constexpr int32_t kBlock = 4096;
+  const StretchPreset& preset = kPresets[state.range(0)];
+  state.SetLabel(preset.name);
+  PhaseVocoder stretch;
+  stretch.configure(bench::kSampleRate, bench::kChannels,
+                    static_cast<int32_t>(state.range(1)));
+  stretch.setTempo(preset.tempo);
+  stretch.setPitchSemiTones(preset.pitchSemi);
+  const std::vector<float> input = bench::makeSignal(kBlock);
+  std::vector<float> output(input.size() * 2);
+  for (auto _ : state) {
+    stretch.putSamples(input.data(), kBlock);
+    while (stretch.receiveSamples(output.data(), kBlock * 2) > 0) {
+    }
+    benchmark::DoNotOptimize(output.data());
+  }
+  bench::reportRealtime(state, kBlock);
+}
+BENCHMARK(BM_PhaseVocoderPreset)
+    ->ArgNames({"preset", "threads"})
+    ->ArgsProduct({{0, 1, 2, 3, 4}, {1, 4}})
+    ->UseRealTime();
+
+// Arg: TransposerBase::ALGORITHM. Rate 0.9 matches a ~-1.8 semitone shift.
+void BM_Transposer(benchmark::State& state) {
+  constexpr int32_t kBlock = 4096;
+  static const char* const kNames[] = {"linear", "cubic", "shannon"};
+  state.SetLabel(kNames[state.range(0)]);
+  TransposerBase::setAlgorithm(
+      static_cast<TransposerBase::ALGORITHM>(state.range(0)));
+  std::unique_ptr<TransposerBase> transposer(TransposerBase::newInstance());
+  TransposerBase::setAlgorithm(TransposerBase::CUBIC);
+  transposer->setChannels(bench::kChannels);
+  transposer->setRate(0.9);
+  FIFOSampleBuffer src(bench::kChannels);
+  FIFOSampleBuffer dest(bench::kChannels);
+  const std::vector<float> input = bench::makeSignal(kBlock);
+  for (auto _ : state) {
+    src.putSamples(input.data(), kBlock);
+    transposer->transpose(dest, src);
+    dest.clear();
+  }
+  bench::reportRealtime(state, kBlock);
+}
+BENCHMARK(BM_Transposer)->ArgName("algorithm")->DenseRange(0, 2);
+
+// Arg: filter length in taps.
+void BM_AAFilter(benchmark::State& state) {
+  constexpr int32_t kBlock = 4096;
+  AAFilter filter(static_cast<uint>(state.range(0)));
+  filter.setCutoffFreq(0.45);
+  const std::vector<float> input = bench::makeSignal(kBlock);
+  std::vector<float> output(input.size());
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(filter.evaluate(output.data(), input.data(),
+                                             kBlock, bench::kChannels));
+  }
+  bench::reportRealtime(state, kBlock);
+}
+BENCHMARK(BM_AAFilter)->ArgName("taps")->Arg(32)->Arg(64)->Arg(128);
+
+// Arg: filter length in taps. Uses the CPU-dispatched implementation.
+void BM_FIRFilter(benchmark::State& state) {
+  constexpr int32_t kBlock = 4096;
+  const uint taps = static_cast<uint>(state.range(0));
+  std::unique_ptr<FIRFilter> filter(FIRFilter::newInstance());
+  std::vector<float> coeffs(taps);
+  for (uint i = 0; i < taps; ++i) {
+    coeffs[i] = 1.0f / static_cast<float>(taps);
+  }
+  filter->setCoefficients(coeffs.data(), taps, 0);
+  const std::vector<float> input = bench::makeSignal(kBlock);
+  std::vector<float> output(input.size());
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(filter->evaluate(output.data(), input.data(),
+                                              kBlock, bench::kChannels));
+  }
+  bench::reportRealtime(state, kBlock);
+}
+BENCHMARK(BM_FIRFilter)->ArgName("taps")->Arg(32)->Arg(64)->Arg(128);
+
+}  // namespace
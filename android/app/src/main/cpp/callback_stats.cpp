@@ -0,0 +1,121 @@
+#include "callback_stats.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+constexpr auto kRelaxed = std::memory_order_relaxed;
+
+int bucketFor(int64_t durationNs) {
+  const double us = static_cast<double>(durationNs) / 1000.0;
+  if (us <= 1.0) return 0;
+  const int bucket = static_cast<int>(
+      std::log2(us) * CallbackStats::kBucketsPerOctave);
+  return std::min(bucket, CallbackStats::kBucketCount - 1);
+}
+
+// Geometric centre of a bucket, in microseconds.
+double bucketValueUs(int bucket) {
+  return std::exp2((bucket + 0.5) / CallbackStats::kBucketsPerOctave);
+}
+}  // namespace
+
+void CallbackStats::clearOnAudioThread() {
+  for (auto& bucket : buckets_) bucket.store(0, kRelaxed);
+  callbacks_.store(0, kRelaxed);
+  framesRendered_.store(0, kRelaxed);
+  framesZeroFilled_.store(0, kRelaxed);
+  underflowCallbacks_.store(0, kRelaxed);
+  framesBypassed_.store(0, kRelaxed);
+  maxDurationNs_.store(0, kRelaxed);
+  totalDurationNs_.store(0, kRelaxed);
+  totalBudgetNs_.store(0, kRelaxed);
+  budgetMax_.store(0.0f, kRelaxed);
+  ringMinFillFrames_.store(-1, kRelaxed);
+}
+
+void CallbackStats::record(int64_t durationNs,
+                           int32_t frames,
+                           int32_t sampleRate,
+                           int32_t zeroFilledFrames,
+                           int32_t ringFillFrames,
+                           int32_t stretchBacklogFrames,
+                           int32_t bypassedFrames) {
+  if (resetRequested_.exchange(false, std::memory_order_acquire)) {
+    clearOnAudioThread();
+  }
+  // Single writer: plain load/store pairs are enough for the accumulators.
+  buckets_[bucketFor(durationNs)].fetch_add(1, kRelaxed);
+  callbacks_.store(callbacks_.load(kRelaxed) + 1, kRelaxed);
+  framesRendered_.store(framesRendered_.load(kRelaxed) + frames, kRelaxed);
+  if (zeroFilledFrames > 0) {
+    framesZeroFilled_.store(
+        framesZeroFilled_.load(kRelaxed) + zeroFilledFrames, kRelaxed);
+    underflowCallbacks_.store(underflowCallbacks_.load(kRelaxed) + 1,
+                              kRelaxed);
+  }
+  if (bypassedFrames > 0) {
+    framesBypassed_.store(framesBypassed_.load(kRelaxed) + bypassedFrames,
+                          kRelaxed);
+  }
+  if (durationNs > maxDurationNs_.load(kRelaxed)) {
+    maxDurationNs_.store(durationNs, kRelaxed);
+  }
+  if (sampleRate > 0 && frames > 0) {
+    const int64_t budgetNs =
+        static_cast<int64_t>(frames) * 1000000000LL / sampleRate;
+    totalDurationNs_.store(totalDurationNs_.load(kRelaxed) + durationNs,
+                           kRelaxed);
+    totalBudgetNs_.store(totalBudgetNs_.load(kRelaxed) + budgetNs, kRelaxed);
+    const float utilization = static_cast<float>(durationNs) / budgetNs;
+    if (utilization > budgetMax_.load(kRelaxed)) {
+      budgetMax_.store(utilization, kRelaxed);
+    }
+  }
+  ringFillFrames_.store(ringFillFrames, kRelaxed);
+  const int32_t minFill = ringMinFillFrames_.load(kRelaxed);
+  if (minFill < 0 || ringFillFrames < minFill) {
+    ringMinFillFrames_.store(ringFillFrames, kRelaxed);
+  }
+  stretchBacklogFrames_.store(stretchBacklogFrames, kRelaxed);
+}
+
+CallbackStatsSnapshot CallbackStats::snapshot() const {
+  CallbackStatsSnapshot out;
+  std::array<uint32_t, kBucketCount> counts;
+  uint64_t total = 0;
+  for (int i = 0; i < kBucketCount; ++i) {
+    counts[i] = buckets_[i].load(kRelaxed);
+    total += counts[i];
+  }
+  if (total > 0) {
+    const uint64_t p50Rank = (total + 1) / 2;
+    const uint64_t p99Rank = std::max<uint64_t>(1, (total * 99 + 99) / 100);
+    uint64_t seen = 0;
+    for (int i = 0; i < kBucketCount; ++i) {
+      const uint64_t before = seen;
+      seen += counts[i];
+      if (before < p50Rank && seen >= p50Rank) out.p50Us = bucketValueUs(i);
+      if (before < p99Rank && seen >= p99Rank) {
+        out.p99Us = bucketValueUs(i);
+        break;
+      }
+    }
+  }
+  out.callbacks = callbacks_.load(kRelaxed);
+  out.framesRendered = framesRendered_.load(kRelaxed);
+  out.framesZeroFilled = framesZeroFilled_.load(kRelaxed);
+  out.underflowCallbacks = underflowCallbacks_.load(kRelaxed);
+  out.framesBypassed = framesBypassed_.load(kRelaxed);
+  out.maxUs = maxDurationNs_.load(kRelaxed) / 1000.0;
+  const int64_t budgetNs = totalBudgetNs_.load(kRelaxed);
+  out.budgetAverage =
+      budgetNs > 0
+          ? static_cast<double>(totalDurationNs_.load(kRelaxed)) / budgetNs
+          : 0.0;
+  out.budgetMax = budgetMax_.load(kRelaxed);
+  out.ringFillFrames = ringFillFrames_.load(kRelaxed);
+  out.ringMinFillFrames = std::max(0, ringMinFillFrames_.load(kRelaxed));
+  out.stretchBacklogFrames = stretchBacklogFrames_.load(kRelaxed);
+  return out;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+struct CallbackStatsSnapshot {
+  int64_t callbacks = 0;
+  int64_t framesRendered = 0;
+  int64_t framesZeroFilled = 0;
+  int64_t underflowCallbacks = 0;
+  // Frames the chain produced without running the stretcher or reverb.
+  int64_t framesBypassed = 0;
+  int32_t ringFillFrames = 0;
+  int32_t ringMinFillFrames = 0;
+  int32_t stretchBacklogFrames = 0;
+  double p50Us = 0.0;
+  double p99Us = 0.0;
+  double maxUs = 0.0;
+  // Callback time divided by the audio duration it produced.
+  double budgetAverage = 0.0;
+  double budgetMax = 0.0;
+};
+
+// Per-engine callback instrumentation. record() is called only from the
+// audio callback and touches nothing but relaxed atomics; snapshot() and
+// reset() may be called from any thread.
+class CallbackStats {
+ public:
+  // Durations are bucketed in eighth-octaves from 1 us, so a bucket spans
+  // about 9% and the top bucket starts at ~65 ms.
+  static constexpr int kBucketsPerOctave = 8;
+  static constexpr int kBucketCount = 16 * kBucketsPerOctave;
+
+  void record(int64_t durationNs,
+              int32_t frames,
+              int32_t sampleRate,
+              int32_t zeroFilledFrames,
+              int32_t ringFillFrames,
+              int32_t stretchBacklogFrames,
+              int32_t bypassedFrames);
+  CallbackStatsSnapshot snapshot() const;
+  // Applied by the next record() so the audio thread stays the only writer.
+  void reset() { resetRequested_.store(true, std::memory_order_release); }
+
+ private:
+  void clearOnAudioThread();
+
+  std::array<std::atomic<uint32_t>, kBucketCount> buckets_{};
+  std::atomic<bool> resetRequested_{false};
+  std::atomic<int64_t> callbacks_{0};
+  std::atomic<int64_t> framesRendered_{0};
+  std::atomic<int64_t> framesZeroFilled_{0};
+  std::atomic<int64_t> underflowCallbacks_{0};
+  std::atomic<int64_t> framesBypassed_{0};
+  std::atomic<int64_t> maxDurationNs_{0};
+  std::atomic<int64_t> totalDurationNs_{0};
+  std::atomic<int64_t> totalBudgetNs_{0};
+  std::atomic<float> budgetMax_{0.0f};
+  std::atomic<int32_t> ringFillFrames_{0};
+  std::atomic<int32_t> ringMinFillFrames_{-1};
+  std::atomic<int32_t> stretchBacklogFrames_{0};
+};
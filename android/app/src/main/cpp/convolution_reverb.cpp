@@ -0,0 +1,474 @@
+#include "convolution_reverb.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iterator>
+
+#include "audio_decoder.h"
+#include "denormals.h"
+#include "format_converter.h"
+#include "memory_usage.h"
+#include "simple_reverb.h"
+#include "thread_config.h"
+#include "trace.h"
+
+namespace {
+// Tail partition sizes; each stage starts at twice its partition, where the
+// one before it ends.
+constexpr int32_t kTailPartitions[] = {2048, 16384};
+constexpr int32_t kDecodeBlockFrames = 4096;
+// The callback wakes the worker without holding its mutex, so a wakeup can
+// be missed; the worker never sleeps longer than this.
+constexpr auto kWorkerPoll = std::chrono::milliseconds(2);
+constexpr float kTwoPi = 6.28318530718f;
+
+int32_t divideRoundingUp(int32_t value, int32_t divisor) {
+  return (value + divisor - 1) / divisor;
+}
+}  // namespace
+
+std::shared_ptr<const ImpulseResponse> loadImpulseResponse(
+    const std::string& path) {
+  std::unique_ptr<AudioDecoder> decoder = createAudioDecoder(path);
+  if (!decoder) return nullptr;
+  auto ir = std::make_shared<ImpulseResponse>();
+  ir->sampleRate = decoder->format().sampleRate;
+  ir->channelCount = std::max(1, decoder->format().channelCount);
+  const size_t maxSamples =
+      static_cast<size_t>(ConvolutionReverb::kMaxImpulseSeconds *
+                          ir->sampleRate) *
+      ir->channelCount;
+  std::vector<float> block(static_cast<size_t>(kDecodeBlockFrames) *
+                           ir->channelCount);
+  while (ir->frames.size() < maxSamples) {
+    const int32_t read = decoder->read(block.data(), kDecodeBlockFrames);
+    if (read < 0) return nullptr;
+    if (read == 0) {
+      if (decoder->isEndOfStream()) break;
+      continue;
+    }
+    const size_t samples = std::min(
+        static_cast<size_t>(read) * ir->channelCount,
+        maxSamples - ir->frames.size());
+    ir->frames.insert(ir->frames.end(), block.begin(),
+                      block.begin() + samples);
+  }
+  if (ir->frameCount() == 0) return nullptr;
+  return ir;
+}
+
+ConvolutionReverb::~ConvolutionReverb() { stopWorker(); }
+
+void ConvolutionReverb::configure(const ImpulseResponse& ir,
+                                  int32_t sampleRate,
+                                  int32_t channels,
+                                  bool useWorker) {
+  stopWorker();
+  sampleRate_ = std::max(1, sampleRate);
+  channels_ = std::max(1, channels);
+  irChannels_ = std::max(1, ir.channelCount);
+
+  const float* source = ir.frames.data();
+  int32_t frames = ir.frameCount();
+  FormatConverter converter;
+  if (ir.sampleRate != sampleRate_) {
+    AudioFormatInfo format;
+    format.sampleRate = ir.sampleRate;
+    format.channelCount = irChannels_;
+    converter.configure(format, sampleRate_, irChannels_);
+    frames = converter.process(source, frames, true, &source);
+  }
+
+  // Unit energy per IR channel, so wet white noise keeps its level.
+  std::vector<std::vector<float>> channelsIr(irChannels_);
+  double energy = 0.0;
+  for (int32_t ch = 0; ch < irChannels_; ++ch) {
+    channelsIr[ch].resize(frames);
+    for (int32_t i = 0; i < frames; ++i) {
+      const float sample = source[i * irChannels_ + ch];
+      channelsIr[ch][i] = sample;
+      energy += static_cast<double>(sample) * sample;
+    }
+  }
+  energy /= irChannels_;
+  const float scale =
+      energy > 0.0 ? static_cast<float>(1.0 / std::sqrt(energy)) : 0.0f;
+  for (auto& channel : channelsIr) {
+    for (float& sample : channel) sample *= scale;
+  }
+
+  const int32_t framesPerMs = std::max(1, sampleRate_ / 1000);
+  remainingEnergy_.assign(divideRoundingUp(std::max(frames, 1), framesPerMs),
+                          0.0f);
+  double remaining = 0.0;
+  for (int32_t i = frames - 1; i >= 0; --i) {
+    for (const auto& channel : channelsIr) {
+      remaining += static_cast<double>(channel[i]) * channel[i];
+    }
+    if (i % framesPerMs == 0) {
+      remainingEnergy_[i / framesPerMs] =
+          static_cast<float>(remaining / irChannels_);
+    }
+  }
+
+  const int32_t headEnd = std::min(frames, 2 * kTailPartitions[0]);
+  buildStage(head_, channelsIr, kHeadPartition, 0, std::max(headEnd, 1));
+  tails_.clear();
+  int32_t offset = headEnd;
+  for (size_t i = 0; i < std::size(kTailPartitions) && offset < frames; ++i) {
+    const int32_t partition = kTailPartitions[i];
+    const int32_t end = i + 1 < std::size(kTailPartitions)
+                            ? std::min(frames, 2 * kTailPartitions[i + 1])
+                            : frames;
+    auto tail = std::make_unique<Tail>();
+    buildStage(tail->stage, channelsIr, partition, offset, end);
+    tail->gather.assign(static_cast<size_t>(partition) * channels_, 0.0f);
+    for (TailSlot& slot : tail->slots) {
+      slot.input.assign(tail->gather.size(), 0.0f);
+      slot.output.assign(tail->gather.size(), 0.0f);
+    }
+    tails_.push_back(std::move(tail));
+    offset = end;
+  }
+
+  inputBlock_.assign(static_cast<size_t>(kHeadPartition) * channels_, 0.0f);
+  wetBlock_.assign(inputBlock_.size(), 0.0f);
+  blockFill_ = 0;
+  blockIndex_ = 0;
+  toneState_.assign(channels_, 0.0f);
+  // The last tail partition is mixed in up to three partitions after its
+  // input arrives.
+  const int32_t longest =
+      tails_.empty() ? kHeadPartition : tails_.back()->stage.partition;
+  idleAfterFrames_ =
+      static_cast<int64_t>(frames) + 3 * longest + 2 * kHeadPartition;
+  quietFrames_ = 0;
+  idle_ = false;
+  missedDeadlines_.store(0);
+  configured_ = true;
+  setParameters(wet_, tone_);
+
+  useWorker_ = useWorker && !tails_.empty();
+  if (useWorker_) {
+    stopWorker_ = false;
+    worker_ = std::thread(&ConvolutionReverb::workerLoop, this);
+  }
+}
+
+void ConvolutionReverb::buildStage(Stage& stage,
+                                   const std::vector<std::vector<float>>& ir,
+                                   int32_t partition,
+                                   int32_t offset,
+                                   int32_t end) {
+  stage.partition = partition;
+  stage.offset = offset;
+  stage.count = std::max(1, divideRoundingUp(end - offset, partition));
+  stage.fft = std::make_unique<RealFft>(2 * partition);
+  const size_t bins = static_cast<size_t>(stage.fft->bins());
+  stage.filterRe.assign(bins * stage.count * irChannels_, 0.0f);
+  stage.filterIm.assign(stage.filterRe.size(), 0.0f);
+  stage.historyRe.assign(bins * stage.count * channels_, 0.0f);
+  stage.historyIm.assign(stage.historyRe.size(), 0.0f);
+  stage.historyIndex = 0;
+  stage.window.assign(static_cast<size_t>(2 * partition) * channels_, 0.0f);
+  stage.sumRe.assign(bins, 0.0f);
+  stage.sumIm.assign(bins, 0.0f);
+  stage.time.assign(static_cast<size_t>(2 * partition), 0.0f);
+
+  // Each partition is zero-padded to the FFT size, so overlap-save keeps
+  // the second half of every inverse transform.
+  for (int32_t ch = 0; ch < irChannels_; ++ch) {
+    const auto& samples = ir[ch];
+    for (int32_t k = 0; k < stage.count; ++k) {
+      std::fill(stage.time.begin(), stage.time.end(), 0.0f);
+      const int32_t first = offset + k * partition;
+      const int32_t last =
+          std::min({first + partition, end,
+                    static_cast<int32_t>(samples.size())});
+      if (last > first) {
+        std::copy(samples.begin() + first, samples.begin() + last,
+                  stage.time.begin());
+      }
+      const size_t at = (static_cast<size_t>(ch) * stage.count + k) * bins;
+      stage.fft->forward(stage.time.data(), &stage.filterRe[at],
+                         &stage.filterIm[at]);
+    }
+  }
+}
+
+void ConvolutionReverb::setParameters(float wet, float tone) {
+  wet_ = std::clamp(wet, 0.0f, 1.0f);
+  tone_ = std::clamp(tone, 0.0f, 1.0f);
+  // One-pole lowpass on the wet signal, 2 kHz to 16 kHz.
+  const float cutoffHz = 2000.0f * std::pow(8.0f, tone_);
+  toneCoeff_ = std::exp(-kTwoPi * std::min(cutoffHz, 0.45f * sampleRate_) /
+                        sampleRate_);
+}
+
+size_t ConvolutionReverb::memoryBytes() const {
+  size_t bytes = stageBytes(head_) + vectorBytes(tails_) +
+                 vectorBytes(inputBlock_) + vectorBytes(wetBlock_) +
+                 vectorBytes(toneState_) + vectorBytes(remainingEnergy_);
+  for (const auto& tail : tails_) {
+    bytes += sizeof(Tail) + stageBytes(tail->stage) + vectorBytes(tail->gather);
+    for (const TailSlot& slot : tail->slots) {
+      bytes += vectorBytes(slot.input) + vectorBytes(slot.output);
+    }
+  }
+  return bytes;
+}
+
+size_t ConvolutionReverb::stageBytes(const Stage& stage) {
+  return (stage.fft ? stage.fft->memoryBytes() : 0) +
+         vectorBytes(stage.filterRe) + vectorBytes(stage.filterIm) +
+         vectorBytes(stage.historyRe) + vectorBytes(stage.historyIm) +
+         vectorBytes(stage.window) + vectorBytes(stage.sumRe) +
+         vectorBytes(stage.sumIm) + vectorBytes(stage.time);
+}
+
+float ConvolutionReverb::tailMs(float floorDb) const {
+  if (!configured_ || wet_ <= 0.0f || remainingEnergy_.empty()) return 0.0f;
+  const float total = remainingEnergy_.front();
+  const float floor = total * std::pow(10.0f, floorDb / 10.0f);
+  size_t ms = remainingEnergy_.size();
+  while (ms > 0 && remainingEnergy_[ms - 1] < floor) --ms;
+  return static_cast<float>(ms) +
+         kHeadPartition * 1000.0f / static_cast<float>(sampleRate_);
+}
+
+void ConvolutionReverb::process(float* interleaved, int32_t frames) {
+  SLOWREVERB_TRACE_SCOPE("ConvolutionReverb::process");
+  wetEnergy_ = 0.0f;
+  if (!configured_ || frames <= 0 || wet_ <= 0.0f) return;
+  if (idle_) {
+    const size_t samples = static_cast<size_t>(frames) * channels_;
+    if (SimpleReverb::isSilent(interleaved, samples)) return;
+    idle_ = false;
+    quietFrames_ = 0;
+  }
+  const float dryMix = 1.0f - wet_;
+  float peak = 0.0f;
+  float energy = 0.0f;
+  int32_t done = 0;
+  while (done < frames) {
+    const int32_t count = std::min(frames - done, kHeadPartition - blockFill_);
+    for (int32_t ch = 0; ch < channels_; ++ch) {
+      float* in = &inputBlock_[static_cast<size_t>(ch) * kHeadPartition];
+      const float* wet = &wetBlock_[static_cast<size_t>(ch) * kHeadPartition];
+      float state = toneState_[ch];
+      for (int32_t i = 0; i < count; ++i) {
+        float& sample = interleaved[(done + i) * channels_ + ch];
+        const float wetSample = wet[blockFill_ + i];
+        in[blockFill_ + i] = sample;
+        state = wetSample + toneCoeff_ * (state - wetSample);
+        peak = std::max({peak, std::fabs(sample), std::fabs(state)});
+        sample = sample * dryMix + state * wet_;
+        energy += state * state;
+      }
+      toneState_[ch] = state;
+    }
+    blockFill_ += count;
+    done += count;
+    if (blockFill_ == kHeadPartition) {
+      processBlock();
+      blockFill_ = 0;
+    }
+  }
+  wetEnergy_ = energy * wet_ * wet_ / (static_cast<float>(frames) * channels_);
+  quietFrames_ =
+      peak < SimpleReverb::kSilenceLevel ? quietFrames_ + frames : 0;
+  if (quietFrames_ >= idleAfterFrames_) idle_ = true;
+}
+
+void ConvolutionReverb::processBlock() {
+  runStage(head_, inputBlock_.data(), wetBlock_.data());
+
+  bool submitted = false;
+  for (auto& tail : tails_) {
+    Stage& stage = tail->stage;
+    const int32_t blocksPerPartition = stage.partition / kHeadPartition;
+    const int32_t position =
+        static_cast<int32_t>(blockIndex_ % blocksPerPartition) *
+        kHeadPartition;
+    for (int32_t ch = 0; ch < channels_; ++ch) {
+      std::memcpy(&tail->gather[static_cast<size_t>(ch) * stage.partition +
+                                position],
+                  &inputBlock_[static_cast<size_t>(ch) * kHeadPartition],
+                  sizeof(float) * kHeadPartition);
+    }
+    if (position + kHeadPartition == stage.partition) {
+      const int64_t partitionIndex = blockIndex_ / blocksPerPartition;
+      TailSlot& slot = tail->slots[partitionIndex % kTailSlots];
+      // A slot the worker has not finished stays with it; that partition is
+      // dropped, the worker runs silence through the stage in its place,
+      // and it shows up as a missed deadline.
+      if (slot.completed.load(std::memory_order_acquire) ==
+          slot.submitted.load(std::memory_order_relaxed)) {
+        slot.input.swap(tail->gather);
+        if (useWorker_) {
+          slot.submitted.store(partitionIndex, std::memory_order_release);
+          submitted = true;
+        } else {
+          runTail(*tail, slot, partitionIndex);
+          slot.submitted.store(partitionIndex, std::memory_order_relaxed);
+          slot.completed.store(partitionIndex, std::memory_order_relaxed);
+        }
+      }
+    }
+  }
+  if (submitted) workerWake_.notify_one();
+
+  // Wet output for this block is conv[blockIndex_ * kHeadPartition + i].
+  const int64_t start = blockIndex_ * kHeadPartition;
+  for (auto& tail : tails_) {
+    const Stage& stage = tail->stage;
+    const int64_t relative = start - stage.offset;
+    if (relative < 0) continue;
+    const int64_t partitionIndex = relative / stage.partition;
+    const int32_t at = static_cast<int32_t>(relative % stage.partition);
+    TailSlot& slot = tail->slots[partitionIndex % kTailSlots];
+    if (slot.completed.load(std::memory_order_acquire) != partitionIndex) {
+      if (at == 0) missedDeadlines_.fetch_add(1, std::memory_order_relaxed);
+      continue;
+    }
+    for (int32_t ch = 0; ch < channels_; ++ch) {
+      const float* src =
+          &slot.output[static_cast<size_t>(ch) * stage.partition + at];
+      float* dst = &wetBlock_[static_cast<size_t>(ch) * kHeadPartition];
+      for (int32_t i = 0; i < kHeadPartition; ++i) dst[i] += src[i];
+    }
+  }
+  ++blockIndex_;
+}
+
+void ConvolutionReverb::runStage(Stage& stage,
+                                 const float* input,
+                                 float* output) {
+  SLOWREVERB_TRACE_SCOPE("ConvolutionReverb::runStage");
+  const int32_t partition = stage.partition;
+  const int32_t bins = stage.fft->bins();
+  for (int32_t ch = 0; ch < channels_; ++ch) {
+    float* window = &stage.window[static_cast<size_t>(ch) * 2 * partition];
+    std::memmove(window, window + partition, sizeof(float) * partition);
+    std::memcpy(window + partition,
+                input + static_cast<size_t>(ch) * partition,
+                sizeof(float) * partition);
+    const size_t channelBase = static_cast<size_t>(ch) * stage.count;
+    const size_t current = (channelBase + stage.historyIndex) * bins;
+    stage.fft->forward(window, &stage.historyRe[current],
+                       &stage.historyIm[current]);
+
+    float* sumRe = stage.sumRe.data();
+    float* sumIm = stage.sumIm.data();
+    std::fill(sumRe, sumRe + bins, 0.0f);
+    std::fill(sumIm, sumIm + bins, 0.0f);
+    const size_t filterBase =
+        static_cast<size_t>(ch % irChannels_) * stage.count;
+    for (int32_t k = 0; k < stage.count; ++k) {
+      const int32_t delayed =
+          (stage.historyIndex - k + stage.count) % stage.count;
+      const float* xRe = &stage.historyRe[(channelBase + delayed) * bins];
+      const float* xIm = &stage.historyIm[(channelBase + delayed) * bins];
+      const float* hRe = &stage.filterRe[(filterBase + k) * bins];
+      const float* hIm = &stage.filterIm[(filterBase + k) * bins];
+      for (int32_t b = 0; b < bins; ++b) {
+        sumRe[b] += xRe[b] * hRe[b] - xIm[b] * hIm[b];
+        sumIm[b] += xRe[b] * hIm[b] + xIm[b] * hRe[b];
+      }
+    }
+    stage.fft->inverse(sumRe, sumIm, stage.time.data());
+    std::memcpy(output + static_cast<size_t>(ch) * partition,
+                stage.time.data() + partition, sizeof(float) * partition);
+  }
+  stage.historyIndex = (stage.historyIndex + 1) % stage.count;
+}
+
+void ConvolutionReverb::skipPartition(Stage& stage) {
+  const int32_t partition = stage.partition;
+  const int32_t bins = stage.fft->bins();
+  for (int32_t ch = 0; ch < channels_; ++ch) {
+    float* window = &stage.window[static_cast<size_t>(ch) * 2 * partition];
+    std::memmove(window, window + partition, sizeof(float) * partition);
+    std::fill(window + partition, window + 2 * partition, 0.0f);
+    const size_t current =
+        (static_cast<size_t>(ch) * stage.count + stage.historyIndex) * bins;
+    stage.fft->forward(window, &stage.historyRe[current],
+                       &stage.historyIm[current]);
+  }
+  stage.historyIndex = (stage.historyIndex + 1) % stage.count;
+}
+
+void ConvolutionReverb::runTail(Tail& tail, TailSlot& slot, int64_t index) {
+  Stage& stage = tail.stage;
+  const int64_t dropped = index - tail.ran - 1;
+  if (dropped >= stage.count) {
+    // Silence has filled the whole delay line and the window.
+    std::fill(stage.window.begin(), stage.window.end(), 0.0f);
+    std::fill(stage.historyRe.begin(), stage.historyRe.end(), 0.0f);
+    std::fill(stage.historyIm.begin(), stage.historyIm.end(), 0.0f);
+  } else {
+    for (int64_t i = 0; i < dropped; ++i) skipPartition(stage);
+  }
+  runStage(stage, slot.input.data(), slot.output.data());
+  tail.ran = index;
+}
+
+bool ConvolutionReverb::nextJob(Tail** tail, TailSlot** slot) {
+  int64_t earliest = 0;
+  bool found = false;
+  for (auto& candidate : tails_) {
+    // Partitions of one stage go through its delay line in order.
+    TailSlot* oldest = nullptr;
+    int64_t oldestIndex = 0;
+    for (TailSlot& entry : candidate->slots) {
+      const int64_t index = entry.submitted.load(std::memory_order_acquire);
+      if (index > entry.completed.load(std::memory_order_relaxed) &&
+          (!oldest || index < oldestIndex)) {
+        oldest = &entry;
+        oldestIndex = index;
+      }
+    }
+    if (!oldest) continue;
+    // First frame of the partition's output, in input frames.
+    const int64_t deadline = oldestIndex * candidate->stage.partition +
+                             candidate->stage.offset;
+    if (!found || deadline < earliest) {
+      earliest = deadline;
+      *tail = candidate.get();
+      *slot = oldest;
+      found = true;
+    }
+  }
+  return found;
+}
+
+void ConvolutionReverb::workerLoop() {
+  applyThreadRole(ThreadRole::kDsp, "sr-conv-tail");
+  const ScopedFlushDenormals flushDenormals;
+  std::unique_lock<std::mutex> lock(workerMutex_);
+  while (!stopWorker_) {
+    Tail* tail = nullptr;
+    TailSlot* slot = nullptr;
+    if (!nextJob(&tail, &slot)) {
+      workerWake_.wait_for(lock, kWorkerPoll);
+      continue;
+    }
+    lock.unlock();
+    const int64_t index = slot->submitted.load(std::memory_order_acquire);
+    runTail(*tail, *slot, index);
+    slot->completed.store(index, std::memory_order_release);
+    lock.lock();
+  }
+}
+
+void ConvolutionReverb::stopWorker() {
+  if (!worker_.joinable()) return;
+  {
+    std::lock_guard<std::mutex> lock(workerMutex_);
+    stopWorker_ = true;
+  }
+  workerWake_.notify_one();
+  worker_.join();
+}
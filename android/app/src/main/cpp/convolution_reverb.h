@@ -0,0 +1,174 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "real_fft.h"
+
+// A decoded impulse response, interleaved at its file's rate.
+struct ImpulseResponse {
+  int32_t sampleRate = 48000;
+  int32_t channelCount = 1;
+  std::vector<float> frames;
+
+  int32_t frameCount() const {
+    return static_cast<int32_t>(frames.size() / channelCount);
+  }
+};
+
+// Decodes the impulse response at path with the platform decoder. Files
+// longer than kMaxImpulseSeconds are cut. Returns nullptr if the file
+// cannot be read or holds no audio.
+std::shared_ptr<const ImpulseResponse> loadImpulseResponse(
+    const std::string& path);
+
+// Convolution reverb over a non-uniformly partitioned impulse response.
+// The head runs as uniformly partitioned FFT convolution inside process();
+// the later, longer partitions are computed once per partition on a worker
+// thread, earliest deadline first, and mixed back in when the callback
+// reaches them. Each tail stage starts two of its partitions into the IR,
+// leaving a full partition period to compute it. Without the worker, tail
+// partitions are computed inline, which suits offline rendering.
+//
+// The wet signal lags the dry one by kHeadPartition frames.
+class ConvolutionReverb {
+ public:
+  static constexpr int32_t kHeadPartition = 256;
+  static constexpr float kMaxImpulseSeconds = 10.0f;
+
+  ConvolutionReverb() = default;
+  ~ConvolutionReverb();
+  ConvolutionReverb(const ConvolutionReverb&) = delete;
+  ConvolutionReverb& operator=(const ConvolutionReverb&) = delete;
+
+  // Resamples ir to sampleRate, normalizes it to unit energy and builds the
+  // partition spectra. Output channel c is convolved with IR channel
+  // c % ir.channelCount. Allocates; call before the audio thread uses it.
+  void configure(const ImpulseResponse& ir,
+                 int32_t sampleRate,
+                 int32_t channels,
+                 bool useWorker);
+  void setParameters(float wet, float tone);
+  // After silent input has run through the whole IR with the wet output
+  // staying below SimpleReverb::kSilenceLevel, process() passes silent
+  // input through untouched until sound returns. The partitions then hold
+  // nothing audible, so resuming from them is the same as running on.
+  void process(float* interleaved, int32_t frames);
+  // Time for the IR's remaining energy to fall by floorDb, plus the wet
+  // latency.
+  float tailMs(float floorDb) const;
+
+  bool hasImpulse() const { return configured_; }
+  // True while process() is skipping the convolution.
+  bool idle() const { return idle_; }
+  // Mean square of the wet signal the last process() mixed in.
+  float wetEnergy() const { return wetEnergy_; }
+  // Heap bytes held by the partition spectra, delay lines and blocks.
+  size_t memoryBytes() const;
+  // Tail partitions the worker had not finished when they were due. Each
+  // one drops that partition's contribution; the stage runs on in step,
+  // with silence in place of input the worker never received.
+  int64_t missedDeadlines() const {
+    return missedDeadlines_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  // Uniformly partitioned overlap-save convolution of one IR segment.
+  struct Stage {
+    int32_t partition = 0;
+    int32_t offset = 0;
+    int32_t count = 0;
+    std::unique_ptr<RealFft> fft;
+    // [irChannel][partition][bin]
+    std::vector<float> filterRe;
+    std::vector<float> filterIm;
+    // Frequency-domain delay line, [channel][partition][bin].
+    std::vector<float> historyRe;
+    std::vector<float> historyIm;
+    int32_t historyIndex = 0;
+    // Previous and current input partition, [channel][2 * partition].
+    std::vector<float> window;
+    std::vector<float> sumRe;
+    std::vector<float> sumIm;
+    std::vector<float> time;
+  };
+
+  // One tail partition handed between the audio thread and the worker. The
+  // audio thread only refills a slot the worker has completed.
+  struct TailSlot {
+    std::vector<float> input;
+    std::vector<float> output;
+    std::atomic<int64_t> submitted{-1};
+    std::atomic<int64_t> completed{-1};
+  };
+
+  static constexpr int kTailSlots = 3;
+
+  struct Tail {
+    Stage stage;
+    // Head blocks gathered into the next partition, [channel][partition].
+    std::vector<float> gather;
+    TailSlot slots[kTailSlots];
+    // Last partition run through stage, by whichever thread runs them.
+    int64_t ran = -1;
+  };
+
+  void buildStage(Stage& stage,
+                  const std::vector<std::vector<float>>& ir,
+                  int32_t partition,
+                  int32_t offset,
+                  int32_t end);
+  // Convolves one partition of channel-major input into output.
+  void runStage(Stage& stage, const float* input, float* output);
+  // Moves stage's delay line on by one partition of silence, without
+  // computing output.
+  void skipPartition(Stage& stage);
+  // Runs partition index of tail through its stage, first catching the
+  // stage up on partitions that were dropped before reaching it.
+  void runTail(Tail& tail, TailSlot& slot, int64_t index);
+  static size_t stageBytes(const Stage& stage);
+  // Runs once per kHeadPartition input frames.
+  void processBlock();
+  void workerLoop();
+  // Worker: the pending slot with the earliest deadline, if any.
+  bool nextJob(Tail** tail, TailSlot** slot);
+  void stopWorker();
+
+  bool configured_ = false;
+  int32_t sampleRate_ = 48000;
+  int32_t channels_ = 2;
+  int32_t irChannels_ = 1;
+  float wet_ = 0.25f;
+  float tone_ = 0.6f;
+  float toneCoeff_ = 0.0f;
+
+  Stage head_;
+  std::vector<std::unique_ptr<Tail>> tails_;
+  // [channel][kHeadPartition]; blockFill_ frames of the current block.
+  std::vector<float> inputBlock_;
+  std::vector<float> wetBlock_;
+  int32_t blockFill_ = 0;
+  int64_t blockIndex_ = 0;
+  std::vector<float> toneState_;
+  // Consecutive frames of silent input and wet output, and how many it
+  // takes for silence to fill every partition.
+  int64_t quietFrames_ = 0;
+  int64_t idleAfterFrames_ = 0;
+  bool idle_ = false;
+  float wetEnergy_ = 0.0f;
+  // IR energy left after each millisecond, as a fraction of the total.
+  std::vector<float> remainingEnergy_;
+  std::atomic<int64_t> missedDeadlines_{0};
+
+  bool useWorker_ = false;
+  std::thread worker_;
+  std::mutex workerMutex_;
+  std::condition_variable workerWake_;
+  bool stopWorker_ = false;
+};
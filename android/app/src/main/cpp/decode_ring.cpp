@@ -0,0 +1,223 @@
+#include "decode_ring.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+constexpr float kInt16Scale = 32767.0f;
+constexpr float kInverseInt16Scale = 1.0f / kInt16Scale;
+// 2^-24, the smallest half-float subnormal step.
+constexpr float kHalfSubnormalStep = 5.9604645e-8f;
+
+// Rounds half away from zero by hand: lrint() is a libm call here, and
+// this form vectorizes.
+uint16_t toInt16(float value) {
+  const float scaled = std::min(std::max(value, -1.0f), 1.0f) * kInt16Scale;
+  const float rounded = scaled + std::copysign(0.5f, scaled);
+  return static_cast<uint16_t>(static_cast<int32_t>(rounded));
+}
+
+float fromInt16(uint16_t value) {
+  return static_cast<int16_t>(value) * kInverseInt16Scale;
+}
+
+#if defined(__aarch64__)
+// AArch64 converts in hardware, rounding to nearest even.
+uint16_t toFloat16(float value) {
+  const __fp16 half = static_cast<__fp16>(value);
+  uint16_t bits;
+  std::memcpy(&bits, &half, sizeof(bits));
+  return bits;
+}
+
+float fromFloat16(uint16_t bits) {
+  __fp16 half;
+  std::memcpy(&half, &bits, sizeof(half));
+  return static_cast<float>(half);
+}
+#else
+// IEEE binary16, rounding to nearest even. Audio never comes near the
+// 65504 limit, so overflow just saturates to infinity.
+uint16_t toFloat16(float value) {
+  uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  const uint32_t sign = (bits >> 16) & 0x8000u;
+  bits &= 0x7fffffffu;
+  if (bits >= 0x47800000u) {
+    return static_cast<uint16_t>(sign | (bits > 0x7f800000u ? 0x7e00u
+                                                             : 0x7c00u));
+  }
+  if (bits < 0x38800000u) {
+    // Subnormal in half precision, or zero below half its smallest step.
+    if (bits < 0x33000000u) return static_cast<uint16_t>(sign);
+    const uint32_t exponent = bits >> 23;
+    const uint32_t mantissa = (bits & 0x7fffffu) | 0x800000u;
+    const uint32_t shift = 126 - exponent;
+    uint32_t half = mantissa >> shift;
+    const uint32_t rest = mantissa & ((1u << shift) - 1);
+    const uint32_t halfway = 1u << (shift - 1);
+    if (rest > halfway || (rest == halfway && (half & 1u))) ++half;
+    return static_cast<uint16_t>(sign | half);
+  }
+  // Rebias the exponent from 127 to 15; a rounding carry moves into it.
+  uint32_t half = (bits - 0x38000000u) >> 13;
+  const uint32_t rest = bits & 0x1fffu;
+  if (rest > 0x1000u || (rest == 0x1000u && (half & 1u))) ++half;
+  return static_cast<uint16_t>(sign | half);
+}
+
+float fromFloat16(uint16_t value) {
+  const uint32_t sign = (value & 0x8000u) << 16;
+  const uint32_t exponent = (value >> 10) & 0x1fu;
+  const uint32_t mantissa = value & 0x3ffu;
+  uint32_t bits;
+  if (exponent == 0x1fu) {
+    bits = sign | 0x7f800000u | (mantissa << 13);
+  } else if (exponent != 0) {
+    bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+  } else {
+    const float magnitude = mantissa * kHalfSubnormalStep;
+    return sign ? -magnitude : magnitude;
+  }
+  float result;
+  std::memcpy(&result, &bits, sizeof(result));
+  return result;
+}
+#endif
+}  // namespace
+
+void DecodeRing::configure(size_t capacityFrames,
+                           int32_t channels,
+                           RingSampleFormat format) {
+  capacityFrames_ = capacityFrames;
+  channels_ = std::max(1, channels);
+  format_ = format;
+  const size_t samples = capacityFrames_ * static_cast<size_t>(channels_);
+  if (format_ == RingSampleFormat::kFloat32) {
+    std::vector<uint16_t>().swap(packed_);
+    samples_.assign(samples, 0.0f);
+  } else {
+    std::vector<float>().swap(samples_);
+    packed_.assign(samples, 0);
+  }
+  reset();
+}
+
+void DecodeRing::reset() {
+  writeIndex_.store(0, std::memory_order_release);
+  readIndex_.store(0, std::memory_order_release);
+}
+
+void DecodeRing::release() {
+  reset();
+  capacityFrames_ = 0;
+  std::vector<float>().swap(samples_);
+  std::vector<uint16_t>().swap(packed_);
+}
+
+void DecodeRing::store(size_t offset, const float* src, size_t count) {
+  switch (format_) {
+    case RingSampleFormat::kFloat32:
+      std::memcpy(samples_.data() + offset, src, count * sizeof(float));
+      break;
+    case RingSampleFormat::kInt16:
+      std::transform(src, src + count, packed_.data() + offset, toInt16);
+      break;
+    case RingSampleFormat::kFloat16:
+      std::transform(src, src + count, packed_.data() + offset, toFloat16);
+      break;
+  }
+}
+
+void DecodeRing::load(size_t offset, float* dst, size_t count) const {
+  switch (format_) {
+    case RingSampleFormat::kFloat32:
+      std::memcpy(dst, samples_.data() + offset, count * sizeof(float));
+      break;
+    case RingSampleFormat::kInt16: {
+      const uint16_t* packed = packed_.data() + offset;
+      std::transform(packed, packed + count, dst, fromInt16);
+      break;
+    }
+    case RingSampleFormat::kFloat16: {
+      const uint16_t* packed = packed_.data() + offset;
+      std::transform(packed, packed + count, dst, fromFloat16);
+      break;
+    }
+  }
+}
+
+void DecodeRing::writeFrames(int64_t frameIndex, const float* src, int frames) {
+  if (frames <= 0 || capacityFrames_ == 0) return;
+  const size_t capacity = capacityFrames_;
+  const size_t channels = static_cast<size_t>(channels_);
+  size_t head = static_cast<size_t>(frameIndex % static_cast<int64_t>(capacity));
+  size_t framesToEnd = capacity - head;
+  int firstFrames = std::min<int>(frames, static_cast<int>(framesToEnd));
+  size_t samplesFirst = static_cast<size_t>(firstFrames) * channels;
+  store(head * channels, src, samplesFirst);
+  int remainingFrames = frames - firstFrames;
+  if (remainingFrames > 0) {
+    store(0, src + samplesFirst,
+          static_cast<size_t>(remainingFrames) * channels);
+  }
+}
+
+void DecodeRing::readFrames(int64_t frameIndex, float* dst, int frames) {
+  if (frames <= 0 || capacityFrames_ == 0) return;
+  const size_t capacity = capacityFrames_;
+  const size_t channels = static_cast<size_t>(channels_);
+  size_t tail = static_cast<size_t>(frameIndex % static_cast<int64_t>(capacity));
+  size_t framesToEnd = capacity - tail;
+  int firstFrames = std::min<int>(frames, static_cast<int>(framesToEnd));
+  size_t samplesFirst = static_cast<size_t>(firstFrames) * channels;
+  load(tail * channels, dst, samplesFirst);
+  int remainingFrames = frames - firstFrames;
+  if (remainingFrames > 0) {
+    load(0, dst + samplesFirst,
+         static_cast<size_t>(remainingFrames) * channels);
+  }
+}
+
+int DecodeRing::tryPush(const float* data, int frames) {
+  if (capacityFrames_ == 0 || frames <= 0) return 0;
+  const int accepted = std::min<int>(frames, static_cast<int>(freeFrames()));
+  if (accepted <= 0) return 0;
+  const auto write = writeIndex_.load(std::memory_order_relaxed);
+  writeFrames(write, data, accepted);
+  writeIndex_.store(write + accepted, std::memory_order_release);
+  return accepted;
+}
+
+int DecodeRing::pop(float* dst, int maxFrames) {
+  if (capacityFrames_ == 0 || maxFrames <= 0) return 0;
+  auto write = writeIndex_.load(std::memory_order_acquire);
+  auto read = readIndex_.load(std::memory_order_relaxed);
+  int64_t available = write - read;
+  if (available <= 0) return 0;
+  const int frames = std::min<int>(maxFrames, static_cast<int>(available));
+  readFrames(read, dst, frames);
+  readIndex_.store(read + frames, std::memory_order_release);
+  return frames;
+}
+
+void DecodeRing::discardUntil(int64_t position) {
+  const auto write = writeIndex_.load(std::memory_order_acquire);
+  const auto read = readIndex_.load(std::memory_order_relaxed);
+  const int64_t target = std::min(position, write);
+  if (target > read) {
+    readIndex_.store(target, std::memory_order_release);
+  }
+}
+
+size_t DecodeRing::availableFrames() const {
+  const auto write = writeIndex_.load(std::memory_order_acquire);
+  const auto read = readIndex_.load(std::memory_order_acquire);
+  return write > read ? static_cast<size_t>(write - read) : 0;
+}
+
+size_t DecodeRing::freeFrames() const {
+  const size_t used = availableFrames();
+  return capacityFrames_ > used ? capacityFrames_ - used : 0;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// How DecodeRing stores samples. The 16-bit formats halve the ring's memory
+// and convert on push and pop: kInt16 clips at full scale and resolves
+// about -90 dBFS, kFloat16 keeps headroom with 11 significant bits.
+enum class RingSampleFormat : int32_t {
+  kFloat32 = 0,
+  kInt16 = 1,
+  kFloat16 = 2,
+};
+
+// Single-producer/single-consumer ring of interleaved float frames between a
+// decoder and the processing chain. The producer only advances the write
+// index and the consumer only the read index; configure(), reset() and
+// release() need both sides quiescent.
+class DecodeRing {
+ public:
+  static size_t bytesPerSample(RingSampleFormat format) {
+    return format == RingSampleFormat::kFloat32 ? sizeof(float)
+                                                : sizeof(uint16_t);
+  }
+
+  void configure(size_t capacityFrames,
+                 int32_t channels,
+                 RingSampleFormat format = RingSampleFormat::kFloat32);
+  void reset();
+  void release();
+
+  // Writes as many frames as fit without overwriting unread audio.
+  int tryPush(const float* data, int frames);
+  int pop(float* dst, int maxFrames);
+  // Consumer side: drops unread frames written before `position`, a value
+  // previously read from totalWritten() on the producer side.
+  void discardUntil(int64_t position);
+  // Frames written since the last reset.
+  int64_t totalWritten() const {
+    return writeIndex_.load(std::memory_order_acquire);
+  }
+
+  size_t availableFrames() const;
+  size_t freeFrames() const;
+  size_t capacityFrames() const { return capacityFrames_; }
+  int32_t channelCount() const { return channels_; }
+  RingSampleFormat format() const { return format_; }
+  // Storage held for samples.
+  size_t memoryBytes() const {
+    return capacityFrames_ * static_cast<size_t>(channels_) *
+           bytesPerSample(format_);
+  }
+
+ private:
+  void writeFrames(int64_t frameIndex, const float* src, int frames);
+  void readFrames(int64_t frameIndex, float* dst, int frames);
+  // Sample offsets into the storage, which never wraps within a call.
+  void store(size_t offset, const float* src, size_t count);
+  void load(size_t offset, float* dst, size_t count) const;
+
+  // Only the vector for format_ holds storage.
+  std::vector<float> samples_;
+  std::vector<uint16_t> packed_;
+  size_t capacityFrames_ = 0;
+  int32_t channels_ = 2;
+  RingSampleFormat format_ = RingSampleFormat::kFloat32;
+  std::atomic<int64_t> writeIndex_{0};
+  std::atomic<int64_t> readIndex_{0};
+};
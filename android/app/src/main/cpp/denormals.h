@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <xmmintrin.h>
+#endif
+
+// Flushes denormal floats to zero on the calling thread while in scope, and
+// restores the previous mode after. Reverb feedback decaying towards zero
+// passes through the denormal range, where float math is many times slower
+// on a lot of cores; the values involved are far below audibility.
+class ScopedFlushDenormals {
+ public:
+  ScopedFlushDenormals() : saved_(read()) { write(saved_ | kFlushBits); }
+  ~ScopedFlushDenormals() { write(saved_); }
+  ScopedFlushDenormals(const ScopedFlushDenormals&) = delete;
+  ScopedFlushDenormals& operator=(const ScopedFlushDenormals&) = delete;
+
+ private:
+#if defined(__x86_64__) || defined(__i386__)
+  // MXCSR flush-to-zero (bit 15) and denormals-are-zero (bit 6).
+  static constexpr uint64_t kFlushBits = 0x8040;
+  static uint64_t read() { return _mm_getcsr(); }
+  static void write(uint64_t mode) {
+    _mm_setcsr(static_cast<unsigned int>(mode));
+  }
+#elif defined(__aarch64__)
+  // FPCR.FZ, which on AArch64 flushes denormal inputs as well as results.
+  static constexpr uint64_t kFlushBits = uint64_t{1} << 24;
+  static uint64_t read() {
+    uint64_t mode;
+    asm volatile("mrs %0, fpcr" : "=r"(mode));
+    return mode;
+  }
+  static void write(uint64_t mode) { asm volatile("msr fpcr, %0" ::"r"(mode)); }
+#elif defined(__arm__) && defined(__ARM_FP)
+  // FPSCR.FZ; NEON always flushes, this covers the VFP paths.
+  static constexpr uint64_t kFlushBits = uint64_t{1} << 24;
+  static uint64_t read() {
+    uint32_t mode;
+    asm volatile("vmrs %0, fpscr" : "=r"(mode));
+    return mode;
+  }
+  static void write(uint64_t mode) {
+    asm volatile("vmsr fpscr, %0" ::"r"(static_cast<uint32_t>(mode)));
+  }
+#else
+  static constexpr uint64_t kFlushBits = 0;
+  static uint64_t read() { return 0; }
+  static void write(uint64_t) {}
+#endif
+
+  const uint64_t saved_;
+};
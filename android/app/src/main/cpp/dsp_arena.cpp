@@ -0,0 +1,163 @@
+#include "dsp_arena.h"
+
+#include <algorithm>
+#include <new>
+
+#include "STAllocator.h"
+
+namespace {
+thread_local DspArena* tCurrent = nullptr;
+
+size_t roundUp(size_t bytes) {
+  return (bytes + DspArena::kAlignment - 1) & ~(DspArena::kAlignment - 1);
+}
+
+const soundtouch::BufferAllocator kSoundTouchAllocator = {
+    &DspArena::allocate, &DspArena::release};
+}  // namespace
+
+// Sits in the cache line in front of each allocation.
+struct DspArena::Chunk {
+  // The arena the chunk was asked of; for a heap chunk, the one its
+  // overflow is counted against, if any.
+  DspArena* arena;
+  // Header included. In the block, also the offset to the next chunk.
+  size_t size;
+  // Size of the chunk before it in the block, 0 for the first.
+  size_t previousSize;
+  bool heap;
+  bool free;
+};
+
+DspArena::Scope::Scope(DspArena& arena) : previous_(tCurrent) {
+  tCurrent = &arena;
+}
+
+DspArena::Scope::~Scope() { tCurrent = previous_; }
+
+DspArena::~DspArena() {
+  if (block_) ::operator delete(block_, std::align_val_t(kAlignment));
+}
+
+bool DspArena::reserve(size_t bytes) {
+  if (live_ > 0 || overflowBytes() > 0) return false;
+  bytes = roundUp(bytes);
+  if (bytes != capacityBytes()) {
+    if (block_) ::operator delete(block_, std::align_val_t(kAlignment));
+    block_ = bytes > 0 ? static_cast<char*>(::operator new(
+                             bytes, std::align_val_t(kAlignment)))
+                       : nullptr;
+    capacity_.store(bytes, std::memory_order_relaxed);
+  }
+  top_ = 0;
+  used_.store(0, std::memory_order_relaxed);
+  peak_.store(0, std::memory_order_relaxed);
+  overflows_.store(0, std::memory_order_relaxed);
+  return true;
+}
+
+void* DspArena::allocate(size_t bytes) {
+  DspArena* arena = tCurrent;
+  if (arena) {
+    if (void* payload = arena->allocateChunk(bytes)) return payload;
+  }
+  const size_t size = kAlignment + roundUp(std::max<size_t>(1, bytes));
+  char* raw = static_cast<char*>(
+      ::operator new(size, std::align_val_t(kAlignment)));
+  new (raw) Chunk{arena, size, 0, true, false};
+  if (arena) {
+    arena->overflowBytes_.fetch_add(size, std::memory_order_relaxed);
+    arena->overflows_.fetch_add(1, std::memory_order_relaxed);
+    arena->recordPeak();
+  }
+  return raw + kAlignment;
+}
+
+void DspArena::release(void* block) {
+  if (!block) return;
+  Chunk* chunk =
+      reinterpret_cast<Chunk*>(static_cast<char*>(block) - kAlignment);
+  if (!chunk->heap) {
+    chunk->arena->releaseChunk(chunk);
+    return;
+  }
+  if (chunk->arena) {
+    chunk->arena->overflowBytes_.fetch_sub(chunk->size,
+                                           std::memory_order_relaxed);
+  }
+  ::operator delete(chunk, std::align_val_t(kAlignment));
+}
+
+void* DspArena::allocateChunk(size_t bytes) {
+  static_assert(sizeof(Chunk) <= kAlignment,
+                "a chunk header must fit in front of its payload");
+  const size_t size = kAlignment + roundUp(std::max<size_t>(1, bytes));
+  size_t offset = 0;
+  size_t previousSize = 0;
+  while (offset < top_) {
+    Chunk* chunk = reinterpret_cast<Chunk*>(block_ + offset);
+    if (chunk->free && chunk->size >= size) {
+      const size_t rest = chunk->size - size;
+      // A remainder too small for a header and a line stays with the chunk.
+      if (rest >= 2 * kAlignment) {
+        chunk->size = size;
+        new (block_ + offset + size) Chunk{this, rest, size, false, true};
+        const size_t next = offset + size + rest;
+        if (next < top_) {
+          reinterpret_cast<Chunk*>(block_ + next)->previousSize = rest;
+        }
+      }
+      chunk->free = false;
+      ++live_;
+      used_.fetch_add(chunk->size, std::memory_order_relaxed);
+      return block_ + offset + kAlignment;
+    }
+    previousSize = chunk->size;
+    offset += chunk->size;
+  }
+  if (capacityBytes() - top_ < size) return nullptr;
+  new (block_ + top_) Chunk{this, size, previousSize, false, false};
+  void* payload = block_ + top_ + kAlignment;
+  top_ += size;
+  ++live_;
+  used_.fetch_add(size, std::memory_order_relaxed);
+  recordPeak();
+  return payload;
+}
+
+void DspArena::releaseChunk(Chunk* chunk) {
+  --live_;
+  used_.fetch_sub(chunk->size, std::memory_order_relaxed);
+  chunk->free = true;
+  size_t offset = reinterpret_cast<char*>(chunk) - block_;
+  const size_t next = offset + chunk->size;
+  if (next < top_) {
+    const Chunk* following = reinterpret_cast<Chunk*>(block_ + next);
+    if (following->free) chunk->size += following->size;
+  }
+  if (chunk->previousSize > 0) {
+    Chunk* before =
+        reinterpret_cast<Chunk*>(block_ + offset - chunk->previousSize);
+    if (before->free) {
+      before->size += chunk->size;
+      chunk = before;
+      offset = reinterpret_cast<char*>(chunk) - block_;
+    }
+  }
+  const size_t end = offset + chunk->size;
+  if (end == top_) {
+    // Free space at the end goes back to the untouched part.
+    top_ = offset;
+  } else {
+    reinterpret_cast<Chunk*>(block_ + end)->previousSize = chunk->size;
+  }
+}
+
+void DspArena::recordPeak() {
+  const size_t needed = top_ + overflowBytes();
+  if (needed > peakBytes()) peak_.store(needed, std::memory_order_relaxed);
+}
+
+void installSoundTouchAllocator() {
+  soundtouch::setBufferAllocator(&kSoundTouchAllocator);
+}
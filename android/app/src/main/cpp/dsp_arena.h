@@ -0,0 +1,119 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+// One preallocated, cache-line-aligned block that a processing chain's
+// buffers are carved from: SoundTouch's FIFOs and filters through its
+// buffer hook, and every DspVector. Allocations go to the arena made
+// current on the calling thread by a Scope, or to the heap when there is
+// none. Each allocation starts on its own cache line and remembers where
+// it came from, so it can be released from anywhere.
+//
+// Inside the block, allocation is first fit over the chunks in address
+// order and release merges free neighbours: a walk over a few dozen
+// headers, without locks or system calls, so buffers can grow on the audio
+// thread. A request that does not fit goes to the heap and is counted as
+// an overflow. An arena serves one thread at a time and must outlive every
+// allocation made from it.
+class DspArena {
+ public:
+  static constexpr size_t kAlignment = 64;
+
+  // Makes arena the one allocations on this thread come from until the
+  // scope ends. Scopes nest.
+  class Scope {
+   public:
+    explicit Scope(DspArena& arena);
+    ~Scope();
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+   private:
+    DspArena* previous_;
+  };
+
+  DspArena() = default;
+  ~DspArena();
+  DspArena(const DspArena&) = delete;
+  DspArena& operator=(const DspArena&) = delete;
+
+  // Replaces the block with one of at least bytes, or frees it for 0, and
+  // clears the peak and overflow counts. False, changing nothing, while
+  // anything allocated from this arena is alive.
+  bool reserve(size_t bytes);
+  // From the current arena, or the heap. Aligned to kAlignment.
+  static void* allocate(size_t bytes);
+  // Returns a block from allocate() wherever it came from. Null is ignored.
+  static void release(void* block);
+
+  size_t capacityBytes() const {
+    return capacity_.load(std::memory_order_relaxed);
+  }
+  // Bytes of the block in use, headers and padding included.
+  size_t usedBytes() const { return used_.load(std::memory_order_relaxed); }
+  // The most the arena's allocations have needed at once since reserve():
+  // the furthest the block was used to, plus what overflowed to the heap.
+  size_t peakBytes() const { return peak_.load(std::memory_order_relaxed); }
+  // Heap bytes still held by allocations that did not fit.
+  size_t overflowBytes() const {
+    return overflowBytes_.load(std::memory_order_relaxed);
+  }
+  // Allocations that did not fit since reserve().
+  int64_t overflows() const {
+    return overflows_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  struct Chunk;
+
+  void* allocateChunk(size_t bytes);
+  void releaseChunk(Chunk* chunk);
+  void recordPeak();
+
+  char* block_ = nullptr;
+  // End of the chunks laid out so far; beyond it the block is untouched.
+  size_t top_ = 0;
+  size_t live_ = 0;
+  std::atomic<size_t> capacity_{0};
+  std::atomic<size_t> used_{0};
+  std::atomic<size_t> peak_{0};
+  std::atomic<size_t> overflowBytes_{0};
+  std::atomic<int64_t> overflows_{0};
+};
+
+// Standard allocator over DspArena::allocate(). Stateless: the arena is
+// picked at allocation time, and any instance can release any block.
+template <typename T>
+class DspAllocator {
+ public:
+  using value_type = T;
+  using is_always_equal = std::true_type;
+
+  DspAllocator() = default;
+  template <typename U>
+  DspAllocator(const DspAllocator<U>&) {}
+
+  T* allocate(size_t count) {
+    return static_cast<T*>(DspArena::allocate(count * sizeof(T)));
+  }
+  void deallocate(T* values, size_t) { DspArena::release(values); }
+
+  template <typename U>
+  bool operator==(const DspAllocator<U>&) const {
+    return true;
+  }
+  template <typename U>
+  bool operator!=(const DspAllocator<U>&) const {
+    return false;
+  }
+};
+
+template <typename T>
+using DspVector = std::vector<T, DspAllocator<T>>;
+
+// Sends SoundTouch's buffers through DspArena. Idempotent.
+void installSoundTouchAllocator();
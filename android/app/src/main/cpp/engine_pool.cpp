@@ -0,0 +1,48 @@
+#include "engine_pool.h"
+
+#include <algorithm>
+#include <utility>
+
+void EnginePool::prewarm(int32_t count,
+                         int32_t sampleRate,
+                         int32_t channelCount) {
+  const size_t target = std::min(kMaxIdle, static_cast<size_t>(
+                                               std::max<int32_t>(0, count)));
+  while (idleCount() < target) {
+    auto engine = std::make_unique<AudioEngine>();
+    if (!engine->sink()) return;
+    engine->prepare(sampleRate, channelCount);
+    recycle(std::move(engine));
+  }
+}
+
+std::unique_ptr<AudioEngine> EnginePool::take() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!idle_.empty()) {
+      std::unique_ptr<AudioEngine> engine = std::move(idle_.back());
+      idle_.pop_back();
+      return engine;
+    }
+  }
+  return std::make_unique<AudioEngine>();
+}
+
+void EnginePool::recycle(std::unique_ptr<AudioEngine> engine) {
+  if (!engine) return;
+  engine->stop();
+  engine->restoreDefaults();
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (idle_.size() < kMaxIdle) {
+    idle_.push_back(std::move(engine));
+    return;
+  }
+  // Destroy outside the lock; it joins no threads but frees megabytes.
+  lock.unlock();
+  engine.reset();
+}
+
+size_t EnginePool::idleCount() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return idle_.size();
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "audio_engine.h"
+
+// Idle engines on the default sink whose decode ring and processing buffers
+// are already sized, so creating an engine for a new preview does not build
+// SoundTouch and allocate its buffers from scratch. Disposed engines are
+// stopped and returned here instead of destroyed, up to kMaxIdle.
+class EnginePool {
+ public:
+  static constexpr size_t kMaxIdle = 4;
+
+  // Tops the pool up to `count` idle engines prepared for the given source
+  // format. Builds engines on the calling thread; call it off the hot path.
+  void prewarm(int32_t count, int32_t sampleRate, int32_t channelCount);
+  // An idle engine if there is one, otherwise a new one.
+  std::unique_ptr<AudioEngine> take();
+  // Keeps a stopped engine for reuse, or destroys it when the pool is full.
+  void recycle(std::unique_ptr<AudioEngine> engine);
+  size_t idleCount() const;
+
+ private:
+  mutable std::mutex mutex_;
+  std::vector<std::unique_ptr<AudioEngine>> idle_;
+};
@@ -0,0 +1,114 @@
+#include "engine_table.h"
+
+#include <utility>
+
+EngineTable::Pin::Pin(Pin&& other) noexcept
+    : slot_(other.slot_), engine_(other.engine_) {
+  other.slot_ = nullptr;
+  other.engine_ = nullptr;
+}
+
+EngineTable::Pin& EngineTable::Pin::operator=(Pin&& other) noexcept {
+  if (this != &other) {
+    release();
+    slot_ = std::exchange(other.slot_, nullptr);
+    engine_ = std::exchange(other.engine_, nullptr);
+  }
+  return *this;
+}
+
+EngineTable::Pin::~Pin() { release(); }
+
+void EngineTable::Pin::release() {
+  if (slot_) unpin(slot_);
+  slot_ = nullptr;
+  engine_ = nullptr;
+}
+
+EngineTable::EngineTable() {
+  freeSlots_.reserve(kCapacity);
+  // Hand out low indices first so handles stay small in logs.
+  for (int i = kCapacity - 1; i >= 0; --i) freeSlots_.push_back(i);
+}
+
+void EngineTable::unpin(Slot* slot) {
+  // remove() sets draining before it reads pins, so either it sees this
+  // pin gone or this sees it draining. The notify is under drainMutex so it
+  // cannot fall between remove()'s check and its wait.
+  if (slot->pins.fetch_sub(1, std::memory_order_seq_cst) == 1 &&
+      slot->draining.load(std::memory_order_seq_cst)) {
+    std::lock_guard<std::mutex> lock(slot->drainMutex);
+    slot->drained.notify_all();
+  }
+}
+
+bool EngineTable::decode(intptr_t handle, int* index, uint32_t* generation) {
+  if (handle <= 0) return false;
+  *index = static_cast<int>(handle & (kCapacity - 1));
+  *generation = static_cast<uint32_t>(handle >> kIndexBits) & kGenerationMask;
+  return (*generation & 1u) != 0;
+}
+
+intptr_t EngineTable::insert(std::unique_ptr<AudioEngine> engine,
+                             bool pooled) {
+  if (!engine) return 0;
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (freeSlots_.empty()) return 0;
+  const int index = freeSlots_.back();
+  freeSlots_.pop_back();
+  Slot& slot = slots_[index];
+  slot.engine = std::move(engine);
+  slot.pooled = pooled;
+  // Publishing the odd generation makes the slot visible to acquire().
+  const uint32_t generation =
+      slot.generation.load(std::memory_order_relaxed) + 1;
+  slot.generation.store(generation, std::memory_order_seq_cst);
+  return (static_cast<intptr_t>(generation & kGenerationMask) << kIndexBits) |
+         index;
+}
+
+EngineTable::Pin EngineTable::acquire(intptr_t handle) {
+  int index = 0;
+  uint32_t generation = 0;
+  if (!decode(handle, &index, &generation)) return Pin();
+  Slot& slot = slots_[index];
+  // Pin first, then check: remove() bumps the generation first, then waits
+  // for pins, so one of the two always sees the other.
+  slot.pins.fetch_add(1, std::memory_order_seq_cst);
+  if ((slot.generation.load(std::memory_order_seq_cst) & kGenerationMask) !=
+      generation) {
+    unpin(&slot);
+    return Pin();
+  }
+  return Pin(&slot, slot.engine.get());
+}
+
+std::unique_ptr<AudioEngine> EngineTable::remove(intptr_t handle,
+                                                 bool* pooled) {
+  int index = 0;
+  uint32_t generation = 0;
+  if (!decode(handle, &index, &generation)) return nullptr;
+  Slot& slot = slots_[index];
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const uint32_t current = slot.generation.load(std::memory_order_relaxed);
+    if ((current & kGenerationMask) != generation) return nullptr;
+    slot.draining.store(true, std::memory_order_seq_cst);
+    slot.generation.store(current + 1, std::memory_order_seq_cst);
+  }
+  // The slot is not on the free list yet, so nothing else touches it while
+  // calls that resolved the old generation finish. A start can hold its pin
+  // for seconds, so sleep rather than spin.
+  {
+    std::unique_lock<std::mutex> lock(slot.drainMutex);
+    slot.drained.wait(lock, [&slot] {
+      return slot.pins.load(std::memory_order_seq_cst) == 0;
+    });
+    slot.draining.store(false, std::memory_order_relaxed);
+  }
+  if (pooled) *pooled = slot.pooled;
+  std::unique_ptr<AudioEngine> engine = std::move(slot.engine);
+  std::lock_guard<std::mutex> lock(mutex_);
+  freeSlots_.push_back(index);
+  return engine;
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "audio_engine.h"
+
+// Fixed-size table mapping FFI handles to engines. A handle packs a slot
+// index with that slot's generation, so a handle from a disposed engine
+// never resolves to a later occupant of the same slot.
+//
+// acquire() is wait-free: it pins the slot with one fetch_add and checks the
+// generation. remove() bumps the generation and then sleeps until pins taken
+// before the bump drain, so an engine is never destroyed under a call that
+// resolved it; the last pin to go wakes it. insert() and remove() serialize
+// on a mutex that lookups never take.
+class EngineTable {
+  struct Slot;
+
+ public:
+  static constexpr int kIndexBits = 6;
+  static constexpr int kCapacity = 1 << kIndexBits;
+
+  // Keeps the engine alive until destroyed; empty for unknown or stale
+  // handles.
+  class Pin {
+   public:
+    Pin() = default;
+    Pin(Pin&& other) noexcept;
+    Pin& operator=(Pin&& other) noexcept;
+    Pin(const Pin&) = delete;
+    Pin& operator=(const Pin&) = delete;
+    ~Pin();
+
+    explicit operator bool() const { return engine_ != nullptr; }
+    AudioEngine* operator->() const { return engine_; }
+    AudioEngine* get() const { return engine_; }
+
+   private:
+    friend class EngineTable;
+    Pin(Slot* slot, AudioEngine* engine) : slot_(slot), engine_(engine) {}
+    void release();
+
+    Slot* slot_ = nullptr;
+    AudioEngine* engine_ = nullptr;
+  };
+
+  EngineTable();
+
+  // Returns 0 when every slot is in use. `pooled` is handed back by
+  // remove() so the caller knows where the engine came from.
+  intptr_t insert(std::unique_ptr<AudioEngine> engine, bool pooled);
+  Pin acquire(intptr_t handle);
+  // Invalidates the handle and returns its engine once no call holds it.
+  // Returns nullptr for unknown or already removed handles.
+  std::unique_ptr<AudioEngine> remove(intptr_t handle, bool* pooled);
+
+ private:
+  // Odd generations are live. Only the low kGenerationBits travel in the
+  // handle, which keeps handles positive in a 32-bit intptr_t.
+  static constexpr int kGenerationBits = 24;
+  static constexpr uint32_t kGenerationMask = (1u << kGenerationBits) - 1;
+
+  struct alignas(64) Slot {
+    std::atomic<uint32_t> generation{0};
+    std::atomic<int32_t> pins{0};
+    // Set while remove() waits for pins to drain.
+    std::atomic<bool> draining{false};
+    std::mutex drainMutex;
+    std::condition_variable drained;
+    std::unique_ptr<AudioEngine> engine;
+    bool pooled = false;
+  };
+
+  static bool decode(intptr_t handle, int* index, uint32_t* generation);
+  static void unpin(Slot* slot);
+
+  std::array<Slot, kCapacity> slots_;
+  std::mutex mutex_;
+  std::vector<int> freeSlots_;
+};
@@ -0,0 +1,195 @@
+#include "engine_telemetry.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+
+namespace {
+constexpr auto kRelaxed = std::memory_order_relaxed;
+constexpr int32_t kFftHop = EngineTelemetry::kFftSize / 2;
+constexpr int32_t kFftMask = EngineTelemetry::kFftSize - 1;
+// Time constant of the RMS averages and of the peak and spectrum fall.
+constexpr double kReleaseSeconds = 0.3;
+constexpr double kLowestBandHz = 40.0;
+constexpr double kHighestBandHz = 16000.0;
+constexpr int kReadAttempts = 8;
+constexpr double kPi = 3.14159265358979323846;
+
+static_assert(sizeof(std::atomic<double>) == sizeof(double) &&
+                  std::atomic<double>::is_always_lock_free,
+              "TelemetryBlock must keep the C layout");
+static_assert(sizeof(std::atomic<int64_t>) == sizeof(int64_t) &&
+                  std::atomic<int64_t>::is_always_lock_free,
+              "TelemetryBlock must keep the C layout");
+static_assert(sizeof(std::atomic<float>) == sizeof(float) &&
+                  std::atomic<float>::is_always_lock_free,
+              "TelemetryBlock must keep the C layout");
+
+float decayOver(int32_t frames, int32_t sampleRate) {
+  return static_cast<float>(
+      std::exp(-frames / (kReleaseSeconds * sampleRate)));
+}
+}  // namespace
+
+EngineTelemetry::EngineTelemetry()
+    : block_(std::make_unique<TelemetryBlock>()),
+      fft_(kFftSize),
+      window_(kFftSize),
+      history_(kFftSize, 0.0f),
+      windowed_(kFftSize),
+      re_(fft_.bins()),
+      im_(fft_.bins()) {
+  double powerSum = 0.0;
+  for (int32_t i = 0; i < kFftSize; ++i) {
+    window_[i] = static_cast<float>(
+        0.5 - 0.5 * std::cos(2.0 * kPi * i / kFftSize));
+    powerSum += static_cast<double>(window_[i]) * window_[i];
+  }
+  // Parseval over the positive bins, so a band holding a sine reads its
+  // RMS.
+  binScale_ = static_cast<float>(2.0 / (kFftSize * powerSum));
+}
+
+void EngineTelemetry::reset() {
+  std::fill(history_.begin(), history_.end(), 0.0f);
+  historyIndex_ = 0;
+  sinceFft_ = 0;
+  sincePublish_ = 0;
+  channels_ = 0;
+  frames_ = 0;
+  std::fill(std::begin(peak_), std::end(peak_), 0.0f);
+  std::fill(std::begin(meanSquare_), std::end(meanSquare_), 0.0f);
+  reverbMeanSquare_ = 0.0f;
+  std::fill(std::begin(spectrum_), std::end(spectrum_), 0.0f);
+  publish(0.0, 0.0);
+}
+
+void EngineTelemetry::setSampleRate(int32_t sampleRate) {
+  sampleRate_ = sampleRate;
+  const int32_t lastBin = kFftSize / 2;
+  const double binHz = static_cast<double>(sampleRate) / kFftSize;
+  const double top =
+      std::max(kLowestBandHz * 2.0, std::min(kHighestBandHz, sampleRate / 2.0));
+  constexpr int32_t kBands = TelemetryBlock::kSpectrumBands;
+  for (int32_t b = 0; b <= kBands; ++b) {
+    const double fraction = static_cast<double>(b) / kBands;
+    const double hz = kLowestBandHz * std::pow(top / kLowestBandHz, fraction);
+    int32_t bin = static_cast<int32_t>(std::lround(hz / binHz));
+    bin = std::max(bin, b == 0 ? 1 : bandStart_[b - 1] + 1);
+    bandStart_[b] = std::min(bin, lastBin);
+  }
+}
+
+void EngineTelemetry::update(const float* interleaved,
+                             int32_t frames,
+                             int32_t channels,
+                             int32_t sampleRate,
+                             float reverbEnergy,
+                             double positionMs,
+                             double durationMs) {
+  if (frames <= 0 || channels <= 0 || sampleRate <= 0) return;
+  if (sampleRate != sampleRate_) setSampleRate(sampleRate);
+  constexpr int32_t kMaxChannels = TelemetryBlock::kMaxChannels;
+  const int32_t metered = std::min(channels, kMaxChannels);
+  if (metered != channels_) {
+    channels_ = metered;
+    std::fill(std::begin(peak_), std::end(peak_), 0.0f);
+    std::fill(std::begin(meanSquare_), std::end(meanSquare_), 0.0f);
+  }
+  const float inverseChannels = 1.0f / channels;
+  float blockPeak[kMaxChannels] = {};
+  float sumSquares[kMaxChannels] = {};
+  for (int32_t n = 0; n < frames; ++n) {
+    const float* frame = interleaved + static_cast<size_t>(n) * channels;
+    float sum = 0.0f;
+    for (int32_t ch = 0; ch < channels; ++ch) sum += frame[ch];
+    history_[historyIndex_] = sum * inverseChannels;
+    historyIndex_ = (historyIndex_ + 1) & kFftMask;
+    for (int32_t c = 0; c < metered; ++c) {
+      const float sample = frame[c];
+      blockPeak[c] = std::max(blockPeak[c], std::fabs(sample));
+      sumSquares[c] += sample * sample;
+    }
+  }
+  const float decay = decayOver(frames, sampleRate);
+  for (int32_t c = 0; c < metered; ++c) {
+    peak_[c] = std::max(blockPeak[c], peak_[c] * decay);
+    meanSquare_[c] =
+        decay * meanSquare_[c] + (1.0f - decay) * sumSquares[c] / frames;
+  }
+  reverbMeanSquare_ =
+      decay * reverbMeanSquare_ + (1.0f - decay) * reverbEnergy;
+  frames_ += frames;
+
+  sinceFft_ += frames;
+  if (sinceFft_ >= kFftHop) {
+    analyzeSpectrum();
+    sinceFft_ %= kFftHop;
+  }
+  sincePublish_ += frames;
+  if (sincePublish_ >= kPublishFrames) {
+    publish(positionMs, durationMs);
+    sincePublish_ = 0;
+  }
+}
+
+void EngineTelemetry::analyzeSpectrum() {
+  for (int32_t i = 0; i < kFftSize; ++i) {
+    windowed_[i] = history_[(historyIndex_ + i) & kFftMask] * window_[i];
+  }
+  fft_.forward(windowed_.data(), re_.data(), im_.data());
+  const float decay = decayOver(kFftHop, sampleRate_);
+  for (int32_t b = 0; b < TelemetryBlock::kSpectrumBands; ++b) {
+    float power = 0.0f;
+    for (int32_t k = bandStart_[b]; k < bandStart_[b + 1]; ++k) {
+      power += re_[k] * re_[k] + im_[k] * im_[k];
+    }
+    const float level = std::sqrt(power * binScale_);
+    spectrum_[b] = std::max(level, spectrum_[b] * decay);
+  }
+}
+
+void EngineTelemetry::publish(double positionMs, double durationMs) {
+  TelemetryBlock& block = *block_;
+  const uint32_t sequence = block.sequence.load(kRelaxed);
+  block.sequence.store(sequence + 1, kRelaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  block.sampleRate.store(sampleRate_, kRelaxed);
+  block.frames.store(frames_, kRelaxed);
+  block.positionMs.store(positionMs, kRelaxed);
+  block.durationMs.store(durationMs, kRelaxed);
+  block.channels.store(channels_, kRelaxed);
+  for (int32_t c = 0; c < TelemetryBlock::kMaxChannels; ++c) {
+    block.peak[c].store(peak_[c], kRelaxed);
+    block.rms[c].store(std::sqrt(meanSquare_[c]), kRelaxed);
+  }
+  block.reverbRms.store(std::sqrt(reverbMeanSquare_), kRelaxed);
+  for (int32_t b = 0; b < TelemetryBlock::kSpectrumBands; ++b) {
+    block.spectrum[b].store(spectrum_[b], kRelaxed);
+  }
+  block.sequence.store(sequence + 2, std::memory_order_release);
+}
+
+bool EngineTelemetry::read(const TelemetryBlock& block,
+                           TelemetrySnapshot* out) {
+  for (int attempt = 0; attempt < kReadAttempts; ++attempt) {
+    const uint32_t before = block.sequence.load(std::memory_order_acquire);
+    if (before & 1u) continue;
+    out->sampleRate = block.sampleRate.load(kRelaxed);
+    out->frames = block.frames.load(kRelaxed);
+    out->positionMs = block.positionMs.load(kRelaxed);
+    out->durationMs = block.durationMs.load(kRelaxed);
+    out->channels = block.channels.load(kRelaxed);
+    for (int32_t c = 0; c < TelemetryBlock::kMaxChannels; ++c) {
+      out->peak[c] = block.peak[c].load(kRelaxed);
+      out->rms[c] = block.rms[c].load(kRelaxed);
+    }
+    out->reverbRms = block.reverbRms.load(kRelaxed);
+    for (int32_t b = 0; b < TelemetryBlock::kSpectrumBands; ++b) {
+      out->spectrum[b] = block.spectrum[b].load(kRelaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (block.sequence.load(kRelaxed) == before) return true;
+  }
+  return false;
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "real_fft.h"
+
+// Shared with the UI: NativeTelemetry in lib/native/native_audio.dart maps
+// this struct directly. Every field is a lock-free atomic the size of the
+// plain type, so the layout is the C one. Levels are linear amplitudes.
+struct TelemetryBlock {
+  // Output channels metered; channels past the eighth are left out.
+  static constexpr int32_t kMaxChannels = 8;
+  static constexpr int32_t kSpectrumBands = 16;
+
+  // Odd while a write is in progress; readers retry when it is odd or
+  // changes under them.
+  std::atomic<uint32_t> sequence{0};
+  std::atomic<int32_t> sampleRate{0};
+  // Output frames metered since start(); 0 until the first callback.
+  std::atomic<int64_t> frames{0};
+  std::atomic<double> positionMs{0.0};
+  std::atomic<double> durationMs{0.0};
+  // Slots of peak and rms holding data: the output channel count, at most
+  // kMaxChannels; 0 until the first callback.
+  std::atomic<int32_t> channels{0};
+  // Per output channel: peak with a falling hold, and RMS over about 300 ms.
+  std::atomic<float> peak[kMaxChannels]{};
+  std::atomic<float> rms[kMaxChannels]{};
+  // RMS of the reverb's wet output over about 300 ms.
+  std::atomic<float> reverbRms{0.0f};
+  std::atomic<int32_t> spectrumBands{kSpectrumBands};
+  // RMS of the mono output in log-spaced bands from 40 Hz to 16 kHz (or
+  // Nyquist), held like the peak.
+  std::atomic<float> spectrum[kSpectrumBands]{};
+};
+
+// A consistent copy of a TelemetryBlock.
+struct TelemetrySnapshot {
+  int32_t sampleRate = 0;
+  int64_t frames = 0;
+  double positionMs = 0.0;
+  double durationMs = 0.0;
+  int32_t channels = 0;
+  float peak[TelemetryBlock::kMaxChannels] = {};
+  float rms[TelemetryBlock::kMaxChannels] = {};
+  float reverbRms = 0.0f;
+  float spectrum[TelemetryBlock::kSpectrumBands] = {};
+};
+
+// Meters the engine's output on the audio thread and publishes it through
+// a seqlock into a TelemetryBlock that other threads, and Dart, read
+// without locking. update() is called only from the audio callback;
+// reset() while it is not running; read() from any thread.
+class EngineTelemetry {
+ public:
+  // Publishing at most once per ProcessingChain quantum.
+  static constexpr int32_t kPublishFrames = 128;
+  static constexpr int32_t kFftSize = 1024;
+
+  EngineTelemetry();
+
+  // Stable for the lifetime of this object.
+  const TelemetryBlock* block() const { return block_.get(); }
+
+  // Zeroes the meters and publishes the cleared block.
+  void reset();
+  // Meters frames of interleaved output. reverbEnergy is the mean square of
+  // the reverb's wet output over the same span.
+  void update(const float* interleaved,
+              int32_t frames,
+              int32_t channels,
+              int32_t sampleRate,
+              float reverbEnergy,
+              double positionMs,
+              double durationMs);
+
+  // Copies block into out unless a write kept overlapping the copy.
+  static bool read(const TelemetryBlock& block, TelemetrySnapshot* out);
+
+ private:
+  void setSampleRate(int32_t sampleRate);
+  void analyzeSpectrum();
+  void publish(double positionMs, double durationMs);
+
+  std::unique_ptr<TelemetryBlock> block_;
+  RealFft fft_;
+  std::vector<float> window_;
+  // Mono output, circular, and the windowed copy the FFT reads.
+  std::vector<float> history_;
+  std::vector<float> windowed_;
+  std::vector<float> re_;
+  std::vector<float> im_;
+  // First bin of each band; the last entry ends the top band.
+  int32_t bandStart_[TelemetryBlock::kSpectrumBands + 1] = {};
+  float binScale_ = 0.0f;
+
+  int32_t sampleRate_ = 0;
+  int32_t channels_ = 0;
+  int32_t historyIndex_ = 0;
+  int32_t sinceFft_ = 0;
+  int32_t sincePublish_ = 0;
+  int64_t frames_ = 0;
+  float peak_[TelemetryBlock::kMaxChannels] = {};
+  float meanSquare_[TelemetryBlock::kMaxChannels] = {};
+  float reverbMeanSquare_ = 0.0f;
+  float spectrum_[TelemetryBlock::kSpectrumBands] = {};
+};
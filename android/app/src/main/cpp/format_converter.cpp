@@ -0,0 +1,86 @@
+#include "format_converter.h"
+
+#include <algorithm>
+#include <cstring>
+
+void mixChannels(const float* src,
+                 int32_t srcChannels,
+                 float* dst,
+                 int32_t dstChannels,
+                 int32_t frames) {
+  if (srcChannels == dstChannels) {
+    std::memcpy(dst, src, sizeof(float) * frames * srcChannels);
+    return;
+  }
+  for (int32_t frame = 0; frame < frames; ++frame) {
+    const float* in = src + frame * srcChannels;
+    float* out = dst + frame * dstChannels;
+    if (srcChannels == 1) {
+      std::fill(out, out + dstChannels, in[0]);
+      continue;
+    }
+    for (int32_t ch = 0; ch < dstChannels; ++ch) {
+      float sum = 0.0f;
+      int32_t count = 0;
+      for (int32_t s = ch; s < srcChannels; s += dstChannels) {
+        sum += in[s];
+        ++count;
+      }
+      out[ch] = count > 0 ? sum / count : in[ch % srcChannels];
+    }
+  }
+}
+
+void FormatConverter::configure(const AudioFormatInfo& source,
+                                int32_t sampleRate,
+                                int32_t channelCount) {
+  sourceChannels_ = std::max(1, source.channelCount);
+  channelCount_ = std::max(1, channelCount);
+  const bool sameRate = source.sampleRate == sampleRate;
+  passthrough_ = sameRate && sourceChannels_ == channelCount_;
+  if (sameRate) {
+    resampler_.reset();
+    return;
+  }
+  if (!resampler_) resampler_ = std::make_unique<soundtouch::SoundTouch>();
+  resampler_->setChannels(static_cast<uint32_t>(channelCount_));
+  resampler_->setSampleRate(static_cast<uint32_t>(source.sampleRate));
+  // A playback rate of source/target yields target-rate frames at the
+  // original pitch and speed.
+  resampler_->setRate(static_cast<double>(source.sampleRate) / sampleRate);
+  resampler_->clear();
+}
+
+void FormatConverter::clear() {
+  if (resampler_) resampler_->clear();
+}
+
+int32_t FormatConverter::process(const float* src,
+                                 int32_t frames,
+                                 bool endOfStream,
+                                 const float** out) {
+  if (passthrough_) {
+    *out = src;
+    return frames;
+  }
+  const float* input = src;
+  if (sourceChannels_ != channelCount_) {
+    mixed_.resize(static_cast<size_t>(std::max(frames, 0)) * channelCount_);
+    mixChannels(src, sourceChannels_, mixed_.data(), channelCount_, frames);
+    input = mixed_.data();
+  }
+  if (!resampler_) {
+    *out = input;
+    return frames;
+  }
+  if (frames > 0) {
+    resampler_->putSamples(input, static_cast<uint32_t>(frames));
+  }
+  if (endOfStream) resampler_->flush();
+  const uint32_t ready = resampler_->numSamples();
+  resampled_.resize(static_cast<size_t>(ready) * channelCount_);
+  const uint32_t received =
+      ready > 0 ? resampler_->receiveSamples(resampled_.data(), ready) : 0;
+  *out = resampled_.data();
+  return static_cast<int32_t>(received);
+}
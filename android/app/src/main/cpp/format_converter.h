@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "SoundTouch.h"
+#include "audio_decoder.h"
+
+// Maps interleaved frames between channel layouts: mono is duplicated,
+// wider layouts are folded onto the target channels by averaging.
+void mixChannels(const float* src,
+                 int32_t srcChannels,
+                 float* dst,
+                 int32_t dstChannels,
+                 int32_t frames);
+
+// Brings decoded frames to a fixed rate and channel layout, so tracks of
+// different formats can feed one processing chain. Runs on a decoder
+// thread; sources that already match pass through without a copy.
+class FormatConverter {
+ public:
+  void configure(const AudioFormatInfo& source,
+                 int32_t sampleRate,
+                 int32_t channelCount);
+  // Drops buffered audio, e.g. after the source was repositioned.
+  void clear();
+
+  // Converts `frames` source frames and points *out at the result, valid
+  // until the next call. Pass endOfStream with the last block to drain the
+  // resampler. Returns the number of converted frames.
+  int32_t process(const float* src,
+                  int32_t frames,
+                  bool endOfStream,
+                  const float** out);
+
+  bool isPassthrough() const { return passthrough_; }
+
+ private:
+  int32_t sourceChannels_ = 2;
+  int32_t channelCount_ = 2;
+  bool passthrough_ = true;
+  std::vector<float> mixed_;
+  std::vector<float> resampled_;
+  // Only built when the rates differ.
+  std::unique_ptr<soundtouch::SoundTouch> resampler_;
+};
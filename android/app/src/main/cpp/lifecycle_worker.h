@@ -0,0 +1,34 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// Runs engine starts, stops and disposals off the calling thread, one at a
+// time in the order they were posted, so the UI thread never waits on a
+// decoder opening or a stream closing. The thread starts with the first
+// post(); destruction runs whatever is still queued and then joins it.
+class LifecycleWorker {
+ public:
+  LifecycleWorker() = default;
+  ~LifecycleWorker();
+  LifecycleWorker(const LifecycleWorker&) = delete;
+  LifecycleWorker& operator=(const LifecycleWorker&) = delete;
+
+  void post(std::function<void()> job);
+  // Returns once every job posted before the call has run.
+  void drain();
+
+ private:
+  void run();
+
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::condition_variable idle_;
+  std::deque<std::function<void()>> jobs_;
+  std::thread thread_;
+  bool busy_ = false;
+  bool stopping_ = false;
+};
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// Heap bytes a vector holds, counting capacity rather than size since
+// that is what stays allocated.
+template <typename T, typename Allocator>
+size_t vectorBytes(const std::vector<T, Allocator>& values) {
+  return values.capacity() * sizeof(T);
+}
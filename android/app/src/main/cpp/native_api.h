@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+
+// Structs passed through the C API in native_audio.cpp and
+// native_render.cpp. The Dart mirrors in lib/native/native_audio.dart and
+// the host tests that drive the API use these definitions; the sizes are
+// pinned so a field added here without the mirrors fails to build.
+
+// Mirrors NativeEngineStats in lib/native/native_audio.dart.
+struct SlowReverbEngineStats {
+  int64_t callbacks;
+  int64_t frames_rendered;
+  int64_t frames_zero_filled;
+  int64_t underflow_callbacks;
+  int32_t xrun_count;
+  int32_t frames_per_burst;
+  int32_t sample_rate;
+  int32_t ring_fill_frames;
+  int32_t ring_min_fill_frames;
+  int32_t ring_capacity_frames;
+  int32_t stretch_backlog_frames;
+  int32_t quality_tier;
+  double callback_p50_us;
+  double callback_p99_us;
+  double callback_max_us;
+  double budget_average;
+  double budget_max;
+  double start_ms;
+  double first_audio_ms;
+  int64_t frames_bypassed;
+  double recovery_ms;
+  int32_t stream_recoveries;
+  int32_t reserved;
+  int64_t performance_cores;
+  int32_t decode_nice;
+  int32_t decode_prioritized;
+  int32_t decode_pinned;
+  int32_t pin_to_performance_cores;
+};
+
+// Mirrors NativeEngineMemory in lib/native/native_audio.dart.
+struct SlowReverbEngineMemory {
+  int64_t budget_bytes;
+  int64_t ring_bytes;
+  int64_t chain_bytes;
+  int64_t total_bytes;
+  double ring_ms;
+  double decode_speed;
+  int32_t ring_frames;
+  int32_t ring_format;
+  int64_t arena_bytes;
+  int64_t arena_peak_bytes;
+  int64_t arena_overflows;
+};
+
+// Mirrors RenderParams in lib/native/native_audio.dart.
+struct SlowReverbRenderParams {
+  double tempo;
+  double pitch_semitones;
+  double wet;
+  double decay;
+  double tone;
+  double room;
+  double echo_ms;
+  int32_t sample_rate;
+  int32_t channels;
+  double width;
+  // 0 for SoundTouch, 1 for the phase vocoder; fixed once a stream renders.
+  int32_t stretch_mode;
+};
+
+static_assert(sizeof(SlowReverbEngineStats) == 168,
+              "Update NativeEngineStats in native_audio.dart");
+static_assert(sizeof(SlowReverbEngineMemory) == 80,
+              "Update NativeEngineMemory in native_audio.dart");
+static_assert(sizeof(SlowReverbRenderParams) == 80,
+              "Update RenderParams in native_audio.dart");
@@ -1,85 +1,280 @@
 #include "audio_engine.h"
+#include "engine_pool.h"
+#include "engine_table.h"
+#include "lifecycle_worker.h"
+#include "native_api.h"
+#include "native_export.h"
+#include "thread_config.h"
+#include "trace.h"
 
-#include <jni.h>
-
+#include <atomic>
 #include <cstdint>
 #include <memory>
-#include <mutex>
-#include <unordered_map>
+#include <string>
+#include <utility>
+
+// Receives lifecycle events: `event` is one of the kEvent* values below and
+// `code` is the start result for kEventStarted, 0 otherwise. Called on the
+// lifecycle worker or an engine's decoder thread, never the audio thread.
+typedef void (*SlowReverbEventCallback)(intptr_t handle,
+                                        int32_t event,
+                                        int32_t code);
 
 namespace {
-std::mutex gMutex;
-std::unordered_map<intptr_t, std::unique_ptr<AudioEngine>> gEngines;
-intptr_t gNextHandle = 1;
+constexpr int32_t kEventStarted = 1;
+constexpr int32_t kEventStopped = 2;
+constexpr int32_t kEventDisposed = 3;
+constexpr int32_t kEventEnded = 4;
+
+constexpr int32_t kStartOk = 0;
+constexpr int32_t kStartUnknownHandle = -1;
+constexpr int32_t kStartDecoderFailed = -2;
+constexpr int32_t kStartOutputFailed = -3;
+
+EngineTable gEngines;
+EnginePool gPool;
+std::atomic<SlowReverbEventCallback> gEventCallback{nullptr};
+// Declared after the table and pool so queued jobs finish before either is
+// destroyed.
+LifecycleWorker gWorker;
 
-AudioEngine* getEngine(intptr_t handle) {
-  auto it = gEngines.find(handle);
-  return it == gEngines.end() ? nullptr : it->second.get();
+void emitEvent(intptr_t handle, int32_t event, int32_t code) {
+  SlowReverbEventCallback callback = gEventCallback.load();
+  if (callback) callback(handle, event, code);
+}
+
+intptr_t insertEngine(std::unique_ptr<AudioEngine> engine, bool pooled) {
+  const intptr_t handle = gEngines.insert(std::move(engine), pooled);
+  if (handle == 0) return 0;
+  auto pinned = gEngines.acquire(handle);
+  pinned->setEndedListener(
+      [handle] { emitEvent(handle, kEventEnded, 0); });
+  return handle;
+}
+
+int32_t startEngine(intptr_t handle, const char* path) {
+  auto engine = gEngines.acquire(handle);
+  if (!engine) return kStartUnknownHandle;
+  if (engine->start(path)) return kStartOk;
+  return engine->startError() == StartError::kOutputStream
+             ? kStartOutputFailed
+             : kStartDecoderFailed;
+}
+
+void disposeEngine(intptr_t handle) {
+  bool pooled = false;
+  std::unique_ptr<AudioEngine> engine = gEngines.remove(handle, &pooled);
+  if (!engine) return;
+  if (pooled) {
+    gPool.recycle(std::move(engine));
+  } else {
+    engine->stop();
+  }
 }
 }  // namespace
 
 extern "C" {
 
-__attribute__((visibility("default"))) intptr_t slowreverb_engine_create() {
-  std::lock_guard<std::mutex> lock(gMutex);
-  const intptr_t handle = gNextHandle++;
-  gEngines[handle] = std::make_unique<AudioEngine>();
-  return handle;
+SLOWREVERB_EXPORT intptr_t slowreverb_engine_create() {
+  return insertEngine(gPool.take(), /*pooled=*/true);
+}
+
+// sink_type follows AudioSinkType: 0 platform default, 1 Oboe, 2 ALSA,
+// 3 offline virtual clock. Returns 0 when that backend is not built in.
+SLOWREVERB_EXPORT intptr_t slowreverb_engine_create_with_sink(
+    int32_t sink_type) {
+  auto sink = createAudioSink(static_cast<AudioSinkType>(sink_type));
+  if (!sink) return 0;
+  return insertEngine(std::make_unique<AudioEngine>(std::move(sink)),
+                      /*pooled=*/false);
 }
 
-__attribute__((visibility("default"))) void slowreverb_engine_dispose(
+// Builds up to `count` idle default-sink engines sized for the given source
+// format, so later creates skip the allocation. Returns the idle count.
+SLOWREVERB_EXPORT int32_t slowreverb_engine_pool_prewarm(
+    int32_t count,
+    int32_t sample_rate,
+    int32_t channels) {
+  gPool.prewarm(count, sample_rate, channels);
+  return static_cast<int32_t>(gPool.idleCount());
+}
+
+SLOWREVERB_EXPORT void slowreverb_engine_dispose(
     intptr_t handle) {
-  std::lock_guard<std::mutex> lock(gMutex);
-  auto it = gEngines.find(handle);
-  if (it != gEngines.end()) {
-    it->second->stop();
-    gEngines.erase(it);
-  }
+  disposeEngine(handle);
 }
 
-__attribute__((visibility("default"))) int slowreverb_engine_start(
+// 0 on success, -1 for an unknown handle, -2 when the file cannot be
+// decoded, -3 when the output stream cannot be opened.
+SLOWREVERB_EXPORT int slowreverb_engine_start(
     intptr_t handle,
     const char* path) {
-  auto* engine = getEngine(handle);
-  if (!engine) return -1;
-  return engine->start(path) ? 0 : -2;
+  return startEngine(handle, path);
 }
 
-__attribute__((visibility("default"))) void slowreverb_engine_stop(
+SLOWREVERB_EXPORT void slowreverb_engine_stop(
     intptr_t handle) {
-  auto* engine = getEngine(handle);
+  auto engine = gEngines.acquire(handle);
   if (engine) engine->stop();
 }
 
-__attribute__((visibility("default"))) void slowreverb_engine_set_tempo(
+// Installs the lifecycle event callback; nullptr removes it. Events raised
+// while none is installed are dropped.
+SLOWREVERB_EXPORT void slowreverb_set_event_callback(
+    SlowReverbEventCallback callback) {
+  gEventCallback.store(callback);
+}
+
+// Process-wide: nonzero pins decode, DSP and offline render threads started
+// from now on to the performance cores, where the device has distinct ones.
+SLOWREVERB_EXPORT void slowreverb_set_pin_to_performance_cores(
+    int32_t enabled) {
+  setPinToPerformanceCores(enabled != 0);
+}
+
+// Writes the trace scopes recorded so far as Chrome trace JSON. 0 on
+// success; -1 when tracing was not compiled in, on Android, where the
+// sections go to ATrace, or when the file cannot be written.
+SLOWREVERB_EXPORT int32_t slowreverb_trace_write(const char* path) {
+  return path && writeChromeTrace(path) ? 0 : -1;
+}
+
+// The async variants return at once and run on one lifecycle thread in the
+// order they were called, each finishing with its event. The path is
+// copied before returning.
+SLOWREVERB_EXPORT void slowreverb_engine_start_async(
+    intptr_t handle,
+    const char* path) {
+  gWorker.post([handle, file = std::string(path ? path : "")] {
+    emitEvent(handle, kEventStarted, startEngine(handle, file.c_str()));
+  });
+}
+
+SLOWREVERB_EXPORT void slowreverb_engine_stop_async(
+    intptr_t handle) {
+  gWorker.post([handle] {
+    slowreverb_engine_stop(handle);
+    emitEvent(handle, kEventStopped, 0);
+  });
+}
+
+SLOWREVERB_EXPORT void slowreverb_engine_dispose_async(
+    intptr_t handle) {
+  gWorker.post([handle] {
+    disposeEngine(handle);
+    emitEvent(handle, kEventDisposed, 0);
+  });
+}
+
+// Audio decoded ahead of starting the output, 0-1000 ms. Takes effect on the
+// next start.
+SLOWREVERB_EXPORT void slowreverb_engine_set_preroll_ms(
+    intptr_t handle,
+    double preroll_ms) {
+  auto engine = gEngines.acquire(handle);
+  if (engine) engine->setPrerollMs(preroll_ms);
+}
+
+SLOWREVERB_EXPORT void slowreverb_engine_seek(
+    intptr_t handle,
+    double position_ms) {
+  auto engine = gEngines.acquire(handle);
+  if (engine) engine->seekToMs(position_ms);
+}
+
+// Plays `path` after the current track without stopping the output. The
+// queue is emptied by start and stop, so call this after start.
+SLOWREVERB_EXPORT int slowreverb_engine_enqueue(
+    intptr_t handle,
+    const char* path) {
+  auto engine = gEngines.acquire(handle);
+  if (!engine || !path) return -1;
+  engine->enqueue(path);
+  return 0;
+}
+
+SLOWREVERB_EXPORT void slowreverb_engine_clear_queue(
+    intptr_t handle) {
+  auto engine = gEngines.acquire(handle);
+  if (engine) engine->clearQueue();
+}
+
+// Equal-power crossfade between queued tracks, 0-1500 ms; 0 is gapless.
+SLOWREVERB_EXPORT void slowreverb_engine_set_crossfade_ms(
+    intptr_t handle,
+    double crossfade_ms) {
+  auto engine = gEngines.acquire(handle);
+  if (engine) engine->setCrossfadeMs(crossfade_ms);
+}
+
+// Index of the playing track: 0 for the one passed to start, then one more
+// per queued track reached. -1 for an unknown handle.
+SLOWREVERB_EXPORT int32_t slowreverb_engine_get_track_index(
+    intptr_t handle) {
+  auto engine = gEngines.acquire(handle);
+  return engine ? engine->currentTrackIndex() : -1;
+}
+
+// A/B compare against the unprocessed signal from the same decode. While
+// enabled the dry branch runs alongside the processed one, at the processed
+// tempo when tempo_matched is non-zero or at the original tempo otherwise.
+SLOWREVERB_EXPORT void slowreverb_engine_set_compare(
+    intptr_t handle,
+    int32_t enabled,
+    int32_t tempo_matched) {
+  auto engine = gEngines.acquire(handle);
+  if (engine) engine->setCompare(enabled != 0, tempo_matched != 0);
+}
+
+// Replaces the built-in reverb with convolution by the impulse response WAV
+// at path; an empty or null path switches back. Returns -2 if the file
+// cannot be decoded.
+SLOWREVERB_EXPORT int slowreverb_engine_set_impulse_response(
+    intptr_t handle,
+    const char* path) {
+  auto engine = gEngines.acquire(handle);
+  if (!engine) return -1;
+  return engine->setImpulseResponse(path ? path : "") ? 0 : -2;
+}
+
+// Hears the dry branch when dry is non-zero, the processed one otherwise,
+// switching at the next callback or crossfading over fade_ms (up to 1000).
+SLOWREVERB_EXPORT void slowreverb_engine_set_monitor(
+    intptr_t handle,
+    int32_t dry,
+    double fade_ms) {
+  auto engine = gEngines.acquire(handle);
+  if (engine) engine->setMonitorDry(dry != 0, fade_ms);
+}
+
+SLOWREVERB_EXPORT void slowreverb_engine_set_tempo(
     intptr_t handle,
     double tempo) {
-  auto* engine = getEngine(handle);
+  auto engine = gEngines.acquire(handle);
   if (engine) engine->setTempo(tempo);
 }
 
-__attribute__((visibility("default"))) void slowreverb_engine_set_pitch(
+SLOWREVERB_EXPORT void slowreverb_engine_set_pitch(
     intptr_t handle,
     double semi) {
-  auto* engine = getEngine(handle);
+  auto engine = gEngines.acquire(handle);
   if (engine) engine->setPitchSemiTones(semi);
 }
 
-__attribute__((visibility("default"))) void slowreverb_engine_set_mix(
+SLOWREVERB_EXPORT void slowreverb_engine_set_mix(
     intptr_t handle,
     double wet) {
-  auto* engine = getEngine(handle);
+  auto engine = gEngines.acquire(handle);
   if (engine) engine->setWet(wet);
 }
 
-__attribute__((visibility("default")))
-void slowreverb_engine_set_reverb(
+SLOWREVERB_EXPORT void slowreverb_engine_set_reverb(
     intptr_t handle,
     double decay,
     double tone,
     double room,
     double echo_ms) {
-  auto* engine = getEngine(handle);
+  auto engine = gEngines.acquire(handle);
   if (!engine) return;
   engine->setDecay(decay);
   engine->setTone(tone);
@@ -87,18 +282,155 @@ void slowreverb_engine_set_reverb(
   engine->setEcho(echo_ms);
 }
 
-__attribute__((visibility("default"))) double slowreverb_engine_get_position_ms(
+// Stereo spread of the built-in reverb, 0 (mono wet) to 1.
+SLOWREVERB_EXPORT void slowreverb_engine_set_width(
+    intptr_t handle,
+    double width) {
+  auto engine = gEngines.acquire(handle);
+  if (engine) engine->setWidth(width);
+}
+
+// 0 for SoundTouch, 1 for the phase vocoder; used from the next start().
+SLOWREVERB_EXPORT void slowreverb_engine_set_stretch_mode(
+    intptr_t handle,
+    int32_t mode) {
+  auto engine = gEngines.acquire(handle);
+  if (engine) {
+    engine->setStretchMode(mode == 1 ? StretchMode::kPhaseVocoder
+                                     : StretchMode::kSoundTouch);
+  }
+}
+
+// Caps the engine's buffers at bytes, 0 for no cap; the decode rings give
+// way first. Used from the next track or start().
+SLOWREVERB_EXPORT void slowreverb_engine_set_memory_budget(
+    intptr_t handle,
+    int64_t bytes) {
+  auto engine = gEngines.acquire(handle);
+  if (engine) engine->setMemoryBudget(bytes);
+}
+
+// Decode ring storage: 0 float, 1 int16, 2 half float. Used from the next
+// track or start().
+SLOWREVERB_EXPORT void slowreverb_engine_set_ring_format(
+    intptr_t handle,
+    int32_t format) {
+  auto engine = gEngines.acquire(handle);
+  if (!engine) return;
+  switch (format) {
+    case 1:
+      engine->setRingFormat(RingSampleFormat::kInt16);
+      break;
+    case 2:
+      engine->setRingFormat(RingSampleFormat::kFloat16);
+      break;
+    default:
+      engine->setRingFormat(RingSampleFormat::kFloat32);
+      break;
+  }
+}
+
+SLOWREVERB_EXPORT int slowreverb_engine_get_memory(
+    intptr_t handle,
+    SlowReverbEngineMemory* out) {
+  auto engine = gEngines.acquire(handle);
+  if (!engine || !out) return -1;
+  const EngineMemory memory = engine->memory();
+  out->budget_bytes = memory.budgetBytes;
+  out->ring_bytes = memory.ringBytes;
+  out->chain_bytes = memory.chainBytes;
+  out->total_bytes = memory.totalBytes;
+  out->ring_ms = memory.ringMs;
+  out->decode_speed = memory.decodeSpeed;
+  out->ring_frames = memory.ringFrames;
+  out->ring_format = static_cast<int32_t>(memory.ringFormat);
+  out->arena_bytes = memory.arenaBytes;
+  out->arena_peak_bytes = memory.arenaPeakBytes;
+  out->arena_overflows = memory.arenaOverflows;
+  return 0;
+}
+
+SLOWREVERB_EXPORT double slowreverb_engine_get_position_ms(
     intptr_t handle) {
-  auto* engine = getEngine(handle);
+  auto engine = gEngines.acquire(handle);
   if (!engine) return 0.0;
   return engine->currentPositionMs();
 }
 
-__attribute__((visibility("default"))) double slowreverb_engine_get_duration_ms(
+// Holds the engine at a quality tier, 0 (cheapest) to 3 (best), or lets it
+// follow the callback load for -1, the default.
+SLOWREVERB_EXPORT void slowreverb_engine_set_quality_tier(intptr_t handle,
+                                                          int32_t tier) {
+  auto engine = gEngines.acquire(handle);
+  if (engine) engine->setQualityTier(tier);
+}
+
+// Current quality tier, -1 for an unknown handle.
+SLOWREVERB_EXPORT int32_t slowreverb_engine_get_quality_tier(
+    intptr_t handle) {
+  auto engine = gEngines.acquire(handle);
+  return engine ? engine->qualityTier() : -1;
+}
+
+SLOWREVERB_EXPORT double slowreverb_engine_get_duration_ms(
     intptr_t handle) {
-  auto* engine = getEngine(handle);
+  auto engine = gEngines.acquire(handle);
   if (!engine) return 0.0;
   return engine->durationMs();
 }
 
+// The block the engine's audio callback publishes position, meters and
+// spectrum into, mapped as NativeTelemetry in lib/native/native_audio.dart.
+// Null for an unknown handle. Drop the pointer when the handle is disposed:
+// a pooled engine is cleared and kept rather than freed, and its block then
+// carries the meters of whichever handle takes the engine next.
+SLOWREVERB_EXPORT const TelemetryBlock* slowreverb_engine_get_telemetry(
+    intptr_t handle) {
+  auto engine = gEngines.acquire(handle);
+  return engine ? engine->telemetry() : nullptr;
+}
+
+SLOWREVERB_EXPORT int slowreverb_engine_get_stats(
+    intptr_t handle,
+    SlowReverbEngineStats* out) {
+  auto engine = gEngines.acquire(handle);
+  if (!engine || !out) return -1;
+  const EngineStats stats = engine->stats();
+  const CallbackStatsSnapshot& cb = stats.callback;
+  out->callbacks = cb.callbacks;
+  out->frames_rendered = cb.framesRendered;
+  out->frames_zero_filled = cb.framesZeroFilled;
+  out->underflow_callbacks = cb.underflowCallbacks;
+  out->xrun_count = stats.xrunCount;
+  out->frames_per_burst = stats.framesPerBurst;
+  out->sample_rate = stats.sampleRate;
+  out->ring_fill_frames = cb.ringFillFrames;
+  out->ring_min_fill_frames = cb.ringMinFillFrames;
+  out->ring_capacity_frames = stats.ringCapacityFrames;
+  out->stretch_backlog_frames = cb.stretchBacklogFrames;
+  out->quality_tier = stats.qualityTier;
+  out->callback_p50_us = cb.p50Us;
+  out->callback_p99_us = cb.p99Us;
+  out->callback_max_us = cb.maxUs;
+  out->budget_average = cb.budgetAverage;
+  out->budget_max = cb.budgetMax;
+  out->start_ms = stats.startMs;
+  out->first_audio_ms = stats.firstAudioMs;
+  out->frames_bypassed = cb.framesBypassed;
+  out->recovery_ms = stats.recoveryMs;
+  out->stream_recoveries = stats.streamRecoveries;
+  out->reserved = 0;
+  out->performance_cores = static_cast<int64_t>(stats.performanceCores);
+  out->decode_nice = stats.decodeNice;
+  out->decode_prioritized = stats.decodePrioritized ? 1 : 0;
+  out->decode_pinned = stats.decodePinned ? 1 : 0;
+  out->pin_to_performance_cores = stats.pinToPerformanceCores ? 1 : 0;
+  return 0;
+}
+
+SLOWREVERB_EXPORT void slowreverb_engine_reset_stats(intptr_t handle) {
+  auto engine = gEngines.acquire(handle);
+  if (engine) engine->resetStats();
+}
+
 }  // extern "C"
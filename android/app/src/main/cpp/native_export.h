@@ -0,0 +1,9 @@
+#pragma once
+
+// Marks C entry points resolved by dart:ffi. The Android and Linux builds
+// hide everything else by default; Windows needs an explicit dllexport.
+#if defined(_WIN32)
+#define SLOWREVERB_EXPORT __declspec(dllexport)
+#else
+#define SLOWREVERB_EXPORT __attribute__((visibility("default")))
+#endif
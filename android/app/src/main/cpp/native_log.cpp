@@ -0,0 +1,47 @@
+#include "native_log.h"
+
+#include <cstdarg>
+
+#ifdef __ANDROID__
+#include <android/log.h>
+#else
+#include <cstdio>
+#endif
+
+namespace {
+constexpr char kTag[] = "SlowReverbEngine";
+
+#ifdef __ANDROID__
+void logv(int priority, const char* fmt, va_list args) {
+  __android_log_vprint(priority, kTag, fmt, args);
+}
+#else
+void logv(const char* level, const char* fmt, va_list args) {
+  std::fprintf(stderr, "%s %s: ", kTag, level);
+  std::vfprintf(stderr, fmt, args);
+  std::fputc('\n', stderr);
+}
+#endif
+}  // namespace
+
+void loge(const char* fmt, ...) {
+  va_list args;
+  va_start(args, fmt);
+#ifdef __ANDROID__
+  logv(ANDROID_LOG_ERROR, fmt, args);
+#else
+  logv("E", fmt, args);
+#endif
+  va_end(args);
+}
+
+void logi(const char* fmt, ...) {
+  va_list args;
+  va_start(args, fmt);
+#ifdef __ANDROID__
+  logv(ANDROID_LOG_INFO, fmt, args);
+#else
+  logv("I", fmt, args);
+#endif
+  va_end(args);
+}
@@ -0,0 +1,6 @@
+#pragma once
+
+// Logging helpers shared by the native engine. On Android these go to logcat
+// under the "SlowReverbEngine" tag, elsewhere to stderr.
+void loge(const char* fmt, ...);
+void logi(const char* fmt, ...);
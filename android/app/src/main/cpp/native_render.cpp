@@ -0,0 +1,171 @@
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <unordered_map>
+
+#include "native_api.h"
+#include "native_export.h"
+#include "render_stream.h"
+#include "snippet_renderer.h"
+
+namespace {
+SnippetRenderer gSnippetRenderer;
+
+// Each call holds its own reference to the stream, so a close that races
+// with it only unregisters the handle; the stream is destroyed when the last
+// call using it returns. Handles count up and are never reused, so a closed
+// handle stays unknown rather than reaching a stream opened after it.
+std::mutex gStreamMutex;
+std::unordered_map<intptr_t, std::shared_ptr<RenderStream>> gStreams;
+intptr_t gNextStreamHandle = 1;
+
+intptr_t registerStream(std::shared_ptr<RenderStream> stream) {
+  std::lock_guard<std::mutex> lock(gStreamMutex);
+  const intptr_t handle = gNextStreamHandle++;
+  gStreams[handle] = std::move(stream);
+  return handle;
+}
+
+std::shared_ptr<RenderStream> getStream(intptr_t handle) {
+  std::lock_guard<std::mutex> lock(gStreamMutex);
+  auto it = gStreams.find(handle);
+  return it == gStreams.end() ? nullptr : it->second;
+}
+
+ChainParameters toChainParameters(const SlowReverbRenderParams& p) {
+  ChainParameters params;
+  params.tempo = static_cast<float>(p.tempo);
+  params.pitchSemi = static_cast<float>(p.pitch_semitones);
+  params.wet = static_cast<float>(p.wet);
+  params.decay = static_cast<float>(p.decay);
+  params.tone = static_cast<float>(p.tone);
+  params.room = static_cast<float>(p.room);
+  params.echoMs = static_cast<float>(p.echo_ms);
+  params.width = static_cast<float>(p.width);
+  params.stretch = p.stretch_mode == 1 ? StretchMode::kPhaseVocoder
+                                       : StretchMode::kSoundTouch;
+  return params;
+}
+}  // namespace
+
+extern "C" {
+
+SLOWREVERB_EXPORT int32_t slowreverb_render_snippet(
+    const char* path,
+    double start_ms,
+    double length_ms,
+    const SlowReverbRenderParams* params,
+    float* out,
+    int32_t capacity_frames) {
+  if (!path || !params) return -1;
+  SnippetRequest request;
+  request.path = path;
+  request.startMs = start_ms;
+  request.lengthMs = length_ms;
+  request.outputSampleRate = params->sample_rate;
+  request.outputChannels = params->channels;
+  request.params = toChainParameters(*params);
+  return gSnippetRenderer.render(request, out, capacity_frames);
+}
+
+SLOWREVERB_EXPORT void slowreverb_render_clear_cache() {
+  gSnippetRenderer.clearCache();
+}
+
+// Opens a pull-driven render of a file. With use_thread != 0 decoding runs
+// ahead on its own thread; otherwise pull() decodes inline.
+SLOWREVERB_EXPORT intptr_t slowreverb_render_open_file(
+    const char* path,
+    int32_t output_sample_rate,
+    int32_t use_thread) {
+  if (!path) return 0;
+  auto stream = std::make_shared<RenderStream>();
+  if (!stream->openFile(path, output_sample_rate, use_thread != 0)) return 0;
+  return registerStream(std::move(stream));
+}
+
+// Opens a pull-driven render fed with PCM through slowreverb_render_feed.
+SLOWREVERB_EXPORT intptr_t slowreverb_render_open_pcm(
+    int32_t sample_rate,
+    int32_t channels,
+    int32_t output_sample_rate) {
+  auto stream = std::make_shared<RenderStream>();
+  if (!stream->openPcm(sample_rate, channels, output_sample_rate)) return 0;
+  return registerStream(std::move(stream));
+}
+
+SLOWREVERB_EXPORT int32_t slowreverb_render_feed(intptr_t handle,
+                                                 const float* src,
+                                                 int32_t frames) {
+  std::shared_ptr<RenderStream> stream = getStream(handle);
+  if (!stream || !src) return -1;
+  return stream->feed(src, frames);
+}
+
+SLOWREVERB_EXPORT void slowreverb_render_end_input(intptr_t handle) {
+  std::shared_ptr<RenderStream> stream = getStream(handle);
+  if (stream) stream->endInput();
+}
+
+SLOWREVERB_EXPORT void slowreverb_render_set_params(
+    intptr_t handle,
+    const SlowReverbRenderParams* params) {
+  std::shared_ptr<RenderStream> stream = getStream(handle);
+  if (stream && params) stream->setParameters(toChainParameters(*params));
+}
+
+// Convolves with the impulse response WAV at path instead of the built-in
+// reverb; an empty or null path switches back. Returns -2 if the file cannot
+// be decoded.
+SLOWREVERB_EXPORT int32_t slowreverb_render_set_impulse(intptr_t handle,
+                                                        const char* path) {
+  std::shared_ptr<RenderStream> stream = getStream(handle);
+  if (!stream) return -1;
+  if (!path || !*path) {
+    stream->setImpulseResponse(nullptr);
+    return 0;
+  }
+  std::shared_ptr<const ImpulseResponse> ir = loadImpulseResponse(path);
+  if (!ir) return -2;
+  stream->setImpulseResponse(std::move(ir));
+  return 0;
+}
+
+SLOWREVERB_EXPORT int32_t slowreverb_render_pull(intptr_t handle,
+                                                 float* dst,
+                                                 int32_t frames) {
+  std::shared_ptr<RenderStream> stream = getStream(handle);
+  if (!stream) return -1;
+  return stream->pull(dst, frames);
+}
+
+SLOWREVERB_EXPORT int32_t slowreverb_render_finished(intptr_t handle) {
+  std::shared_ptr<RenderStream> stream = getStream(handle);
+  return !stream || stream->finished() ? 1 : 0;
+}
+
+SLOWREVERB_EXPORT int32_t slowreverb_render_get_format(intptr_t handle,
+                                                       int32_t* sample_rate,
+                                                       int32_t* channels) {
+  std::shared_ptr<RenderStream> stream = getStream(handle);
+  if (!stream) return -1;
+  if (sample_rate) *sample_rate = stream->outputRate();
+  if (channels) *channels = stream->channelCount();
+  return 0;
+}
+
+// Calls still running on the stream keep it alive; the last of them to
+// return destroys it.
+SLOWREVERB_EXPORT void slowreverb_render_close(intptr_t handle) {
+  std::shared_ptr<RenderStream> stream;
+  {
+    std::lock_guard<std::mutex> lock(gStreamMutex);
+    auto it = gStreams.find(handle);
+    if (it == gStreams.end()) return;
+    stream = std::move(it->second);
+    gStreams.erase(it);
+  }
+}
+
+}  // extern "C"
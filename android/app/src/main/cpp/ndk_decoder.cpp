@@ -0,0 +1,198 @@
+#include "ndk_decoder.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "native_log.h"
+#include "trace.h"
+
+namespace {
+constexpr int64_t kDequeueTimeoutUs = 10000;
+}  // namespace
+
+NdkDecoder::~NdkDecoder() { close(); }
+
+void NdkDecoder::close() {
+  if (codec_) {
+    AMediaCodec_stop(codec_);
+    AMediaCodec_delete(codec_);
+    codec_ = nullptr;
+  }
+  if (extractor_) {
+    AMediaExtractor_delete(extractor_);
+    extractor_ = nullptr;
+  }
+}
+
+bool NdkDecoder::open(const std::string& path) {
+  close();
+  extractor_ = AMediaExtractor_new();
+  if (!extractor_) {
+    loge("Failed to create extractor");
+    return false;
+  }
+  if (AMediaExtractor_setDataSource(extractor_, path.c_str()) != AMEDIA_OK) {
+    loge("Failed to set data source %s", path.c_str());
+    close();
+    return false;
+  }
+  int32_t channels = 2;
+  int32_t sampleRate = 48000;
+
+  const size_t trackCount = AMediaExtractor_getTrackCount(extractor_);
+  for (size_t i = 0; i < trackCount; ++i) {
+    AMediaFormat* format = AMediaExtractor_getTrackFormat(extractor_, i);
+    const char* formatMime = nullptr;
+    if (AMediaFormat_getString(format, AMEDIAFORMAT_KEY_MIME,
+                               &formatMime) &&
+        strncmp(formatMime, "audio/", 6) == 0) {
+      AMediaExtractor_selectTrack(extractor_, i);
+      AMediaFormat_getInt32(format, AMEDIAFORMAT_KEY_CHANNEL_COUNT, &channels);
+      AMediaFormat_getInt32(format, AMEDIAFORMAT_KEY_SAMPLE_RATE, &sampleRate);
+      int64_t durationValue = 0;
+      if (AMediaFormat_getInt64(format, AMEDIAFORMAT_KEY_DURATION,
+                                &durationValue)) {
+        format_.durationUs = durationValue;
+      }
+      codec_ = AMediaCodec_createDecoderByType(formatMime);
+      if (codec_ &&
+          AMediaCodec_configure(codec_, format, nullptr, nullptr, 0) ==
+              AMEDIA_OK) {
+        AMediaCodec_start(codec_);
+        AMediaFormat_delete(format);
+        break;
+      }
+      if (codec_) {
+        AMediaCodec_delete(codec_);
+        codec_ = nullptr;
+      }
+    }
+    AMediaFormat_delete(format);
+  }
+
+  if (!codec_) {
+    loge("Failed to initialize decoder for %s", path.c_str());
+    close();
+    return false;
+  }
+  format_.channelCount = std::max(1, channels);
+  format_.sampleRate = std::max(8000, sampleRate);
+  extractorEos_ = false;
+  codecEos_ = false;
+  endOfStream_ = false;
+  return true;
+}
+
+bool NdkDecoder::seekToUs(int64_t positionUs) {
+  if (!codec_) return false;
+  if (AMediaExtractor_seekTo(extractor_, positionUs,
+                             AMEDIAEXTRACTOR_SEEK_PREVIOUS_SYNC) !=
+      AMEDIA_OK) {
+    return false;
+  }
+  AMediaCodec_flush(codec_);
+  pending_.clear();
+  pendingOffset_ = 0;
+  extractorEos_ = false;
+  codecEos_ = false;
+  endOfStream_ = false;
+  // The extractor lands on the previous sync sample; drop decoded audio
+  // that precedes the requested position.
+  skipUntilUs_ = positionUs;
+  return true;
+}
+
+void NdkDecoder::queueInput() {
+  const ssize_t inputIndex =
+      AMediaCodec_dequeueInputBuffer(codec_, kDequeueTimeoutUs);
+  if (inputIndex < 0) return;
+  size_t bufSize = 0;
+  auto* buffer = AMediaCodec_getInputBuffer(codec_, inputIndex, &bufSize);
+  const int sampleSize =
+      AMediaExtractor_readSampleData(extractor_, buffer, bufSize);
+  const int64_t presentationTimeUs = AMediaExtractor_getSampleTime(extractor_);
+  if (sampleSize < 0) {
+    extractorEos_ = true;
+    AMediaCodec_queueInputBuffer(codec_, inputIndex, 0, 0, 0,
+                                 AMEDIACODEC_BUFFER_FLAG_END_OF_STREAM);
+  } else {
+    AMediaCodec_queueInputBuffer(codec_, inputIndex, 0, sampleSize,
+                                 presentationTimeUs, 0);
+    AMediaExtractor_advance(extractor_);
+  }
+}
+
+bool NdkDecoder::drainOutput() {
+  AMediaCodecBufferInfo info;
+  ssize_t outputIndex;
+  {
+    SLOWREVERB_TRACE_SCOPE("AMediaCodec_dequeueOutputBuffer");
+    outputIndex =
+        AMediaCodec_dequeueOutputBuffer(codec_, &info, kDequeueTimeoutUs);
+  }
+  if (outputIndex < 0) {
+    return outputIndex == AMEDIACODEC_INFO_TRY_AGAIN_LATER ||
+           outputIndex == AMEDIACODEC_INFO_OUTPUT_FORMAT_CHANGED ||
+           outputIndex == AMEDIACODEC_INFO_OUTPUT_BUFFERS_CHANGED;
+  }
+  size_t outSize = 0;
+  auto* buffer = AMediaCodec_getOutputBuffer(codec_, outputIndex, &outSize);
+  if (info.size > 0 && buffer) {
+    const int32_t channels = format_.channelCount;
+    int frameCount = info.size / (sizeof(int16_t) * channels);
+    const int16_t* src =
+        reinterpret_cast<const int16_t*>(buffer + info.offset);
+    if (skipUntilUs_ >= 0) {
+      const int64_t skipFrames =
+          (skipUntilUs_ - info.presentationTimeUs) * format_.sampleRate /
+          1000000;
+      if (skipFrames >= frameCount) {
+        frameCount = 0;
+      } else {
+        if (skipFrames > 0) {
+          src += skipFrames * channels;
+          frameCount -= static_cast<int>(skipFrames);
+        }
+        skipUntilUs_ = -1;
+      }
+    }
+    if (frameCount > 0) {
+      pending_.resize(static_cast<size_t>(frameCount) * channels);
+      pendingOffset_ = 0;
+      for (size_t i = 0; i < pending_.size(); ++i) {
+        pending_[i] = static_cast<float>(src[i]) / 32768.0f;
+      }
+    }
+  }
+  AMediaCodec_releaseOutputBuffer(codec_, outputIndex, false);
+  if (info.flags & AMEDIACODEC_BUFFER_FLAG_END_OF_STREAM) {
+    codecEos_ = true;
+  }
+  return true;
+}
+
+int32_t NdkDecoder::read(float* dst, int32_t maxFrames) {
+  if (!codec_) return -1;
+  const size_t channels = static_cast<size_t>(format_.channelCount);
+  if (pendingOffset_ >= pending_.size() && !codecEos_) {
+    pending_.clear();
+    pendingOffset_ = 0;
+    if (!extractorEos_) {
+      queueInput();
+    }
+    if (!drainOutput()) {
+      loge("Decoder output error");
+      return -1;
+    }
+  }
+  const size_t availableFrames = (pending_.size() - pendingOffset_) / channels;
+  const size_t frames =
+      std::min(availableFrames, static_cast<size_t>(std::max(0, maxFrames)));
+  if (frames > 0) {
+    std::memcpy(dst, pending_.data() + pendingOffset_,
+                frames * channels * sizeof(float));
+    pendingOffset_ += frames * channels;
+  }
+  endOfStream_ = codecEos_ && pendingOffset_ >= pending_.size();
+  return static_cast<int32_t>(frames);
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <media/NdkMediaCodec.h>
+#include <media/NdkMediaExtractor.h>
+
+#include <vector>
+
+#include "audio_decoder.h"
+
+// AMediaExtractor + AMediaCodec decoder for any format the device supports.
+class NdkDecoder : public AudioDecoder {
+ public:
+  ~NdkDecoder() override;
+
+  bool open(const std::string& path) override;
+  bool seekToUs(int64_t positionUs) override;
+  int32_t read(float* dst, int32_t maxFrames) override;
+
+ private:
+  void close();
+  void queueInput();
+  // Dequeues one output buffer into pending_. Returns false on a codec
+  // error.
+  bool drainOutput();
+
+  AMediaExtractor* extractor_ = nullptr;
+  AMediaCodec* codec_ = nullptr;
+  bool extractorEos_ = false;
+  bool codecEos_ = false;
+  int64_t skipUntilUs_ = -1;
+  std::vector<float> pending_;
+  size_t pendingOffset_ = 0;
+};
@@ -0,0 +1,80 @@
+#include "oboe_sink.h"
+
+#include "native_log.h"
+#include "trace.h"
+
+OboeSink::~OboeSink() { close(); }
+
+bool OboeSink::open(const AudioSinkConfig& config,
+                    AudioSinkCallback* callback) {
+  close();
+  callback_ = callback;
+  oboe::AudioStreamBuilder builder;
+  builder.setDirection(oboe::Direction::Output)
+      .setPerformanceMode(oboe::PerformanceMode::LowLatency)
+      .setSharingMode(oboe::SharingMode::Exclusive)
+      .setFormat(oboe::AudioFormat::Float)
+      .setSampleRate(config.sampleRate)
+      .setChannelCount(config.channelCount)
+      .setDataCallback(this)
+      .setErrorCallback(this);
+  if (config.framesPerBurst > 0) {
+    builder.setFramesPerDataCallback(config.framesPerBurst);
+  }
+
+  oboe::AudioStream* stream = nullptr;
+  const oboe::Result result = builder.openStream(&stream);
+  if (result != oboe::Result::OK) {
+    loge("Failed to open audio stream: %s", oboe::convertToText(result));
+    return false;
+  }
+  stream_.reset(stream);
+  sampleRate_ = stream_->getSampleRate();
+  channelCount_ = stream_->getChannelCount();
+  framesPerBurst_ = stream_->getFramesPerBurst();
+  maxCallbackFrames_ = stream_->getBufferCapacityInFrames();
+  return true;
+}
+
+bool OboeSink::start() {
+  if (!stream_) return false;
+  if (stream_->requestStart() != oboe::Result::OK) {
+    loge("Failed to start audio stream");
+    return false;
+  }
+  return true;
+}
+
+void OboeSink::stop() {
+  if (stream_) stream_->stop();
+}
+
+void OboeSink::close() {
+  if (stream_) {
+    stream_->stop();
+    stream_->close();
+    stream_.reset();
+  }
+}
+
+int32_t OboeSink::xrunCount() const {
+  if (!stream_) return -1;
+  const auto result = stream_->getXRunCount();
+  return result ? result.value() : -1;
+}
+
+oboe::DataCallbackResult OboeSink::onAudioReady(oboe::AudioStream* /*stream*/,
+                                                void* audioData,
+                                                int32_t numFrames) {
+  SLOWREVERB_TRACE_SCOPE("OboeSink::onAudioReady");
+  const bool keepGoing =
+      callback_->onRender(static_cast<float*>(audioData), numFrames);
+  return keepGoing ? oboe::DataCallbackResult::Continue
+                   : oboe::DataCallbackResult::Stop;
+}
+
+void OboeSink::onErrorAfterClose(oboe::AudioStream* /*stream*/,
+                                 oboe::Result error) {
+  loge("Stream error: %s", oboe::convertToText(error));
+  if (callback_) callback_->onSinkError(oboe::convertToText(error));
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <memory>
+
+#include "oboe/Oboe.h"
+
+#include "audio_sink.h"
+
+class OboeSink : public AudioSink,
+                 public oboe::AudioStreamDataCallback,
+                 public oboe::AudioStreamErrorCallback {
+ public:
+  ~OboeSink() override;
+
+  bool open(const AudioSinkConfig& config,
+            AudioSinkCallback* callback) override;
+  bool start() override;
+  void stop() override;
+  void close() override;
+
+  const char* name() const override { return "oboe"; }
+  int32_t xrunCount() const override;
+
+  oboe::DataCallbackResult onAudioReady(oboe::AudioStream* stream,
+                                        void* audioData,
+                                        int32_t numFrames) override;
+  void onErrorAfterClose(oboe::AudioStream* stream,
+                         oboe::Result error) override;
+
+ private:
+  std::unique_ptr<oboe::AudioStream> stream_;
+  AudioSinkCallback* callback_ = nullptr;
+};
@@ -0,0 +1,154 @@
+#include "offline_sink.h"
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+
+OfflineSink::OfflineSink(const OfflineSinkOptions& options)
+    : options_(options) {}
+
+OfflineSink::~OfflineSink() { close(); }
+
+void OfflineSink::setOptions(const OfflineSinkOptions& options) {
+  options_ = options;
+}
+
+bool OfflineSink::open(const AudioSinkConfig& config,
+                       AudioSinkCallback* callback) {
+  close();
+  if (!callback || config.sampleRate <= 0 || config.channelCount <= 0) {
+    return false;
+  }
+  if (config.framesPerBurst > 0) {
+    options_.minBurstFrames = config.framesPerBurst;
+    options_.maxBurstFrames = config.framesPerBurst;
+  }
+  options_.minBurstFrames = std::max(1, options_.minBurstFrames);
+  options_.maxBurstFrames =
+      std::max(options_.minBurstFrames, options_.maxBurstFrames);
+  if (options_.deviceBufferFrames < options_.maxBurstFrames) {
+    options_.deviceBufferFrames = options_.maxBurstFrames * 2;
+  }
+  callback_ = callback;
+  sampleRate_ = options_.deviceSampleRate > 0 ? options_.deviceSampleRate
+                                              : config.sampleRate;
+  channelCount_ = config.channelCount;
+  framesPerBurst_ = options_.maxBurstFrames;
+  maxCallbackFrames_ = options_.maxBurstFrames;
+  buffer_.assign(static_cast<size_t>(maxCallbackFrames_) * channelCount_,
+                 0.0f);
+  return true;
+}
+
+bool OfflineSink::start() {
+  if (!callback_ || running_.load()) return false;
+  {
+    std::lock_guard<std::mutex> lock(statsMutex_);
+    stats_ = OfflineSinkStats();
+  }
+  finished_.store(false);
+  running_.store(true);
+  thread_ = std::thread(&OfflineSink::renderLoop, this);
+  return true;
+}
+
+void OfflineSink::stop() {
+  running_.store(false);
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+void OfflineSink::close() {
+  stop();
+  callback_ = nullptr;
+}
+
+int32_t OfflineSink::xrunCount() const {
+  std::lock_guard<std::mutex> lock(statsMutex_);
+  return stats_.xruns;
+}
+
+OfflineSinkStats OfflineSink::stats() const {
+  std::lock_guard<std::mutex> lock(statsMutex_);
+  return stats_;
+}
+
+void OfflineSink::waitUntilFinished() {
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+  running_.store(false);
+}
+
+void OfflineSink::disconnect(int32_t nextSampleRate) {
+  stop();
+  options_.deviceSampleRate = nextSampleRate;
+  if (callback_) callback_->onSinkError("device disconnected");
+}
+
+void OfflineSink::renderLoop() {
+  using Clock = std::chrono::steady_clock;
+  std::minstd_rand rng(options_.seed);
+  std::uniform_int_distribution<int32_t> burstDist(options_.minBurstFrames,
+                                                   options_.maxBurstFrames);
+  std::uniform_real_distribution<double> jitterDist(
+      0.0, std::max(0.0, options_.jitterMs));
+  const double msPerFrame = 1000.0 / sampleRate_;
+  const double bufferFrames = options_.deviceBufferFrames;
+  const Clock::time_point origin = Clock::now();
+
+  // Virtual device state: `queued` frames are waiting to be played and
+  // drain at the sample rate as `nowMs` advances.
+  double nowMs = 0.0;
+  double queued = 0.0;
+  int64_t rendered = 0;
+
+  while (running_.load()) {
+    int32_t burst = burstDist(rng);
+    if (options_.maxFrames > 0) {
+      const int64_t left = options_.maxFrames - rendered;
+      if (left <= 0) break;
+      burst = static_cast<int32_t>(std::min<int64_t>(burst, left));
+    }
+
+    // Wake when the device has room for the burst, plus scheduling jitter.
+    const double roomAtMs =
+        nowMs + std::max(0.0, queued - (bufferFrames - burst)) * msPerFrame;
+    const double wakeMs = roomAtMs + jitterDist(rng);
+    queued = std::max(0.0, queued - (wakeMs - nowMs) / msPerFrame);
+    nowMs = wakeMs;
+    if (options_.paced) {
+      std::this_thread::sleep_until(
+          origin + std::chrono::duration_cast<Clock::duration>(
+                       std::chrono::duration<double, std::milli>(wakeMs)));
+    }
+
+    const Clock::time_point begin = Clock::now();
+    const bool keepGoing = callback_->onRender(buffer_.data(), burst);
+    const double callbackMs =
+        std::chrono::duration<double, std::milli>(Clock::now() - begin)
+            .count();
+
+    // The device keeps playing while the callback runs. Playback starts
+    // with the first buffer, so the first callback cannot underrun.
+    nowMs += callbackMs;
+    if (rendered > 0) queued -= callbackMs / msPerFrame;
+    const bool xrun = queued < 0.0;
+    queued = std::max(0.0, queued) + burst;
+    rendered += burst;
+
+    {
+      std::lock_guard<std::mutex> lock(statsMutex_);
+      stats_.callbacks += 1;
+      stats_.frames = rendered;
+      if (xrun) stats_.xruns += 1;
+      stats_.virtualTimeMs = nowMs;
+      stats_.totalCallbackMs += callbackMs;
+      stats_.maxCallbackMs = std::max(stats_.maxCallbackMs, callbackMs);
+      stats_.outputLatencyMs = queued * msPerFrame;
+    }
+    if (!keepGoing) break;
+  }
+  finished_.store(true);
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "audio_sink.h"
+
+struct OfflineSinkOptions {
+  int32_t minBurstFrames = 192;
+  int32_t maxBurstFrames = 192;
+  // Frames the simulated device holds; 0 means two maximum bursts.
+  int32_t deviceBufferFrames = 0;
+  // Each wakeup is delayed by a uniform random amount up to this value.
+  double jitterMs = 0.0;
+  // Sleep so the virtual clock tracks wall time. When false the sink runs
+  // as fast as the callback allows and only the virtual clock advances.
+  bool paced = true;
+  // Stop after this many frames; 0 runs until stop().
+  int64_t maxFrames = 0;
+  // Rate the simulated device runs at; 0 takes the one asked for.
+  int32_t deviceSampleRate = 0;
+  uint32_t seed = 1;
+};
+
+struct OfflineSinkStats {
+  int64_t callbacks = 0;
+  int64_t frames = 0;
+  int32_t xruns = 0;
+  double virtualTimeMs = 0.0;
+  double totalCallbackMs = 0.0;
+  double maxCallbackMs = 0.0;
+  // Audio queued in the simulated device after the last callback.
+  double outputLatencyMs = 0.0;
+};
+
+// Drives the render callback from a simulated device clock instead of audio
+// hardware. Burst sizes and wakeup jitter come from a seeded generator, so a
+// given configuration always requests the same sequence of buffers. The
+// device drains at the sample rate while the callback runs; an xrun is
+// counted whenever it would have run dry.
+class OfflineSink : public AudioSink {
+ public:
+  OfflineSink() = default;
+  explicit OfflineSink(const OfflineSinkOptions& options);
+  ~OfflineSink() override;
+
+  void setOptions(const OfflineSinkOptions& options);
+
+  bool open(const AudioSinkConfig& config,
+            AudioSinkCallback* callback) override;
+  bool start() override;
+  void stop() override;
+  void close() override;
+
+  const char* name() const override { return "offline"; }
+  int32_t xrunCount() const override;
+
+  OfflineSinkStats stats() const;
+  // True once maxFrames were rendered or the callback asked to stop.
+  bool finished() const { return finished_.load(); }
+  // Blocks until finished() or the sink is stopped.
+  void waitUntilFinished();
+  // Simulates the device going away: rendering stops and the callback gets
+  // onSinkError(), as from Oboe after a disconnect. The next open() finds
+  // a device at nextSampleRate, or at the requested rate for 0.
+  void disconnect(int32_t nextSampleRate);
+
+ private:
+  void renderLoop();
+
+  OfflineSinkOptions options_;
+  AudioSinkCallback* callback_ = nullptr;
+  std::vector<float> buffer_;
+  std::thread thread_;
+  std::atomic<bool> running_{false};
+  std::atomic<bool> finished_{false};
+  mutable std::mutex statsMutex_;
+  OfflineSinkStats stats_;
+};
@@ -0,0 +1,420 @@
+#include "phase_vocoder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#include "RateTransposer.h"
+#include "memory_usage.h"
+#include "thread_config.h"
+#include "trace.h"
+
+namespace {
+constexpr float kTwoPi = 6.28318530717958647692f;
+// 2048-point frames at 44.1 and 48 kHz.
+constexpr double kFrameSeconds = 0.035;
+// Four-times overlap; Hann squared then sums to 1.5 at every sample.
+constexpr int32_t kOverlap = 4;
+constexpr float kOverlapGain = 1.0f / 1.5f;
+// Frames a batch holds when worker threads share it.
+constexpr int32_t kParallelBatchFrames = 16;
+constexpr int32_t kMaxThreads = 4;
+// A frame is a transient when its positive spectral flux, as a fraction of
+// its magnitude, exceeds the running average by this ratio and the floor.
+constexpr float kTransientRatio = 2.5f;
+constexpr float kMinTransientFlux = 0.08f;
+constexpr float kFluxSmoothing = 0.1f;
+// Peaks quieter than this relative to the loudest bin do not lock phases.
+constexpr float kPeakFloor = 1e-4f;
+
+float wrapPhase(float phase) {
+  return phase - kTwoPi * std::nearbyint(phase / kTwoPi);
+}
+}  // namespace
+
+PhaseVocoder::PhaseVocoder()
+    : transposer_(std::make_unique<soundtouch::RateTransposer>()) {
+  setOutPipe(transposer_.get());
+}
+
+PhaseVocoder::~PhaseVocoder() { stopWorkers(); }
+
+int32_t PhaseVocoder::offlineThreads() {
+  return std::clamp<int32_t>(
+      static_cast<int32_t>(std::thread::hardware_concurrency()), 1,
+      kMaxThreads);
+}
+
+size_t PhaseVocoder::memoryBytes() const {
+  size_t bytes = (fft_ ? fft_->memoryBytes() : 0) + vectorBytes(workerFfts_);
+  for (const auto& fft : workerFfts_) bytes += fft->memoryBytes();
+  for (const auto* values :
+       {&window_, &synthesisWindow_, &spectraRe_, &spectraIm_, &rotationRe_,
+        &rotationIm_, &frames_, &magnitude_, &previousMagnitude_, &phase_,
+        &previousPhase_, &synthesisPhase_, &overlap_, &hopOutput_,
+        &leadIn_}) {
+    bytes += vectorBytes(*values);
+  }
+  return bytes + vectorBytes(batchOffsets_) + vectorBytes(peaks_);
+}
+
+void PhaseVocoder::configure(int32_t sampleRate,
+                             int32_t channels,
+                             int32_t threads) {
+  stopWorkers();
+  sampleRate_ = std::max(8000, sampleRate);
+  channels_ = std::max(1, channels);
+  // At least kFrameSeconds per frame: long enough to resolve low partials,
+  // short enough that onsets smear no further than the transient reset.
+  fftSize_ = 256;
+  while (fftSize_ < kFrameSeconds * sampleRate_) fftSize_ *= 2;
+  bins_ = fftSize_ / 2 + 1;
+  synthesisHop_ = fftSize_ / kOverlap;
+  fft_ = std::make_unique<RealFft>(fftSize_);
+
+  window_.resize(fftSize_);
+  synthesisWindow_.resize(fftSize_);
+  for (int32_t n = 0; n < fftSize_; ++n) {
+    window_[n] = 0.5f - 0.5f * std::cos(kTwoPi * n / fftSize_);
+    synthesisWindow_[n] = window_[n] * kOverlapGain;
+  }
+
+  threads = std::clamp(threads, 1, kMaxThreads);
+  batchCapacity_ = threads > 1 ? kParallelBatchFrames : 1;
+  const size_t spectra =
+      static_cast<size_t>(batchCapacity_) * channels_ * bins_;
+  batchOffsets_.assign(batchCapacity_, 0);
+  spectraRe_.assign(spectra, 0.0f);
+  spectraIm_.assign(spectra, 0.0f);
+  rotationRe_.assign(static_cast<size_t>(batchCapacity_) * bins_, 1.0f);
+  rotationIm_.assign(static_cast<size_t>(batchCapacity_) * bins_, 0.0f);
+  frames_.assign(static_cast<size_t>(batchCapacity_) * channels_ * fftSize_,
+                 0.0f);
+
+  magnitude_.assign(bins_, 0.0f);
+  previousMagnitude_.assign(bins_, 0.0f);
+  phase_.assign(bins_, 0.0f);
+  previousPhase_.assign(bins_, 0.0f);
+  synthesisPhase_.assign(bins_, 0.0f);
+  peaks_.reserve(bins_);
+
+  overlap_.assign(static_cast<size_t>(channels_) * fftSize_, 0.0f);
+  hopOutput_.assign(static_cast<size_t>(channels_) * synthesisHop_, 0.0f);
+  leadIn_.assign(static_cast<size_t>(channels_) * fftSize_ / 2, 0.0f);
+
+  input_.setChannels(channels_);
+  transposer_->setChannels(channels_);
+  updateStretch();
+  clear();
+
+  // No workers run here, so the job count can restart for the new ones.
+  stopWorkers_ = false;
+  generation_ = 0;
+  workerFfts_.clear();
+  for (int32_t i = 1; i < threads; ++i) {
+    workerFfts_.push_back(std::make_unique<RealFft>(fftSize_));
+  }
+  for (int32_t i = 1; i < threads; ++i) {
+    workers_.emplace_back(&PhaseVocoder::workerLoop, this, i - 1);
+  }
+}
+
+void PhaseVocoder::setTempo(double tempo) {
+  tempo_ = std::max(0.01, tempo);
+  updateStretch();
+}
+
+void PhaseVocoder::setPitchSemiTones(double semi) {
+  pitch_ = std::exp2(semi / 12.0);
+  updateStretch();
+}
+
+void PhaseVocoder::setRate(double rate) {
+  rate_ = std::max(0.01, rate);
+  updateStretch();
+}
+
+void PhaseVocoder::updateStretch() {
+  // Stretch by pitch / tempo, then resample by pitch: the pitch factor
+  // cancels in duration, as in SoundTouch's own pipeline.
+  stretch_ = std::clamp(pitch_ / tempo_, kMinStretch, kMaxStretch);
+  analysisHop_ = synthesisHop_ / stretch_;
+  // The anti-alias filter is redesigned on every rate change.
+  if (pitch_ * rate_ != transposerRate_) {
+    transposerRate_ = pitch_ * rate_;
+    transposer_->setRate(transposerRate_);
+  }
+}
+
+double PhaseVocoder::getInputOutputSampleRatio() const {
+  return 1.0 / (tempo_ * rate_);
+}
+
+uint PhaseVocoder::numUnprocessedSamples() const {
+  return static_cast<uint>(std::max(
+      0.0, static_cast<double>(inputFrames_) - nextSourceFrame_));
+}
+
+void PhaseVocoder::clear() {
+  input_.clear();
+  transposer_->clear();
+  std::fill(overlap_.begin(), overlap_.end(), 0.0f);
+  std::fill(previousMagnitude_.begin(), previousMagnitude_.end(), 0.0f);
+  std::fill(previousPhase_.begin(), previousPhase_.end(), 0.0f);
+  std::fill(synthesisPhase_.begin(), synthesisPhase_.end(), 0.0f);
+  hopFraction_ = 0.0;
+  previousHop_ = 0;
+  primed_ = false;
+  fluxAverage_ = 0.0f;
+  sinceReset_ = 0;
+  transients_ = 0;
+  inputFrames_ = 0;
+  consumedFrames_ = 0;
+  nextSourceFrame_ = 0.0;
+  // Half a frame of silence ahead of the input centres the first frame on
+  // input frame 0; the output it produces before that centre is dropped.
+  skipFrames_ = fftSize_ / 2;
+  if (!leadIn_.empty()) {
+    input_.putSamples(leadIn_.data(), static_cast<uint>(fftSize_ / 2));
+  }
+}
+
+void PhaseVocoder::putSamples(const soundtouch::SAMPLETYPE* samples,
+                              uint numSamples) {
+  if (numSamples == 0 || !fft_) return;
+  input_.putSamples(samples, numSamples);
+  inputFrames_ += numSamples;
+  processFrames();
+}
+
+void PhaseVocoder::processFrames() {
+  while (true) {
+    const int32_t available = static_cast<int32_t>(input_.numSamples());
+    int32_t count = 0;
+    int32_t offset = 0;
+    int32_t hops[kParallelBatchFrames];
+    while (count < batchCapacity_ && offset + fftSize_ <= available) {
+      batchOffsets_[count] = offset;
+      // Whole-frame hops; the fraction carries so the average is exact.
+      hopFraction_ += analysisHop_;
+      const int32_t hop = static_cast<int32_t>(hopFraction_);
+      hopFraction_ -= hop;
+      hops[count] = hop;
+      offset += hop;
+      ++count;
+    }
+    if (count == 0) return;
+
+    batchInput_ = input_.ptrBegin();
+    runPass(Pass::kAnalysis, count * channels_);
+    for (int32_t frame = 0; frame < count; ++frame) {
+      updatePhases(frame, previousHop_);
+      previousHop_ = hops[frame];
+    }
+    runPass(Pass::kSynthesis, count * channels_);
+    for (int32_t frame = 0; frame < count; ++frame) {
+      emitFrame(frame, consumedFrames_ + batchOffsets_[frame]);
+    }
+    input_.receiveSamples(static_cast<uint>(offset));
+    consumedFrames_ += offset;
+  }
+}
+
+void PhaseVocoder::runPass(Pass pass, int32_t items) {
+  if (workers_.empty()) {
+    for (int32_t item = 0; item < items; ++item) {
+      transformItem(pass, item, *fft_);
+    }
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(workMutex_);
+    pass_ = pass;
+    passItems_ = items;
+    nextItem_.store(0);
+    busyWorkers_ = static_cast<int32_t>(workers_.size());
+    ++generation_;
+  }
+  workWake_.notify_all();
+  drainItems(*fft_);
+  std::unique_lock<std::mutex> lock(workMutex_);
+  workDone_.wait(lock, [this] { return busyWorkers_ == 0; });
+}
+
+void PhaseVocoder::drainItems(RealFft& fft) {
+  SLOWREVERB_TRACE_SCOPE("PhaseVocoder::drainItems");
+  for (int32_t item = nextItem_.fetch_add(1); item < passItems_;
+       item = nextItem_.fetch_add(1)) {
+    transformItem(pass_, item, fft);
+  }
+}
+
+void PhaseVocoder::transformItem(Pass pass, int32_t item, RealFft& fft) {
+  const int32_t frame = item / channels_;
+  const int32_t channel = item % channels_;
+  const size_t spectrum = static_cast<size_t>(item) * bins_;
+  float* re = &spectraRe_[spectrum];
+  float* im = &spectraIm_[spectrum];
+  float* time = &frames_[static_cast<size_t>(item) * fftSize_];
+
+  if (pass == Pass::kAnalysis) {
+    const float* src = batchInput_ +
+                       static_cast<size_t>(batchOffsets_[frame]) * channels_ +
+                       channel;
+    for (int32_t n = 0; n < fftSize_; ++n) {
+      time[n] = src[static_cast<size_t>(n) * channels_] * window_[n];
+    }
+    fft.forward(time, re, im);
+    return;
+  }
+
+  const float* rotRe = &rotationRe_[static_cast<size_t>(frame) * bins_];
+  const float* rotIm = &rotationIm_[static_cast<size_t>(frame) * bins_];
+  for (int32_t k = 0; k < bins_; ++k) {
+    const float xr = re[k];
+    const float xi = im[k];
+    re[k] = xr * rotRe[k] - xi * rotIm[k];
+    im[k] = xr * rotIm[k] + xi * rotRe[k];
+  }
+  fft.inverse(re, im, time);
+  for (int32_t n = 0; n < fftSize_; ++n) time[n] *= synthesisWindow_[n];
+}
+
+void PhaseVocoder::updatePhases(int32_t frame, int32_t hop) {
+  const size_t first = static_cast<size_t>(frame) * channels_ * bins_;
+  float loudest = 0.0f;
+  float total = 0.0f;
+  float rise = 0.0f;
+  for (int32_t k = 0; k < bins_; ++k) {
+    float re = 0.0f;
+    float im = 0.0f;
+    for (int32_t ch = 0; ch < channels_; ++ch) {
+      re += spectraRe_[first + static_cast<size_t>(ch) * bins_ + k];
+      im += spectraIm_[first + static_cast<size_t>(ch) * bins_ + k];
+    }
+    const float magnitude = std::sqrt(re * re + im * im);
+    magnitude_[k] = magnitude;
+    phase_[k] = std::atan2(im, re);
+    loudest = std::max(loudest, magnitude);
+    total += magnitude;
+    rise += std::max(0.0f, magnitude - previousMagnitude_[k]);
+  }
+
+  const float flux = total > 0.0f ? rise / total : 0.0f;
+  bool reset = !primed_;
+  if (primed_) {
+    sinceReset_ += hop;
+    if (flux > kTransientRatio * fluxAverage_ && flux > kMinTransientFlux &&
+        sinceReset_ >= fftSize_ / 2) {
+      reset = true;
+      ++transients_;
+    }
+    fluxAverage_ += kFluxSmoothing * (flux - fluxAverage_);
+  }
+  if (reset) sinceReset_ = 0;
+
+  peaks_.clear();
+  const float floor = loudest * kPeakFloor;
+  for (int32_t k = 1; k + 1 < bins_; ++k) {
+    if (magnitude_[k] > floor && magnitude_[k] > magnitude_[k - 1] &&
+        magnitude_[k] >= magnitude_[k + 1]) {
+      peaks_.push_back(k);
+    }
+  }
+
+  float* rotRe = &rotationRe_[static_cast<size_t>(frame) * bins_];
+  float* rotIm = &rotationIm_[static_cast<size_t>(frame) * bins_];
+  auto rotate = [&](int32_t start, int32_t end, float rotation) {
+    const float c = std::cos(rotation);
+    const float s = std::sin(rotation);
+    for (int32_t k = start; k < end; ++k) {
+      rotRe[k] = c;
+      rotIm[k] = s;
+      synthesisPhase_[k] = wrapPhase(phase_[k] + rotation);
+    }
+  };
+  if (peaks_.empty()) rotate(0, bins_, 0.0f);
+
+  int32_t start = 0;
+  for (size_t i = 0; i < peaks_.size(); ++i) {
+    const int32_t peak = peaks_[i];
+    float rotation = 0.0f;
+    if (!reset && hop > 0) {
+      const float omega = kTwoPi * peak / fftSize_;
+      const float deviation =
+          wrapPhase(phase_[peak] - previousPhase_[peak] - omega * hop);
+      const float frequency = omega + deviation / hop;
+      rotation = wrapPhase(synthesisPhase_[peak] +
+                           frequency * synthesisHop_ - phase_[peak]);
+    }
+    // Bins up to halfway to the next peak follow this one's rotation.
+    const int32_t end =
+        i + 1 < peaks_.size() ? (peak + peaks_[i + 1]) / 2 + 1 : bins_;
+    rotate(start, end, rotation);
+    start = end;
+  }
+
+  std::swap(previousMagnitude_, magnitude_);
+  std::swap(previousPhase_, phase_);
+  primed_ = true;
+}
+
+void PhaseVocoder::emitFrame(int32_t frame, int64_t startFrame) {
+  const float* time =
+      &frames_[static_cast<size_t>(frame) * channels_ * fftSize_];
+  for (int32_t ch = 0; ch < channels_; ++ch) {
+    float* acc = &overlap_[static_cast<size_t>(ch) * fftSize_];
+    const float* src = time + static_cast<size_t>(ch) * fftSize_;
+    for (int32_t n = 0; n < fftSize_; ++n) acc[n] += src[n];
+    for (int32_t n = 0; n < synthesisHop_; ++n) {
+      hopOutput_[static_cast<size_t>(n) * channels_ + ch] = acc[n];
+    }
+    std::memmove(acc, acc + synthesisHop_,
+                 sizeof(float) * (fftSize_ - synthesisHop_));
+    std::fill(acc + fftSize_ - synthesisHop_, acc + fftSize_, 0.0f);
+  }
+
+  // The frame is centred on input frame startFrame + fftSize_ / 2, less the
+  // lead-in, and the hop just finished ends fftSize_ / 2 - synthesisHop_
+  // stretched frames before that centre.
+  nextSourceFrame_ = static_cast<double>(startFrame) -
+                     (fftSize_ / 2 - synthesisHop_) / stretch_;
+
+  const int32_t skip = std::min(skipFrames_, synthesisHop_);
+  skipFrames_ -= skip;
+  if (skip < synthesisHop_) {
+    transposer_->putSamples(
+        hopOutput_.data() + static_cast<size_t>(skip) * channels_,
+        static_cast<uint>(synthesisHop_ - skip));
+  }
+}
+
+void PhaseVocoder::workerLoop(int32_t index) {
+  // Room for any index; applyThreadRole() keeps the first 15 characters.
+  char name[24];
+  std::snprintf(name, sizeof(name), "sr-vocoder-%d", index + 1);
+  applyThreadRole(ThreadRole::kRender, name);
+  uint64_t seen = 0;
+  std::unique_lock<std::mutex> lock(workMutex_);
+  while (true) {
+    workWake_.wait(lock,
+                   [&] { return stopWorkers_ || generation_ != seen; });
+    if (stopWorkers_) return;
+    seen = generation_;
+    lock.unlock();
+    drainItems(*workerFfts_[index]);
+    lock.lock();
+    if (--busyWorkers_ == 0) workDone_.notify_one();
+  }
+}
+
+void PhaseVocoder::stopWorkers() {
+  {
+    std::lock_guard<std::mutex> lock(workMutex_);
+    stopWorkers_ = true;
+  }
+  workWake_.notify_all();
+  for (auto& worker : workers_) worker.join();
+  workers_.clear();
+}
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#define SOUNDTOUCH_FLOAT_SAMPLES 1
+#include "FIFOSampleBuffer.h"
+#include "FIFOSamplePipe.h"
+
+#include "dsp_arena.h"
+#include "real_fft.h"
+
+namespace soundtouch {
+class RateTransposer;
+}  // namespace soundtouch
+
+// FFT phase-vocoder time stretcher with SoundTouch's pipe interface, used in
+// place of TDStretch for slowdowns where WSOLA's repeated segments start to
+// echo. Every hop analyses one Hann-windowed frame per channel and overlaps
+// it back at a fixed synthesis hop, so the cost per output hop is constant
+// at any tempo. Phases are advanced only at spectral peaks; the bins around
+// a peak keep their offset to it (identity phase locking), and all channels
+// share the rotation worked out on their sum so the stereo image holds. A
+// jump in spectral flux marks a transient, where phases restart from the
+// analysis so attacks stay sharp. Pitch and the output rate are applied
+// afterwards by SoundTouch's rate transposer.
+//
+// Hops are processed in batches: forward transforms, then the phase update
+// in order, then inverse transforms. With more than one thread the
+// transforms of a batch are spread over worker threads, for offline
+// rendering; the output is the same as with one.
+class PhaseVocoder : public soundtouch::FIFOProcessor {
+ public:
+  // Stretch (output over input frames, before pitch) the analysis hop can
+  // cover without skipping input, and an upper bound that keeps it above a
+  // few frames.
+  static constexpr double kMinStretch = 0.3;
+  static constexpr double kMaxStretch = 16.0;
+
+  PhaseVocoder();
+  ~PhaseVocoder() override;
+  PhaseVocoder(const PhaseVocoder&) = delete;
+  PhaseVocoder& operator=(const PhaseVocoder&) = delete;
+
+  // Builds the FFT plans and buffers for the format and clears. threads > 1
+  // starts threads - 1 workers. Allocates; call off the audio thread.
+  void configure(int32_t sampleRate, int32_t channels, int32_t threads);
+  void setTempo(double tempo);
+  void setPitchSemiTones(double semi);
+  // Input over output sample rate, as SoundTouch::setRate().
+  void setRate(double rate);
+  // Output frames per input frame, as SoundTouch reports it.
+  double getInputOutputSampleRatio() const;
+  // Input frames put but not yet reflected in the output.
+  uint numUnprocessedSamples() const;
+  int32_t fftSize() const { return fftSize_; }
+  // Frames where a transient reset the phases since the last clear().
+  int64_t transients() const { return transients_; }
+  // Heap bytes held by the FFT plans and frame buffers; the SoundTouch
+  // FIFOs around them are not counted.
+  size_t memoryBytes() const;
+
+  void putSamples(const soundtouch::SAMPLETYPE* samples,
+                  uint numSamples) override;
+  void clear() override;
+
+  // Threads worth using for offline rendering on this device.
+  static int32_t offlineThreads();
+
+ private:
+  enum class Pass { kAnalysis, kSynthesis };
+
+  void updateStretch();
+  // Runs every hop the buffered input covers.
+  void processFrames();
+  void runPass(Pass pass, int32_t items);
+  void drainItems(RealFft& fft);
+  // One channel of one batch frame: item = frame * channels_ + channel.
+  void transformItem(Pass pass, int32_t item, RealFft& fft);
+  // Sets the batch frame's per-bin rotation from the channel sum.
+  void updatePhases(int32_t frame, int32_t hop);
+  // Overlap-adds the batch frame and passes one synthesis hop on.
+  void emitFrame(int32_t frame, int64_t startFrame);
+  void workerLoop(int32_t index);
+  void stopWorkers();
+
+  std::unique_ptr<soundtouch::RateTransposer> transposer_;
+  soundtouch::FIFOSampleBuffer input_;
+  int32_t sampleRate_ = 48000;
+  int32_t channels_ = 2;
+  int32_t fftSize_ = 0;
+  int32_t bins_ = 0;
+  int32_t synthesisHop_ = 0;
+  double tempo_ = 1.0;
+  double pitch_ = 1.0;
+  double rate_ = 1.0;
+  double stretch_ = 1.0;
+  double transposerRate_ = 1.0;
+  double analysisHop_ = 0.0;
+  double hopFraction_ = 0.0;
+  std::unique_ptr<RealFft> fft_;
+  DspVector<float> window_;
+  // Hann window scaled for unit gain after overlap-add.
+  DspVector<float> synthesisWindow_;
+
+  // Current batch: [frame][channel][bin] spectra, [frame][bin] rotations
+  // and [frame][channel][fftSize_] time frames.
+  int32_t batchCapacity_ = 1;
+  const float* batchInput_ = nullptr;
+  DspVector<int32_t> batchOffsets_;
+  DspVector<float> spectraRe_;
+  DspVector<float> spectraIm_;
+  DspVector<float> rotationRe_;
+  DspVector<float> rotationIm_;
+  DspVector<float> frames_;
+
+  // Phase state of the channel sum.
+  DspVector<float> magnitude_;
+  DspVector<float> previousMagnitude_;
+  DspVector<float> phase_;
+  DspVector<float> previousPhase_;
+  DspVector<float> synthesisPhase_;
+  DspVector<int32_t> peaks_;
+  int32_t previousHop_ = 0;
+  bool primed_ = false;
+  float fluxAverage_ = 0.0f;
+  int64_t sinceReset_ = 0;
+  int64_t transients_ = 0;
+
+  // [channel][fftSize_] overlap-add accumulator.
+  DspVector<float> overlap_;
+  DspVector<float> hopOutput_;
+  DspVector<float> leadIn_;
+  int32_t skipFrames_ = 0;
+  int64_t inputFrames_ = 0;
+  // Buffer frames consumed since clear(), lead-in included.
+  int64_t consumedFrames_ = 0;
+  // Input frame the next frame passed to the transposer was taken from.
+  double nextSourceFrame_ = 0.0;
+
+  std::vector<std::thread> workers_;
+  std::vector<std::unique_ptr<RealFft>> workerFfts_;
+  std::mutex workMutex_;
+  std::condition_variable workWake_;
+  std::condition_variable workDone_;
+  Pass pass_ = Pass::kAnalysis;
+  int32_t passItems_ = 0;
+  std::atomic<int32_t> nextItem_{0};
+  int32_t busyWorkers_ = 0;
+  uint64_t generation_ = 0;
+  bool stopWorkers_ = false;
+};
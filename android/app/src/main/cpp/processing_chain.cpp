@@ -0,0 +1,519 @@
+#include "processing_chain.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <utility>
+
+#include "trace.h"
+
+namespace {
+constexpr int32_t kFlushBlockFrames = 128;
+constexpr int kMaxFlushBlocks = 200;
+// Silent input it takes to push everything audible out of either
+// stretcher, SoundTouch's sequence windows or the vocoder's FFT frame.
+constexpr double kStretchSettleSeconds = 0.25;
+// Arena sizing, measured on the default build with a little to spare; an
+// arena that still overflows is sized from its peak when it is next
+// reserved. The stages take a share that follows the rates: SoundTouch's
+// windows and filters the input rate, the reverb's lines the output rate.
+// On top comes what prewarm() grows the FIFOs to per frame of its block
+// and channel, scaled by the output over the input rate. That includes
+// room for a growing FIFO's new storage next to its old one.
+constexpr double kArenaBytesPerHz = 8.0;
+constexpr double kArenaBytesPerPrewarmSample = 750.0;
+constexpr double kArenaBytesPerVocoderPrewarmSample = 1000.0;
+
+// SoundTouch's anti-alias filter and interpolator are left alone: changing
+// the filter length moves its group delay, which clicks, and reallocates;
+// the interpolator is fixed when SoundTouch is built. 0 ms leaves the
+// window to SoundTouch's tempo-dependent default.
+struct QualitySettings {
+  bool quickSeek;
+  int sequenceMs;
+  int seekWindowMs;
+  int32_t combs;
+};
+constexpr QualitySettings kQualitySettings[ProcessingChain::kQualityTiers] =
+    {
+        {true, 100, 10, 2},
+        {true, 90, 15, 3},
+        {true, 0, 0, 4},
+        {false, 0, 0, 4},
+};
+}  // namespace
+
+ProcessingChain::ProcessingChain() {
+  installSoundTouchAllocator();
+  soundTouch_.emplace();
+  soundTouch_->setSetting(SETTING_USE_AA_FILTER, 1);
+}
+
+void ProcessingChain::configure(int32_t inputRate,
+                                int32_t outputRate,
+                                int32_t channels,
+                                const ChainParameters& params) {
+  inputRate_ = std::max(8000, inputRate);
+  outputRate_ = std::max(8000, outputRate);
+  channels_ = std::max(1, channels);
+  current_ = params;
+  current_.tempo = clampTempo(current_.tempo);
+  targets_ = current_;
+  reserveArena();
+  buildStages();
+}
+
+size_t ProcessingChain::arenaBytes(int32_t maxInputFrames) const {
+  const double perSample = current_.stretch == StretchMode::kPhaseVocoder
+                               ? kArenaBytesPerVocoderPrewarmSample
+                               : kArenaBytesPerPrewarmSample;
+  const double bytes =
+      kArenaBytesPerHz * (inputRate_ + outputRate_) +
+      perSample * channels_ * maxInputFrames * outputRate_ / inputRate_;
+  return static_cast<size_t>(bytes);
+}
+
+bool ProcessingChain::reserveArena() {
+  size_t bytes = arenaBytes(arenaFrames_);
+  // What overflowed is needed again by the same use.
+  if (arena_.overflows() > 0) {
+    bytes = std::max(bytes, arena_.peakBytes() + arena_.peakBytes() / 8);
+  }
+  if (bytes <= arena_.capacityBytes()) return false;
+  releaseStages();
+  arena_.reserve(bytes);
+  return true;
+}
+
+void ProcessingChain::releaseStages() {
+  soundTouch_.reset();
+  vocoder_.reset();
+  reverb_ = SimpleReverb();
+  quantumStorage_ = DspVector<float>();
+  flushSilence_ = DspVector<float>();
+  quantum_ = nullptr;
+  prewarmedFrames_ = 0;
+}
+
+void ProcessingChain::buildStages() {
+  DspArena::Scope scope(arena_);
+  flushSilence_.assign(static_cast<size_t>(kFlushBlockFrames) * channels_,
+                       0.0f);
+  quantumStorage_.assign(static_cast<size_t>(kQuantumFrames) * channels_,
+                         0.0f);
+  quantum_ = quantumStorage_.data();
+  const double rate = static_cast<double>(inputRate_) / outputRate_;
+  if (current_.stretch == StretchMode::kPhaseVocoder) {
+    soundTouch_.reset();
+    if (!vocoder_) vocoder_.emplace();
+    vocoder_->configure(inputRate_, channels_, stretchThreads_);
+    vocoder_->setRate(rate);
+  } else {
+    vocoder_.reset();
+    if (!soundTouch_) {
+      soundTouch_.emplace();
+      soundTouch_->setSetting(SETTING_USE_AA_FILTER, 1);
+    }
+    soundTouch_->setChannels(channels_);
+    soundTouch_->setSampleRate(inputRate_);
+    soundTouch_->setRate(rate);
+  }
+  applyQualityTier(qualityTier_);
+  clear();
+  bypassedFrames_ = 0;
+  applyStretch(current_.tempo, current_.pitchSemi);
+  reverb_.configure(outputRate_, channels_);
+  reverb_.setCombCount(kQualitySettings[qualityTier_].combs);
+  applyReverbParameters();
+}
+
+void ProcessingChain::setOutputRate(int32_t outputRate) {
+  const int32_t rate = std::max(8000, outputRate);
+  if (rate == outputRate_) return;
+  outputRate_ = rate;
+  DspArena::Scope scope(arena_);
+  const double ratio = static_cast<double>(inputRate_) / outputRate_;
+  if (current_.stretch == StretchMode::kPhaseVocoder) {
+    vocoder_->setRate(ratio);
+  } else {
+    soundTouch_->setRate(ratio);
+  }
+  applyStretch(current_.tempo, current_.pitchSemi);
+  reverb_.configure(outputRate_, channels_);
+  reverb_.setCombCount(kQualitySettings[qualityTier_].combs);
+  applyReverbParameters();
+}
+
+size_t ProcessingChain::memoryBytes() const {
+  return arena_.capacityBytes() + arena_.overflowBytes();
+}
+
+void ProcessingChain::prewarm(int32_t maxInputFrames) {
+  // Pitch covers an octave each way.
+  const float extremes[][2] = {{clampTempo(kMinTempo), -12.0f},
+                               {kMaxTempo, 12.0f}};
+  constexpr int kBlocks = 8;
+  const int32_t frames = std::max<int32_t>(1, maxInputFrames);
+  if (frames <= prewarmedFrames_ && inputRate_ == prewarmedInputRate_ &&
+      outputRate_ == prewarmedOutputRate_ && channels_ == prewarmedChannels_ &&
+      current_.stretch == prewarmedStretch_) {
+    return;
+  }
+  if (frames > arenaFrames_) {
+    arenaFrames_ = frames;
+    if (reserveArena()) buildStages();
+  }
+  DspArena::Scope scope(arena_);
+  std::vector<float> silence(static_cast<size_t>(frames) * channels_, 0.0f);
+  std::vector<float> sink(silence.size() * 4);
+  const int32_t sinkFrames = frames * 4;
+  soundtouch::FIFOSamplePipe& pipe = stretcher();
+  // The cheapest tier's fixed windows can need more input than the default
+  // ones at fast tempos, so both are covered.
+  for (const int32_t tier : {0, kDefaultQualityTier}) {
+    applyQualityTier(tier);
+    for (const auto& extreme : extremes) {
+      applyStretch(extreme[0], extreme[1]);
+      // Let output pile up so the FIFOs also cover a callback's backlog,
+      // and carry it across the switch: crossing pitch 0 reorders
+      // SoundTouch's stages and moves everything queued into the rate
+      // transposer.
+      for (int block = 0; block < kBlocks; ++block) {
+        pipe.putSamples(silence.data(), static_cast<uint>(frames));
+      }
+    }
+  }
+  while (pipe.receiveSamples(sink.data(), static_cast<uint>(sinkFrames)) >
+         0) {
+  }
+  applyQualityTier(qualityTier_);
+  clear();
+  applyStretch(current_.tempo, current_.pitchSemi);
+  prewarmedStretch_ = current_.stretch;
+  prewarmedFrames_ = frames;
+  prewarmedInputRate_ = inputRate_;
+  prewarmedOutputRate_ = outputRate_;
+  prewarmedChannels_ = channels_;
+}
+
+float ProcessingChain::smoothValue(float current, float target, float factor) {
+  const float delta = target - current;
+  if (std::fabs(delta) < 1e-4f) {
+    return target;
+  }
+  return current + delta * factor;
+}
+
+float ProcessingChain::clampTempo(float tempo) const {
+  const float floor = current_.stretch == StretchMode::kPhaseVocoder
+                          ? kMinTempo
+                          : kMinSoundTouchTempo;
+  return std::clamp(tempo, floor, kMaxTempo);
+}
+
+void ProcessingChain::applyStretch(float tempo, float pitchSemi) {
+  if (current_.stretch == StretchMode::kPhaseVocoder) {
+    vocoder_->setTempo(tempo);
+    vocoder_->setPitchSemiTones(pitchSemi);
+  } else {
+    soundTouch_->setTempo(tempo);
+    soundTouch_->setPitchSemiTones(pitchSemi);
+  }
+}
+
+void ProcessingChain::smoothTowards(const ChainParameters& targets) {
+  constexpr float kTempoSmooth = 0.12f;
+  constexpr float kReverbSmooth = 0.08f;
+
+  const float tempoNext = smoothValue(
+      current_.tempo, clampTempo(targets.tempo), kTempoSmooth);
+  const float pitchNext =
+      smoothValue(current_.pitchSemi, targets.pitchSemi, kTempoSmooth);
+  const bool tempoChanged = std::fabs(tempoNext - current_.tempo) > 5e-4f;
+  const bool pitchChanged = std::fabs(pitchNext - current_.pitchSemi) > 5e-4f;
+  if (tempoChanged || pitchChanged) {
+    applyStretch(tempoNext, pitchNext);
+  }
+  current_.tempo = tempoNext;
+  current_.pitchSemi = pitchNext;
+
+  const float wetNext = smoothValue(current_.wet, targets.wet, kReverbSmooth);
+  const float decayNext =
+      smoothValue(current_.decay, targets.decay, kReverbSmooth);
+  const float toneNext =
+      smoothValue(current_.tone, targets.tone, kReverbSmooth);
+  const float roomNext =
+      smoothValue(current_.room, targets.room, kReverbSmooth);
+  const float echoNext =
+      smoothValue(current_.echoMs, targets.echoMs, kReverbSmooth);
+  const float widthNext =
+      smoothValue(current_.width, targets.width, kReverbSmooth);
+
+  const bool reverbNeedsUpdate =
+      std::fabs(wetNext - current_.wet) > 5e-4f ||
+      std::fabs(decayNext - current_.decay) > 5e-4f ||
+      std::fabs(toneNext - current_.tone) > 5e-4f ||
+      std::fabs(roomNext - current_.room) > 5e-4f ||
+      std::fabs(echoNext - current_.echoMs) > 5e-4f ||
+      std::fabs(widthNext - current_.width) > 5e-4f;
+
+  if (reverbNeedsUpdate) {
+    current_.wet = wetNext;
+    current_.decay = decayNext;
+    current_.tone = toneNext;
+    current_.room = roomNext;
+    current_.echoMs = echoNext;
+    current_.width = widthNext;
+    applyReverbParameters();
+  }
+}
+
+void ProcessingChain::setParameters(const ChainParameters& params) {
+  const StretchMode stretch = current_.stretch;
+  current_ = params;
+  current_.stretch = stretch;
+  current_.tempo = clampTempo(current_.tempo);
+  targets_ = current_;
+  DspArena::Scope scope(arena_);
+  applyStretch(current_.tempo, current_.pitchSemi);
+  applyReverbParameters();
+}
+
+void ProcessingChain::setQualityTier(int32_t tier) {
+  tier = std::clamp(tier, 0, kQualityTiers - 1);
+  if (tier == qualityTier_) return;
+  qualityTier_ = tier;
+  DspArena::Scope scope(arena_);
+  applyQualityTier(tier);
+  reverb_.setCombCount(kQualitySettings[tier].combs);
+}
+
+void ProcessingChain::applyQualityTier(int32_t tier) {
+  if (current_.stretch != StretchMode::kSoundTouch) return;
+  // Only the overlap length sizes TDStretch's buffers; the seek settings
+  // take effect from the next sequence without reallocating.
+  const QualitySettings& settings = kQualitySettings[tier];
+  soundTouch_->setSetting(SETTING_USE_QUICKSEEK, settings.quickSeek ? 1 : 0);
+  soundTouch_->setSetting(SETTING_SEQUENCE_MS, settings.sequenceMs);
+  soundTouch_->setSetting(SETTING_SEEKWINDOW_MS, settings.seekWindowMs);
+}
+
+void ProcessingChain::applyReverbParameters() {
+  reverb_.setParameters(current_.wet, current_.decay, current_.tone,
+                        current_.room, current_.echoMs, current_.width);
+  if (convolution_) convolution_->setParameters(current_.wet, current_.tone);
+}
+
+float ProcessingChain::reverbTailMs() const {
+  if (convolution_ && convolution_->hasImpulse()) {
+    return convolution_->tailMs(-40.0f);
+  }
+  return reverb_.tailMs(-40.0f);
+}
+
+std::unique_ptr<ConvolutionReverb> ProcessingChain::swapConvolution(
+    std::unique_ptr<ConvolutionReverb> next) {
+  std::swap(convolution_, next);
+  if (convolution_) convolution_->setParameters(current_.wet, current_.tone);
+  return next;
+}
+
+void ProcessingChain::putSamples(const float* interleaved, int32_t frames) {
+  if (frames <= 0) return;
+  const double ratio = stretchRatio();
+  expectedOutputFrames_ += frames * ratio;
+  inputFrames_ += frames;
+  flushed_ = false;
+
+  const bool silent = SimpleReverb::isSilent(
+      interleaved, static_cast<size_t>(frames) * channels_);
+  if (!silent) {
+    silentInputFrames_ = 0;
+    bypassing_ = false;
+  } else if (!bypassing_ && owedZeros_ == 0 &&
+             silentInputFrames_ >= kStretchSettleSeconds * inputRate_) {
+    // Whatever the stretcher still holds comes out before the zeros.
+    bypassing_ = true;
+    pipeAhead_ = stretcher().numSamples();
+    owedCarry_ = 0.0;
+  }
+  if (bypassing_) {
+    owedCarry_ += frames * ratio;
+    const int64_t whole = static_cast<int64_t>(owedCarry_);
+    owedZeros_ += whole;
+    owedCarry_ -= static_cast<double>(whole);
+    return;
+  }
+  // Only silence that went through the stretcher settles it.
+  if (silent) silentInputFrames_ += frames;
+  DspArena::Scope scope(arena_);
+  SLOWREVERB_TRACE_SCOPE("stretcher.putSamples");
+  stretcher().putSamples(interleaved, static_cast<uint>(frames));
+}
+
+int32_t ProcessingChain::receiveSamples(float* interleaved, int32_t maxFrames) {
+  DspArena::Scope scope(arena_);
+  int32_t served = 0;
+  while (served < maxFrames) {
+    if (quantumRead_ == quantumFrames_ && !processQuantum()) break;
+    const int32_t count =
+        std::min(quantumFrames_ - quantumRead_, maxFrames - served);
+    std::memcpy(interleaved + static_cast<size_t>(served) * channels_,
+                quantum_ + static_cast<size_t>(quantumRead_) * channels_,
+                static_cast<size_t>(count) * channels_ * sizeof(float));
+    quantumRead_ += count;
+    served += count;
+  }
+  return served;
+}
+
+bool ProcessingChain::processQuantum() {
+  soundtouch::FIFOSamplePipe& pipe = stretcher();
+  const int64_t ready = pipe.numSamples() + owedZeros_;
+  // Only the end of a flushed stream gets a short quantum.
+  if (ready < kQuantumFrames && (!flushed_ || ready == 0)) return false;
+  int32_t frames =
+      static_cast<int32_t>(std::min<int64_t>(ready, kQuantumFrames));
+  int32_t filled = 0;
+  int32_t zeros = 0;
+  while (filled < frames) {
+    float* at = quantum_ + static_cast<size_t>(filled) * channels_;
+    int32_t count = frames - filled;
+    if (owedZeros_ > 0 && pipeAhead_ == 0) {
+      count = static_cast<int32_t>(std::min<int64_t>(count, owedZeros_));
+      std::fill(at, at + static_cast<size_t>(count) * channels_, 0.0f);
+      owedZeros_ -= count;
+      zeros += count;
+    } else {
+      if (owedZeros_ > 0) {
+        count = static_cast<int32_t>(std::min<int64_t>(count, pipeAhead_));
+      }
+      SLOWREVERB_TRACE_SCOPE("stretcher.receiveSamples");
+      count = static_cast<int32_t>(
+          pipe.receiveSamples(at, static_cast<uint>(count)));
+      pipeAhead_ = std::max<int64_t>(0, pipeAhead_ - count);
+      if (count == 0) break;
+    }
+    filled += count;
+  }
+  frames = filled;
+  receivedFrames_ += frames;
+  smoothTowards(targets_);
+  if (convolution_ && convolution_->hasImpulse()) {
+    convolution_->process(quantum_, frames);
+  } else {
+    reverb_.process(quantum_, frames);
+  }
+  if (zeros == frames && reverbIdle()) bypassedFrames_ += frames;
+  quantumFrames_ = frames;
+  quantumRead_ = 0;
+  return true;
+}
+
+int32_t ProcessingChain::availableFrames() const {
+  const int32_t ready =
+      static_cast<int32_t>(stretcher().numSamples() + owedZeros_);
+  const int32_t whole =
+      flushed_ ? ready : ready / kQuantumFrames * kQuantumFrames;
+  return quantumFrames_ - quantumRead_ + whole;
+}
+
+double ProcessingChain::outputFramesPerInputFrame() const {
+  const double tempo = std::max(0.01f, current_.tempo);
+  return static_cast<double>(outputRate_) / (inputRate_ * tempo);
+}
+
+double ProcessingChain::nextOutputSourceFrame() const {
+  const int64_t pending = stretcher().numSamples() + owedZeros_ +
+                          quantumFrames_ - quantumRead_;
+  return static_cast<double>(inputFrames_) - unprocessedFrames() -
+         pending / outputFramesPerInputFrame();
+}
+
+soundtouch::FIFOSamplePipe& ProcessingChain::stretcher() {
+  if (current_.stretch == StretchMode::kPhaseVocoder) return *vocoder_;
+  return *soundTouch_;
+}
+
+const soundtouch::FIFOSamplePipe& ProcessingChain::stretcher() const {
+  if (current_.stretch == StretchMode::kPhaseVocoder) return *vocoder_;
+  return *soundTouch_;
+}
+
+double ProcessingChain::stretchRatio() {
+  if (current_.stretch == StretchMode::kPhaseVocoder) {
+    return vocoder_->getInputOutputSampleRatio();
+  }
+  return soundTouch_->getInputOutputSampleRatio();
+}
+
+float ProcessingChain::reverbEnergy() const {
+  if (convolution_ && convolution_->hasImpulse()) {
+    return convolution_->wetEnergy();
+  }
+  return reverb_.wetEnergy();
+}
+
+bool ProcessingChain::reverbIdle() const {
+  if (current_.wet <= 0.0f) return true;
+  if (convolution_ && convolution_->hasImpulse()) return convolution_->idle();
+  return reverb_.idle();
+}
+
+uint ProcessingChain::unprocessedFrames() const {
+  if (current_.stretch == StretchMode::kPhaseVocoder) {
+    return vocoder_->numUnprocessedSamples();
+  }
+  return soundTouch_->numUnprocessedSamples();
+}
+
+void ProcessingChain::flush() {
+  const int64_t stillExpected = std::max<int64_t>(
+      0, static_cast<int64_t>(expectedOutputFrames_ + 0.5) - receivedFrames_);
+  DspArena::Scope scope(arena_);
+  soundtouch::FIFOSamplePipe& pipe = stretcher();
+  if (bypassing_) {
+    // The stretcher holds only silence; the rest is owed as zeros.
+    owedZeros_ = std::max<int64_t>(
+        owedZeros_, stillExpected - static_cast<int64_t>(pipe.numSamples()));
+  }
+  for (int block = 0; block < kMaxFlushBlocks &&
+                      stillExpected > pipe.numSamples() + owedZeros_;
+       ++block) {
+    // Straight to the stretcher: the padding is not part of the expected
+    // output.
+    pipe.putSamples(flushSilence_.data(), kFlushBlockFrames);
+  }
+  int64_t excess = pipe.numSamples() + owedZeros_ - stillExpected;
+  if (excess > 0) {
+    // Trimmed from the end: stretcher output put after the owed zeros,
+    // then the zeros, then the stretcher output ahead of them.
+    int64_t keep = pipe.numSamples();
+    const int64_t behind = owedZeros_ > 0 ? keep - pipeAhead_ : keep;
+    int64_t cut = std::min(excess, behind);
+    keep -= cut;
+    excess -= cut;
+    cut = std::min(excess, owedZeros_);
+    owedZeros_ -= cut;
+    keep -= excess - cut;
+    pipe.adjustAmountOfSamples(static_cast<uint>(keep));
+    pipeAhead_ = std::min(pipeAhead_, keep);
+  }
+  owedCarry_ = 0.0;
+  flushed_ = true;
+}
+
+void ProcessingChain::clear() {
+  stretcher().clear();
+  expectedOutputFrames_ = 0.0;
+  receivedFrames_ = 0;
+  inputFrames_ = 0;
+  quantumFrames_ = 0;
+  quantumRead_ = 0;
+  flushed_ = false;
+  silentInputFrames_ = 0;
+  bypassing_ = false;
+  owedZeros_ = 0;
+  owedCarry_ = 0.0;
+  pipeAhead_ = 0;
+}
@@ -0,0 +1,220 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+
+#define SOUNDTOUCH_FLOAT_SAMPLES 1
+#include "SoundTouch.h"
+
+#include "convolution_reverb.h"
+#include "dsp_arena.h"
+#include "phase_vocoder.h"
+#include "simple_reverb.h"
+
+enum class StretchMode : int32_t {
+  // SoundTouch's WSOLA stretcher (TDStretch).
+  kSoundTouch = 0,
+  // PhaseVocoder, for slowdowns past where WSOLA starts to echo.
+  kPhaseVocoder = 1,
+};
+
+struct ChainParameters {
+  float tempo = 1.0f;
+  float pitchSemi = 0.0f;
+  float wet = 0.25f;
+  float decay = 6.0f;
+  float tone = 0.6f;
+  float room = 0.8f;
+  float echoMs = 0.0f;
+  float width = 1.0f;
+  // Read by configure() only; later parameter updates keep the stretcher.
+  StretchMode stretch = StretchMode::kSoundTouch;
+};
+
+// The stretch -> reverb chain shared by the realtime engine and the offline
+// renderers. Input is consumed at inputRate and produced at outputRate;
+// SoundTouch's rate transposer does the conversion. The stretch stage is
+// SoundTouch or, for StretchMode::kPhaseVocoder, PhaseVocoder feeding the
+// same transposer. The reverb stage is SimpleReverb unless a
+// ConvolutionReverb with an impulse response is installed, which then only
+// follows the wet and tone parameters.
+//
+// Everything after the stretcher runs on fixed quanta of kQuantumFrames:
+// parameter smoothing steps and the reverb processes once per quantum, and
+// receiveSamples() serves any block size from the current one. The result
+// is the same whatever burst size the output device asks for.
+//
+// Silent input is detected per put: once it has run long enough to clear
+// the stretcher, further silence skips the stretcher and is owed as zeros
+// at the current stretch ratio, and the reverbs go idle once their tails
+// have decayed. Nothing audible changes; an idle chain costs next to
+// nothing until sound returns.
+//
+// The stretcher, the built-in reverb and the chain's own buffers live in
+// one DspArena, reserved by configure() and prewarm() for the format and
+// block size, so they sit together and growing them on the audio thread
+// does not touch the heap. The arena is only replaced, rebuilding those
+// stages, when it has to grow.
+class ProcessingChain {
+ public:
+  static constexpr int32_t kQuantumFrames = 128;
+  // Tempo range of the chain. SoundTouch is held at kMinSoundTouchTempo and
+  // above, below which WSOLA's repeats turn into audible echoes.
+  static constexpr float kMinTempo = 0.25f;
+  static constexpr float kMaxTempo = 1.5f;
+  static constexpr float kMinSoundTouchTempo = 0.5f;
+  // Quality tiers, cheapest first. The default is SoundTouch's own
+  // defaults with quick seeking, which the chain always used before tiers.
+  static constexpr int32_t kQualityTiers = 4;
+  static constexpr int32_t kDefaultQualityTier = 2;
+
+  ProcessingChain();
+
+  // Threads the phase vocoder spreads its transforms over, from the next
+  // configure(). Only for chains driven offline; realtime chains keep one.
+  void setStretchThreads(int32_t threads) { stretchThreads_ = threads; }
+  void configure(int32_t inputRate,
+                 int32_t outputRate,
+                 int32_t channels,
+                 const ChainParameters& params);
+  // Runs silence through the stretcher at the extreme tempo/pitch settings
+  // so its FIFOs reach the capacity realtime use needs, then resets. Call
+  // after configure() and before the first realtime putSamples(), with the
+  // largest block that will be put at once. SoundTouch never shrinks its
+  // buffers, so this is a no-op when the chain was already prewarmed for the
+  // same rates and channel count.
+  void prewarm(int32_t maxInputFrames);
+  // Re-targets the resampling to a new output rate, as when the output
+  // device changes, keeping the stretcher's buffered audio and position.
+  // The reverb restarts at the new rate. Not while the chain is processing.
+  void setOutputRate(int32_t outputRate);
+  // Bytes held for the stretcher, the built-in reverb and the chain's
+  // buffers: the arena and whatever overflowed it. An installed convolution
+  // reverb is not counted.
+  size_t memoryBytes() const;
+  const DspArena& arena() const { return arena_; }
+
+  // Trades stretch and reverb quality for CPU: SoundTouch's seek method and
+  // windows, and the reverb's comb count. Safe on the audio thread while
+  // playing; every change is glitch-free. Kept across configure().
+  void setQualityTier(int32_t tier);
+  int32_t qualityTier() const { return qualityTier_; }
+
+  // Sets the parameters the active ones move towards, one smoothing step
+  // per quantum.
+  void setTargets(const ChainParameters& targets) { targets_ = targets; }
+  // Applies params at once, without smoothing, and makes them the targets.
+  void setParameters(const ChainParameters& params);
+
+  void putSamples(const float* interleaved, int32_t frames);
+  // Copies processed frames out, processing quanta as they are needed.
+  int32_t receiveSamples(float* interleaved, int32_t maxFrames);
+  // Frames ready to be received: the rest of the current quantum and every
+  // whole quantum the stretcher holds, or all of it after flush().
+  int32_t availableFrames() const;
+  // Output frames produced per input frame at the current settings.
+  double outputFramesPerInputFrame() const;
+  // Frames put since the last clear(), flush padding excluded.
+  int64_t inputFrames() const { return inputFrames_; }
+  // Estimated input frame, counted like inputFrames(), that the next
+  // received frame was stretched from. Accurate to about SoundTouch's
+  // overlap window; unlike summing received frames it does not drift when
+  // the tempo changes.
+  double nextOutputSourceFrame() const;
+  float reverbTailMs() const;
+  // Mean square of the reverb's wet output over the last quantum.
+  float reverbEnergy() const;
+  // Frames received since configure() that needed neither the stretcher
+  // nor the reverb.
+  int64_t bypassedFrames() const { return bypassedFrames_; }
+
+  // Installs a configured convolution reverb in the reverb stage, or puts
+  // SimpleReverb back for nullptr or one without an impulse response.
+  // Returns the previous instance without freeing it, so the audio thread
+  // can hand it back to be released elsewhere.
+  std::unique_ptr<ConvolutionReverb> swapConvolution(
+      std::unique_ptr<ConvolutionReverb> next);
+
+  // Pushes the buffered input out with silence. Equivalent to
+  // SoundTouch::flush() but without its per-call scratch allocation, so it
+  // is safe on the audio thread.
+  void flush();
+  void clear();
+
+  const ChainParameters& current() const { return current_; }
+  StretchMode stretchMode() const { return current_.stretch; }
+  int32_t channelCount() const { return channels_; }
+  int32_t inputRate() const { return inputRate_; }
+  int32_t outputRate() const { return outputRate_; }
+
+ private:
+  static float smoothValue(float current, float target, float factor);
+  // Moves the active parameters one smoothing step towards targets.
+  void smoothTowards(const ChainParameters& targets);
+  // Pulls the next quantum from the stretcher, steps the parameters and runs
+  // the reverb over it. False when a whole quantum is not ready yet.
+  bool processQuantum();
+  float clampTempo(float tempo) const;
+  void applyStretch(float tempo, float pitchSemi);
+  void applyReverbParameters();
+  void applyQualityTier(int32_t tier);
+  // The stage selected by current_.stretch.
+  soundtouch::FIFOSamplePipe& stretcher();
+  const soundtouch::FIFOSamplePipe& stretcher() const;
+  double stretchRatio();
+  uint unprocessedFrames() const;
+  bool reverbIdle() const;
+  // Arena size for the format and maxInputFrames per put.
+  size_t arenaBytes(int32_t maxInputFrames) const;
+  // Replaces the arena if it is too small for arenaFrames_ or overflowed,
+  // releasing every stage first. True when the stages need building again.
+  bool reserveArena();
+  void releaseStages();
+  // Creates the active stretcher if needed and configures the stages for
+  // the format, in the arena.
+  void buildStages();
+
+  // First, so it outlives everything allocated from it.
+  DspArena arena_;
+  // Block size the arena was last sized for.
+  int32_t arenaFrames_ = 0;
+  // Only the stretcher selected by current_.stretch exists.
+  std::optional<soundtouch::SoundTouch> soundTouch_;
+  std::optional<PhaseVocoder> vocoder_;
+  int32_t stretchThreads_ = 1;
+  int32_t qualityTier_ = kDefaultQualityTier;
+  SimpleReverb reverb_;
+  std::unique_ptr<ConvolutionReverb> convolution_;
+  ChainParameters current_;
+  ChainParameters targets_;
+  // Starts on a cache line, as every DspVector does.
+  DspVector<float> quantumStorage_;
+  float* quantum_ = nullptr;
+  int32_t quantumFrames_ = 0;
+  int32_t quantumRead_ = 0;
+  bool flushed_ = false;
+  DspVector<float> flushSilence_;
+  // Mirrors SoundTouch's private output bookkeeping for flush().
+  double expectedOutputFrames_ = 0.0;
+  int64_t receivedFrames_ = 0;
+  int64_t inputFrames_ = 0;
+  // Silence bypass: consecutive silent input frames, zeros owed in place of
+  // stretcher output with their fractional carry, and the stretcher frames
+  // that come before the owed zeros.
+  int64_t silentInputFrames_ = 0;
+  bool bypassing_ = false;
+  int64_t owedZeros_ = 0;
+  double owedCarry_ = 0.0;
+  int64_t pipeAhead_ = 0;
+  int64_t bypassedFrames_ = 0;
+  // Configuration the stretcher's buffers were last grown for.
+  StretchMode prewarmedStretch_ = StretchMode::kSoundTouch;
+  int32_t prewarmedFrames_ = 0;
+  int32_t prewarmedInputRate_ = 0;
+  int32_t prewarmedOutputRate_ = 0;
+  int32_t prewarmedChannels_ = 0;
+  int32_t inputRate_ = 48000;
+  int32_t outputRate_ = 48000;
+  int32_t channels_ = 2;
+};
@@ -0,0 +1,97 @@
+#include "quality_governor.h"
+
+#include <algorithm>
+
+namespace {
+constexpr auto kRelaxed = std::memory_order_relaxed;
+constexpr int64_t kWindowNs = 250'000'000;
+// Peak callback time over budget that makes a window hot or calm.
+constexpr double kHotLoad = 0.7;
+constexpr double kCalmLoad = 0.35;
+constexpr double kOverrunLoad = 1.0;
+constexpr int32_t kHotWindowsToStepDown = 2;
+// 2 s of calm before the first step up, at most a minute after repeated
+// failed ones.
+constexpr int32_t kCalmWindowsToStepUp = 8;
+constexpr int32_t kMaxCalmWindowsToStepUp = 240;
+// A step down this soon after a step up counts the step up as failed.
+constexpr int32_t kFailedStepUpWindows = 8;
+}  // namespace
+
+QualityGovernor::QualityGovernor(int32_t tierCount, int32_t initialTier)
+    : tierCount_(std::max(1, tierCount)),
+      initialTier_(std::clamp(initialTier, 0, tierCount_ - 1)),
+      tier_(initialTier_) {
+  reset();
+}
+
+void QualityGovernor::reset() {
+  const int32_t pinned = pinned_.load(kRelaxed);
+  tier_.store(pinned == kAuto ? initialTier_ : pinned, kRelaxed);
+  windowBudgetNs_ = 0;
+  windowPeak_ = 0.0;
+  hotWindows_ = 0;
+  calmWindows_ = 0;
+  settling_ = false;
+  calmWindowsNeeded_ = kCalmWindowsToStepUp;
+  windowsSinceStepUp_ = kFailedStepUpWindows;
+}
+
+void QualityGovernor::pin(int32_t tier) {
+  pinned_.store(tier < 0 ? kAuto : std::min(tier, tierCount_ - 1), kRelaxed);
+}
+
+void QualityGovernor::update(int64_t durationNs, int64_t budgetNs) {
+  const int32_t pinned = pinned_.load(kRelaxed);
+  if (pinned != kAuto) {
+    tier_.store(pinned, kRelaxed);
+    return;
+  }
+  if (budgetNs <= 0) return;
+  const double load = static_cast<double>(durationNs) / budgetNs;
+  windowBudgetNs_ += budgetNs;
+  if (settling_) {
+    // The window after a step belongs to the transition.
+    if (windowBudgetNs_ < kWindowNs) return;
+    settling_ = false;
+    windowBudgetNs_ = 0;
+    return;
+  }
+  if (load >= kOverrunLoad) {
+    step(-1);
+    return;
+  }
+  windowPeak_ = std::max(windowPeak_, load);
+  if (windowBudgetNs_ < kWindowNs) return;
+
+  const double peak = windowPeak_;
+  windowPeak_ = 0.0;
+  windowBudgetNs_ = 0;
+  windowsSinceStepUp_ =
+      std::min(windowsSinceStepUp_ + 1, kFailedStepUpWindows);
+  if (peak > kHotLoad) {
+    calmWindows_ = 0;
+    if (++hotWindows_ >= kHotWindowsToStepDown) step(-1);
+    return;
+  }
+  hotWindows_ = 0;
+  calmWindows_ = peak < kCalmLoad ? calmWindows_ + 1 : 0;
+  if (calmWindows_ >= calmWindowsNeeded_) step(1);
+}
+
+void QualityGovernor::step(int32_t delta) {
+  const int32_t current = tier_.load(kRelaxed);
+  const int32_t next = std::clamp(current + delta, 0, tierCount_ - 1);
+  if (delta < 0 && next != current &&
+      windowsSinceStepUp_ < kFailedStepUpWindows) {
+    calmWindowsNeeded_ =
+        std::min(calmWindowsNeeded_ * 2, kMaxCalmWindowsToStepUp);
+  }
+  if (delta > 0 && next != current) windowsSinceStepUp_ = 0;
+  tier_.store(next, kRelaxed);
+  windowBudgetNs_ = 0;
+  windowPeak_ = 0.0;
+  hotWindows_ = 0;
+  calmWindows_ = 0;
+  settling_ = next != current;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Picks the processing chain's quality tier from how much of its time budget
+// each audio callback uses. Load is judged over short windows: two hot
+// windows in a row, or a single overrun, step one tier down. Stepping up
+// takes a run of calm windows, and the run needed doubles whenever a step up
+// is followed shortly by a step back down, so a device at the edge settles
+// on the tier it can hold instead of oscillating.
+//
+// update() is called only from the audio callback; reset() while it is not
+// running; pin() and tier() from any thread.
+class QualityGovernor {
+ public:
+  static constexpr int32_t kAuto = -1;
+
+  explicit QualityGovernor(int32_t tierCount, int32_t initialTier);
+
+  void reset();
+  // Holds the tier at tier, or hands it back to the governor for kAuto.
+  void pin(int32_t tier);
+  int32_t pinned() const { return pinned_.load(std::memory_order_relaxed); }
+  int32_t tier() const { return tier_.load(std::memory_order_relaxed); }
+
+  // One callback: the time it took and the audio duration it produced.
+  void update(int64_t durationNs, int64_t budgetNs);
+
+ private:
+  void step(int32_t delta);
+
+  const int32_t tierCount_;
+  const int32_t initialTier_;
+  std::atomic<int32_t> tier_;
+  std::atomic<int32_t> pinned_{kAuto};
+
+  int64_t windowBudgetNs_ = 0;
+  double windowPeak_ = 0.0;
+  int32_t hotWindows_ = 0;
+  int32_t calmWindows_ = 0;
+  int32_t calmWindowsNeeded_ = 0;
+  int32_t windowsSinceStepUp_ = 0;
+  bool settling_ = false;
+};
@@ -0,0 +1,152 @@
+#include "real_fft.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#include "memory_usage.h"
+
+namespace {
+constexpr double kTwoPi = 6.28318530717958647692;
+}  // namespace
+
+RealFft::RealFft(int32_t size) : size_(size), half_(size / 2) {
+  bitReverse_.resize(half_);
+  int32_t bits = 0;
+  while ((1 << bits) < half_) ++bits;
+  for (int32_t i = 0; i < half_; ++i) {
+    int32_t reversed = 0;
+    for (int32_t b = 0; b < bits; ++b) {
+      if (i & (1 << b)) reversed |= 1 << (bits - 1 - b);
+    }
+    bitReverse_[i] = reversed;
+  }
+  // Stage by stage, so each stage reads its twiddles contiguously: the
+  // stage with butterflies span apart uses entries [span - 1, 2 * span - 1).
+  twiddleRe_.resize(std::max(1, half_ - 1));
+  twiddleIm_.resize(std::max(1, half_ - 1));
+  for (int32_t span = 1; span < half_; span <<= 1) {
+    for (int32_t k = 0; k < span; ++k) {
+      const double angle = kTwoPi * k / (2 * span);
+      twiddleRe_[span - 1 + k] = static_cast<float>(std::cos(angle));
+      twiddleIm_[span - 1 + k] = static_cast<float>(-std::sin(angle));
+    }
+  }
+  splitRe_.resize(half_ + 1);
+  splitIm_.resize(half_ + 1);
+  for (int32_t k = 0; k <= half_; ++k) {
+    splitRe_[k] = static_cast<float>(std::cos(kTwoPi * k / size_));
+    splitIm_[k] = static_cast<float>(-std::sin(kTwoPi * k / size_));
+  }
+  workRe_.resize(half_);
+  workIm_.resize(half_);
+}
+
+size_t RealFft::memoryBytes() const {
+  return sizeof(RealFft) + vectorBytes(bitReverse_) + vectorBytes(twiddleRe_) +
+         vectorBytes(twiddleIm_) + vectorBytes(splitRe_) +
+         vectorBytes(splitIm_) + vectorBytes(workRe_) + vectorBytes(workIm_);
+}
+
+void RealFft::transform(bool inverse) {
+  float* re = workRe_.data();
+  float* im = workIm_.data();
+  for (int32_t i = 0; i < half_; ++i) {
+    const int32_t j = bitReverse_[i];
+    if (j > i) {
+      std::swap(re[i], re[j]);
+      std::swap(im[i], im[j]);
+    }
+  }
+  const float sign = inverse ? -1.0f : 1.0f;
+  int32_t firstSpan = 1;
+  if (half_ >= 4) {
+    // The first two stages only multiply by 1 and -i (i inverse), so they
+    // run fused, four points at a time.
+    for (int32_t start = 0; start < half_; start += 4) {
+      float* r = re + start;
+      float* m = im + start;
+      const float sumRe0 = r[0] + r[1];
+      const float sumIm0 = m[0] + m[1];
+      const float diffRe0 = r[0] - r[1];
+      const float diffIm0 = m[0] - m[1];
+      const float sumRe1 = r[2] + r[3];
+      const float sumIm1 = m[2] + m[3];
+      // (r[2] - r[3]) times -i for the forward transform.
+      const float rotRe1 = sign * (m[2] - m[3]);
+      const float rotIm1 = -sign * (r[2] - r[3]);
+      r[0] = sumRe0 + sumRe1;
+      m[0] = sumIm0 + sumIm1;
+      r[2] = sumRe0 - sumRe1;
+      m[2] = sumIm0 - sumIm1;
+      r[1] = diffRe0 + rotRe1;
+      m[1] = diffIm0 + rotIm1;
+      r[3] = diffRe0 - rotRe1;
+      m[3] = diffIm0 - rotIm1;
+    }
+    firstSpan = 4;
+  }
+  for (int32_t span = firstSpan; span < half_; span <<= 1) {
+    const float* twRe = &twiddleRe_[span - 1];
+    const float* twIm = &twiddleIm_[span - 1];
+    for (int32_t start = 0; start < half_; start += 2 * span) {
+      float* aRe = re + start;
+      float* aIm = im + start;
+      float* bRe = aRe + span;
+      float* bIm = aIm + span;
+      for (int32_t k = 0; k < span; ++k) {
+        const float wr = twRe[k];
+        const float wi = sign * twIm[k];
+        const float tr = bRe[k] * wr - bIm[k] * wi;
+        const float ti = bRe[k] * wi + bIm[k] * wr;
+        bRe[k] = aRe[k] - tr;
+        bIm[k] = aIm[k] - ti;
+        aRe[k] += tr;
+        aIm[k] += ti;
+      }
+    }
+  }
+}
+
+void RealFft::forward(const float* in, float* re, float* im) {
+  // Even samples go in the real part, odd ones in the imaginary part.
+  for (int32_t n = 0; n < half_; ++n) {
+    workRe_[n] = in[2 * n];
+    workIm_[n] = in[2 * n + 1];
+  }
+  transform(false);
+  for (int32_t k = 0; k <= half_; ++k) {
+    const int32_t a = k == half_ ? 0 : k;
+    const int32_t b = k == 0 ? 0 : half_ - k;
+    // Even and odd half-spectra from Z[k] and conj(Z[half - k]).
+    const float evenRe = 0.5f * (workRe_[a] + workRe_[b]);
+    const float evenIm = 0.5f * (workIm_[a] - workIm_[b]);
+    const float oddRe = 0.5f * (workIm_[a] + workIm_[b]);
+    const float oddIm = -0.5f * (workRe_[a] - workRe_[b]);
+    re[k] = evenRe + splitRe_[k] * oddRe - splitIm_[k] * oddIm;
+    im[k] = evenIm + splitRe_[k] * oddIm + splitIm_[k] * oddRe;
+  }
+}
+
+void RealFft::inverse(const float* re, const float* im, float* out) {
+  for (int32_t k = 0; k < half_; ++k) {
+    const int32_t m = half_ - k;
+    // E = (X[k] + conj(X[half - k])) / 2, O = (X[k] - conj(X[half - k])) /
+    // (2 W^k); then Z = E + iO.
+    const float evenRe = 0.5f * (re[k] + re[m]);
+    const float evenIm = 0.5f * (im[k] - im[m]);
+    const float diffRe = 0.5f * (re[k] - re[m]);
+    const float diffIm = 0.5f * (im[k] + im[m]);
+    // Dividing by W^k multiplies by its conjugate.
+    const float oddRe = diffRe * splitRe_[k] + diffIm * splitIm_[k];
+    const float oddIm = diffIm * splitRe_[k] - diffRe * splitIm_[k];
+    workRe_[k] = evenRe - oddIm;
+    workIm_[k] = evenIm + oddRe;
+  }
+  transform(true);
+  const float scale = 1.0f / static_cast<float>(half_);
+  for (int32_t n = 0; n < half_; ++n) {
+    out[2 * n] = workRe_[n] * scale;
+    out[2 * n + 1] = workIm_[n] * scale;
+  }
+}
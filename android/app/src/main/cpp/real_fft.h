@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "dsp_arena.h"
+
+// Radix-2 FFT of real signals, computed as a half-size complex FFT. Spectra
+// are split into real and imaginary arrays of size()/2 + 1 bins so the
+// convolution's multiply-accumulate loops vectorize. Holds scratch space:
+// one instance per thread.
+class RealFft {
+ public:
+  // size must be a power of two, at least 4.
+  explicit RealFft(int32_t size);
+
+  int32_t size() const { return size_; }
+  int32_t bins() const { return size_ / 2 + 1; }
+  // Heap bytes held by the tables and scratch space.
+  size_t memoryBytes() const;
+
+  // Unscaled forward transform of size() samples.
+  void forward(const float* in, float* re, float* im);
+  // Inverse of forward(), including the 1/size() scaling.
+  void inverse(const float* re, const float* im, float* out);
+
+ private:
+  // In-place complex FFT of half_ points over workRe_/workIm_.
+  void transform(bool inverse);
+
+  int32_t size_ = 0;
+  int32_t half_ = 0;
+  DspVector<int32_t> bitReverse_;
+  // e^(-pi*i*k/span) for each stage of the complex FFT, stage after stage.
+  DspVector<float> twiddleRe_;
+  DspVector<float> twiddleIm_;
+  // e^(-2*pi*i*k/size_) for splitting the packed real spectrum.
+  DspVector<float> splitRe_;
+  DspVector<float> splitIm_;
+  DspVector<float> workRe_;
+  DspVector<float> workIm_;
+};
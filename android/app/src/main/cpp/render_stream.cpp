@@ -0,0 +1,204 @@
+#include "render_stream.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "denormals.h"
+#include "native_log.h"
+#include "thread_config.h"
+#include "trace.h"
+
+namespace {
+constexpr int32_t kInputChunkFrames = 4096;
+constexpr int32_t kRingSeconds = 2;
+}  // namespace
+
+RenderStream::~RenderStream() { stopDecodeThread(); }
+
+void RenderStream::configureInput(const AudioFormatInfo& format,
+                                  int32_t outputRate) {
+  format_ = format;
+  outputRate_ = outputRate > 0 ? outputRate : format.sampleRate;
+  inputScratch_.assign(
+      static_cast<size_t>(kInputChunkFrames) * format_.channelCount, 0.0f);
+}
+
+bool RenderStream::openFile(const std::string& path,
+                            int32_t outputRate,
+                            bool useDecodeThread) {
+  decoder_ = createAudioDecoder(path);
+  if (!decoder_) return false;
+  configureInput(decoder_->format(), outputRate);
+  if (useDecodeThread) {
+    ring_.configure(static_cast<size_t>(format_.sampleRate) * kRingSeconds,
+                    format_.channelCount);
+    decoding_.store(true);
+    decodeThread_ = std::thread(&RenderStream::decodingLoop, this);
+  }
+  return true;
+}
+
+bool RenderStream::openPcm(int32_t sampleRate,
+                           int32_t channels,
+                           int32_t outputRate) {
+  if (sampleRate <= 0 || channels <= 0) return false;
+  AudioFormatInfo format;
+  format.sampleRate = sampleRate;
+  format.channelCount = channels;
+  configureInput(format, outputRate);
+  ring_.configure(static_cast<size_t>(sampleRate) * kRingSeconds, channels);
+  return true;
+}
+
+int32_t RenderStream::feed(const float* interleaved, int32_t frames) {
+  if (decoder_ || inputEnded_.load()) return 0;
+  return ring_.tryPush(interleaved, frames);
+}
+
+void RenderStream::endInput() {
+  if (!decoder_) inputEnded_.store(true);
+}
+
+void RenderStream::setParameters(const ChainParameters& params) {
+  std::lock_guard<std::mutex> lock(paramsMutex_);
+  targets_ = params;
+}
+
+void RenderStream::setImpulseResponse(
+    std::shared_ptr<const ImpulseResponse> ir) {
+  std::lock_guard<std::mutex> lock(paramsMutex_);
+  impulse_ = std::move(ir);
+  impulseChanged_ = true;
+}
+
+void RenderStream::decodingLoop() {
+  applyThreadRole(ThreadRole::kDecode, "sr-render-dec");
+  const ScopedFlushDenormals flushDenormals;
+  std::vector<float> buffer(inputScratch_.size());
+  while (decoding_.load()) {
+    int32_t decoded;
+    {
+      SLOWREVERB_TRACE_SCOPE("RenderStream::decode");
+      decoded = decoder_->read(buffer.data(), kInputChunkFrames);
+    }
+    int32_t offset = 0;
+    while (decoded > 0 && offset < decoded && decoding_.load()) {
+      const int32_t pushed = ring_.tryPush(
+          buffer.data() + static_cast<size_t>(offset) * format_.channelCount,
+          decoded - offset);
+      offset += pushed;
+      std::unique_lock<std::mutex> lock(ringMutex_);
+      ringCond_.notify_all();
+      if (offset < decoded) {
+        ringCond_.wait(lock, [this] {
+          return ring_.freeFrames() > 0 || !decoding_.load();
+        });
+      }
+    }
+    if (decoded < 0 || decoder_->isEndOfStream()) break;
+  }
+  std::lock_guard<std::mutex> lock(ringMutex_);
+  inputEnded_.store(true);
+  ringCond_.notify_all();
+}
+
+void RenderStream::stopDecodeThread() {
+  {
+    std::lock_guard<std::mutex> lock(ringMutex_);
+    decoding_.store(false);
+    ringCond_.notify_all();
+  }
+  if (decodeThread_.joinable()) {
+    decodeThread_.join();
+  }
+}
+
+int32_t RenderStream::nextInput() {
+  if (decoder_ && !decodeThread_.joinable()) {
+    SLOWREVERB_TRACE_SCOPE("RenderStream::decode");
+    const int32_t decoded =
+        decoder_->read(inputScratch_.data(), kInputChunkFrames);
+    if (decoded > 0) return decoded;
+    if (decoded < 0 || decoder_->isEndOfStream()) return -1;
+    return 0;
+  }
+  if (decoder_) {
+    // Decode thread: wait for it rather than returning short, since pull()
+    // callers are not realtime.
+    std::unique_lock<std::mutex> lock(ringMutex_);
+    ringCond_.wait(lock, [this] {
+      return ring_.availableFrames() > 0 || inputEnded_.load();
+    });
+  }
+  const bool ended = inputEnded_.load();
+  const int popped = ring_.pop(inputScratch_.data(), kInputChunkFrames);
+  if (decoder_) {
+    // Under the lock, so the decoder is either still to check for room or
+    // already waiting, and cannot miss the wakeup in between.
+    std::lock_guard<std::mutex> lock(ringMutex_);
+    ringCond_.notify_all();
+  }
+  if (popped > 0) return popped;
+  return ended ? -1 : 0;
+}
+
+int32_t RenderStream::pull(float* dst, int32_t frames) {
+  SLOWREVERB_TRACE_SCOPE("RenderStream::pull");
+  if (!dst || frames <= 0 || finished_.load()) return 0;
+  ChainParameters targets;
+  std::shared_ptr<const ImpulseResponse> impulse;
+  bool impulseChanged = false;
+  {
+    std::lock_guard<std::mutex> lock(paramsMutex_);
+    targets = targets_;
+    impulseChanged = impulseChanged_;
+    impulseChanged_ = false;
+    if (impulseChanged) impulse = impulse_;
+  }
+  if (!configured_) {
+    // Pulled by a non-realtime caller, so the phase vocoder may use threads.
+    chain_.setStretchThreads(PhaseVocoder::offlineThreads());
+    chain_.configure(format_.sampleRate, outputRate_, format_.channelCount,
+                     targets);
+    configured_ = true;
+  } else {
+    chain_.setTargets(targets);
+  }
+  if (impulseChanged) {
+    std::unique_ptr<ConvolutionReverb> convolution;
+    if (impulse) {
+      convolution = std::make_unique<ConvolutionReverb>();
+      convolution->configure(*impulse, outputRate_, format_.channelCount,
+                             false);
+    }
+    chain_.swapConvolution(std::move(convolution));
+  }
+
+  const size_t channels = static_cast<size_t>(format_.channelCount);
+  int32_t written = 0;
+  while (written < frames) {
+    if (chain_.availableFrames() > 0) {
+      written += chain_.receiveSamples(dst + written * channels,
+                                       frames - written);
+      continue;
+    }
+    if (inputFinished_) {
+      if (flushed_) {
+        finished_.store(true);
+        break;
+      }
+      chain_.flush();
+      flushed_ = true;
+      continue;
+    }
+    const int32_t got = nextInput();
+    if (got > 0) {
+      chain_.putSamples(inputScratch_.data(), got);
+    } else if (got < 0) {
+      inputFinished_ = true;
+    } else {
+      break;
+    }
+  }
+  return written;
+}
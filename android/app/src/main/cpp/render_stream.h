@@ -0,0 +1,79 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "audio_decoder.h"
+#include "decode_ring.h"
+#include "processing_chain.h"
+
+// Pull-driven counterpart of AudioEngine: runs the same processing chain but
+// produces audio only when pull() is called, at whatever speed the caller
+// drives it. Input comes from a file (decoded inline, or on a decode thread
+// when requested) or from PCM fed by the caller.
+class RenderStream {
+ public:
+  ~RenderStream();
+
+  bool openFile(const std::string& path,
+                int32_t outputRate,
+                bool useDecodeThread);
+  bool openPcm(int32_t sampleRate, int32_t channels, int32_t outputRate);
+
+  // Queues caller-provided PCM. Returns the number of frames accepted; the
+  // rest must be fed again once pull() has made room.
+  int32_t feed(const float* interleaved, int32_t frames);
+  void endInput();
+
+  // The stretch mode is taken from the parameters in effect at the first
+  // pull().
+  void setParameters(const ChainParameters& params);
+  // Switches the reverb stage to convolution with ir, or back to
+  // SimpleReverb for nullptr. Tail partitions are computed inline, so
+  // rendering runs as fast as the caller pulls. Applied at the next pull().
+  void setImpulseResponse(std::shared_ptr<const ImpulseResponse> ir);
+  // Fills up to frames interleaved frames of processed audio. Returns fewer
+  // when fed input runs dry or the stream has finished. One thread at a
+  // time; the other calls may come from any thread.
+  int32_t pull(float* dst, int32_t frames);
+  bool finished() const { return finished_.load(); }
+
+  int32_t outputRate() const { return outputRate_; }
+  int32_t channelCount() const { return format_.channelCount; }
+
+ private:
+  void configureInput(const AudioFormatInfo& format, int32_t outputRate);
+  // Fetches the next block of source frames into inputScratch_. Returns 0
+  // when input is momentarily unavailable, -1 when it has ended.
+  int32_t nextInput();
+  void decodingLoop();
+  void stopDecodeThread();
+
+  std::unique_ptr<AudioDecoder> decoder_;
+  AudioFormatInfo format_;
+  int32_t outputRate_ = 48000;
+  ProcessingChain chain_;
+  DecodeRing ring_;
+  std::vector<float> inputScratch_;
+
+  std::mutex paramsMutex_;
+  ChainParameters targets_;
+  std::shared_ptr<const ImpulseResponse> impulse_;
+  bool impulseChanged_ = false;
+  // Owned by pull().
+  bool configured_ = false;
+  bool inputFinished_ = false;
+  bool flushed_ = false;
+  std::atomic<bool> finished_{false};
+  std::atomic<bool> inputEnded_{false};
+
+  std::thread decodeThread_;
+  std::atomic<bool> decoding_{false};
+  std::mutex ringMutex_;
+  std::condition_variable ringCond_;
+};
@@ -1,15 +1,64 @@
 #include "simple_reverb.h"
 
 #include <algorithm>
+#include <cmath>
+#include <iterator>
+
+#include "memory_usage.h"
+#include "trace.h"
 
 namespace {
-constexpr int kCombCount = 4;
+constexpr int kCombCount = SimpleReverb::kMaxCombs;
 constexpr int kEchoCount = 2;
+constexpr int kCombBaseMs[kCombCount] = {35, 47, 58, 67};
+constexpr int kEchoBaseMs[kEchoCount] = {120, 180};
+constexpr float kMaxRoomScale = 1.3f;
+constexpr float kMaxEchoMs = 500.0f;
+// Per-channel all-pass delays; channels past the table reuse it, shifted.
+constexpr float kDiffuserMs[] = {4.3f, 5.9f,  7.1f,  8.3f,
+                                 9.7f, 11.3f, 12.7f, 13.9f};
+constexpr int kDiffuserCount = sizeof(kDiffuserMs) / sizeof(kDiffuserMs[0]);
+constexpr float kDiffuserGain = 0.5f;
+// Spreads each channel's comb taps over the first half of the line.
+constexpr float kTapSpread = 0.6180339887f;
+constexpr float kCombFadeMs = 20.0f;
+
+size_t delaySamples(float delayMs, int32_t sampleRate) {
+  return static_cast<size_t>(delayMs * sampleRate / 1000.0f) + 1;
+}
 }  // namespace
 
 void SimpleReverb::configure(int32_t sampleRate, int32_t channels) {
   sampleRate_ = std::max(1, sampleRate);
   channels_ = std::max(1, channels);
+  // Reserve the longest delays up front so parameter changes made from the
+  // audio thread only resize within capacity.
+  combLines_.resize(kCombCount);
+  echoLines_.resize(kEchoCount);
+  for (int i = 0; i < kCombCount; ++i) {
+    combLines_[i].buffer.reserve(
+        delaySamples(kCombBaseMs[i] * kMaxRoomScale, sampleRate_));
+  }
+  for (int i = 0; i < kEchoCount; ++i) {
+    echoLines_[i].buffer.reserve(
+        delaySamples(kEchoBaseMs[i] + kMaxEchoMs, sampleRate_));
+  }
+  combTaps_.assign(static_cast<size_t>(channels_) * kCombCount, 0);
+  diffusers_.resize(channels_);
+  for (int ch = 0; ch < channels_; ++ch) {
+    const float delayMs = kDiffuserMs[ch % kDiffuserCount] +
+                          0.7f * static_cast<float>(ch / kDiffuserCount);
+    diffusers_[ch].buffer.assign(delaySamples(delayMs, sampleRate_), 0.0f);
+    diffusers_[ch].index = 0;
+  }
+  channelWet_.assign(static_cast<size_t>(channels_) * kMaxBlockFrames, 0.0f);
+  mid_.assign(kMaxBlockFrames, 0.0f);
+  echo_.assign(kMaxBlockFrames, 0.0f);
+  combFadeStep_ = 1.0f / (kCombFadeMs * sampleRate_ / 1000.0f);
+  std::copy(std::begin(combTarget_), std::end(combTarget_),
+            std::begin(combGain_));
+  quietFrames_ = 0;
+  idle_ = false;
   ensureLines();
 }
 
@@ -17,72 +66,277 @@ void SimpleReverb::setParameters(float wet,
                                  float decay,
                                  float tone,
                                  float room,
-                                 float echo) {
+                                 float echo,
+                                 float width) {
   wet_ = std::clamp(wet, 0.0f, 1.0f);
   decay_ = std::clamp(decay, 0.1f, 12.0f);
   tone_ = std::clamp(tone, 0.0f, 1.0f);
   room_ = std::clamp(room, 0.0f, 1.0f);
-  echoMs_ = std::max(0.0f, echo);
+  echoMs_ = std::clamp(echo, 0.0f, kMaxEchoMs);
+  width_ = std::clamp(width, 0.0f, 1.0f);
   ensureLines();
 }
 
+void SimpleReverb::setCombCount(int32_t combs) {
+  const int32_t active = std::clamp(combs, 1, kCombCount);
+  // Comb outputs add up like uncorrelated signals, so power is kept.
+  const float gain = std::sqrt(static_cast<float>(kCombCount) / active);
+  for (int i = 0; i < kCombCount; ++i) {
+    combTarget_[i] = i < active ? gain : 0.0f;
+  }
+}
+
+float SimpleReverb::tailMs(float floorDb) const {
+  if (wet_ <= 0.0f) return 0.0f;
+  const float combGain = std::clamp(decay_ / 8.0f, 0.05f, 0.9f);
+  const float echoGain = std::clamp(0.2f + (tone_ * 0.4f), 0.2f, 0.7f);
+  const float floor = std::pow(10.0f, floorDb / 20.0f);
+  float longest = 0.0f;
+  for (const auto& line : combLines_) {
+    const float delayMs = line.buffer.size() * 1000.0f / sampleRate_;
+    longest = std::max(
+        longest, delayMs * std::log(floor) / std::log(combGain));
+  }
+  for (const auto& line : echoLines_) {
+    const float delayMs = line.buffer.size() * 1000.0f / sampleRate_;
+    longest = std::max(
+        longest, delayMs * std::log(floor) / std::log(echoGain));
+  }
+  return longest;
+}
+
 void SimpleReverb::ensureLines() {
-  const float roomScale = 0.5f + room_ * 0.8f;
-  const int combBaseMs[kCombCount] = {35, 47, 58, 67};
-  const int echoBaseMs[kEchoCount] = {120, 180};
+  const float roomScale = 0.5f + room_ * (kMaxRoomScale - 0.5f);
 
-  combLines_.resize(channels_ * kCombCount);
-  for (int ch = 0; ch < channels_; ++ch) {
-    for (int i = 0; i < kCombCount; ++i) {
-      const float delayMs = combBaseMs[i] * roomScale;
-      const size_t samples =
-          static_cast<size_t>(delayMs * sampleRate_ / 1000.0f) + 1;
-      auto& line = combLines_[ch * kCombCount + i];
-      line.buffer.resize(samples, 0.0f);
-      line.index %= samples;
+  blockFrames_ = kMaxBlockFrames;
+  for (int i = 0; i < kCombCount; ++i) {
+    const size_t samples =
+        delaySamples(kCombBaseMs[i] * roomScale, sampleRate_);
+    auto& line = combLines_[i];
+    line.buffer.resize(samples, 0.0f);
+    line.index %= samples;
+    // Channel 0 reads the comb output itself; the others read it earlier
+    // in the line, i.e. at shorter delays of the same recirculating signal.
+    for (int ch = 0; ch < channels_; ++ch) {
+      const float spread = ch * kTapSpread * (i + 1);
+      combTaps_[ch * kCombCount + i] = static_cast<size_t>(
+          (spread - std::floor(spread)) * 0.5f * samples);
     }
+    const int32_t halfLine = static_cast<int32_t>(samples / 2);
+    blockFrames_ = std::min(blockFrames_, std::max<int32_t>(1, halfLine));
   }
 
-  echoLines_.resize(channels_ * kEchoCount);
-  for (int ch = 0; ch < channels_; ++ch) {
-    for (int i = 0; i < kEchoCount; ++i) {
-      const float delayMs = echoBaseMs[i] + echoMs_;
-      const size_t samples =
-          static_cast<size_t>(delayMs * sampleRate_ / 1000.0f) + 1;
-      auto& line = echoLines_[ch * kEchoCount + i];
-      line.buffer.resize(samples, 0.0f);
-      line.index %= samples;
+  for (int i = 0; i < kEchoCount; ++i) {
+    const size_t samples =
+        delaySamples(kEchoBaseMs[i] + echoMs_, sampleRate_);
+    auto& line = echoLines_[i];
+    line.buffer.resize(samples, 0.0f);
+    line.index %= samples;
+  }
+
+  longestLine_ = 0;
+  for (const auto& line : combLines_) {
+    longestLine_ = std::max(longestLine_, line.buffer.size());
+  }
+  for (const auto& line : echoLines_) {
+    longestLine_ = std::max(longestLine_, line.buffer.size());
+  }
+}
+
+size_t SimpleReverb::memoryBytes() const {
+  size_t bytes = vectorBytes(combTaps_) + vectorBytes(channelWet_) +
+                 vectorBytes(mid_) + vectorBytes(echo_);
+  for (const auto* lines : {&combLines_, &echoLines_, &diffusers_}) {
+    bytes += vectorBytes(*lines);
+    for (const auto& line : *lines) bytes += vectorBytes(line.buffer);
+  }
+  return bytes;
+}
+
+bool SimpleReverb::isSilent(const float* samples, size_t count) {
+  return std::all_of(samples, samples + count, [](float sample) {
+    return std::fabs(sample) < kSilenceLevel;
+  });
+}
+
+bool SimpleReverb::tryIdle() {
+  for (const auto* lines : {&combLines_, &echoLines_, &diffusers_}) {
+    for (const auto& line : *lines) {
+      if (!isSilent(line.buffer.data(), line.buffer.size())) return false;
+    }
+  }
+  for (auto* lines : {&combLines_, &echoLines_, &diffusers_}) {
+    for (auto& line : *lines) {
+      std::fill(line.buffer.begin(), line.buffer.end(), 0.0f);
     }
   }
+  idle_ = true;
+  return true;
 }
 
 void SimpleReverb::process(float* interleaved, int32_t frames) {
+  SLOWREVERB_TRACE_SCOPE("SimpleReverb::process");
+  wetEnergy_ = 0.0f;
   if (frames <= 0 || wet_ <= 0.0f) return;
+  if (idle_) {
+    if (isSilent(interleaved, static_cast<size_t>(frames) * channels_)) return;
+    idle_ = false;
+    quietFrames_ = 0;
+  }
   const float combGain = std::clamp(decay_ / 8.0f, 0.05f, 0.9f);
   const float echoGain = std::clamp(0.2f + (tone_ * 0.4f), 0.2f, 0.7f);
   const float dryMix = 1.0f - wet_;
+  const float inverseChannels = 1.0f / channels_;
+  const float wetScale = 1.0f / (kCombCount + kEchoCount * 0.5f);
+  float energy = 0.0f;
+
+  // Line by line over short blocks. A block stays under half the shortest
+  // comb, so no tap reads a slot written earlier in the same block and the
+  // result matches running the lines sample by sample.
+  for (int32_t done = 0; done < frames;) {
+    const int32_t count = std::min(frames - done, blockFrames_);
+    float* samples = interleaved + static_cast<size_t>(done) * channels_;
+    float* mid = mid_.data();
+    float* echo = echo_.data();
+    float peak = 0.0f;
+    for (int32_t n = 0; n < count; ++n) {
+      float sum = 0.0f;
+      for (int ch = 0; ch < channels_; ++ch) {
+        const float sample = samples[n * channels_ + ch];
+        sum += sample;
+        peak = std::max(peak, std::fabs(sample));
+      }
+      mid[n] = sum * inverseChannels;
+    }
+    std::fill(channelWet_.begin(), channelWet_.end(), 0.0f);
+    std::fill(echo, echo + count, 0.0f);
+
+    for (int i = 0; i < kCombCount; ++i) {
+      auto& line = combLines_[i];
+      const float gain = combGain_[i];
+      const float target = combTarget_[i];
+      if (gain == 0.0f && target == 0.0f) continue;
+      const float fade = combFadeStep_ * count;
+      const float next = gain < target ? std::min(target, gain + fade)
+                                       : std::max(target, gain - fade);
+      const float step = (next - gain) / count;
+      for (int ch = 0; ch < channels_; ++ch) {
+        size_t tap = line.index + combTaps_[ch * kCombCount + i];
+        if (tap >= line.buffer.size()) tap -= line.buffer.size();
+        readLine(line.buffer, tap, &channelWet_[ch * kMaxBlockFrames], count,
+                 gain, step);
+      }
+      combGain_[i] = next;
+      if (next == 0.0f && target == 0.0f) {
+        // Faded out: restart from silence if it comes back.
+        std::fill(line.buffer.begin(), line.buffer.end(), 0.0f);
+        continue;
+      }
+      feedLine(line, mid, combGain, nullptr, 0.0f, count);
+    }
+    for (auto& line : echoLines_) {
+      feedLine(line, mid, echoGain, echo, 0.5f, count);
+    }
 
-  for (int32_t frame = 0; frame < frames; ++frame) {
     for (int ch = 0; ch < channels_; ++ch) {
-      const int idx = frame * channels_ + ch;
-      const float dry = interleaved[idx];
-      float accum = 0.0f;
-      for (int i = 0; i < kCombCount; ++i) {
-        auto& line = combLines_[ch * kCombCount + i];
-        const float delayed = line.buffer[line.index];
-        line.buffer[line.index] = dry + delayed * combGain;
-        line.index = (line.index + 1) % line.buffer.size();
-        accum += delayed;
+      float* wet = &channelWet_[ch * kMaxBlockFrames];
+      for (int32_t n = 0; n < count; ++n) {
+        wet[n] = (wet[n] + echo[n]) * wetScale;
+      }
+      diffuse(diffusers_[ch], wet, count);
+    }
+
+    for (int32_t n = 0; n < count; ++n) {
+      float wetMid = 0.0f;
+      for (int ch = 0; ch < channels_; ++ch) {
+        wetMid += channelWet_[ch * kMaxBlockFrames + n];
+      }
+      wetMid *= inverseChannels;
+      for (int ch = 0; ch < channels_; ++ch) {
+        const float wetSample =
+            wetMid + width_ * (channelWet_[ch * kMaxBlockFrames + n] - wetMid);
+        float& sample = samples[n * channels_ + ch];
+        sample = sample * dryMix + wetSample * wet_;
+        peak = std::max(peak, std::fabs(wetSample));
+        energy += wetSample * wetSample;
       }
-      for (int i = 0; i < kEchoCount; ++i) {
-        auto& line = echoLines_[ch * kEchoCount + i];
-        const float delayed = line.buffer[line.index];
-        line.buffer[line.index] = dry + delayed * echoGain;
-        line.index = (line.index + 1) % line.buffer.size();
-        accum += delayed * 0.5f;
+    }
+    done += count;
+    quietFrames_ = peak < kSilenceLevel ? quietFrames_ + count : 0;
+  }
+  wetEnergy_ = energy * wet_ * wet_ / (static_cast<float>(frames) * channels_);
+  // A line is read out once per its length, so after that long without
+  // output above the level it is worth scanning; a miss waits another round.
+  if (quietFrames_ >= static_cast<int64_t>(longestLine_) && !tryIdle()) {
+    quietFrames_ = 0;
+  }
+}
+
+void SimpleReverb::readLine(const DspVector<float>& buffer,
+                            size_t from,
+                            float* dst,
+                            int32_t count,
+                            float gain,
+                            float gainStep) {
+  const float* src = buffer.data();
+  const size_t size = buffer.size();
+  while (count > 0) {
+    const int32_t run =
+        static_cast<int32_t>(std::min<size_t>(count, size - from));
+    if (gainStep == 0.0f && gain == 1.0f) {
+      for (int32_t n = 0; n < run; ++n) dst[n] += src[from + n];
+    } else {
+      for (int32_t n = 0; n < run; ++n) {
+        dst[n] += src[from + n] * (gain + gainStep * n);
       }
-      const float wetSample = accum / (kCombCount + kEchoCount * 0.5f);
-      interleaved[idx] = dry * dryMix + wetSample * wet_;
+      gain += gainStep * run;
+    }
+    dst += run;
+    count -= run;
+    from = 0;
+  }
+}
+
+void SimpleReverb::feedLine(DelayLine& line,
+                            const float* input,
+                            float feedback,
+                            float* output,
+                            float outputGain,
+                            int32_t count) {
+  float* buffer = line.buffer.data();
+  const size_t size = line.buffer.size();
+  while (count > 0) {
+    const int32_t run =
+        static_cast<int32_t>(std::min<size_t>(count, size - line.index));
+    float* slot = buffer + line.index;
+    if (output) {
+      for (int32_t n = 0; n < run; ++n) output[n] += slot[n] * outputGain;
+      output += run;
+    }
+    for (int32_t n = 0; n < run; ++n) slot[n] = input[n] + slot[n] * feedback;
+    input += run;
+    count -= run;
+    line.index += run;
+    if (line.index == size) line.index = 0;
+  }
+}
+
+void SimpleReverb::diffuse(DelayLine& line, float* samples, int32_t count) {
+  float* buffer = line.buffer.data();
+  const size_t size = line.buffer.size();
+  while (count > 0) {
+    const int32_t run =
+        static_cast<int32_t>(std::min<size_t>(count, size - line.index));
+    float* slot = buffer + line.index;
+    for (int32_t n = 0; n < run; ++n) {
+      const float input = samples[n];
+      const float output = slot[n] - kDiffuserGain * input;
+      slot[n] = input + kDiffuserGain * output;
+      samples[n] = output;
     }
+    samples += run;
+    count -= run;
+    line.index += run;
+    if (line.index == size) line.index = 0;
   }
 }
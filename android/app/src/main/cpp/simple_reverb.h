@@ -1,21 +1,77 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
-#include <vector>
 
+#include "dsp_arena.h"
+
+// Comb and echo network run once over the mid (channel average) signal.
+// Each output channel reads the combs at its own taps and passes through
+// its own short all-pass, so channels come out decorrelated while the cost
+// barely grows with the channel count.
 class SimpleReverb {
  public:
   void configure(int32_t sampleRate, int32_t channels);
-  void setParameters(float wet, float decay, float tone, float room, float echo);
+  // width scales the difference between each channel's wet signal and the
+  // wet mid: 0 is a mono reverb, 1 the full decorrelated spread.
+  void setParameters(float wet,
+                     float decay,
+                     float tone,
+                     float room,
+                     float echo,
+                     float width);
+  // Once the input has been silent long enough for every line to fall
+  // below kSilenceLevel, the lines are cleared and process() passes silent
+  // input through untouched until sound returns.
   void process(float* interleaved, int32_t frames);
+  // Runs only the first combs of the network, kMaxCombs at most. Combs
+  // fade in and out over a few milliseconds, and the remaining ones are
+  // made louder to keep the wet level, so this can change while playing.
+  void setCombCount(int32_t combs);
+  // Time for the feedback lines to decay by floorDb at the current settings.
+  float tailMs(float floorDb) const;
+  // True while process() is skipping the network.
+  bool idle() const { return idle_; }
+  // Mean square of the wet signal the last process() mixed in.
+  float wetEnergy() const { return wetEnergy_; }
+  // Heap bytes held by the delay lines and scratch buffers.
+  size_t memoryBytes() const;
+
+  static constexpr int32_t kMaxCombs = 4;
+  // Peak level treated as silence, about -100 dBFS: below one 16-bit step.
+  static constexpr float kSilenceLevel = 1e-5f;
+  static bool isSilent(const float* samples, size_t count);
 
  private:
   struct DelayLine {
-    std::vector<float> buffer;
+    DspVector<float> buffer;
     size_t index = 0;
   };
 
+  static constexpr int32_t kMaxBlockFrames = 256;
+
   void ensureLines();
+  // Clears the lines and goes idle if none holds anything above
+  // kSilenceLevel.
+  bool tryIdle();
+  // Adds count samples of buffer, starting at from and wrapping, to dst,
+  // scaled by a gain ramp from gain in steps of gainStep.
+  static void readLine(const DspVector<float>& buffer,
+                       size_t from,
+                       float* dst,
+                       int32_t count,
+                       float gain,
+                       float gainStep);
+  // Advances a feedback line by count samples of input, adding its delayed
+  // output times outputGain to output when given.
+  static void feedLine(DelayLine& line,
+                       const float* input,
+                       float feedback,
+                       float* output,
+                       float outputGain,
+                       int32_t count);
+  // Runs samples in place through a Schroeder all-pass.
+  static void diffuse(DelayLine& line, float* samples, int32_t count);
 
   int32_t sampleRate_ = 48000;
   int32_t channels_ = 2;
@@ -24,6 +80,27 @@ class SimpleReverb {
   float tone_ = 0.6f;
   float room_ = 0.8f;
   float echoMs_ = 0.0f;
-  std::vector<DelayLine> combLines_;
-  std::vector<DelayLine> echoLines_;
+  float width_ = 1.0f;
+  DspVector<DelayLine> combLines_;
+  // Per comb: output gain now and the one it fades to; 0 and 0 skips it.
+  float combGain_[kMaxCombs] = {1.0f, 1.0f, 1.0f, 1.0f};
+  float combTarget_[kMaxCombs] = {1.0f, 1.0f, 1.0f, 1.0f};
+  float combFadeStep_ = 1.0f;
+  DspVector<DelayLine> echoLines_;
+  // Per channel: comb read offsets, [channel][comb], and the all-pass.
+  DspVector<size_t> combTaps_;
+  DspVector<DelayLine> diffusers_;
+  // Block scratch: per-channel wet, [channel][kMaxBlockFrames], the mid
+  // input and the shared echo output.
+  DspVector<float> channelWet_;
+  DspVector<float> mid_;
+  DspVector<float> echo_;
+  // Frames per block; below half the shortest comb.
+  int32_t blockFrames_ = kMaxBlockFrames;
+  // Consecutive frames of silent input and output, and the longest line,
+  // after which the lines are checked for silence.
+  int64_t quietFrames_ = 0;
+  size_t longestLine_ = 0;
+  bool idle_ = false;
+  float wetEnergy_ = 0.0f;
 };
@@ -0,0 +1,149 @@
+#include "snippet_renderer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#include "audio_decoder.h"
+#include "format_converter.h"
+
+namespace {
+constexpr size_t kMaxCacheEntries = 24;
+constexpr size_t kMaxCacheBytes = 96u * 1024u * 1024u;
+constexpr float kMaxReverbPrerollMs = 2000.0f;
+constexpr int32_t kChunkFrames = 4096;
+}  // namespace
+
+int32_t SnippetRenderer::framesFor(const SnippetRequest& request) {
+  return static_cast<int32_t>(
+      std::lround(std::max(0.0, request.lengthMs) *
+                  request.outputSampleRate / 1000.0));
+}
+
+std::string SnippetRenderer::cacheKey(const SnippetRequest& request) {
+  const ChainParameters& p = request.params;
+  char buffer[256];
+  std::snprintf(buffer, sizeof(buffer),
+                "|%.1f|%.1f|%d|%d|%.4f|%.4f|%.4f|%.4f|%.4f|%.4f|%.2f|%.4f|%d",
+                request.startMs, request.lengthMs, request.outputSampleRate,
+                request.outputChannels, p.tempo, p.pitchSemi, p.wet, p.decay,
+                p.tone, p.room, p.echoMs, p.width,
+                static_cast<int>(p.stretch));
+  return request.path + buffer;
+}
+
+int32_t SnippetRenderer::render(const SnippetRequest& request,
+                                float* out,
+                                int32_t capacityFrames) {
+  const int32_t frames = framesFor(request);
+  if (!out || frames <= 0 || capacityFrames < frames ||
+      request.outputChannels <= 0 || request.outputSampleRate <= 0) {
+    return -1;
+  }
+  const size_t samples =
+      static_cast<size_t>(frames) * static_cast<size_t>(request.outputChannels);
+  const std::string key = cacheKey(request);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto it = cache_.begin(); it != cache_.end(); ++it) {
+      if (it->key == key) {
+        std::memcpy(out, it->samples.data(), samples * sizeof(float));
+        cache_.splice(cache_.begin(), cache_, it);
+        return cache_.front().audibleFrames;
+      }
+    }
+  }
+
+  const int32_t audible = renderUncached(request, out, frames);
+  if (audible < 0) return audible;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  CacheEntry entry;
+  entry.key = key;
+  entry.audibleFrames = audible;
+  entry.samples.assign(out, out + samples);
+  cachedBytes_ += samples * sizeof(float);
+  cache_.push_front(std::move(entry));
+  while (!cache_.empty() &&
+         (cache_.size() > kMaxCacheEntries || cachedBytes_ > kMaxCacheBytes)) {
+    cachedBytes_ -= cache_.back().samples.size() * sizeof(float);
+    cache_.pop_back();
+  }
+  return audible;
+}
+
+void SnippetRenderer::clearCache() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  cache_.clear();
+  cachedBytes_ = 0;
+}
+
+int32_t SnippetRenderer::renderUncached(const SnippetRequest& request,
+                                        float* out,
+                                        int32_t frames) {
+  auto decoder = createAudioDecoder(request.path);
+  if (!decoder) return -1;
+  const AudioFormatInfo& format = decoder->format();
+  const int32_t channels = format.channelCount;
+
+  ProcessingChain chain;
+  chain.setStretchThreads(PhaseVocoder::offlineThreads());
+  chain.configure(format.sampleRate, request.outputSampleRate, channels,
+                  request.params);
+
+  // Start early enough that the reverb tail and SoundTouch's overlap buffers
+  // are already filled when the requested range begins.
+  const double prerollMs = std::min<double>(
+      std::min(chain.reverbTailMs(), kMaxReverbPrerollMs) + 100.0,
+      std::max(0.0, request.startMs));
+  const double decodeStartMs = std::max(0.0, request.startMs) - prerollMs;
+  if (!decoder->seekToUs(static_cast<int64_t>(decodeStartMs * 1000.0))) {
+    return -1;
+  }
+  int64_t discardFrames = std::llround(
+      prerollMs * format.sampleRate / 1000.0 *
+      chain.outputFramesPerInputFrame());
+
+  std::vector<float> input(static_cast<size_t>(kChunkFrames) * channels);
+  std::vector<float> processed(static_cast<size_t>(kChunkFrames) * channels);
+  const int32_t outChannels = request.outputChannels;
+  int32_t written = 0;
+  bool flushed = false;
+
+  while (written < frames) {
+    if (chain.availableFrames() < kChunkFrames && !flushed) {
+      const int32_t decoded = decoder->read(input.data(), kChunkFrames);
+      if (decoded < 0) break;
+      if (decoded > 0) {
+        chain.putSamples(input.data(), decoded);
+      } else if (decoder->isEndOfStream()) {
+        chain.flush();
+        flushed = true;
+      }
+      continue;
+    }
+    const int32_t received =
+        chain.receiveSamples(processed.data(), kChunkFrames);
+    if (received <= 0) {
+      if (flushed) break;
+      continue;
+    }
+    int32_t offset = 0;
+    if (discardFrames > 0) {
+      offset = static_cast<int32_t>(std::min<int64_t>(discardFrames, received));
+      discardFrames -= offset;
+    }
+    const int32_t usable = std::min(received - offset, frames - written);
+    if (usable > 0) {
+      mixChannels(processed.data() + static_cast<size_t>(offset) * channels,
+                  channels, out + static_cast<size_t>(written) * outChannels,
+                  outChannels, usable);
+      written += usable;
+    }
+  }
+
+  std::fill(out + static_cast<size_t>(written) * outChannels,
+            out + static_cast<size_t>(frames) * outChannels, 0.0f);
+  return written;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "processing_chain.h"
+
+struct SnippetRequest {
+  std::string path;
+  double startMs = 0.0;
+  double lengthMs = 0.0;
+  int32_t outputSampleRate = 48000;
+  int32_t outputChannels = 2;
+  ChainParameters params;
+};
+
+// Renders short processed excerpts of a file offline, for previews on
+// platforms without the realtime engine. Results are cached per request so
+// toggling back to an earlier parameter set does not render again.
+class SnippetRenderer {
+ public:
+  static int32_t framesFor(const SnippetRequest& request);
+
+  // Writes framesFor(request) interleaved frames into out. Returns the number
+  // of frames containing audio (the rest is zero-filled past the end of the
+  // file), or -1 if the file cannot be decoded.
+  int32_t render(const SnippetRequest& request,
+                 float* out,
+                 int32_t capacityFrames);
+  void clearCache();
+
+ private:
+  struct CacheEntry {
+    std::string key;
+    int32_t audibleFrames = 0;
+    std::vector<float> samples;
+  };
+
+  static std::string cacheKey(const SnippetRequest& request);
+  int32_t renderUncached(const SnippetRequest& request, float* out,
+                         int32_t frames);
+
+  std::mutex mutex_;
+  std::list<CacheEntry> cache_;
+  size_t cachedBytes_ = 0;
+};
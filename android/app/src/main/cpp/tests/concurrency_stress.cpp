@@ -0,0 +1,832 @@
+// Concurrency stress harness for the decode ring and the engine lifecycle.
+//
+//   slowreverb_stress [--seconds=N] [--threads=N] [--seed=N]
+//                     [--only=ring|engine|telemetry|render]
+//
+// ring    A producer and a consumer move a numbered frame sequence through a
+//         DecodeRing in random chunk sizes while observer threads poll its
+//         fill level. Every frame is checked for order, and throughput is
+//         reported with and without observers. The 16-bit storage formats
+//         are then checked for round-trip precision across the wrap.
+// telemetry
+//         The audio thread's EngineTelemetry publishes while reader threads
+//         copy it. The published position is derived from the frame count,
+//         so a copy that mixes two writes is caught.
+// engine  Worker threads call the FFI entry points (create, start, stop,
+//         seek, setters, getters, dispose) in random order with random
+//         gaps. The engines share a small handle table, so dispose races
+//         with every other call. The engines run on the offline sink.
+// render  Pairs of threads share a render stream: one feeds and pulls it
+//         while the other polls it and closes it after a random gap, so
+//         close lands in the middle of pull. Half the streams decode a
+//         file on their own thread, which close has to join. Once closed,
+//         and after the next stream has been opened, the old handle must be
+//         rejected.
+//
+// Configure with -DSLOWREVERB_SANITIZER=thread so ThreadSanitizer reports
+// data races; it exits with status 66 when it found any. Without it the run
+// still checks ring integrity and FFI return values.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "decode_ring.h"
+#include "engine_telemetry.h"
+#include "native_api.h"
+#include "test_signals.h"
+
+// The C API from native_audio.cpp, which is compiled into this executable.
+extern "C" {
+intptr_t slowreverb_engine_create_with_sink(int32_t sink_type);
+void slowreverb_engine_dispose(intptr_t handle);
+int slowreverb_engine_start(intptr_t handle, const char* path);
+void slowreverb_engine_stop(intptr_t handle);
+void slowreverb_set_event_callback(void (*callback)(intptr_t handle,
+                                                    int32_t event,
+                                                    int32_t code));
+void slowreverb_set_pin_to_performance_cores(int32_t enabled);
+void slowreverb_engine_start_async(intptr_t handle, const char* path);
+void slowreverb_engine_stop_async(intptr_t handle);
+void slowreverb_engine_dispose_async(intptr_t handle);
+void slowreverb_engine_seek(intptr_t handle, double position_ms);
+int slowreverb_engine_enqueue(intptr_t handle, const char* path);
+void slowreverb_engine_clear_queue(intptr_t handle);
+void slowreverb_engine_set_crossfade_ms(intptr_t handle, double crossfade_ms);
+int32_t slowreverb_engine_get_track_index(intptr_t handle);
+void slowreverb_engine_set_compare(intptr_t handle,
+                                   int32_t enabled,
+                                   int32_t tempo_matched);
+void slowreverb_engine_set_monitor(intptr_t handle,
+                                   int32_t dry,
+                                   double fade_ms);
+int slowreverb_engine_set_impulse_response(intptr_t handle, const char* path);
+void slowreverb_engine_set_tempo(intptr_t handle, double tempo);
+void slowreverb_engine_set_pitch(intptr_t handle, double semi);
+void slowreverb_engine_set_mix(intptr_t handle, double wet);
+void slowreverb_engine_set_reverb(intptr_t handle,
+                                  double decay,
+                                  double tone,
+                                  double room,
+                                  double echo_ms);
+void slowreverb_engine_set_width(intptr_t handle, double width);
+double slowreverb_engine_get_position_ms(intptr_t handle);
+double slowreverb_engine_get_duration_ms(intptr_t handle);
+int slowreverb_engine_get_stats(intptr_t handle, SlowReverbEngineStats* out);
+void slowreverb_engine_set_memory_budget(intptr_t handle, int64_t bytes);
+void slowreverb_engine_set_ring_format(intptr_t handle, int32_t format);
+int slowreverb_engine_get_memory(intptr_t handle, SlowReverbEngineMemory* out);
+void slowreverb_engine_reset_stats(intptr_t handle);
+
+intptr_t slowreverb_render_open_file(const char* path,
+                                     int32_t output_sample_rate,
+                                     int32_t use_thread);
+intptr_t slowreverb_render_open_pcm(int32_t sample_rate,
+                                    int32_t channels,
+                                    int32_t output_sample_rate);
+int32_t slowreverb_render_feed(intptr_t handle,
+                               const float* src,
+                               int32_t frames);
+void slowreverb_render_end_input(intptr_t handle);
+int32_t slowreverb_render_pull(intptr_t handle, float* dst, int32_t frames);
+int32_t slowreverb_render_finished(intptr_t handle);
+int32_t slowreverb_render_get_format(intptr_t handle,
+                                     int32_t* sample_rate,
+                                     int32_t* channels);
+void slowreverb_render_close(intptr_t handle);
+}
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr int32_t kSampleRate = 48000;
+constexpr int32_t kChannels = 2;
+constexpr double kInputSeconds = 3.0;
+constexpr int32_t kOfflineSinkType = 3;
+constexpr int kEngineSlots = 4;
+
+struct Options {
+  double seconds = 4.0;
+  int threads = 6;
+  uint32_t seed = 1;
+  std::string only;
+};
+
+bool takeFlag(const char* arg, const char* name, std::string* value) {
+  const size_t length = std::strlen(name);
+  if (std::strncmp(arg, name, length) != 0 || arg[length] != '=') {
+    return false;
+  }
+  *value = arg + length + 1;
+  return true;
+}
+
+// ---------------------------------------------------------------- ring
+
+// Frame n carries n split into two exactly representable halves.
+void writeSequence(float* dst, int64_t first, int frames) {
+  for (int i = 0; i < frames; ++i) {
+    const int64_t n = first + i;
+    dst[i * kChannels] = static_cast<float>(n & 0xFFFF);
+    dst[i * kChannels + 1] = static_cast<float>((n >> 16) & 0xFFFF);
+  }
+}
+
+bool checkSequence(const float* src, int64_t first, int frames) {
+  for (int i = 0; i < frames; ++i) {
+    const int64_t n = first + i;
+    if (src[i * kChannels] != static_cast<float>(n & 0xFFFF) ||
+        src[i * kChannels + 1] != static_cast<float>((n >> 16) & 0xFFFF)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+struct RingResult {
+  int64_t frames = 0;
+  int64_t fullStalls = 0;
+  int64_t emptyStalls = 0;
+  int64_t observerPolls = 0;
+  double seconds = 0.0;
+  bool intact = true;
+};
+
+RingResult runRing(double seconds, int observers, uint32_t seed) {
+  constexpr int32_t kCapacityFrames = 8192;
+  constexpr int32_t kMaxChunkFrames = 2048;
+  DecodeRing ring;
+  ring.configure(kCapacityFrames, kChannels);
+
+  std::atomic<bool> running{true};
+  RingResult result;
+
+  std::thread producer([&] {
+    std::minstd_rand rng(seed);
+    std::uniform_int_distribution<int> chunkDist(1, kMaxChunkFrames);
+    std::vector<float> chunk(static_cast<size_t>(kMaxChunkFrames) * kChannels);
+    int64_t next = 0;
+    int64_t stalls = 0;
+    while (running.load(std::memory_order_relaxed)) {
+      const int frames = chunkDist(rng);
+      writeSequence(chunk.data(), next, frames);
+      int offset = 0;
+      while (offset < frames && running.load(std::memory_order_relaxed)) {
+        const int pushed =
+            ring.tryPush(chunk.data() + offset * kChannels, frames - offset);
+        if (pushed == 0) {
+          ++stalls;
+          std::this_thread::yield();
+        }
+        offset += pushed;
+      }
+      next += offset;
+    }
+    result.fullStalls = stalls;
+  });
+
+  std::vector<std::thread> observerThreads;
+  std::vector<int64_t> polls(observers, 0);
+  for (int i = 0; i < observers; ++i) {
+    observerThreads.emplace_back([&, i] {
+      int64_t count = 0;
+      size_t sink = 0;
+      while (running.load(std::memory_order_relaxed)) {
+        sink += ring.availableFrames() + ring.freeFrames();
+        sink += static_cast<size_t>(ring.totalWritten());
+        ++count;
+      }
+      polls[i] = count + static_cast<int64_t>(sink & 1);
+    });
+  }
+
+  // Consumer on this thread.
+  std::minstd_rand rng(seed * 7919u + 1u);
+  std::uniform_int_distribution<int> chunkDist(1, kMaxChunkFrames);
+  std::vector<float> chunk(static_cast<size_t>(kMaxChunkFrames) * kChannels);
+  int64_t consumed = 0;
+  const Clock::time_point begin = Clock::now();
+  const Clock::time_point deadline =
+      begin + std::chrono::duration_cast<Clock::duration>(
+                  std::chrono::duration<double>(seconds));
+  while (Clock::now() < deadline) {
+    const int popped = ring.pop(chunk.data(), chunkDist(rng));
+    if (popped == 0) {
+      ++result.emptyStalls;
+      std::this_thread::yield();
+      continue;
+    }
+    if (result.intact && !checkSequence(chunk.data(), consumed, popped)) {
+      std::fprintf(stderr, "ring: sequence broken after frame %lld\n",
+                   static_cast<long long>(consumed));
+      result.intact = false;
+    }
+    consumed += popped;
+  }
+  result.seconds =
+      std::chrono::duration<double>(Clock::now() - begin).count();
+  running.store(false);
+  producer.join();
+  for (std::thread& thread : observerThreads) thread.join();
+  for (int64_t count : polls) result.observerPolls += count;
+  result.frames = consumed;
+  return result;
+}
+
+// Pushes values in and beyond [-1, 1] through a compact ring in uneven
+// chunks that cross the wrap, and returns the largest error against what
+// the format promises: exact clipping to full scale and half a step for
+// int16, a relative 2^-11 (absolute 2^-25 among subnormals) for half
+// floats. Negative when a value came back out of bounds.
+double ringFormatError(RingSampleFormat format, uint32_t seed) {
+  constexpr int32_t kCapacityFrames = 1000;
+  constexpr int kChunkFrames = 333;
+  constexpr int kChunks = 24;
+  DecodeRing ring;
+  ring.configure(kCapacityFrames, kChannels, format);
+  std::minstd_rand rng(seed);
+  std::uniform_real_distribution<float> wide(-2.0f, 2.0f);
+  std::uniform_real_distribution<float> exponent(-30.0f, 0.0f);
+  std::vector<float> in(static_cast<size_t>(kChunkFrames) * kChannels);
+  std::vector<float> out(in.size());
+  double worst = 0.0;
+  for (int chunk = 0; chunk < kChunks; ++chunk) {
+    for (size_t i = 0; i < in.size(); ++i) {
+      // Alternate full-range values with tiny ones down to 2^-30.
+      in[i] = i % 2 ? wide(rng) : std::copysign(std::exp2(exponent(rng)),
+                                                wide(rng));
+    }
+    if (ring.tryPush(in.data(), kChunkFrames) != kChunkFrames ||
+        ring.pop(out.data(), kChunkFrames) != kChunkFrames) {
+      return -1.0;
+    }
+    for (size_t i = 0; i < in.size(); ++i) {
+      double error;
+      if (format == RingSampleFormat::kInt16) {
+        const float clipped = std::clamp(in[i], -1.0f, 1.0f);
+        error = std::fabs(out[i] - clipped) / (0.5 / 32767.0);
+      } else {
+        error = std::fabs(out[i] - in[i]) /
+                std::max(std::fabs(in[i]) * std::exp2(-11.0), std::exp2(-25.0));
+      }
+      worst = std::max(worst, error);
+    }
+  }
+  return worst;
+}
+
+bool ringScenario(const Options& options) {
+  bool ok = true;
+  const int observerCounts[] = {0, std::max(1, options.threads - 2)};
+  for (int observers : observerCounts) {
+    const RingResult r =
+        runRing(options.seconds / 2.0, observers, options.seed);
+    const double framesPerSecond = r.frames / std::max(1e-9, r.seconds);
+    std::printf(
+        "%-4s ring observers=%d  %.1f Mframes/s  %.1f MB/s  %.0fx realtime  "
+        "full_stalls=%lld empty_stalls=%lld polls=%lld\n",
+        r.intact ? "ok" : "FAIL", observers, framesPerSecond / 1e6,
+        framesPerSecond * kChannels * sizeof(float) / 1e6,
+        framesPerSecond / kSampleRate, static_cast<long long>(r.fullStalls),
+        static_cast<long long>(r.emptyStalls),
+        static_cast<long long>(r.observerPolls));
+    ok = ok && r.intact && r.frames > 0;
+  }
+  const struct {
+    RingSampleFormat format;
+    const char* name;
+  } formats[] = {{RingSampleFormat::kInt16, "int16"},
+                 {RingSampleFormat::kFloat16, "float16"}};
+  for (const auto& entry : formats) {
+    // Relative to the bound; anything up to 1 is within it, allowing for
+    // float rounding in the check itself.
+    const double error = ringFormatError(entry.format, options.seed);
+    const bool within = error >= 0.0 && error <= 1.0 + 1e-3;
+    std::printf("%-4s ring format=%s  error=%.3f of bound\n",
+                within ? "ok" : "FAIL", entry.name, error);
+    ok = ok && within;
+  }
+  return ok;
+}
+
+// ----------------------------------------------------------- telemetry
+
+double telemetryPositionMs(int64_t frames) {
+  return static_cast<double>(frames) * 1000.0 / kSampleRate;
+}
+
+bool telemetryScenario(const Options& options) {
+  constexpr int32_t kBurstFrames = EngineTelemetry::kPublishFrames;
+  EngineTelemetry telemetry;
+  telemetry.reset();
+  const TelemetryBlock& block = *telemetry.block();
+  const test_signals::Signal signal =
+      test_signals::transients(kSampleRate, kChannels, 1.0);
+  const int64_t signalFrames =
+      static_cast<int64_t>(signal.samples.size()) / kChannels;
+
+  std::atomic<bool> running{true};
+  std::atomic<int64_t> reads{0};
+  std::atomic<int64_t> retries{0};
+  std::atomic<int64_t> torn{0};
+  std::vector<std::thread> readers;
+  for (int i = 0; i < std::max(1, options.threads - 1); ++i) {
+    readers.emplace_back([&] {
+      TelemetrySnapshot snapshot;
+      int64_t count = 0;
+      int64_t failed = 0;
+      int64_t broken = 0;
+      while (running.load(std::memory_order_relaxed)) {
+        if (!EngineTelemetry::read(block, &snapshot)) {
+          ++failed;
+          continue;
+        }
+        const double expected = telemetryPositionMs(snapshot.frames);
+        if (snapshot.positionMs != expected ||
+            snapshot.durationMs != 2.0 * expected ||
+            (snapshot.frames > 0 && snapshot.channels != kChannels)) {
+          ++broken;
+        }
+        ++count;
+      }
+      reads += count;
+      retries += failed;
+      torn += broken;
+    });
+  }
+
+  // The audio thread, unpaced.
+  int64_t frames = 0;
+  const Clock::time_point deadline =
+      Clock::now() + std::chrono::duration_cast<Clock::duration>(
+                         std::chrono::duration<double>(options.seconds / 2.0));
+  while (Clock::now() < deadline) {
+    const int64_t offset = frames % (signalFrames - kBurstFrames);
+    frames += kBurstFrames;
+    const double positionMs = telemetryPositionMs(frames);
+    telemetry.update(&signal.samples[static_cast<size_t>(offset) * kChannels],
+                     kBurstFrames, kChannels, kSampleRate, 0.01f, positionMs,
+                     2.0 * positionMs);
+  }
+  running.store(false);
+  for (std::thread& reader : readers) reader.join();
+
+  const bool ok = torn.load() == 0 && reads.load() > 0;
+  std::printf("%-4s telemetry publishes=%lld reads=%lld failed_reads=%lld "
+              "torn=%lld\n",
+              ok ? "ok" : "FAIL",
+              static_cast<long long>(frames / kBurstFrames),
+              static_cast<long long>(reads.load()),
+              static_cast<long long>(retries.load()),
+              static_cast<long long>(torn.load()));
+  return ok;
+}
+
+// -------------------------------------------------------------- engine
+
+enum Op {
+  kCreate,
+  kDispose,
+  kStart,
+  kStop,
+  kSeek,
+  kSetters,
+  kGetters,
+  kStats,
+  kStaleHandle,
+  kQueue,
+  kAsync,
+  kOpCount,
+};
+
+const char* const kOpNames[kOpCount] = {
+    "create", "dispose", "start", "stop",  "seek",  "set",
+    "get",    "stats",   "stale", "queue", "async",
+};
+
+// Relative frequency of each operation.
+const int kOpWeights[kOpCount] = {2, 2, 4, 3, 6, 10, 8, 4, 2, 4, 4};
+
+// Lifecycle event codes from native_audio.cpp.
+constexpr int32_t kEventStarted = 1;
+constexpr int32_t kEventEnded = 4;
+
+struct EngineCounters {
+  std::atomic<int64_t> ops[kOpCount] = {};
+  std::atomic<int64_t> startFailures{0};
+  std::atomic<int64_t> badValues{0};
+};
+
+// The event callback has no context pointer, so its tallies are global.
+std::atomic<int64_t> gAsyncPosted{0};
+std::atomic<int64_t> gAsyncCompleted{0};
+std::atomic<int64_t> gAsyncStartFailures{0};
+std::atomic<int64_t> gEndedEvents{0};
+
+void onEngineEvent(intptr_t, int32_t event, int32_t code) {
+  if (event == kEventEnded) {
+    gEndedEvents += 1;
+    return;
+  }
+  if (event == kEventStarted && code != 0 && code != -1) {
+    gAsyncStartFailures += 1;
+  }
+  gAsyncCompleted += 1;
+}
+
+void engineWorker(int index,
+                  const Options& options,
+                  const std::string& input,
+                  Clock::time_point deadline,
+                  std::atomic<intptr_t>* slots,
+                  std::atomic<intptr_t>* lastDisposed,
+                  EngineCounters* counters) {
+  std::minstd_rand rng(options.seed * 104729u + static_cast<uint32_t>(index));
+  std::discrete_distribution<int> opDist(std::begin(kOpWeights),
+                                         std::end(kOpWeights));
+  std::uniform_int_distribution<int> slotDist(0, kEngineSlots - 1);
+  std::uniform_real_distribution<double> unit(0.0, 1.0);
+  std::uniform_int_distribution<int> gapUs(0, 2000);
+  SlowReverbEngineStats stats;
+
+  while (Clock::now() < deadline) {
+    const int op = opDist(rng);
+    std::atomic<intptr_t>& slot = slots[slotDist(rng)];
+    const intptr_t handle = slot.load();
+    switch (op) {
+      case kCreate: {
+        if (handle != 0) break;
+        const intptr_t created =
+            slowreverb_engine_create_with_sink(kOfflineSinkType);
+        intptr_t expected = 0;
+        if (!slot.compare_exchange_strong(expected, created)) {
+          slowreverb_engine_dispose(created);
+        }
+        break;
+      }
+      case kDispose: {
+        const intptr_t taken = slot.exchange(0);
+        if (taken != 0) {
+          slowreverb_engine_dispose(taken);
+          lastDisposed->store(taken);
+        }
+        break;
+      }
+      case kStart: {
+        const int result = slowreverb_engine_start(handle, input.c_str());
+        // -1 is a handle disposed since it was read; anything else failing
+        // means a lifecycle race broke the engine.
+        if (result != 0 && result != -1) counters->startFailures += 1;
+        break;
+      }
+      case kStop:
+        slowreverb_engine_stop(handle);
+        break;
+      case kSeek:
+        slowreverb_engine_seek(handle, unit(rng) * kInputSeconds * 1000.0);
+        break;
+      case kSetters:
+        slowreverb_engine_set_tempo(handle, 0.5 + unit(rng));
+        slowreverb_engine_set_pitch(handle, -6.0 + 12.0 * unit(rng));
+        slowreverb_engine_set_mix(handle, unit(rng));
+        slowreverb_engine_set_reverb(handle, 0.5 + 8.0 * unit(rng), unit(rng),
+                                     unit(rng), 300.0 * unit(rng));
+        slowreverb_engine_set_width(handle, unit(rng));
+        slowreverb_engine_set_memory_budget(
+            handle,
+            unit(rng) < 0.5 ? 0 : static_cast<int64_t>(4e6 * unit(rng)));
+        slowreverb_engine_set_ring_format(handle,
+                                          static_cast<int32_t>(3 * unit(rng)));
+        slowreverb_engine_set_compare(handle, unit(rng) < 0.7,
+                                      unit(rng) < 0.5);
+        slowreverb_engine_set_monitor(handle, unit(rng) < 0.5,
+                                      50.0 * unit(rng));
+        // The input doubles as an impulse response; loading it is slow, so
+        // only now and then.
+        if (unit(rng) < 0.1) {
+          slowreverb_engine_set_impulse_response(
+              handle, unit(rng) < 0.5 ? input.c_str() : "");
+        }
+        break;
+      case kGetters: {
+        const double position = slowreverb_engine_get_position_ms(handle);
+        const double duration = slowreverb_engine_get_duration_ms(handle);
+        if (!std::isfinite(position) || position < 0.0 ||
+            !std::isfinite(duration) || duration < 0.0) {
+          counters->badValues += 1;
+        }
+        break;
+      }
+      case kStats: {
+        slowreverb_engine_get_stats(handle, &stats);
+        if (unit(rng) < 0.1) slowreverb_engine_reset_stats(handle);
+        SlowReverbEngineMemory memory;
+        if (slowreverb_engine_get_memory(handle, &memory) == 0 &&
+            (memory.ring_bytes < 0 || memory.chain_bytes < 0 ||
+             memory.total_bytes != memory.ring_bytes + memory.chain_bytes ||
+             memory.ring_format < 0 || memory.ring_format > 2)) {
+          counters->badValues += 1;
+        }
+        break;
+      }
+      case kStaleHandle: {
+        const intptr_t stale = lastDisposed->load();
+        if (stale != 0 &&
+            slowreverb_engine_start(stale, input.c_str()) != -1) {
+          // Disposed handles are never reused, so this must miss.
+          counters->badValues += 1;
+        }
+        slowreverb_engine_set_tempo(stale, 1.0);
+        break;
+      }
+      case kQueue:
+        // Short tracks, so transitions happen while the other workers seek
+        // and restart the same engine.
+        if (unit(rng) < 0.2) {
+          slowreverb_engine_clear_queue(handle);
+        } else if (unit(rng) < 0.1) {
+          if (slowreverb_engine_enqueue(handle, nullptr) != -1) {
+            counters->badValues += 1;
+          }
+        } else {
+          slowreverb_engine_enqueue(handle, input.c_str());
+        }
+        slowreverb_engine_set_crossfade_ms(handle, unit(rng) < 0.5
+                                                       ? 0.0
+                                                       : 1500.0 * unit(rng));
+        if (slowreverb_engine_get_track_index(handle) < -1) {
+          counters->badValues += 1;
+        }
+        break;
+      case kAsync: {
+        const double pick = unit(rng);
+        gAsyncPosted += 1;
+        if (pick < 0.5) {
+          slowreverb_engine_start_async(handle, input.c_str());
+        } else if (pick < 0.85) {
+          slowreverb_engine_stop_async(handle);
+        } else {
+          // Not recorded as lastDisposed: the handle stays valid until the
+          // job runs.
+          slowreverb_engine_dispose_async(slot.exchange(0));
+        }
+        break;
+      }
+      default:
+        break;
+    }
+    counters->ops[op] += 1;
+    std::this_thread::sleep_for(std::chrono::microseconds(gapUs(rng)));
+  }
+}
+
+bool engineScenario(const Options& options) {
+  const std::string input =
+      (std::filesystem::temp_directory_path() / "slowreverb_stress_input.wav")
+          .string();
+  const test_signals::Signal signal =
+      test_signals::transients(kSampleRate, kChannels, kInputSeconds);
+  if (!test_signals::writeWav16(input, signal.samples, kSampleRate,
+                                kChannels)) {
+    std::fprintf(stderr, "could not write %s\n", input.c_str());
+    return false;
+  }
+
+  std::atomic<intptr_t> slots[kEngineSlots] = {};
+  std::atomic<intptr_t> lastDisposed{0};
+  EngineCounters counters;
+  slowreverb_set_event_callback(&onEngineEvent);
+  // Decoder threads place themselves as they start, concurrently with the
+  // stats reads; pinning is a no-op where all cores are alike.
+  slowreverb_set_pin_to_performance_cores(1);
+  const Clock::time_point deadline =
+      Clock::now() + std::chrono::duration_cast<Clock::duration>(
+                         std::chrono::duration<double>(options.seconds));
+  std::vector<std::thread> workers;
+  for (int i = 0; i < options.threads; ++i) {
+    workers.emplace_back(engineWorker, i, std::cref(options), std::cref(input),
+                         deadline, slots, &lastDisposed, &counters);
+  }
+  for (std::thread& worker : workers) worker.join();
+  for (std::atomic<intptr_t>& slot : slots) {
+    slowreverb_engine_dispose_async(slot.exchange(0));
+    gAsyncPosted += 1;
+  }
+  // Every queued job reports exactly once.
+  const Clock::time_point drainDeadline =
+      Clock::now() + std::chrono::seconds(30);
+  while (gAsyncCompleted < gAsyncPosted && Clock::now() < drainDeadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  slowreverb_set_event_callback(nullptr);
+  slowreverb_set_pin_to_performance_cores(0);
+  std::filesystem::remove(input);
+
+  const bool ok = counters.startFailures == 0 && counters.badValues == 0 &&
+                  gAsyncStartFailures == 0 &&
+                  gAsyncCompleted == gAsyncPosted;
+  std::printf("%-4s engine threads=%d", ok ? "ok" : "FAIL", options.threads);
+  for (int op = 0; op < kOpCount; ++op) {
+    std::printf(" %s=%lld", kOpNames[op],
+                static_cast<long long>(counters.ops[op].load()));
+  }
+  std::printf(" start_failures=%lld bad_values=%lld",
+              static_cast<long long>(counters.startFailures.load()),
+              static_cast<long long>(counters.badValues.load()));
+  std::printf(" async_done=%lld/%lld async_start_failures=%lld ended=%lld\n",
+              static_cast<long long>(gAsyncCompleted.load()),
+              static_cast<long long>(gAsyncPosted.load()),
+              static_cast<long long>(gAsyncStartFailures.load()),
+              static_cast<long long>(gEndedEvents.load()));
+  return ok;
+}
+
+// ---------------------------------------------------------------- render
+
+constexpr int32_t kRenderChunkFrames = 512;
+
+struct RenderCounters {
+  std::atomic<int64_t> opened{0};
+  std::atomic<int64_t> pulls{0};
+  std::atomic<int64_t> closes{0};
+  std::atomic<int64_t> openFailures{0};
+  std::atomic<int64_t> badValues{0};
+};
+
+// Opens streams one after another and feeds and pulls each until a pull
+// reports the handle closed.
+void renderPuller(int index,
+                  const std::string& input,
+                  const std::vector<float>& pcm,
+                  Clock::time_point deadline,
+                  std::atomic<intptr_t>* slot,
+                  std::atomic<bool>* done,
+                  RenderCounters* counters) {
+  std::vector<float> out(kRenderChunkFrames * kChannels);
+  const int32_t pcmFrames = static_cast<int32_t>(pcm.size() / kChannels);
+  intptr_t previous = 0;
+  bool fromFile = (index & 1) != 0;
+  while (Clock::now() < deadline) {
+    const intptr_t handle =
+        fromFile ? slowreverb_render_open_file(input.c_str(), kSampleRate, 1)
+                 : slowreverb_render_open_pcm(kSampleRate, kChannels,
+                                              kSampleRate);
+    if (handle == 0) {
+      counters->openFailures += 1;
+      break;
+    }
+    counters->opened += 1;
+    if (handle == previous) counters->badValues += 1;
+    slot->store(handle);
+    if (previous != 0 &&
+        (slowreverb_render_pull(previous, out.data(), kRenderChunkFrames) !=
+             -1 ||
+         slowreverb_render_finished(previous) != 1 ||
+         slowreverb_render_get_format(previous, nullptr, nullptr) != -1)) {
+      counters->badValues += 1;
+    }
+    int32_t fed = 0;
+    while (true) {
+      if (!fromFile) {
+        if (fed < pcmFrames) {
+          const int32_t accepted = slowreverb_render_feed(
+              handle, pcm.data() + static_cast<size_t>(fed) * kChannels,
+              std::min(kRenderChunkFrames, pcmFrames - fed));
+          if (accepted == -1) break;
+          if (accepted < 0) counters->badValues += 1;
+          fed += std::max(accepted, 0);
+        } else {
+          slowreverb_render_end_input(handle);
+        }
+      }
+      const int32_t pulled =
+          slowreverb_render_pull(handle, out.data(), kRenderChunkFrames);
+      if (pulled == -1) break;
+      if (pulled < 0 || pulled > kRenderChunkFrames) counters->badValues += 1;
+      counters->pulls += 1;
+      int32_t rate = 0;
+      if (slowreverb_render_get_format(handle, &rate, nullptr) == 0 &&
+          rate != kSampleRate) {
+        counters->badValues += 1;
+      }
+      slowreverb_render_finished(handle);
+    }
+    previous = handle;
+    fromFile = !fromFile;
+  }
+  done->store(true);
+}
+
+// Closes whatever stream its puller has open after a random gap, until the
+// puller has stopped opening them.
+void renderCloser(int index,
+                  const Options& options,
+                  std::atomic<intptr_t>* slot,
+                  const std::atomic<bool>* done,
+                  RenderCounters* counters) {
+  std::minstd_rand rng(options.seed * 7919u + static_cast<uint32_t>(index));
+  std::uniform_int_distribution<int> gapUs(0, 3000);
+  while (!done->load() || slot->load() != 0) {
+    std::this_thread::sleep_for(std::chrono::microseconds(gapUs(rng)));
+    const intptr_t handle = slot->exchange(0);
+    if (handle == 0) continue;
+    // Polled from another thread than the puller, as Dart may.
+    slowreverb_render_finished(handle);
+    slowreverb_render_close(handle);
+    counters->closes += 1;
+  }
+}
+
+bool renderScenario(const Options& options) {
+  const std::string input =
+      (std::filesystem::temp_directory_path() / "slowreverb_stress_render.wav")
+          .string();
+  const test_signals::Signal signal =
+      test_signals::transients(kSampleRate, kChannels, kInputSeconds);
+  if (!test_signals::writeWav16(input, signal.samples, kSampleRate,
+                                kChannels)) {
+    std::fprintf(stderr, "could not write %s\n", input.c_str());
+    return false;
+  }
+
+  const int pairs = std::max(1, options.threads / 2);
+  std::vector<std::atomic<intptr_t>> slots(pairs);
+  std::vector<std::atomic<bool>> done(pairs);
+  for (int i = 0; i < pairs; ++i) {
+    slots[i].store(0);
+    done[i].store(false);
+  }
+  RenderCounters counters;
+  const Clock::time_point deadline =
+      Clock::now() + std::chrono::duration_cast<Clock::duration>(
+                         std::chrono::duration<double>(options.seconds));
+  std::vector<std::thread> threads;
+  for (int i = 0; i < pairs; ++i) {
+    threads.emplace_back(renderPuller, i, std::cref(input),
+                         std::cref(signal.samples), deadline, &slots[i],
+                         &done[i], &counters);
+    threads.emplace_back(renderCloser, i, std::cref(options), &slots[i],
+                         &done[i], &counters);
+  }
+  for (std::thread& thread : threads) thread.join();
+  std::filesystem::remove(input);
+
+  const bool ok = counters.openFailures == 0 && counters.badValues == 0 &&
+                  counters.closes == counters.opened;
+  std::printf("%-4s render pairs=%d opened=%lld closed=%lld pulls=%lld "
+              "open_failures=%lld bad_values=%lld\n",
+              ok ? "ok" : "FAIL", pairs,
+              static_cast<long long>(counters.opened.load()),
+              static_cast<long long>(counters.closes.load()),
+              static_cast<long long>(counters.pulls.load()),
+              static_cast<long long>(counters.openFailures.load()),
+              static_cast<long long>(counters.badValues.load()));
+  return ok;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options options;
+  for (int i = 1; i < argc; ++i) {
+    std::string value;
+    if (takeFlag(argv[i], "--seconds", &value)) {
+      options.seconds = std::max(0.1, std::atof(value.c_str()));
+    } else if (takeFlag(argv[i], "--threads", &value)) {
+      options.threads = std::max(2, std::atoi(value.c_str()));
+    } else if (takeFlag(argv[i], "--seed", &value)) {
+      options.seed = static_cast<uint32_t>(std::strtoul(value.c_str(),
+                                                        nullptr, 10));
+    } else if (takeFlag(argv[i], "--only", &options.only)) {
+      continue;
+    } else {
+      std::fprintf(stderr, "Unknown argument: %s\n", argv[i]);
+      return 1;
+    }
+  }
+
+  bool ok = true;
+  if (options.only.empty() || options.only == "ring") {
+    ok = ringScenario(options) && ok;
+  }
+  if (options.only.empty() || options.only == "telemetry") {
+    ok = telemetryScenario(options) && ok;
+  }
+  if (options.only.empty() || options.only == "engine") {
+    ok = engineScenario(options) && ok;
+  }
+  if (options.only.empty() || options.only == "render") {
+    ok = renderScenario(options) && ok;
+  }
+  return ok ? 0 : 1;
+}
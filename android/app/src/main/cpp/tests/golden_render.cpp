@@ -0,0 +1,313 @@
+// Golden-render harness: renders the synthetic corpus through the offline
+// ProcessingChain at a matrix of presets and compares each result with the
+// reference WAV in tests/golden.
+//
+//   slowreverb_golden [--golden_dir=DIR] [--update] [--filter=TEXT]
+//                     [--report=FILE.json] [--dump_dir=DIR]
+//
+// --update rewrites the references; do this only when an output change is
+// intended, and say so in the commit. Each case also reports its realtime
+// factor so speedups can be checked in the same run.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <complex>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "processing_chain.h"
+#include "test_signals.h"
+
+namespace {
+
+constexpr int32_t kSampleRate = 16000;
+constexpr int32_t kChannels = 2;
+constexpr int32_t kChunkFrames = 4096;
+// Silence appended to every input so the reverb tail is part of the output.
+constexpr double kTailSeconds = 0.5;
+
+// References are 16-bit, so anything under ~1e-4 is quantisation noise.
+constexpr double kMaxAbsErrorTolerance = 2e-3;
+constexpr double kSpectralDistanceToleranceDb = 1.0;
+
+struct Preset {
+  const char* name;
+  ChainParameters params;
+};
+
+std::vector<Preset> presets() {
+  std::vector<Preset> out;
+  auto add = [&out](const char* name, float tempo, float pitch, float wet,
+                    float decay, float tone, float room, float echoMs) {
+    Preset preset{name, {}};
+    preset.params.tempo = tempo;
+    preset.params.pitchSemi = pitch;
+    preset.params.wet = wet;
+    preset.params.decay = decay;
+    preset.params.tone = tone;
+    preset.params.room = room;
+    preset.params.echoMs = echoMs;
+    out.push_back(preset);
+  };
+  add("dry", 1.0f, 0.0f, 0.0f, 6.0f, 0.6f, 0.8f, 0.0f);
+  add("chill", 0.85f, -1.5f, 0.40f, 6.0f, 0.6f, 0.80f, 0.0f);
+  add("dreamy", 0.80f, -2.0f, 0.55f, 9.0f, 0.55f, 0.95f, 40.0f);
+  add("sped_up", 1.25f, 2.0f, 0.35f, 5.0f, 0.65f, 0.70f, 0.0f);
+  // Below SoundTouch's range, so only through the phase vocoder.
+  add("vocoder", 0.4f, -3.0f, 0.35f, 6.0f, 0.6f, 0.80f, 0.0f);
+  out.back().params.stretch = StretchMode::kPhaseVocoder;
+  return out;
+}
+
+std::vector<float> render(const test_signals::Signal& signal,
+                          const ChainParameters& params) {
+  ProcessingChain chain;
+  chain.configure(signal.sampleRate, signal.sampleRate, signal.channels,
+                  params);
+  std::vector<float> input = signal.samples;
+  input.resize(input.size() +
+                   static_cast<size_t>(kTailSeconds * signal.sampleRate) *
+                       signal.channels,
+               0.0f);
+  const int32_t totalFrames =
+      static_cast<int32_t>(input.size() / signal.channels);
+  std::vector<float> output;
+  std::vector<float> chunk(static_cast<size_t>(kChunkFrames) *
+                           signal.channels);
+  auto drain = [&]() {
+    while (true) {
+      const int32_t got = chain.receiveSamples(chunk.data(), kChunkFrames);
+      if (got <= 0) break;
+      output.insert(output.end(), chunk.begin(),
+                    chunk.begin() + static_cast<size_t>(got) * signal.channels);
+    }
+  };
+  for (int32_t offset = 0; offset < totalFrames; offset += kChunkFrames) {
+    const int32_t frames = std::min(kChunkFrames, totalFrames - offset);
+    chain.putSamples(input.data() + static_cast<size_t>(offset) *
+                                        signal.channels,
+                     frames);
+    drain();
+  }
+  chain.flush();
+  drain();
+  return output;
+}
+
+// In-place iterative radix-2 FFT; size must be a power of two.
+void fft(std::vector<std::complex<double>>* data) {
+  const size_t n = data->size();
+  auto& a = *data;
+  for (size_t i = 1, j = 0; i < n; ++i) {
+    size_t bit = n >> 1;
+    for (; j & bit; bit >>= 1) j ^= bit;
+    j ^= bit;
+    if (i < j) std::swap(a[i], a[j]);
+  }
+  for (size_t len = 2; len <= n; len <<= 1) {
+    const double angle = -2.0 * 3.14159265358979323846 / len;
+    const std::complex<double> step(std::cos(angle), std::sin(angle));
+    for (size_t i = 0; i < n; i += len) {
+      std::complex<double> w(1.0, 0.0);
+      for (size_t k = 0; k < len / 2; ++k) {
+        const std::complex<double> u = a[i + k];
+        const std::complex<double> v = a[i + k + len / 2] * w;
+        a[i + k] = u + v;
+        a[i + k + len / 2] = u - v;
+        w *= step;
+      }
+    }
+  }
+}
+
+// Mean log-spectral distance in dB over Hann-windowed frames of the
+// channel-summed signals. Power is floored at -80 dB so near-silent frames
+// do not dominate.
+double spectralDistanceDb(const std::vector<float>& a,
+                          const std::vector<float>& b,
+                          int32_t channels) {
+  constexpr size_t kFrame = 1024;
+  constexpr size_t kHop = 512;
+  constexpr double kFloor = 1e-8;
+  const size_t frames = std::min(a.size(), b.size()) / channels;
+  if (frames < kFrame) return 0.0;
+  std::vector<double> window(kFrame);
+  for (size_t i = 0; i < kFrame; ++i) {
+    window[i] = 0.5 - 0.5 * std::cos(2.0 * 3.14159265358979323846 * i /
+                                     (kFrame - 1));
+  }
+  std::vector<std::complex<double>> fa(kFrame);
+  std::vector<std::complex<double>> fb(kFrame);
+  double total = 0.0;
+  int count = 0;
+  for (size_t start = 0; start + kFrame <= frames; start += kHop) {
+    for (size_t i = 0; i < kFrame; ++i) {
+      double sa = 0.0;
+      double sb = 0.0;
+      for (int32_t ch = 0; ch < channels; ++ch) {
+        sa += a[(start + i) * channels + ch];
+        sb += b[(start + i) * channels + ch];
+      }
+      fa[i] = sa * window[i];
+      fb[i] = sb * window[i];
+    }
+    fft(&fa);
+    fft(&fb);
+    double sum = 0.0;
+    for (size_t k = 0; k <= kFrame / 2; ++k) {
+      const double pa = std::max(std::norm(fa[k]) / kFrame, kFloor);
+      const double pb = std::max(std::norm(fb[k]) / kFrame, kFloor);
+      const double diff = 10.0 * std::log10(pa / pb);
+      sum += diff * diff;
+    }
+    total += std::sqrt(sum / (kFrame / 2 + 1));
+    ++count;
+  }
+  return count > 0 ? total / count : 0.0;
+}
+
+struct CaseResult {
+  std::string name;
+  bool passed = false;
+  std::string failure;
+  double maxAbsError = 0.0;
+  double spectralDistanceDb = 0.0;
+  double realtimeFactor = 0.0;
+};
+
+bool takeFlag(const char* arg, const char* name, std::string* value) {
+  const size_t length = std::strlen(name);
+  if (std::strncmp(arg, name, length) != 0 || arg[length] != '=') {
+    return false;
+  }
+  *value = arg + length + 1;
+  return true;
+}
+
+bool writeReport(const std::string& path,
+                 const std::vector<CaseResult>& results) {
+  FILE* file = std::fopen(path.c_str(), "w");
+  if (!file) return false;
+  std::fprintf(file, "{\n  \"cases\": [\n");
+  for (size_t i = 0; i < results.size(); ++i) {
+    const CaseResult& r = results[i];
+    std::fprintf(file,
+                 "    {\"name\": \"%s\", \"passed\": %s, "
+                 "\"max_abs_error\": %.8f, \"spectral_distance_db\": %.6f, "
+                 "\"realtime_factor\": %.3f}%s\n",
+                 r.name.c_str(), r.passed ? "true" : "false", r.maxAbsError,
+                 r.spectralDistanceDb, r.realtimeFactor,
+                 i + 1 < results.size() ? "," : "");
+  }
+  std::fprintf(file, "  ]\n}\n");
+  return std::fclose(file) == 0;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::string goldenDir = SLOWREVERB_GOLDEN_DIR;
+  std::string filter;
+  std::string reportPath;
+  std::string dumpDir;
+  bool update = false;
+  for (int i = 1; i < argc; ++i) {
+    if (takeFlag(argv[i], "--golden_dir", &goldenDir) ||
+        takeFlag(argv[i], "--filter", &filter) ||
+        takeFlag(argv[i], "--report", &reportPath) ||
+        takeFlag(argv[i], "--dump_dir", &dumpDir)) {
+      continue;
+    }
+    if (std::strcmp(argv[i], "--update") == 0) {
+      update = true;
+      continue;
+    }
+    std::fprintf(stderr, "Unknown argument: %s\n", argv[i]);
+    return 1;
+  }
+
+  std::vector<CaseResult> results;
+  int failures = 0;
+  for (const test_signals::Signal& signal :
+       test_signals::corpus(kSampleRate, kChannels)) {
+    for (const Preset& preset : presets()) {
+      CaseResult result;
+      result.name = signal.name + "__" + preset.name;
+      if (!filter.empty() && result.name.find(filter) == std::string::npos) {
+        continue;
+      }
+      const auto begin = std::chrono::steady_clock::now();
+      const std::vector<float> output = render(signal, preset.params);
+      const double seconds = std::chrono::duration<double>(
+                                 std::chrono::steady_clock::now() - begin)
+                                 .count();
+      const double audioSeconds =
+          static_cast<double>(output.size() / kChannels) / kSampleRate;
+      result.realtimeFactor = seconds > 0.0 ? audioSeconds / seconds : 0.0;
+
+      const std::string referencePath =
+          goldenDir + "/" + result.name + ".wav";
+      if (!dumpDir.empty()) {
+        test_signals::writeWav16(dumpDir + "/" + result.name + ".wav", output,
+                                 kSampleRate, kChannels);
+      }
+      if (update) {
+        result.passed = test_signals::writeWav16(referencePath, output,
+                                                 kSampleRate, kChannels);
+        if (!result.passed) result.failure = "could not write reference";
+      } else {
+        std::vector<float> reference;
+        int32_t rate = 0;
+        int32_t channels = 0;
+        if (!test_signals::readWav(referencePath, &reference, &rate,
+                                   &channels)) {
+          result.failure = "missing reference";
+        } else if (rate != kSampleRate || channels != kChannels) {
+          result.failure = "reference format mismatch";
+        } else if (reference.size() != output.size()) {
+          result.failure = "length " +
+                           std::to_string(output.size() / kChannels) +
+                           " != reference " +
+                           std::to_string(reference.size() / kChannels);
+        } else {
+          for (size_t i = 0; i < output.size(); ++i) {
+            const double clamped = std::clamp(output[i], -1.0f, 1.0f);
+            result.maxAbsError = std::max(
+                result.maxAbsError, std::fabs(clamped - reference[i]));
+          }
+          result.spectralDistanceDb =
+              spectralDistanceDb(output, reference, kChannels);
+          if (result.maxAbsError > kMaxAbsErrorTolerance) {
+            result.failure = "max error above tolerance";
+          } else if (result.spectralDistanceDb >
+                     kSpectralDistanceToleranceDb) {
+            result.failure = "spectral distance above tolerance";
+          } else {
+            result.passed = true;
+          }
+        }
+      }
+      failures += result.passed ? 0 : 1;
+      std::printf("%-4s %-28s max_err=%.6f lsd=%.3fdB rtf=%.1fx %s\n",
+                  result.passed ? "ok" : "FAIL", result.name.c_str(),
+                  result.maxAbsError, result.spectralDistanceDb,
+                  result.realtimeFactor, result.failure.c_str());
+      results.push_back(result);
+    }
+  }
+
+  if (!reportPath.empty() && !writeReport(reportPath, results)) {
+    std::fprintf(stderr, "Could not write report %s\n", reportPath.c_str());
+    return 1;
+  }
+  if (failures > 0) {
+    std::printf("%d of %zu golden cases failed\n", failures, results.size());
+    return 1;
+  }
+  std::printf("%zu golden cases %s\n", results.size(),
+              update ? "updated" : "passed");
+  return 0;
+}
@@ -0,0 +1,242 @@
+// Runs AudioEngine's render callback on the offline sink with the realtime
+// checker armed for the duration of every callback. Any allocation, free or
+// mutex lock inside the callback prints a stack trace and fails the test.
+//
+// Scenarios:
+//   steady      paced playback with fixed parameters
+//   automation  paced playback while the UI thread moves every parameter
+//   convolution automation with a convolution reverb, swapped in and out
+//   vocoder     automation and A/B compare on the phase vocoder, below 0.5x
+//   quality     automation while cycling through every quality tier
+//   recovery    automation and A/B compare across a device loss that
+//               changes the rate
+//   starved     unpaced playback that outruns the decoder (underflow path)
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "audio_engine.h"
+#include "offline_sink.h"
+#include "rt_checker.h"
+#include "test_signals.h"
+
+namespace {
+
+constexpr int32_t kSampleRate = 48000;
+constexpr int32_t kChannels = 2;
+
+// Forwards to an OfflineSink, arming the checker around each callback.
+class CheckedSink : public AudioSink, public AudioSinkCallback {
+ public:
+  explicit CheckedSink(const OfflineSinkOptions& options) : inner_(options) {}
+
+  bool open(const AudioSinkConfig& config,
+            AudioSinkCallback* callback) override {
+    target_ = callback;
+    if (!inner_.open(config, this)) return false;
+    sampleRate_ = inner_.sampleRate();
+    channelCount_ = inner_.channelCount();
+    framesPerBurst_ = inner_.framesPerBurst();
+    maxCallbackFrames_ = inner_.maxCallbackFrames();
+    return true;
+  }
+  bool start() override { return inner_.start(); }
+  void stop() override { inner_.stop(); }
+  void close() override { inner_.close(); }
+  const char* name() const override { return "checked-offline"; }
+  int32_t xrunCount() const override { return inner_.xrunCount(); }
+
+  bool onRender(float* interleaved, int32_t frames) override {
+    rt_checker::ScopedArm armed;
+    return target_->onRender(interleaved, frames);
+  }
+  void onSinkError(const char* message) override {
+    target_->onSinkError(message);
+  }
+
+  OfflineSink& inner() { return inner_; }
+
+ private:
+  OfflineSink inner_;
+  AudioSinkCallback* target_ = nullptr;
+};
+
+struct Scenario {
+  const char* name;
+  bool paced;
+  bool automate;
+  // Arms the A/B dry branch and flips between the branches.
+  bool compare;
+  // Plays through the convolution reverb and switches it off and on again.
+  bool convolution;
+  // Stretches with the phase vocoder over its extended tempo range.
+  bool vocoder;
+  // Pins the chain to each quality tier in turn.
+  bool quality;
+  // Pulls the device part way through; the engine must reopen it at
+  // another rate and carry on from the same position.
+  bool disconnect;
+  double seconds;
+};
+
+constexpr int32_t kReconnectRate = 44100;
+constexpr int kDisconnectStep = 20;
+constexpr auto kRecoveryTimeout = std::chrono::seconds(5);
+
+// Pulls the device and waits for the engine to reopen it. Returns false
+// when it does not, or when playback did not resume where it stopped.
+bool disconnectAndRecover(AudioEngine* engine, CheckedSink* sink,
+                          const char* name) {
+  sink->inner().disconnect(kReconnectRate);
+  const double lostAtMs = engine->currentPositionMs();
+  const auto deadline = std::chrono::steady_clock::now() + kRecoveryTimeout;
+  while (engine->stats().streamRecoveries == 0) {
+    if (std::chrono::steady_clock::now() > deadline) {
+      std::fprintf(stderr, "[%s] stream not recovered\n", name);
+      return false;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  const EngineStats stats = engine->stats();
+  // The position is rescaled to the new rate, which may round it down by
+  // a frame.
+  const double resumedAtMs = engine->currentPositionMs();
+  if (stats.sampleRate != kReconnectRate || resumedAtMs < lostAtMs - 1.0) {
+    std::fprintf(stderr, "[%s] resumed at %d Hz, %.1f ms (lost at %.1f ms)\n",
+                 name, stats.sampleRate, resumedAtMs, lostAtMs);
+    return false;
+  }
+  std::printf("     %-11s recovered in %.2f ms\n", name, stats.recoveryMs);
+  return true;
+}
+
+bool runScenario(const Scenario& scenario,
+                 const std::string& input,
+                 const std::string& impulse) {
+  OfflineSinkOptions options;
+  options.minBurstFrames = 96;
+  options.maxBurstFrames = 480;
+  options.jitterMs = 0.5;
+  options.paced = scenario.paced;
+  options.maxFrames =
+      static_cast<int64_t>(scenario.seconds * kSampleRate);
+  auto sink = std::make_unique<CheckedSink>(options);
+  CheckedSink* checked = sink.get();
+  AudioEngine engine(std::move(sink));
+  engine.setTempo(0.85);
+  engine.setPitchSemiTones(-1.5);
+  engine.setWet(0.4);
+  engine.setDecay(6.0);
+  engine.setTone(0.6);
+  engine.setRoomSize(0.8);
+  if (scenario.vocoder) engine.setStretchMode(StretchMode::kPhaseVocoder);
+  if (scenario.convolution && !engine.setImpulseResponse(impulse)) {
+    std::fprintf(stderr, "[%s] impulse response not loaded\n", scenario.name);
+    return false;
+  }
+
+  rt_checker::resetCounts();
+  if (!engine.start(input)) {
+    std::fprintf(stderr, "[%s] engine failed to start\n", scenario.name);
+    return false;
+  }
+  bool recovered = !scenario.disconnect;
+  if (scenario.automate) {
+    for (int step = 0; !checked->inner().finished(); ++step) {
+      if (scenario.disconnect && step == kDisconnectStep) {
+        recovered = disconnectAndRecover(&engine, checked, scenario.name);
+        if (!recovered) break;
+      }
+      const double phase = (step % 20) / 20.0;
+      engine.setTempo((scenario.vocoder ? 0.3 : 0.7) + 0.5 * phase);
+      engine.setPitchSemiTones(-4.0 + 6.0 * phase);
+      engine.setWet(0.2 + 0.6 * phase);
+      engine.setDecay(3.0 + 8.0 * phase);
+      engine.setTone(phase);
+      engine.setRoomSize(phase);
+      engine.setEcho(200.0 * phase);
+      engine.setWidth(1.0 - phase);
+      if (scenario.compare) {
+        engine.setCompare(step % 40 < 30, (step / 10) % 2 == 0);
+        engine.setMonitorDry(step % 4 < 2, (step % 3) * 20.0);
+      }
+      if (scenario.convolution && step % 10 == 9) {
+        engine.setImpulseResponse(step % 20 < 10 ? std::string() : impulse);
+      }
+      if (scenario.quality) {
+        engine.setQualityTier(step % (ProcessingChain::kQualityTiers + 1) - 1);
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(40));
+    }
+  }
+  checked->inner().waitUntilFinished();
+  const OfflineSinkStats stats = checked->inner().stats();
+  engine.stop();
+
+  const int violations = rt_checker::violationCount();
+  // Buffers the chains' arenas could not hold would have come from the
+  // heap, on the audio thread if that is where they grew.
+  const EngineMemory memory = engine.memory();
+  const bool ok =
+      violations == 0 && recovered && memory.arenaOverflows == 0;
+  std::printf("%-4s %-11s callbacks=%lld suppressed=%d violations=%d "
+              "arena=%lld/%lld KiB overflows=%lld\n",
+              ok ? "ok" : "FAIL", scenario.name,
+              static_cast<long long>(stats.callbacks),
+              rt_checker::suppressedCount(), violations,
+              static_cast<long long>(memory.arenaPeakBytes / 1024),
+              static_cast<long long>(memory.arenaBytes / 1024),
+              static_cast<long long>(memory.arenaOverflows));
+  return ok;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const char* only = argc > 1 ? argv[1] : nullptr;
+  const std::string input =
+      (std::filesystem::temp_directory_path() / "slowreverb_rt_input.wav")
+          .string();
+  test_signals::Signal signal =
+      test_signals::transients(kSampleRate, kChannels, 4.0);
+  if (!test_signals::writeWav16(input, signal.samples, kSampleRate,
+                                kChannels)) {
+    std::fprintf(stderr, "could not write %s\n", input.c_str());
+    return 1;
+  }
+  const std::string impulse =
+      (std::filesystem::temp_directory_path() / "slowreverb_rt_impulse.wav")
+          .string();
+  // Long enough to reach the last tail stage.
+  test_signals::Signal room =
+      test_signals::transients(kSampleRate, kChannels, 1.5);
+  if (!test_signals::writeWav16(impulse, room.samples, kSampleRate,
+                                kChannels)) {
+    std::fprintf(stderr, "could not write %s\n", impulse.c_str());
+    return 1;
+  }
+
+  const Scenario scenarios[] = {
+      {"steady", true, false, false, false, false, false, false, 1.0},
+      {"automation", true, true, false, false, false, false, false, 2.0},
+      {"compare", true, true, true, false, false, false, false, 3.0},
+      {"convolution", true, true, false, true, false, false, false, 3.0},
+      {"vocoder", true, true, true, false, true, false, false, 3.0},
+      {"quality", true, true, false, false, false, true, false, 3.0},
+      {"recovery", true, true, true, true, false, false, true, 3.0},
+      {"starved", false, false, false, false, false, false, false, 3.0},
+  };
+  bool ok = true;
+  for (const Scenario& scenario : scenarios) {
+    if (only && std::strcmp(only, scenario.name) != 0) continue;
+    ok = runScenario(scenario, input, impulse) && ok;
+  }
+  std::filesystem::remove(input);
+  std::filesystem::remove(impulse);
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,227 @@
+#include "rt_checker.h"
+
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <pthread.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <vector>
+
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+void* __libc_memalign(size_t alignment, size_t size);
+void __libc_free(void* ptr);
+}
+
+namespace rt_checker {
+namespace {
+
+constexpr int kMaxFrames = 48;
+constexpr int kMaxReports = 20;
+
+thread_local bool tArmed = false;
+
+struct Suppression {
+  std::string symbol;
+  std::string reason;
+};
+
+std::atomic<int> gViolations{0};
+std::atomic<int> gSuppressed{0};
+// Only touched while the reporting thread is disarmed.
+std::vector<Suppression>& suppressions() {
+  static std::vector<Suppression> list;
+  return list;
+}
+
+// Returns the demangled function name of one backtrace_symbols() line, or
+// the raw line when it cannot be parsed.
+std::string describeFrame(const char* line) {
+  const char* open = std::strchr(line, '(');
+  const char* plus = open ? std::strchr(open, '+') : nullptr;
+  if (!open || !plus || plus == open + 1) return line;
+  const std::string mangled(open + 1, plus);
+  int status = 0;
+  char* demangled =
+      abi::__cxa_demangle(mangled.c_str(), nullptr, nullptr, &status);
+  std::string name = status == 0 && demangled ? demangled : mangled;
+  std::free(demangled);
+  return name;
+}
+
+void reportUnarmed(const char* what) {
+  void* frames[kMaxFrames];
+  const int depth = backtrace(frames, kMaxFrames);
+  char** symbols = backtrace_symbols(frames, depth);
+  std::vector<std::string> stack;
+  for (int i = 3; i < depth; ++i) {  // Skip the reporter and the hook.
+    stack.push_back(symbols ? describeFrame(symbols[i]) : "?");
+  }
+  std::free(symbols);
+
+  for (const Suppression& s : suppressions()) {
+    for (const std::string& frame : stack) {
+      if (frame.find(s.symbol) != std::string::npos) {
+        gSuppressed.fetch_add(1);
+        return;
+      }
+    }
+  }
+
+  const int count = gViolations.fetch_add(1) + 1;
+  if (count <= kMaxReports) {
+    std::fprintf(stderr, "\nRealtime violation #%d: %s on the audio thread\n",
+                 count, what);
+    for (size_t i = 0; i < stack.size(); ++i) {
+      std::fprintf(stderr, "  #%zu %s\n", i, stack[i].c_str());
+    }
+  } else if (count == kMaxReports + 1) {
+    std::fprintf(stderr, "\n(further violations are counted, not printed)\n");
+  }
+}
+
+// Allocations made while reporting must not recurse into the checker, so
+// the thread stays disarmed until every temporary has been destroyed.
+void report(const char* what) {
+  tArmed = false;
+  reportUnarmed(what);
+  tArmed = true;
+}
+
+inline void check(const char* what) {
+  if (tArmed) report(what);
+}
+
+using MutexFn = int (*)(pthread_mutex_t*);
+
+// The real pthread entry points, resolved on first use. dlsym may allocate,
+// which is fine: nothing is armed that early.
+MutexFn realMutexFn(const char* name, std::atomic<MutexFn>* slot) {
+  MutexFn fn = slot->load(std::memory_order_acquire);
+  if (!fn) {
+    fn = reinterpret_cast<MutexFn>(dlsym(RTLD_NEXT, name));
+    slot->store(fn, std::memory_order_release);
+  }
+  return fn;
+}
+
+std::atomic<MutexFn> gRealLock{nullptr};
+std::atomic<MutexFn> gRealTrylock{nullptr};
+
+}  // namespace
+
+void arm() { tArmed = true; }
+void disarm() { tArmed = false; }
+bool armed() { return tArmed; }
+
+void suppress(const std::string& symbolSubstring, const std::string& reason) {
+  const bool wasArmed = tArmed;
+  tArmed = false;
+  suppressions().push_back({symbolSubstring, reason});
+  tArmed = wasArmed;
+}
+
+int violationCount() { return gViolations.load(); }
+int suppressedCount() { return gSuppressed.load(); }
+
+void resetCounts() {
+  gViolations.store(0);
+  gSuppressed.store(0);
+}
+
+}  // namespace rt_checker
+
+extern "C" {
+
+void* malloc(size_t size) {
+  rt_checker::check("malloc");
+  return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size) {
+  rt_checker::check("calloc");
+  return __libc_calloc(count, size);
+}
+
+void* realloc(void* ptr, size_t size) {
+  rt_checker::check("realloc");
+  return __libc_realloc(ptr, size);
+}
+
+void* aligned_alloc(size_t alignment, size_t size) {
+  rt_checker::check("aligned_alloc");
+  return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void** out, size_t alignment, size_t size) {
+  rt_checker::check("posix_memalign");
+  void* ptr = __libc_memalign(alignment, size);
+  if (!ptr) return ENOMEM;
+  *out = ptr;
+  return 0;
+}
+
+void free(void* ptr) {
+  if (ptr) rt_checker::check("free");
+  __libc_free(ptr);
+}
+
+int pthread_mutex_lock(pthread_mutex_t* mutex) {
+  rt_checker::check("pthread_mutex_lock");
+  return rt_checker::realMutexFn("pthread_mutex_lock",
+                                 &rt_checker::gRealLock)(mutex);
+}
+
+int pthread_mutex_trylock(pthread_mutex_t* mutex) {
+  rt_checker::check("pthread_mutex_trylock");
+  return rt_checker::realMutexFn("pthread_mutex_trylock",
+                                 &rt_checker::gRealTrylock)(mutex);
+}
+
+}  // extern "C"
+
+// The global operator new/delete are replaced too, so allocations are
+// caught even when libstdc++ is linked statically or uses its own pool.
+void* operator new(size_t size) {
+  rt_checker::check("operator new");
+  if (void* ptr = __libc_malloc(size ? size : 1)) return ptr;
+  throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) {
+  rt_checker::check("operator new[]");
+  if (void* ptr = __libc_malloc(size ? size : 1)) return ptr;
+  throw std::bad_alloc();
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+  rt_checker::check("operator new");
+  return __libc_malloc(size ? size : 1);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+  rt_checker::check("operator new[]");
+  return __libc_malloc(size ? size : 1);
+}
+
+void operator delete(void* ptr) noexcept {
+  if (ptr) rt_checker::check("operator delete");
+  __libc_free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+  if (ptr) rt_checker::check("operator delete[]");
+  __libc_free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept { operator delete(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { operator delete[](ptr); }
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <string>
+
+// Detects allocations, frees and mutex locks on a thread while it is armed.
+// Linking rt_checker.cpp into an executable replaces malloc/free, the global
+// operator new/delete and pthread_mutex_lock for the whole process (glibc
+// only); the hooks are inert on threads that are not armed.
+namespace rt_checker {
+
+void arm();
+void disarm();
+bool armed();
+
+// Violations whose stack contains `symbolSubstring` are counted separately
+// and do not fail the run. Use only for known issues tracked elsewhere.
+void suppress(const std::string& symbolSubstring, const std::string& reason);
+
+int violationCount();
+int suppressedCount();
+void resetCounts();
+
+class ScopedArm {
+ public:
+  ScopedArm() { arm(); }
+  ~ScopedArm() { disarm(); }
+  ScopedArm(const ScopedArm&) = delete;
+  ScopedArm& operator=(const ScopedArm&) = delete;
+};
+
+}  // namespace rt_checker
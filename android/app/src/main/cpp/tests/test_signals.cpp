@@ -0,0 +1,155 @@
+#include "test_signals.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+#include "wav_decoder.h"
+
+namespace test_signals {
+namespace {
+constexpr double kPi = 3.14159265358979323846;
+
+Signal blank(const char* name,
+             int32_t sampleRate,
+             int32_t channels,
+             double seconds) {
+  Signal signal;
+  signal.name = name;
+  signal.sampleRate = sampleRate;
+  signal.channels = channels;
+  signal.samples.assign(
+      static_cast<size_t>(std::lround(seconds * sampleRate)) * channels, 0.0f);
+  return signal;
+}
+
+// Writes the same mono value to every channel, with a small per-channel
+// gain offset so stereo paths are not trivially identical.
+void setFrame(Signal* signal, int32_t frame, float value) {
+  for (int32_t ch = 0; ch < signal->channels; ++ch) {
+    signal->samples[static_cast<size_t>(frame) * signal->channels + ch] =
+        value * (1.0f - 0.1f * static_cast<float>(ch));
+  }
+}
+
+uint32_t nextNoise(uint32_t* state) {
+  *state = *state * 1664525u + 1013904223u;
+  return *state;
+}
+
+void writeLe(FILE* file, uint32_t value, int bytes) {
+  for (int i = 0; i < bytes; ++i) {
+    std::fputc(static_cast<int>((value >> (8 * i)) & 0xFF), file);
+  }
+}
+}  // namespace
+
+Signal sweep(int32_t sampleRate, int32_t channels, double seconds) {
+  Signal signal = blank("sweep", sampleRate, channels, seconds);
+  const double f0 = 40.0;
+  const double f1 = sampleRate * 0.45;
+  const double k = std::log(f1 / f0);
+  const int32_t frames = signal.frames();
+  for (int32_t i = 0; i < frames; ++i) {
+    const double t = static_cast<double>(i) / sampleRate;
+    const double phase =
+        2.0 * kPi * f0 * seconds / k * (std::exp(t / seconds * k) - 1.0);
+    setFrame(&signal, i, static_cast<float>(0.5 * std::sin(phase)));
+  }
+  return signal;
+}
+
+Signal impulses(int32_t sampleRate, int32_t channels, double seconds) {
+  Signal signal = blank("impulses", sampleRate, channels, seconds);
+  const int32_t spacing = sampleRate / 4;
+  for (int32_t i = 0; i < signal.frames(); i += spacing) {
+    setFrame(&signal, i, 0.9f);
+  }
+  return signal;
+}
+
+Signal transients(int32_t sampleRate, int32_t channels, double seconds) {
+  Signal signal = blank("transients", sampleRate, channels, seconds);
+  const int32_t spacing = sampleRate / 3;
+  const double decayPerFrame = std::exp(-1.0 / (0.03 * sampleRate));
+  uint32_t noise = 0xC0FFEEu;
+  double envelope = 0.0;
+  for (int32_t i = 0; i < signal.frames(); ++i) {
+    if (i % spacing == 0) envelope = 0.8;
+    const double n =
+        static_cast<double>(nextNoise(&noise) >> 8) / (1u << 23) - 1.0;
+    setFrame(&signal, i, static_cast<float>(envelope * n));
+    envelope *= decayPerFrame;
+  }
+  return signal;
+}
+
+Signal silenceTail(int32_t sampleRate, int32_t channels, double seconds) {
+  Signal signal = blank("silence_tail", sampleRate, channels, seconds);
+  const int32_t toneFrames = std::min(signal.frames(), sampleRate * 3 / 10);
+  for (int32_t i = 0; i < toneFrames; ++i) {
+    const double t = static_cast<double>(i) / sampleRate;
+    setFrame(&signal, i, static_cast<float>(0.6 * std::sin(2.0 * kPi * 440.0 * t)));
+  }
+  return signal;
+}
+
+std::vector<Signal> corpus(int32_t sampleRate, int32_t channels) {
+  return {
+      sweep(sampleRate, channels, 1.0),
+      impulses(sampleRate, channels, 1.0),
+      transients(sampleRate, channels, 1.0),
+      silenceTail(sampleRate, channels, 1.0),
+  };
+}
+
+bool writeWav16(const std::string& path,
+                const std::vector<float>& interleaved,
+                int32_t sampleRate,
+                int32_t channels) {
+  FILE* file = std::fopen(path.c_str(), "wb");
+  if (!file) return false;
+  const uint32_t dataBytes =
+      static_cast<uint32_t>(interleaved.size() * sizeof(int16_t));
+  std::fwrite("RIFF", 1, 4, file);
+  writeLe(file, 36 + dataBytes, 4);
+  std::fwrite("WAVEfmt ", 1, 8, file);
+  writeLe(file, 16, 4);
+  writeLe(file, 1, 2);
+  writeLe(file, static_cast<uint32_t>(channels), 2);
+  writeLe(file, static_cast<uint32_t>(sampleRate), 4);
+  writeLe(file, static_cast<uint32_t>(sampleRate * channels * 2), 4);
+  writeLe(file, static_cast<uint32_t>(channels * 2), 2);
+  writeLe(file, 16, 2);
+  std::fwrite("data", 1, 4, file);
+  writeLe(file, dataBytes, 4);
+  for (float sample : interleaved) {
+    const float clamped = std::clamp(sample, -1.0f, 1.0f);
+    const int16_t value = static_cast<int16_t>(std::lround(clamped * 32767.0f));
+    writeLe(file, static_cast<uint16_t>(value), 2);
+  }
+  return std::fclose(file) == 0;
+}
+
+bool readWav(const std::string& path,
+             std::vector<float>* interleaved,
+             int32_t* sampleRate,
+             int32_t* channels) {
+  WavDecoder decoder;
+  if (!decoder.open(path)) return false;
+  const AudioFormatInfo& format = decoder.format();
+  *sampleRate = format.sampleRate;
+  *channels = format.channelCount;
+  interleaved->clear();
+  std::vector<float> chunk(4096 * static_cast<size_t>(format.channelCount));
+  while (true) {
+    const int32_t frames = decoder.read(chunk.data(), 4096);
+    if (frames <= 0) break;
+    interleaved->insert(interleaved->end(), chunk.begin(),
+                        chunk.begin() + static_cast<size_t>(frames) *
+                                            format.channelCount);
+  }
+  return true;
+}
+
+}  // namespace test_signals
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Deterministic synthetic inputs shared by the host test executables.
+namespace test_signals {
+
+struct Signal {
+  std::string name;
+  int32_t sampleRate = 0;
+  int32_t channels = 0;
+  std::vector<float> samples;  // Interleaved.
+
+  int32_t frames() const {
+    return channels > 0 ? static_cast<int32_t>(samples.size() / channels) : 0;
+  }
+};
+
+// Logarithmic sine sweep from 40 Hz to just under Nyquist.
+Signal sweep(int32_t sampleRate, int32_t channels, double seconds);
+// Unit impulses every 250 ms.
+Signal impulses(int32_t sampleRate, int32_t channels, double seconds);
+// Exponentially decaying noise bursts, like drum hits.
+Signal transients(int32_t sampleRate, int32_t channels, double seconds);
+// A short tone followed by digital silence, to exercise reverb tails.
+Signal silenceTail(int32_t sampleRate, int32_t channels, double seconds);
+
+// The fixed golden corpus.
+std::vector<Signal> corpus(int32_t sampleRate, int32_t channels);
+
+// 16-bit PCM WAV I/O for references and debugging dumps.
+bool writeWav16(const std::string& path,
+                const std::vector<float>& interleaved,
+                int32_t sampleRate,
+                int32_t channels);
+bool readWav(const std::string& path,
+             std::vector<float>* interleaved,
+             int32_t* sampleRate,
+             int32_t* channels);
+
+}  // namespace test_signals
@@ -0,0 +1,187 @@
+#include "thread_config.h"
+
+#include <atomic>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#endif
+
+#include "native_log.h"
+
+namespace {
+std::atomic<bool> gPinToPerformanceCores{false};
+
+#if defined(__linux__)
+// ANDROID_PRIORITY_AUDIO, as Process.THREAD_PRIORITY_AUDIO.
+constexpr int kAudioNice = -16;
+// ANDROID_PRIORITY_URGENT_AUDIO, for an audio thread refused SCHED_FIFO.
+constexpr int kUrgentAudioNice = -19;
+// Low for SCHED_FIFO, within what rtkit and the usual audio group limits
+// grant, and below the sound server's own threads.
+constexpr int kAudioFifoPriority = 10;
+constexpr int kMaxCpus = 64;
+
+// One bit per ThreadRole that has already logged a refusal.
+std::atomic<uint32_t> gReportedRoles{0};
+
+const char* roleName(ThreadRole role) {
+  switch (role) {
+    case ThreadRole::kAudio:
+      return "audio";
+    case ThreadRole::kDecode:
+      return "decode";
+    case ThreadRole::kDsp:
+      return "DSP";
+    case ThreadRole::kRender:
+      return "render";
+    case ThreadRole::kControl:
+      return "control";
+  }
+  return "unknown";
+}
+
+void reportOnce(ThreadRole role, const char* what, int error) {
+  const uint32_t bit = 1u << static_cast<uint32_t>(role);
+  if (gReportedRoles.fetch_or(bit) & bit) return;
+  logi("Could not %s for %s threads: %s", what, roleName(role),
+       std::strerror(error));
+}
+
+id_t currentThreadId() { return static_cast<id_t>(syscall(SYS_gettid)); }
+
+// For the calling thread only; Linux applies setpriority() per thread.
+bool setNice(int nice) {
+  return setpriority(PRIO_PROCESS, currentThreadId(), nice) == 0;
+}
+
+int readNice() {
+  errno = 0;
+  const int nice = getpriority(PRIO_PROCESS, currentThreadId());
+  return errno == 0 ? nice : 0;
+}
+
+long readMaxFrequencyKhz(int cpu) {
+  char path[80];
+  std::snprintf(path, sizeof(path),
+                "/sys/devices/system/cpu/cpu%d/cpufreq/cpuinfo_max_freq",
+                cpu);
+  FILE* file = std::fopen(path, "r");
+  if (!file) return 0;
+  long khz = 0;
+  if (std::fscanf(file, "%ld", &khz) != 1) khz = 0;
+  std::fclose(file);
+  return khz;
+}
+
+uint64_t readPerformanceCores() {
+  const int cpus = static_cast<int>(
+      std::clamp<long>(sysconf(_SC_NPROCESSORS_CONF), 0, kMaxCpus));
+  long khz[kMaxCpus] = {};
+  long slowest = 0;
+  long fastest = 0;
+  for (int cpu = 0; cpu < cpus; ++cpu) {
+    khz[cpu] = readMaxFrequencyKhz(cpu);
+    if (khz[cpu] <= 0) continue;
+    slowest = slowest > 0 ? std::min(slowest, khz[cpu]) : khz[cpu];
+    fastest = std::max(fastest, khz[cpu]);
+  }
+  uint64_t cores = 0;
+  if (fastest == slowest) return cores;
+  for (int cpu = 0; cpu < cpus; ++cpu) {
+    if (khz[cpu] > slowest) cores |= uint64_t{1} << cpu;
+  }
+  return cores;
+}
+
+bool setPriority(ThreadRole role) {
+  switch (role) {
+    case ThreadRole::kAudio: {
+      sched_param param = {};
+      param.sched_priority = kAudioFifoPriority;
+      if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) == 0) {
+        return true;
+      }
+      if (setNice(kUrgentAudioNice)) return true;
+      reportOnce(role, "raise the priority", errno);
+      return false;
+    }
+    case ThreadRole::kDecode:
+    case ThreadRole::kDsp:
+      if (setNice(kAudioNice)) return true;
+      reportOnce(role, "raise the priority", errno);
+      return false;
+    case ThreadRole::kRender: {
+      const sched_param param = {};
+      const int error =
+          pthread_setschedparam(pthread_self(), SCHED_BATCH, &param);
+      if (error == 0) return true;
+      reportOnce(role, "switch to SCHED_BATCH", error);
+      return false;
+    }
+    case ThreadRole::kControl:
+      return true;
+  }
+  return false;
+}
+
+bool pinToFastCores(ThreadRole role) {
+  const uint64_t cores = performanceCores();
+  if (cores == 0) return false;
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (int cpu = 0; cpu < kMaxCpus; ++cpu) {
+    if ((cores >> cpu) & 1) CPU_SET(cpu, &set);
+  }
+  if (sched_setaffinity(0, sizeof(set), &set) == 0) return true;
+  reportOnce(role, "pin to the performance cores", errno);
+  return false;
+}
+#endif
+}  // namespace
+
+ThreadPlacement applyThreadRole(ThreadRole role, const char* name) {
+  ThreadPlacement placement;
+#if defined(__linux__)
+  char shortName[16];
+  std::snprintf(shortName, sizeof(shortName), "%s", name);
+  pthread_setname_np(pthread_self(), shortName);
+  placement.prioritized = setPriority(role);
+  int policy = SCHED_OTHER;
+  sched_param param = {};
+  pthread_getschedparam(pthread_self(), &policy, &param);
+  placement.realtime = policy == SCHED_FIFO;
+  if (role == ThreadRole::kDecode || role == ThreadRole::kDsp ||
+      role == ThreadRole::kRender) {
+    placement.pinned = pinToPerformanceCores() && pinToFastCores(role);
+  }
+  placement.nice = readNice();
+#else
+  (void)role;
+  (void)name;
+#endif
+  return placement;
+}
+
+uint64_t performanceCores() {
+#if defined(__linux__)
+  static const uint64_t cores = readPerformanceCores();
+  return cores;
+#else
+  return 0;
+#endif
+}
+
+void setPinToPerformanceCores(bool enabled) {
+  gPinToPerformanceCores.store(enabled);
+}
+
+bool pinToPerformanceCores() { return gPinToPerformanceCores.load(); }
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+
+// What a native thread is for, which decides how it is scheduled.
+enum class ThreadRole : int32_t {
+  // Renders into an output device the engine drives itself (ALSA). Asks for
+  // SCHED_FIFO, and the audio nice value when that is refused. Oboe's
+  // callback thread is scheduled by AAudio and is left alone.
+  kAudio = 0,
+  // Keeps a decode ring ahead of the audio callback.
+  kDecode,
+  // Work the audio callback waits on, e.g. the convolution reverb's tail
+  // partitions.
+  kDsp,
+  // Offline rendering workers: SCHED_BATCH at the default nice value, so
+  // throughput work does not preempt the UI or the audio threads.
+  kRender,
+  // Lifecycle and recovery workers; named only.
+  kControl,
+};
+
+// What applyThreadRole() got for the calling thread.
+struct ThreadPlacement {
+  // Nice value in effect afterwards.
+  int32_t nice = 0;
+  // The role's priority or policy was granted; true for kControl, which
+  // asks for none. Raising priority needs RLIMIT_NICE or RLIMIT_RTPRIO
+  // headroom, which Android gives apps and desktop Linux often does not.
+  bool prioritized = false;
+  // Running under SCHED_FIFO.
+  bool realtime = false;
+  // Restricted to performanceCores().
+  bool pinned = false;
+};
+
+// Names the calling thread (Linux keeps 15 characters), sets its priority
+// for role and, while setPinToPerformanceCores() is on, restricts decode,
+// DSP and render threads to the performance cores. Whatever the OS refuses
+// is logged once per role and left as it was. A no-op off Linux.
+ThreadPlacement applyThreadRole(ThreadRole role, const char* name);
+
+// The cores faster than the slowest cluster, going by each core's maximum
+// cpufreq frequency, as a mask of CPUs 0-63: the big and prime cores of a
+// big.LITTLE phone. 0 when every core is alike or the frequencies cannot
+// be read, in which case nothing is pinned. Read once.
+uint64_t performanceCores();
+
+// Applies to threads started from then on. Off by default: pinned threads
+// cannot fall back to an idle little core while the big ones are busy.
+void setPinToPerformanceCores(bool enabled);
+bool pinToPerformanceCores();
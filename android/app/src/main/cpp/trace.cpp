@@ -0,0 +1,216 @@
+#include "trace.h"
+
+#if defined(SLOWREVERB_TRACE) && defined(__ANDROID__)
+#define SLOWREVERB_TRACE_ATRACE 1
+#elif defined(SLOWREVERB_TRACE) && defined(__linux__)
+#define SLOWREVERB_TRACE_RING 1
+#endif
+
+#if defined(SLOWREVERB_TRACE_ATRACE)
+#include <dlfcn.h>
+#elif defined(SLOWREVERB_TRACE_RING)
+#include <pthread.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+#include "native_log.h"
+#endif
+
+#if defined(SLOWREVERB_TRACE_ATRACE)
+namespace {
+using BeginSectionFn = void (*)(const char*);
+using EndSectionFn = void (*)();
+
+// Resolved at run time: ATrace_beginSection() arrived in API 23, above the
+// app's minimum SDK.
+struct ATraceFunctions {
+  BeginSectionFn beginSection;
+  EndSectionFn endSection;
+};
+
+const ATraceFunctions& atrace() {
+  static const ATraceFunctions functions = {
+      reinterpret_cast<BeginSectionFn>(
+          dlsym(RTLD_DEFAULT, "ATrace_beginSection")),
+      reinterpret_cast<EndSectionFn>(
+          dlsym(RTLD_DEFAULT, "ATrace_endSection"))};
+  return functions;
+}
+}  // namespace
+
+TraceScope::TraceScope(const char* name) : name_(name), beginNs_(0) {
+  const ATraceFunctions& functions = atrace();
+  if (functions.beginSection && functions.endSection) {
+    functions.beginSection(name_);
+  }
+}
+
+TraceScope::~TraceScope() {
+  const ATraceFunctions& functions = atrace();
+  if (functions.beginSection && functions.endSection) {
+    functions.endSection();
+  }
+}
+
+bool writeChromeTrace(const char*) { return false; }
+
+#elif defined(SLOWREVERB_TRACE_RING)
+namespace {
+// Threads traced at once; a thread that finds every log taken records
+// nothing.
+constexpr int32_t kMaxThreads = 32;
+// At a few scopes per 4 ms callback, several seconds of the audio thread.
+constexpr int64_t kEventsPerThread = 8192;
+
+struct Event {
+  std::atomic<const char*> name{nullptr};
+  std::atomic<int64_t> beginNs{0};
+  std::atomic<int64_t> endNs{0};
+};
+
+// One thread's most recent events, handed to another thread once it exits.
+// Event i is kept in events[i % kEventsPerThread]. Its writer counts it in
+// started before overwriting the slot and in published after, so a reader
+// can tell which of the events it copied were overwritten meanwhile.
+struct ThreadLog {
+  std::atomic<bool> claimed{false};
+  std::atomic<int32_t> tid{0};
+  std::atomic<char> threadName[16];
+  // Index of the current owner's first event.
+  std::atomic<int64_t> first{0};
+  std::atomic<int64_t> started{0};
+  std::atomic<int64_t> published{0};
+  Event events[kEventsPerThread];
+};
+
+ThreadLog gLogs[kMaxThreads];
+thread_local ThreadLog* tLog = nullptr;
+
+// Gives a thread's log back when the thread exits. Created at load, so the
+// first scope on the audio thread does not.
+const pthread_key_t gLogKey = [] {
+  pthread_key_t key;
+  pthread_key_create(&key, [](void* log) {
+    static_cast<ThreadLog*>(log)->claimed.store(false,
+                                                std::memory_order_release);
+  });
+  return key;
+}();
+
+int64_t nowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+ThreadLog* currentLog() {
+  if (tLog) return tLog;
+  for (ThreadLog& log : gLogs) {
+    bool expected = false;
+    if (!log.claimed.compare_exchange_strong(expected, true,
+                                             std::memory_order_acquire)) {
+      continue;
+    }
+    char name[16] = {};
+    pthread_getname_np(pthread_self(), name, sizeof(name));
+    for (size_t i = 0; i < sizeof(name); ++i) {
+      log.threadName[i].store(name[i], std::memory_order_relaxed);
+    }
+    log.tid.store(static_cast<int32_t>(syscall(SYS_gettid)),
+                  std::memory_order_relaxed);
+    log.first.store(log.started.load(std::memory_order_relaxed),
+                    std::memory_order_relaxed);
+    pthread_setspecific(gLogKey, &log);
+    tLog = &log;
+    return tLog;
+  }
+  return nullptr;
+}
+
+// JSON-safe copy of a thread's name.
+void readThreadName(const ThreadLog& log, char* name, size_t size) {
+  for (size_t i = 0; i + 1 < size; ++i) {
+    const char c = log.threadName[i].load(std::memory_order_relaxed);
+    const bool plain = c == 0 || (static_cast<unsigned char>(c) >= 0x20 &&
+                                  c != '"' && c != '\\');
+    name[i] = plain ? c : '_';
+  }
+  name[size - 1] = 0;
+}
+
+// Writes the trace named by SLOWREVERB_TRACE_FILE when the program exits.
+struct ExitWriter {
+  ~ExitWriter() {
+    const char* path = std::getenv("SLOWREVERB_TRACE_FILE");
+    if (path && *path && !writeChromeTrace(path)) {
+      loge("Could not write the trace to %s", path);
+    }
+  }
+} gExitWriter;
+}  // namespace
+
+TraceScope::TraceScope(const char* name) : name_(name), beginNs_(nowNs()) {}
+
+TraceScope::~TraceScope() {
+  ThreadLog* log = currentLog();
+  if (!log) return;
+  const int64_t index = log->started.load(std::memory_order_relaxed);
+  log->started.store(index + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  Event& event = log->events[index % kEventsPerThread];
+  event.name.store(name_, std::memory_order_relaxed);
+  event.beginNs.store(beginNs_, std::memory_order_relaxed);
+  event.endNs.store(nowNs(), std::memory_order_relaxed);
+  log->published.store(index + 1, std::memory_order_release);
+}
+
+bool writeChromeTrace(const char* path) {
+  std::FILE* file = std::fopen(path, "w");
+  if (!file) return false;
+  const int pid = static_cast<int>(getpid());
+  std::fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+  const char* separator = "\n";
+  for (const ThreadLog& log : gLogs) {
+    const int64_t published = log.published.load(std::memory_order_acquire);
+    const int64_t first =
+        std::max(log.first.load(std::memory_order_relaxed),
+                 published - kEventsPerThread);
+    if (first >= published) continue;
+    const int tid = log.tid.load(std::memory_order_relaxed);
+    char name[16];
+    readThreadName(log, name, sizeof(name));
+    std::fprintf(file,
+                 "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,"
+                 "\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                 separator, pid, tid, name);
+    separator = ",\n";
+    for (int64_t i = first; i < published; ++i) {
+      const Event& event = log.events[i % kEventsPerThread];
+      const char* eventName = event.name.load(std::memory_order_relaxed);
+      const int64_t beginNs = event.beginNs.load(std::memory_order_relaxed);
+      const int64_t endNs = event.endNs.load(std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      // The slot was reused while it was being copied.
+      const int64_t started = log.started.load(std::memory_order_relaxed);
+      if (started > i + kEventsPerThread) continue;
+      std::fprintf(file,
+                   ",\n{\"name\":\"%s\",\"cat\":\"slowreverb\",\"ph\":\"X\","
+                   "\"pid\":%d,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                   eventName, pid, tid, beginNs / 1e3,
+                   (endNs - beginNs) / 1e3);
+    }
+  }
+  std::fprintf(file, "\n]}\n");
+  const bool written = !std::ferror(file);
+  return std::fclose(file) == 0 && written;
+}
+
+#else
+bool writeChromeTrace(const char*) { return false; }
+#endif
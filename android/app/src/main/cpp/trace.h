@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+
+// Compile-time optional trace scopes around the decode and render pipeline,
+// for telling a decoder stall from a starved stretcher or an overrunning
+// reverb. Configured with -DSLOWREVERB_TRACE=ON, every scope is an ATrace
+// section on Android, visible in Perfetto and systrace. Elsewhere it is an
+// event in a ring of the calling thread's most recent events, written out
+// as Chrome trace JSON by writeChromeTrace(), or at exit to the file named
+// by SLOWREVERB_TRACE_FILE. Recording takes neither locks nor allocations,
+// so scopes may sit on the audio thread. Without the option the macro
+// expands to nothing.
+//
+// Names must be string literals: only the pointer is kept.
+#if defined(SLOWREVERB_TRACE)
+#define SLOWREVERB_TRACE_CONCAT_(a, b) a##b
+#define SLOWREVERB_TRACE_CONCAT(a, b) SLOWREVERB_TRACE_CONCAT_(a, b)
+#define SLOWREVERB_TRACE_SCOPE(name) \
+  const TraceScope SLOWREVERB_TRACE_CONCAT(traceScope, __LINE__)(name)
+
+class TraceScope {
+ public:
+  explicit TraceScope(const char* name);
+  ~TraceScope();
+  TraceScope(const TraceScope&) = delete;
+  TraceScope& operator=(const TraceScope&) = delete;
+
+ private:
+  const char* name_;
+  int64_t beginNs_;
+};
+#else
+#define SLOWREVERB_TRACE_SCOPE(name) static_cast<void>(0)
+#endif
+
+// Writes every thread's retained events to path as Chrome trace JSON, for
+// chrome://tracing or ui.perfetto.dev. Events recorded while it runs may be
+// left out. False when tracing is compiled out, on Android (where the
+// system records the sections), or when the file cannot be written.
+bool writeChromeTrace(const char* path);
@@ -0,0 +1,161 @@
+#include "wav_decoder.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "native_log.h"
+
+namespace {
+constexpr uint16_t kFormatPcm = 1;
+constexpr uint16_t kFormatFloat = 3;
+constexpr uint16_t kFormatExtensible = 0xFFFE;
+
+uint16_t readU16(const uint8_t* p) {
+  return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+uint32_t readU32(const uint8_t* p) {
+  return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+         (static_cast<uint32_t>(p[2]) << 16) |
+         (static_cast<uint32_t>(p[3]) << 24);
+}
+
+float sampleToFloat(const uint8_t* p, int32_t bytes, bool isFloat) {
+  if (isFloat) {
+    if (bytes == 8) {
+      double value;
+      std::memcpy(&value, p, sizeof(value));
+      return static_cast<float>(value);
+    }
+    float value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+  }
+  switch (bytes) {
+    case 1:
+      return (static_cast<float>(p[0]) - 128.0f) / 128.0f;
+    case 2:
+      return static_cast<float>(static_cast<int16_t>(readU16(p))) / 32768.0f;
+    case 3: {
+      const int32_t value = static_cast<int32_t>(
+          (static_cast<uint32_t>(p[0]) << 8) |
+          (static_cast<uint32_t>(p[1]) << 16) |
+          (static_cast<uint32_t>(p[2]) << 24));
+      return static_cast<float>(value) / 2147483648.0f;
+    }
+    default:
+      return static_cast<float>(static_cast<int32_t>(readU32(p))) /
+             2147483648.0f;
+  }
+}
+}  // namespace
+
+WavDecoder::~WavDecoder() { close(); }
+
+void WavDecoder::close() {
+  if (file_) {
+    std::fclose(file_);
+    file_ = nullptr;
+  }
+}
+
+bool WavDecoder::open(const std::string& path) {
+  close();
+  file_ = std::fopen(path.c_str(), "rb");
+  if (!file_) {
+    loge("Failed to open %s", path.c_str());
+    return false;
+  }
+  uint8_t header[12];
+  if (std::fread(header, 1, sizeof(header), file_) != sizeof(header) ||
+      std::memcmp(header, "RIFF", 4) != 0 ||
+      std::memcmp(header + 8, "WAVE", 4) != 0) {
+    loge("Not a RIFF/WAVE file: %s", path.c_str());
+    close();
+    return false;
+  }
+
+  bool haveFormat = false;
+  uint8_t chunk[8];
+  while (std::fread(chunk, 1, sizeof(chunk), file_) == sizeof(chunk)) {
+    const uint32_t chunkSize = readU32(chunk + 4);
+    const long chunkStart = std::ftell(file_);
+    if (std::memcmp(chunk, "fmt ", 4) == 0 && chunkSize >= 16) {
+      uint8_t fmt[40] = {};
+      const size_t toRead = std::min<size_t>(chunkSize, sizeof(fmt));
+      if (std::fread(fmt, 1, toRead, file_) != toRead) break;
+      uint16_t formatTag = readU16(fmt);
+      if (formatTag == kFormatExtensible && toRead >= 26) {
+        formatTag = readU16(fmt + 24);
+      }
+      const int32_t bits = readU16(fmt + 14);
+      format_.channelCount = readU16(fmt + 2);
+      format_.sampleRate = static_cast<int32_t>(readU32(fmt + 4));
+      bytesPerSample_ = bits / 8;
+      isFloat_ = formatTag == kFormatFloat;
+      haveFormat = (formatTag == kFormatPcm && bytesPerSample_ >= 1 &&
+                    bytesPerSample_ <= 4) ||
+                   (isFloat_ && (bytesPerSample_ == 4 || bytesPerSample_ == 8));
+      if (!haveFormat) {
+        loge("Unsupported WAV encoding (tag %u, %d bits)", formatTag, bits);
+        break;
+      }
+    } else if (std::memcmp(chunk, "data", 4) == 0 && haveFormat) {
+      dataOffset_ = chunkStart;
+      const int64_t frameBytes =
+          static_cast<int64_t>(bytesPerSample_) * format_.channelCount;
+      totalFrames_ = frameBytes > 0 ? chunkSize / frameBytes : 0;
+      framePosition_ = 0;
+      endOfStream_ = false;
+      if (format_.sampleRate > 0) {
+        format_.durationUs = totalFrames_ * 1000000 / format_.sampleRate;
+      }
+      return format_.channelCount > 0 && format_.sampleRate > 0;
+    }
+    // Chunks are word aligned.
+    std::fseek(file_, chunkStart + chunkSize + (chunkSize & 1), SEEK_SET);
+  }
+  loge("No playable data chunk in %s", path.c_str());
+  close();
+  return false;
+}
+
+bool WavDecoder::seekToUs(int64_t positionUs) {
+  if (!file_) return false;
+  const int64_t frame = std::clamp<int64_t>(
+      positionUs * format_.sampleRate / 1000000, 0, totalFrames_);
+  const int64_t offset =
+      dataOffset_ + frame * bytesPerSample_ * format_.channelCount;
+  if (std::fseek(file_, static_cast<long>(offset), SEEK_SET) != 0) {
+    return false;
+  }
+  framePosition_ = frame;
+  endOfStream_ = frame >= totalFrames_;
+  return true;
+}
+
+int32_t WavDecoder::read(float* dst, int32_t maxFrames) {
+  if (!file_) return -1;
+  const int64_t remaining = totalFrames_ - framePosition_;
+  const int32_t frames =
+      static_cast<int32_t>(std::min<int64_t>(maxFrames, remaining));
+  if (frames <= 0) {
+    endOfStream_ = true;
+    return 0;
+  }
+  const size_t frameBytes =
+      static_cast<size_t>(bytesPerSample_) * format_.channelCount;
+  raw_.resize(static_cast<size_t>(frames) * frameBytes);
+  const size_t got = std::fread(raw_.data(), frameBytes, frames, file_);
+  const size_t samples = got * format_.channelCount;
+  const uint8_t* src = raw_.data();
+  for (size_t i = 0; i < samples; ++i) {
+    dst[i] = sampleToFloat(src, bytesPerSample_, isFloat_);
+    src += bytesPerSample_;
+  }
+  framePosition_ += static_cast<int64_t>(got);
+  if (got < static_cast<size_t>(frames)) {
+    endOfStream_ = true;
+  }
+  return static_cast<int32_t>(got);
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdio>
+#include <vector>
+
+#include "audio_decoder.h"
+
+// Reads PCM (16/24/32-bit) and IEEE float (32/64-bit) RIFF/WAVE files.
+class WavDecoder : public AudioDecoder {
+ public:
+  ~WavDecoder() override;
+
+  bool open(const std::string& path) override;
+  bool seekToUs(int64_t positionUs) override;
+  int32_t read(float* dst, int32_t maxFrames) override;
+
+ private:
+  void close();
+
+  std::FILE* file_ = nullptr;
+  bool isFloat_ = false;
+  int32_t bytesPerSample_ = 2;
+  int64_t dataOffset_ = 0;
+  int64_t totalFrames_ = 0;
+  int64_t framePosition_ = 0;
+  std::vector<uint8_t> raw_;
+};
@@ -0,0 +1,127 @@
+////////////////////////////////////////////////////////////////////////////////
+///
+/// Allocation hook for the sample and coefficient buffers SoundTouch grows
+/// while it runs: FIFO storage, FIR coefficients, the anti-alias filter's
+/// design scratch and TDStretch's overlap buffer. By default these come from
+/// the C++ heap. An application that must not touch the heap on its audio
+/// thread can install its own allocator, e.g. one serving a preallocated
+/// arena, with 'setBufferAllocator'.
+///
+/// Each buffer remembers the release function it was allocated with, so a
+/// buffer always goes back where it came from even if the hook is changed
+/// while it is alive.
+///
+/// Local patch  : Added to this vendored copy of SoundTouch for the app's
+///                arena allocator; it is not part of upstream SoundTouch.
+/// Upstream WWW : http://www.surina.net/soundtouch
+///
+////////////////////////////////////////////////////////////////////////////////
+//
+// License :
+//
+//  This file is a local patch to the library below and is distributed
+//  under the library's license. Upstream's notice follows unchanged.
+//
+//  SoundTouch audio processing library
+//  Copyright (c) Olli Parviainen
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2.1 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef STAllocator_H
+#define STAllocator_H
+
+#include <stddef.h>
+#include <atomic>
+#include <new>
+
+namespace soundtouch
+{
+
+/// Allocates 'bytes' aligned to at least 16 bytes. Must not return NULL;
+/// throw or fall back to the heap instead.
+typedef void *(*BufferAllocateFn)(size_t bytes);
+/// Releases a block returned by the matching BufferAllocateFn.
+typedef void (*BufferReleaseFn)(void *block);
+
+struct BufferAllocator
+{
+    BufferAllocateFn allocate;
+    BufferReleaseFn release;
+};
+
+namespace detail
+{
+    /// Room in front of each buffer for its release function; keeps the
+    /// buffer 16-byte aligned.
+    const size_t BUFFER_HEADER_BYTES = 16;
+
+    inline void *heapAllocate(size_t bytes)
+    {
+        return ::operator new(bytes);
+    }
+
+    inline void heapRelease(void *block)
+    {
+        ::operator delete(block);
+    }
+
+    inline const BufferAllocator *heapAllocator()
+    {
+        static const BufferAllocator heap = {heapAllocate, heapRelease};
+        return &heap;
+    }
+
+    inline std::atomic<const BufferAllocator *> &bufferAllocator()
+    {
+        static std::atomic<const BufferAllocator *> current(heapAllocator());
+        return current;
+    }
+}
+
+/// Routes buffers allocated from now on through 'allocator'. The struct
+/// must stay valid until the hook is changed again, its release function
+/// for as long as any of its buffers. NULL restores the heap.
+inline void setBufferAllocator(const BufferAllocator *allocator)
+{
+    detail::bufferAllocator().store(
+        allocator ? allocator : detail::heapAllocator(),
+        std::memory_order_release);
+}
+
+/// Replacement for 'new T[count]' on buffers of trivial types.
+template <class T> T *newBuffer(size_t count)
+{
+    const BufferAllocator *allocator =
+        detail::bufferAllocator().load(std::memory_order_acquire);
+    char *block = (char *)allocator->allocate(detail::BUFFER_HEADER_BYTES +
+                                              count * sizeof(T));
+    *(BufferReleaseFn *)block = allocator->release;
+    return (T *)(block + detail::BUFFER_HEADER_BYTES);
+}
+
+/// Replacement for 'delete[] buffer' on buffers from 'newBuffer'.
+template <class T> void deleteBuffer(T *buffer)
+{
+    if (buffer == NULL) return;
+    char *block = (char *)buffer - detail::BUFFER_HEADER_BYTES;
+    const BufferReleaseFn release = *(BufferReleaseFn *)block;
+    release(block);
+}
+
+}
+
+#endif
@@ -39,6 +39,7 @@
 #include <stdlib.h>
 #include "AAFilter.h"
 #include "FIRFilter.h"
+#include "STAllocator.h"
 
 using namespace soundtouch;
 
@@ -121,8 +122,8 @@ void AAFilter::calculateCoeffs()
     assert(cutoffFreq >= 0);
     assert(cutoffFreq <= 0.5);
 
-    work = new double[length];
-    coeffs = new SAMPLETYPE[length];
+    work = newBuffer<double>(length);
+    coeffs = newBuffer<SAMPLETYPE>(length);
 
     wc = 2.0 * PI * cutoffFreq;
     tempCoeff = TWOPI / (double)length;
@@ -177,8 +178,8 @@ void AAFilter::calculateCoeffs()
 
     _DEBUG_SAVE_AAFIR_COEFFS(coeffs, length);
 
-    delete[] work;
-    delete[] coeffs;
+    deleteBuffer(work);
+    deleteBuffer(coeffs);
 }
 
 
@@ -57,6 +57,7 @@
 #include "FIFOSampleBuffer.h"
 #include "PeakFinder.h"
 #include "BPMDetect.h"
+#include "STAllocator.h"
 
 using namespace soundtouch;
 
@@ -198,7 +199,7 @@ BPMDetect::BPMDetect(int numChannels, int aSampleRate) :
     assert(windowLen > windowStart);
 
     // allocate new working objects
-    xcorr = new float[windowLen];
+    xcorr = newBuffer<float>(windowLen);
     memset(xcorr, 0, windowLen * sizeof(float));
 
     pos = 0;
@@ -206,7 +207,7 @@ BPMDetect::BPMDetect(int numChannels, int aSampleRate) :
     peakVal = 0;
     init_scaler = 1;
     beatcorr_ringbuffpos = 0;
-    beatcorr_ringbuff = new float[windowLen];
+    beatcorr_ringbuff = newBuffer<float>(windowLen);
     memset(beatcorr_ringbuff, 0, windowLen * sizeof(float));
 
     // allocate processing buffer
@@ -216,19 +217,19 @@ BPMDetect::BPMDetect(int numChannels, int aSampleRate) :
     buffer->clear();
 
     // calculate hamming windows
-    hamw = new float[XCORR_UPDATE_SEQUENCE];
+    hamw = newBuffer<float>(XCORR_UPDATE_SEQUENCE);
     hamming(hamw, XCORR_UPDATE_SEQUENCE);
-    hamw2 = new float[XCORR_UPDATE_SEQUENCE / 2];
+    hamw2 = newBuffer<float>(XCORR_UPDATE_SEQUENCE / 2);
     hamming(hamw2, XCORR_UPDATE_SEQUENCE / 2);
 }
 
 
 BPMDetect::~BPMDetect()
 {
-    delete[] xcorr;
-    delete[] beatcorr_ringbuff;
-    delete[] hamw;
-    delete[] hamw2;
+    deleteBuffer(xcorr);
+    deleteBuffer(beatcorr_ringbuff);
+    deleteBuffer(hamw);
+    deleteBuffer(hamw2);
     delete buffer;
 }
 
@@ -527,7 +528,7 @@ float BPMDetect::getBpm()
     _SaveDebugData("soundtouch-bpm-xcorr.txt", xcorr, windowStart, windowLen, coeff);
 
     // Smoothen by N-point moving-average
-    float *data = new float[windowLen];
+    float *data = newBuffer<float>(windowLen);
     memset(data, 0, sizeof(float) * windowLen);
     MAFilter(data, xcorr, windowStart, windowLen, MOVING_AVERAGE_N);
 
@@ -537,7 +538,7 @@ float BPMDetect::getBpm()
     // save bpm debug data if debug data writing enabled
     _SaveDebugData("soundtouch-bpm-smoothed.txt", data, windowStart, windowLen, coeff);
 
-    delete[] data;
+    deleteBuffer(data);
 
     assert(decimateBy != 0);
     if (peakPos < 1e-9) return 0.0; // detection failed.
@@ -42,6 +42,7 @@
 #include <assert.h>
 
 #include "FIFOSampleBuffer.h"
+#include "STAllocator.h"
 
 using namespace soundtouch;
 
@@ -62,7 +63,7 @@ FIFOSampleBuffer::FIFOSampleBuffer(int numChannels)
 // destructor
 FIFOSampleBuffer::~FIFOSampleBuffer()
 {
-    delete[] bufferUnaligned;
+    deleteBuffer(bufferUnaligned);
     bufferUnaligned = NULL;
     buffer = NULL;
 }
@@ -165,7 +166,7 @@ void FIFOSampleBuffer::ensureCapacity(uint capacityRequirement)
         // enlarge the buffer in 4kbyte steps (round up to next 4k boundary)
         sizeInBytes = (capacityRequirement * channels * sizeof(SAMPLETYPE) + 4095) & (uint)-4096;
         assert(sizeInBytes % 2 == 0);
-        tempUnaligned = new SAMPLETYPE[sizeInBytes / sizeof(SAMPLETYPE) + 16 / sizeof(SAMPLETYPE)];
+        tempUnaligned = newBuffer<SAMPLETYPE>(sizeInBytes / sizeof(SAMPLETYPE) + 16 / sizeof(SAMPLETYPE));
         if (tempUnaligned == NULL)
         {
             ST_THROW_RT_ERROR("Couldn't allocate memory!\n");
@@ -176,7 +177,7 @@ void FIFOSampleBuffer::ensureCapacity(uint capacityRequirement)
         {
             memcpy(temp, ptrBegin(), samplesInBuffer * channels * sizeof(SAMPLETYPE));
         }
-        delete[] bufferUnaligned;
+        deleteBuffer(bufferUnaligned);
         buffer = temp;
         bufferUnaligned = tempUnaligned;
         bufferPos = 0;
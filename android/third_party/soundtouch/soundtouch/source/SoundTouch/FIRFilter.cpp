@@ -43,6 +43,7 @@
 #include <math.h>
 #include <stdlib.h>
 #include "FIRFilter.h"
+#include "STAllocator.h"
 #include "cpu_detect.h"
 
 using namespace soundtouch;
@@ -66,8 +67,8 @@ FIRFilter::FIRFilter()
 
 FIRFilter::~FIRFilter()
 {
-    delete[] filterCoeffs;
-    delete[] filterCoeffsStereo;
+    deleteBuffer(filterCoeffs);
+    deleteBuffer(filterCoeffsStereo);
 }
 
 
@@ -236,10 +237,10 @@ void FIRFilter::setCoefficients(const SAMPLETYPE *coeffs, uint newLength, uint u
     resultDivFactor = uResultDivFactor;
     resultDivider = (SAMPLETYPE)::pow(2.0, (int)resultDivFactor);
 
-    delete[] filterCoeffs;
-    filterCoeffs = new SAMPLETYPE[length];
-    delete[] filterCoeffsStereo;
-    filterCoeffsStereo = new SAMPLETYPE[length*2];
+    deleteBuffer(filterCoeffs);
+    filterCoeffs = newBuffer<SAMPLETYPE>(length);
+    deleteBuffer(filterCoeffsStereo);
+    filterCoeffsStereo = newBuffer<SAMPLETYPE>(length*2);
     for (uint i = 0; i < length; i ++)
     {
         filterCoeffs[i] = (SAMPLETYPE)(coeffs[i] * scale);
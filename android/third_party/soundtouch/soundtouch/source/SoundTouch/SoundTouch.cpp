@@ -69,6 +69,7 @@
 #include <stdio.h>
 
 #include "SoundTouch.h"
+#include "STAllocator.h"
 #include "TDStretch.h"
 #include "RateTransposer.h"
 #include "cpu_detect.h"
@@ -319,7 +320,7 @@ void SoundTouch::flush()
 {
     int i;
     int numStillExpected;
-    SAMPLETYPE *buff = new SAMPLETYPE[128 * channels];
+    SAMPLETYPE *buff = newBuffer<SAMPLETYPE>(128 * channels);
 
     // how many samples are still expected to output
     numStillExpected = (int)((long)(samplesExpectedOut + 0.5) - samplesOutput);
@@ -337,7 +338,7 @@ void SoundTouch::flush()
 
     adjustAmountOfSamples(numStillExpected);
 
-    delete[] buff;
+    deleteBuffer(buff);
 
     // Clear input buffers
     pTDStretch->clearInput();
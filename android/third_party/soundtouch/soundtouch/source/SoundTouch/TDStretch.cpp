@@ -47,6 +47,7 @@
 #include <float.h>
 
 #include "STTypes.h"
+#include "STAllocator.h"
 #include "cpu_detect.h"
 #include "TDStretch.h"
 
@@ -103,7 +104,7 @@ TDStretch::TDStretch() : FIFOProcessor(&outputBuffer)
 
 TDStretch::~TDStretch()
 {
-    delete[] pMidBufferUnaligned;
+    deleteBuffer(pMidBufferUnaligned);
 }
 
 
@@ -746,9 +747,9 @@ void TDStretch::acceptNewOverlapLength(int newOverlapLength)
 
     if (overlapLength > prevOvl)
     {
-        delete[] pMidBufferUnaligned;
+        deleteBuffer(pMidBufferUnaligned);
 
-        pMidBufferUnaligned = new SAMPLETYPE[overlapLength * channels + 16 / sizeof(SAMPLETYPE)];
+        pMidBufferUnaligned = newBuffer<SAMPLETYPE>(overlapLength * channels + 16 / sizeof(SAMPLETYPE));
         // ensure that 'pMidBuffer' is aligned to 16 byte boundary for efficiency
         pMidBuffer = (SAMPLETYPE *)SOUNDTOUCH_ALIGN_POINTER_16(pMidBufferUnaligned);
 
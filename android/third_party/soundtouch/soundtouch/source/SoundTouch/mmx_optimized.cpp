@@ -42,6 +42,7 @@
 ////////////////////////////////////////////////////////////////////////////////
 
 #include "STTypes.h"
+#include "STAllocator.h"
 
 #ifdef SOUNDTOUCH_ALLOW_MMX
 // MMX routines available only with integer sample type
@@ -301,7 +302,7 @@ FIRFilterMMX::FIRFilterMMX() : FIRFilter()
 
 FIRFilterMMX::~FIRFilterMMX()
 {
-    delete[] filterCoeffsUnalign;
+    deleteBuffer(filterCoeffsUnalign);
 }
 
 
@@ -312,8 +313,8 @@ void FIRFilterMMX::setCoefficients(const short *coeffs, uint newLength, uint uRe
     FIRFilter::setCoefficients(coeffs, newLength, uResultDivFactor);
 
     // Ensure that filter coeffs array is aligned to 16-byte boundary
-    delete[] filterCoeffsUnalign;
-    filterCoeffsUnalign = new short[2 * newLength + 8];
+    deleteBuffer(filterCoeffsUnalign);
+    filterCoeffsUnalign = newBuffer<short>(2 * newLength + 8);
     filterCoeffsAlign = (short *)SOUNDTOUCH_ALIGN_POINTER_16(filterCoeffsUnalign);
 
     // rearrange the filter coefficients for mmx routines 
@@ -46,6 +46,7 @@
 
 #include "cpu_detect.h"
 #include "STTypes.h"
+#include "STAllocator.h"
 
 using namespace soundtouch;
 
@@ -202,7 +203,7 @@ FIRFilterSSE::FIRFilterSSE() : FIRFilter()
 
 FIRFilterSSE::~FIRFilterSSE()
 {
-    delete[] filterCoeffsUnalign;
+    deleteBuffer(filterCoeffsUnalign);
     filterCoeffsAlign = NULL;
     filterCoeffsUnalign = NULL;
 }
@@ -219,8 +220,8 @@ void FIRFilterSSE::setCoefficients(const float *coeffs, uint newLength, uint uRe
     // Scale the filter coefficients so that it won't be necessary to scale the filtering result
     // also rearrange coefficients suitably for SSE
     // Ensure that filter coeffs array is aligned to 16-byte boundary
-    delete[] filterCoeffsUnalign;
-    filterCoeffsUnalign = new float[2 * newLength + 4];
+    deleteBuffer(filterCoeffsUnalign);
+    filterCoeffsUnalign = newBuffer<float>(2 * newLength + 4);
     filterCoeffsAlign = (float *)SOUNDTOUCH_ALIGN_POINTER_16(filterCoeffsUnalign);
 
     fDivider = (float)resultDivider;
@@ -2,12 +2,15 @@ import 'dart:async';
 import 'dart:collection';
 import 'dart:convert';
 import 'dart:io';
+import 'dart:isolate';
 import 'dart:math' as math;
+import 'dart:typed_data';
 
 import 'package:desktop_drop/desktop_drop.dart';
 import 'package:file_picker/file_picker.dart';
 import 'package:flutter/foundation.dart';
 import 'package:flutter/material.dart';
+import 'package:flutter/scheduler.dart';
 import 'package:flutter_localizations/flutter_localizations.dart';
 import 'package:just_audio/just_audio.dart';
 import 'package:path/path.dart' as p;
@@ -571,7 +574,8 @@ const Map<String, _HelpDialogContent> _helpDialogContent =
   ),
 };
 
-class _SlowReverbHomePageState extends State<SlowReverbHomePage> {
+class _SlowReverbHomePageState extends State<SlowReverbHomePage>
+    with SingleTickerProviderStateMixin {
   static const _prefsKeyMusic = 'last_music_dir';
   static const _prefsKeyFfmpeg = 'last_ffmpeg_path';
   static const _defaultTempoFactor = 0.78;
@@ -633,7 +637,13 @@ class _SlowReverbHomePageState extends State<SlowReverbHomePage> {
   Duration? _previewTotalDuration;
   Duration? _previewPosition;
   Timer? _previewUpdateTimer;
-  Timer? _nativeProgressTimer;
+  Ticker? _nativeProgressTicker;
+  TelemetryReader? _nativeTelemetry;
+  int _lastNativeProgressStep = -1;
+  // Bumped by every native start and stop, so a start that completes after
+  // the user moved on is ignored.
+  int _nativeStartGeneration = 0;
+  StreamSubscription<NativeEngineEvent>? _nativeEventSub;
   StreamSubscription<PlayerState>? _previewStateSub;
   StreamSubscription<Duration?>? _previewDurationSub;
   StreamSubscription<Duration>? _previewPositionSub;
@@ -649,6 +659,14 @@ class _SlowReverbHomePageState extends State<SlowReverbHomePage> {
   int _estimatedTotalBytes = 0;
   int _nativePreviewHandle = 0;
   bool _nativePreviewActive = false;
+  final Map<String, String> _snippetSourcePaths = {};
+  Directory? _snippetSourceDirectory;
+  double _snippetSourceStartMs = 0;
+  double _snippetTempo = 1.0;
+  bool _snippetPreviewActive = false;
+  // Bumped per snippet request, so a render that finishes after a newer one
+  // was asked for is dropped.
+  int _snippetRequest = 0;
 
   double get _currentTempo =>
       _useManualSettings ? _manualTempo : _defaultTempoFactor;
@@ -997,7 +1015,9 @@ class _SlowReverbHomePageState extends State<SlowReverbHomePage> {
     });
     _loadPreferences();
     if (_supportsNativeRealtimePreview) {
+      _nativeAudio.prewarmEngines(1);
       _nativePreviewHandle = _nativeAudio.createHandle();
+      _nativeEventSub = _nativeAudio.events.listen(_onNativeEngineEvent);
     }
   }
 
@@ -1009,12 +1029,21 @@ class _SlowReverbHomePageState extends State<SlowReverbHomePage> {
     _previewDurationSub?.cancel();
     _previewPositionSub?.cancel();
     _previewUpdateTimer?.cancel();
-    _nativeProgressTimer?.cancel();
+    _nativeProgressTicker?.dispose();
+    _nativeEventSub?.cancel();
     unawaited(_previewPlayer.dispose());
     unawaited(_cleanupPreviewFiles());
+    final snippetSourceDir = _snippetSourceDirectory;
+    if (snippetSourceDir != null) {
+      unawaited(
+        snippetSourceDir
+            .delete(recursive: true)
+            .then((_) {}, onError: (_) {}),
+      );
+    }
     if (_supportsNativeRealtimePreview && _nativePreviewHandle != 0) {
-      _nativeAudio.stop(_nativePreviewHandle);
-      _nativeAudio.dispose(_nativePreviewHandle);
+      _nativeTelemetry = null;
+      unawaited(_nativeAudio.disposeAsync(_nativePreviewHandle));
       _nativePreviewHandle = 0;
     }
     super.dispose();
@@ -1048,6 +1077,7 @@ class _SlowReverbHomePageState extends State<SlowReverbHomePage> {
   }
 
   void _handlePreviewFinished() {
+    _snippetPreviewActive = false;
     unawaited(_cleanupPreviewFiles());
     _previewUpdateTimer?.cancel();
     if (!mounted) return;
@@ -1079,9 +1109,10 @@ class _SlowReverbHomePageState extends State<SlowReverbHomePage> {
 
   Future<void> _stopNativePreview() async {
     if (!_supportsNativeRealtimePreview) return;
-    _nativeProgressTimer?.cancel();
+    _nativeStartGeneration++;
+    _nativeProgressTicker?.stop();
     if (_nativePreviewHandle != 0) {
-      _nativeAudio.stop(_nativePreviewHandle);
+      unawaited(_nativeAudio.stopAsync(_nativePreviewHandle));
     }
     if (!mounted) return;
     setState(() {
@@ -1093,9 +1124,10 @@ class _SlowReverbHomePageState extends State<SlowReverbHomePage> {
 
   void _handleNativePreviewFinished() {
     if (!_supportsNativeRealtimePreview) return;
-    _nativeProgressTimer?.cancel();
+    _nativeStartGeneration++;
+    _nativeProgressTicker?.stop();
     if (_nativePreviewHandle != 0) {
-      _nativeAudio.stop(_nativePreviewHandle);
+      unawaited(_nativeAudio.stopAsync(_nativePreviewHandle));
     }
     if (!mounted) return;
     setState(() {
@@ -1106,30 +1138,39 @@ class _SlowReverbHomePageState extends State<SlowReverbHomePage> {
     });
   }
 
-  void _startNativeProgressTimer() {
+  void _onNativeEngineEvent(NativeEngineEvent event) {
+    if (event.type != NativeEngineEvent.ended ||
+        event.handle != _nativePreviewHandle ||
+        !_nativePreviewActive) {
+      return;
+    }
+    _handleNativePreviewFinished();
+  }
+
+  void _startNativeProgressTicker() {
     if (!_supportsNativeRealtimePreview || _nativePreviewHandle == 0) return;
-    _nativeProgressTimer?.cancel();
-    _nativeProgressTimer =
-        Timer.periodic(const Duration(milliseconds: 200), (_) {
-      if (!_nativePreviewActive || !mounted) return;
-      final positionMs =
-          _nativeAudio.positionMs(_nativePreviewHandle).round();
-      final durationMs =
-          _nativeAudio.durationMs(_nativePreviewHandle).round();
-      if (!mounted) return;
-      setState(() {
-        _previewPosition = Duration(milliseconds: positionMs);
-        if (durationMs > 0) {
-          _previewTotalDuration = Duration(milliseconds: durationMs);
-        }
-      });
-      final total = _previewTotalDuration;
-      final position = _previewPosition;
-      if (total != null &&
-          position != null &&
-          total.inMilliseconds > 0 &&
-          position >= total) {
-        _handleNativePreviewFinished();
+    _nativeTelemetry ??= _nativeAudio.telemetry(_nativePreviewHandle);
+    _lastNativeProgressStep = -1;
+    final ticker =
+        _nativeProgressTicker ??= createTicker(_onNativeProgressTick);
+    if (!ticker.isActive) ticker.start();
+  }
+
+  // Runs every frame: the telemetry is read from native memory without an
+  // FFI call, and the page only rebuilds when the position moves by 100 ms.
+  void _onNativeProgressTick(Duration _) {
+    if (!_nativePreviewActive || !mounted) return;
+    final telemetry = _nativeTelemetry?.read();
+    if (telemetry == null || telemetry.frames == 0) return;
+    final step = telemetry.positionMs ~/ 100;
+    if (step == _lastNativeProgressStep) return;
+    _lastNativeProgressStep = step;
+    final positionMs = telemetry.positionMs.round();
+    final durationMs = telemetry.durationMs.round();
+    setState(() {
+      _previewPosition = Duration(milliseconds: positionMs);
+      if (durationMs > 0) {
+        _previewTotalDuration = Duration(milliseconds: durationMs);
       }
     });
   }
@@ -1179,10 +1220,12 @@ class _SlowReverbHomePageState extends State<SlowReverbHomePage> {
       return;
     }
     await _stopNativePreview();
-    final startResult = _nativeAudio.start(
+    final generation = _nativeStartGeneration;
+    final startResult = await _nativeAudio.startAsync(
       _nativePreviewHandle,
       job.inputPath,
     );
+    if (generation != _nativeStartGeneration) return;
     if (startResult != 0) {
       if (!mounted) return;
       _showSnack(
@@ -1213,7 +1256,7 @@ class _SlowReverbHomePageState extends State<SlowReverbHomePage> {
       _isGeneratingPreview = false;
     });
     _applyNativeRealtimeParameters();
-    _startNativeProgressTimer();
+    _startNativeProgressTicker();
   }
 
   void _queuePreviewUpdate() {
@@ -1236,6 +1279,7 @@ class _SlowReverbHomePageState extends State<SlowReverbHomePage> {
     if (_isRealtimePreviewPlaying) {
       await _stopNativePreview();
     } else {
+      _snippetPreviewActive = false;
       await _previewPlayer.stop();
       await _previewPlayer.seek(Duration.zero);
       await _cleanupPreviewFiles();
@@ -1316,12 +1360,139 @@ class _SlowReverbHomePageState extends State<SlowReverbHomePage> {
       _showSnack(context.tr('preview.status.preparing'));
       return;
     }
+    if (_nativeAudio.isSnippetRenderAvailable) {
+      await _prepareSnippetPreview(
+        targetJob,
+        triggeredByLiveUpdate: triggeredByLiveUpdate,
+      );
+      return;
+    }
     await _preparePreview(
       targetJob,
       triggeredByLiveUpdate: triggeredByLiveUpdate,
     );
   }
 
+  /// Returns a WAV copy of [job] that the native renderer can read. WAV
+  /// inputs are used as-is; other formats are transcoded once per file so
+  /// later parameter changes only cost a native render.
+  Future<String?> _snippetSourceFor(AudioJob job) async {
+    if (p.extension(job.inputPath).toLowerCase() == '.wav') {
+      return job.inputPath;
+    }
+    final cached = _snippetSourcePaths[job.inputPath];
+    if (cached != null && await File(cached).exists()) return cached;
+    final ffmpegPath = _ffmpegPath;
+    if (ffmpegPath == null || !await File(ffmpegPath).exists()) return null;
+    final dir = _snippetSourceDirectory ??=
+        await Directory.systemTemp.createTemp('slowreverb_source_');
+    final target = p.join(
+      dir.path,
+      '${_snippetSourcePaths.length}_${p.basenameWithoutExtension(job.fileName)}.wav',
+    );
+    final result = await _executeFfmpegOnce(ffmpegPath, [
+      '-y',
+      '-i',
+      job.inputPath,
+      '-vn',
+      '-acodec',
+      'pcm_s16le',
+      target,
+    ]);
+    if ((result['exitCode'] as int? ?? -1) != 0) return null;
+    _snippetSourcePaths[job.inputPath] = target;
+    return target;
+  }
+
+  Future<void> _prepareSnippetPreview(
+    AudioJob job, {
+    bool triggeredByLiveUpdate = false,
+  }) async {
+    if (!mounted) return;
+    _previewUpdateTimer?.cancel();
+    final request = ++_snippetRequest;
+    setState(() {
+      _isGeneratingPreview = true;
+      _previewStatusMessage = triggeredByLiveUpdate
+          ? 'Memperbarui preview ${job.fileName}...'
+          : 'Menyiapkan preview untuk ${job.fileName}...';
+      _previewingJob = job;
+    });
+    // Resume from the source position the previous snippet had reached.
+    var startMs = 0.0;
+    if (triggeredByLiveUpdate && _snippetPreviewActive) {
+      startMs = _snippetSourceStartMs +
+          _previewPlayer.position.inMilliseconds * _snippetTempo;
+    }
+    await _previewPlayer.stop();
+    await _cleanupPreviewFiles();
+    var fallBackToFfmpeg = false;
+    try {
+      final source = await _snippetSourceFor(job);
+      final tempo = _currentTempo.clamp(0.5, 1.5);
+      final rendered = source == null
+          ? null
+          : await _renderSnippetWav(
+              source,
+              startMs: startMs,
+              tempo: tempo,
+              pitchSemi: _ratioToSemitone(_pitchFactorForTempo(tempo)),
+              wet: _wetMix,
+              decay: _decayTimeSeconds,
+              tone: _toneBalance,
+              room: _roomSize,
+              echoMs: _echoBeforeReverbMs,
+            );
+      if (request != _snippetRequest) return;
+      if (rendered == null) {
+        fallBackToFfmpeg = true;
+      } else {
+        _snippetSourceStartMs = rendered.startMs;
+        _snippetTempo = tempo;
+        _snippetPreviewActive = true;
+        await _previewPlayer.setAudioSource(
+          _SnippetAudioSource(rendered.wav),
+        );
+        unawaited(_previewPlayer.play());
+        if (!mounted) return;
+        setState(() {
+          _previewStatusMessage = triggeredByLiveUpdate
+              ? context.tr('preview.status.updatedLive')
+              : context.tr(
+                  'preview.status.rendered',
+                  params: {'file': job.fileName},
+                );
+          _previewTotalDuration = rendered.duration;
+          _previewPosition = Duration.zero;
+        });
+      }
+    } catch (error) {
+      _snippetPreviewActive = false;
+      if (!mounted) return;
+      setState(() {
+        _previewingJob = null;
+        _previewStatusMessage =
+            context.tr('preview.status.error', params: {'error': '$error'});
+      });
+      _showSnack(
+        context.tr('preview.status.error', params: {'error': '$error'}),
+      );
+    } finally {
+      if (mounted && request == _snippetRequest) {
+        setState(() {
+          _isGeneratingPreview = false;
+        });
+      }
+    }
+    if (fallBackToFfmpeg) {
+      _snippetPreviewActive = false;
+      await _preparePreview(
+        job,
+        triggeredByLiveUpdate: triggeredByLiveUpdate,
+      );
+    }
+  }
+
   Future<void> _preparePreview(
     AudioJob job, {
     bool triggeredByLiveUpdate = false,
@@ -2989,6 +3160,112 @@ Future<Map<String, Object?>> _executeFfmpegOnce(
   };
 }
 
+const _snippetPreviewLength = Duration(seconds: 30);
+
+/// A rendered snippet packed as WAV, and where in the source it starts.
+typedef _SnippetWav = ({Uint8List wav, Duration duration, double startMs});
+
+/// Renders [_snippetPreviewLength] of [source] from [startMs], or from the
+/// start when nothing is left past it, and packs it as WAV on a short-lived
+/// isolate: an uncached render takes well over a frame. Null when the
+/// native renderer cannot decode the file. A top-level function, so the
+/// isolate's closure captures only these arguments.
+Future<_SnippetWav?> _renderSnippetWav(
+  String source, {
+  required double startMs,
+  required double tempo,
+  required double pitchSemi,
+  required double wet,
+  required double decay,
+  required double tone,
+  required double room,
+  required double echoMs,
+}) {
+  return Isolate.run(() {
+    final bridge = NativeAudioBridge.instance;
+    RenderedSnippet? render(double fromMs) => bridge.renderSnippet(
+          source,
+          startMs: fromMs,
+          lengthMs: _snippetPreviewLength.inMilliseconds.toDouble(),
+          tempo: tempo,
+          pitchSemi: pitchSemi,
+          wet: wet,
+          decay: decay,
+          tone: tone,
+          room: room,
+          echoMs: echoMs,
+        );
+    var fromMs = startMs;
+    var snippet = render(fromMs);
+    if (snippet != null && snippet.audibleFrames == 0 && fromMs > 0) {
+      fromMs = 0;
+      snippet = render(fromMs);
+    }
+    if (snippet == null || snippet.audibleFrames == 0) return null;
+    return (
+      wav: _encodeSnippetWav(snippet),
+      duration: snippet.audibleDuration,
+      startMs: fromMs,
+    );
+  });
+}
+
+/// Packs a rendered snippet into a 16-bit PCM WAV held in memory.
+Uint8List _encodeSnippetWav(RenderedSnippet snippet) {
+  final samples = snippet.audibleFrames * snippet.channels;
+  final dataBytes = samples * 2;
+  final bytes = ByteData(44 + dataBytes);
+  void writeTag(int offset, String tag) {
+    for (var i = 0; i < 4; i++) {
+      bytes.setUint8(offset + i, tag.codeUnitAt(i));
+    }
+  }
+
+  writeTag(0, 'RIFF');
+  bytes.setUint32(4, 36 + dataBytes, Endian.little);
+  writeTag(8, 'WAVE');
+  writeTag(12, 'fmt ');
+  bytes.setUint32(16, 16, Endian.little);
+  bytes.setUint16(20, 1, Endian.little);
+  bytes.setUint16(22, snippet.channels, Endian.little);
+  bytes.setUint32(24, snippet.sampleRate, Endian.little);
+  bytes.setUint32(
+    28,
+    snippet.sampleRate * snippet.channels * 2,
+    Endian.little,
+  );
+  bytes.setUint16(32, snippet.channels * 2, Endian.little);
+  bytes.setUint16(34, 16, Endian.little);
+  writeTag(36, 'data');
+  bytes.setUint32(40, dataBytes, Endian.little);
+  final source = snippet.samples;
+  for (var i = 0; i < samples; i++) {
+    final value = (source[i].clamp(-1.0, 1.0) * 32767).round();
+    bytes.setInt16(44 + i * 2, value, Endian.little);
+  }
+  return bytes.buffer.asUint8List();
+}
+
+/// Serves an in-memory WAV to just_audio without touching the disk.
+class _SnippetAudioSource extends StreamAudioSource {
+  _SnippetAudioSource(this._bytes);
+
+  final Uint8List _bytes;
+
+  @override
+  Future<StreamAudioResponse> request([int? start, int? end]) async {
+    final from = start ?? 0;
+    final to = end ?? _bytes.length;
+    return StreamAudioResponse(
+      sourceLength: _bytes.length,
+      contentLength: to - from,
+      offset: from,
+      stream: Stream.value(_bytes.sublist(from, to)),
+      contentType: 'audio/wav',
+    );
+  }
+}
+
 enum ReverbPreset { chill, sad, dreamy, vocal, extreme }
 
 class _ReverbPresetConfig {
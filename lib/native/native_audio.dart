@@ -1,13 +1,13 @@
+import 'dart:async';
+import 'dart:collection';
 import 'dart:ffi' as ffi;
 import 'dart:io';
+import 'dart:typed_data';
 
 import 'package:ffi/ffi.dart';
 
 class NativeAudioBridge {
-  NativeAudioBridge._()
-      : _lib = Platform.isAndroid
-            ? ffi.DynamicLibrary.open('libslowreverb_native.so')
-            : null {
+  NativeAudioBridge._() : _lib = _openLibrary() {
     final lib = _lib;
     if (Platform.isAndroid && lib != null) {
       _create = lib.lookupFunction<_CreateNative, _CreateFn>(
@@ -22,6 +22,55 @@ class NativeAudioBridge {
       _stop = lib.lookupFunction<_VoidHandleNative, _VoidHandleFn>(
         'slowreverb_engine_stop',
       );
+      _startAsync = lib.lookupFunction<_StartAsyncNative, _StartAsyncFn>(
+        'slowreverb_engine_start_async',
+      );
+      _stopAsync = lib.lookupFunction<_VoidHandleNative, _VoidHandleFn>(
+        'slowreverb_engine_stop_async',
+      );
+      _disposeAsync = lib.lookupFunction<_VoidHandleNative, _VoidHandleFn>(
+        'slowreverb_engine_dispose_async',
+      );
+      _setEventCallback =
+          lib.lookupFunction<_SetEventCallbackNative, _SetEventCallbackFn>(
+        'slowreverb_set_event_callback',
+      );
+      _setPinning = lib.lookupFunction<_SetFlagNative, _SetFlagFn>(
+        'slowreverb_set_pin_to_performance_cores',
+      );
+      _writeTrace = lib.lookupFunction<_WriteTraceNative, _WriteTraceFn>(
+        'slowreverb_trace_write',
+      );
+      _seek = lib.lookupFunction<_DoubleSetterNative, _DoubleSetter>(
+        'slowreverb_engine_seek',
+      );
+      _setPreroll = lib.lookupFunction<_DoubleSetterNative, _DoubleSetter>(
+        'slowreverb_engine_set_preroll_ms',
+      );
+      _poolPrewarm = lib.lookupFunction<_PoolPrewarmNative, _PoolPrewarmFn>(
+        'slowreverb_engine_pool_prewarm',
+      );
+      _enqueue = lib.lookupFunction<_StartNative, _StartFn>(
+        'slowreverb_engine_enqueue',
+      );
+      _clearQueue = lib.lookupFunction<_VoidHandleNative, _VoidHandleFn>(
+        'slowreverb_engine_clear_queue',
+      );
+      _setCrossfade = lib.lookupFunction<_DoubleSetterNative, _DoubleSetter>(
+        'slowreverb_engine_set_crossfade_ms',
+      );
+      _getTrackIndex = lib.lookupFunction<_GetIntNative, _GetInt>(
+        'slowreverb_engine_get_track_index',
+      );
+      _setCompare = lib.lookupFunction<_SetCompareNative, _SetCompareFn>(
+        'slowreverb_engine_set_compare',
+      );
+      _setMonitor = lib.lookupFunction<_SetMonitorNative, _SetMonitorFn>(
+        'slowreverb_engine_set_monitor',
+      );
+      _setImpulse = lib.lookupFunction<_StartNative, _StartFn>(
+        'slowreverb_engine_set_impulse_response',
+      );
       _setTempo = lib.lookupFunction<_DoubleSetterNative, _DoubleSetter>(
         'slowreverb_engine_set_tempo',
       );
@@ -34,39 +83,224 @@ class NativeAudioBridge {
       _setReverb = lib.lookupFunction<_ReverbSetterNative, _ReverbSetter>(
         'slowreverb_engine_set_reverb',
       );
+      _setWidth = lib.lookupFunction<_DoubleSetterNative, _DoubleSetter>(
+        'slowreverb_engine_set_width',
+      );
+      _setStretchMode = lib.lookupFunction<_IntSetterNative, _IntSetter>(
+        'slowreverb_engine_set_stretch_mode',
+      );
+      _setQualityTier = lib.lookupFunction<_IntSetterNative, _IntSetter>(
+        'slowreverb_engine_set_quality_tier',
+      );
+      _getQualityTier = lib.lookupFunction<_GetIntNative, _GetInt>(
+        'slowreverb_engine_get_quality_tier',
+      );
+      _setMemoryBudget = lib.lookupFunction<_IntSetter64Native, _IntSetter>(
+        'slowreverb_engine_set_memory_budget',
+      );
+      _setRingFormat = lib.lookupFunction<_IntSetterNative, _IntSetter>(
+        'slowreverb_engine_set_ring_format',
+      );
+      _getMemory = lib.lookupFunction<_GetMemoryNative, _GetMemoryFn>(
+        'slowreverb_engine_get_memory',
+      );
       _getPosition = lib.lookupFunction<_GetDoubleNative, _GetDouble>(
         'slowreverb_engine_get_position_ms',
       );
       _getDuration = lib.lookupFunction<_GetDoubleNative, _GetDouble>(
         'slowreverb_engine_get_duration_ms',
       );
+      _getTelemetry = lib.lookupFunction<_GetTelemetryNative, _GetTelemetryFn>(
+        'slowreverb_engine_get_telemetry',
+      );
+      _getStats = lib.lookupFunction<_GetStatsNative, _GetStatsFn>(
+        'slowreverb_engine_get_stats',
+      );
+      _resetStats = lib.lookupFunction<_VoidHandleNative, _VoidHandleFn>(
+        'slowreverb_engine_reset_stats',
+      );
     } else {
       _create = null;
       _dispose = null;
       _start = null;
       _stop = null;
+      _startAsync = null;
+      _stopAsync = null;
+      _disposeAsync = null;
+      _setEventCallback = null;
+      _setPinning = null;
+      _writeTrace = null;
+      _seek = null;
+      _setPreroll = null;
+      _poolPrewarm = null;
+      _enqueue = null;
+      _clearQueue = null;
+      _setCrossfade = null;
+      _getTrackIndex = null;
+      _setCompare = null;
+      _setMonitor = null;
+      _setImpulse = null;
       _setTempo = null;
       _setPitch = null;
       _setMix = null;
       _setReverb = null;
+      _setWidth = null;
+      _setStretchMode = null;
+      _setQualityTier = null;
+      _getQualityTier = null;
+      _setMemoryBudget = null;
+      _setRingFormat = null;
+      _getMemory = null;
       _getPosition = null;
       _getDuration = null;
+      _getTelemetry = null;
+      _getStats = null;
+      _resetStats = null;
+    }
+    if (lib != null) {
+      _renderSnippet = lib.lookupFunction<_RenderSnippetNative, _RenderSnippetFn>(
+        'slowreverb_render_snippet',
+      );
+      _clearRenderCache = lib.lookupFunction<_VoidNative, _VoidFn>(
+        'slowreverb_render_clear_cache',
+      );
+      _renderOpenFile =
+          lib.lookupFunction<_RenderOpenFileNative, _RenderOpenFileFn>(
+        'slowreverb_render_open_file',
+      );
+      _renderOpenPcm =
+          lib.lookupFunction<_RenderOpenPcmNative, _RenderOpenPcmFn>(
+        'slowreverb_render_open_pcm',
+      );
+      _renderFeed = lib.lookupFunction<_RenderFeedNative, _RenderFeedFn>(
+        'slowreverb_render_feed',
+        isLeaf: true,
+      );
+      // Not a leaf call: a pull can configure the chain, decode inline or
+      // wait for the decode thread, and a leaf call would hold up garbage
+      // collection for every isolate meanwhile.
+      _renderPull = lib.lookupFunction<_RenderPullNative, _RenderPullFn>(
+        'slowreverb_render_pull',
+      );
+      _renderEndInput = lib.lookupFunction<_VoidHandleNative, _VoidHandleFn>(
+        'slowreverb_render_end_input',
+      );
+      _renderFinished = lib.lookupFunction<_GetIntNative, _GetInt>(
+        'slowreverb_render_finished',
+      );
+      _renderSetParams =
+          lib.lookupFunction<_RenderSetParamsNative, _RenderSetParamsFn>(
+        'slowreverb_render_set_params',
+      );
+      _renderSetImpulse = lib.lookupFunction<_StartNative, _StartFn>(
+        'slowreverb_render_set_impulse',
+      );
+      _renderGetFormat =
+          lib.lookupFunction<_RenderGetFormatNative, _RenderGetFormatFn>(
+        'slowreverb_render_get_format',
+      );
+      _renderClose = lib.lookupFunction<_VoidHandleNative, _VoidHandleFn>(
+        'slowreverb_render_close',
+      );
+    } else {
+      _renderSnippet = null;
+      _clearRenderCache = null;
+      _renderOpenFile = null;
+      _renderOpenPcm = null;
+      _renderFeed = null;
+      _renderPull = null;
+      _renderEndInput = null;
+      _renderFinished = null;
+      _renderSetParams = null;
+      _renderSetImpulse = null;
+      _renderGetFormat = null;
+      _renderClose = null;
     }
   }
 
+  static ffi.DynamicLibrary? _openLibrary() {
+    if (Platform.isAndroid) {
+      return ffi.DynamicLibrary.open('libslowreverb_native.so');
+    }
+    try {
+      if (Platform.isLinux) {
+        return ffi.DynamicLibrary.open('libslowreverb_native.so');
+      }
+      if (Platform.isWindows) {
+        return ffi.DynamicLibrary.open('slowreverb_native.dll');
+      }
+    } on ArgumentError {
+      return null;
+    }
+    return null;
+  }
+
   static final NativeAudioBridge instance = NativeAudioBridge._();
 
+  /// Stretch modes, mirroring StretchMode in processing_chain.h.
+  static const int stretchSoundTouch = 0;
+  static const int stretchPhaseVocoder = 1;
+
+  /// Quality tiers, mirroring ProcessingChain::kQualityTiers: 0 is the
+  /// cheapest, [qualityTierCount] - 1 the best. [qualityAuto] lets the
+  /// engine pick by load.
+  static const int qualityAuto = -1;
+  static const int qualityTierCount = 4;
+
+  /// Decode ring storage, mirroring RingSampleFormat in decode_ring.h.
+  static const int ringFloat32 = 0;
+  static const int ringInt16 = 1;
+  static const int ringFloat16 = 2;
+
   final ffi.DynamicLibrary? _lib;
   late final _CreateFn? _create;
   late final _VoidHandleFn? _dispose;
   late final _StartFn? _start;
   late final _VoidHandleFn? _stop;
+  late final _StartAsyncFn? _startAsync;
+  late final _VoidHandleFn? _stopAsync;
+  late final _VoidHandleFn? _disposeAsync;
+  late final _SetEventCallbackFn? _setEventCallback;
+  late final _SetFlagFn? _setPinning;
+  late final _WriteTraceFn? _writeTrace;
+  late final _DoubleSetter? _seek;
+  late final _DoubleSetter? _setPreroll;
+  late final _PoolPrewarmFn? _poolPrewarm;
+  late final _StartFn? _enqueue;
+  late final _VoidHandleFn? _clearQueue;
+  late final _DoubleSetter? _setCrossfade;
+  late final _GetInt? _getTrackIndex;
+  late final _SetCompareFn? _setCompare;
+  late final _SetMonitorFn? _setMonitor;
+  late final _StartFn? _setImpulse;
   late final _DoubleSetter? _setTempo;
   late final _DoubleSetter? _setPitch;
   late final _DoubleSetter? _setMix;
   late final _ReverbSetter? _setReverb;
+  late final _DoubleSetter? _setWidth;
+  late final _IntSetter? _setStretchMode;
+  late final _IntSetter? _setQualityTier;
+  late final _GetInt? _getQualityTier;
+  late final _IntSetter? _setMemoryBudget;
+  late final _IntSetter? _setRingFormat;
+  late final _GetMemoryFn? _getMemory;
   late final _GetDouble? _getPosition;
   late final _GetDouble? _getDuration;
+  late final _GetTelemetryFn? _getTelemetry;
+  late final _GetStatsFn? _getStats;
+  late final _VoidHandleFn? _resetStats;
+  late final _RenderSnippetFn? _renderSnippet;
+  late final _VoidFn? _clearRenderCache;
+  late final _RenderOpenFileFn? _renderOpenFile;
+  late final _RenderOpenPcmFn? _renderOpenPcm;
+  late final _RenderFeedFn? _renderFeed;
+  late final _RenderPullFn? _renderPull;
+  late final _VoidHandleFn? _renderEndInput;
+  late final _GetInt? _renderFinished;
+  late final _RenderSetParamsFn? _renderSetParams;
+  late final _StartFn? _renderSetImpulse;
+  late final _RenderGetFormatFn? _renderGetFormat;
+  late final _VoidHandleFn? _renderClose;
 
   bool get isAvailable =>
       _lib != null &&
@@ -81,6 +315,34 @@ class NativeAudioBridge {
       _getPosition != null &&
       _getDuration != null;
 
+  /// Builds up to [count] idle engines sized for the given source format so
+  /// that [createHandle] hands out a ready one. Returns the idle count.
+  int prewarmEngines(int count, {int sampleRate = 44100, int channels = 2}) {
+    if (!isAvailable || _poolPrewarm == null) return 0;
+    return _poolPrewarm!(count, sampleRate, channels);
+  }
+
+  /// Pins decoding, the convolution reverb's worker and offline rendering
+  /// threads started from now on to the performance cores, on devices with
+  /// big and little ones. Process-wide and off by default; see
+  /// [EngineStats.performanceCores].
+  void setPinToPerformanceCores(bool enabled) {
+    if (_setPinning == null) return;
+    _setPinning!(enabled ? 1 : 0);
+  }
+
+  /// Writes the native trace scopes recorded so far to [path] as Chrome
+  /// trace JSON, for chrome://tracing or ui.perfetto.dev. Only libraries
+  /// configured with SLOWREVERB_TRACE record them; on Android they go to the
+  /// system trace instead. Returns false when nothing was written.
+  bool writeTrace(String path) {
+    if (_writeTrace == null) return false;
+    final ptr = path.toNativeUtf8();
+    final result = _writeTrace!(ptr.cast());
+    calloc.free(ptr);
+    return result == 0;
+  }
+
   int createHandle() {
     if (!isAvailable) return 0;
     return _create!();
@@ -104,6 +366,169 @@ class NativeAudioBridge {
     _stop!(handle);
   }
 
+  bool get supportsAsyncLifecycle =>
+      isAvailable &&
+      _startAsync != null &&
+      _stopAsync != null &&
+      _disposeAsync != null &&
+      _setEventCallback != null;
+
+  /// Lifecycle events from every engine, delivered on this isolate's event
+  /// loop. Includes [NativeEngineEvent.ended] when a track plays out.
+  Stream<NativeEngineEvent> get events {
+    _listenForEvents();
+    return _events.stream;
+  }
+
+  /// Like [start], but the decoder and stream open on a native worker
+  /// thread. Completes with the same result codes.
+  Future<int> startAsync(int handle, String path) {
+    if (!supportsAsyncLifecycle || handle == 0) {
+      return Future.value(start(handle, path));
+    }
+    _listenForEvents();
+    final completer = _enqueuePending(handle);
+    final ptr = path.toNativeUtf8();
+    // The native side copies the path before returning.
+    _startAsync!(handle, ptr.cast());
+    calloc.free(ptr);
+    return completer.future;
+  }
+
+  /// Like [stop], with the stream torn down on the native worker thread.
+  Future<void> stopAsync(int handle) {
+    if (!supportsAsyncLifecycle || handle == 0) {
+      stop(handle);
+      return Future.value();
+    }
+    _listenForEvents();
+    final completer = _enqueuePending(handle);
+    _stopAsync!(handle);
+    return completer.future;
+  }
+
+  /// Like [dispose]; the handle is invalid once the future completes.
+  Future<void> disposeAsync(int handle) {
+    if (!supportsAsyncLifecycle || handle == 0) {
+      dispose(handle);
+      return Future.value();
+    }
+    _listenForEvents();
+    final completer = _enqueuePending(handle);
+    _disposeAsync!(handle);
+    return completer.future;
+  }
+
+  final StreamController<NativeEngineEvent> _events =
+      StreamController<NativeEngineEvent>.broadcast();
+  // Async calls per handle in the order they were made; the native worker
+  // runs them, and reports them, in that order.
+  final Map<int, Queue<Completer<int>>> _pending = {};
+  ffi.NativeCallable<_EventCallbackNative>? _eventCallback;
+
+  void _listenForEvents() {
+    if (_eventCallback != null || !supportsAsyncLifecycle) return;
+    // A listener callable posts each call to this isolate's port, so the
+    // worker and decoder threads never wait on Dart.
+    final callable = ffi.NativeCallable<_EventCallbackNative>.listener(
+      _onEvent,
+    )..keepIsolateAlive = false;
+    _eventCallback = callable;
+    _setEventCallback!(callable.nativeFunction);
+  }
+
+  Completer<int> _enqueuePending(int handle) {
+    final completer = Completer<int>();
+    _pending.putIfAbsent(handle, Queue.new).add(completer);
+    return completer;
+  }
+
+  void _onEvent(int handle, int type, int code) {
+    if (type != NativeEngineEvent.ended) {
+      final queue = _pending[handle];
+      if (queue != null && queue.isNotEmpty) {
+        queue.removeFirst().complete(code);
+        if (queue.isEmpty) _pending.remove(handle);
+      }
+    }
+    _events.add(NativeEngineEvent(handle: handle, type: type, code: code));
+  }
+
+  /// Moves playback to [positionMs] in the source; applied asynchronously.
+  void seek(int handle, double positionMs) {
+    if (!isAvailable || _seek == null || handle == 0) return;
+    _seek!(handle, positionMs);
+  }
+
+  /// Audio decoded and processed before output starts; applies from the
+  /// next [start].
+  void setPreroll(int handle, double prerollMs) {
+    if (!isAvailable || _setPreroll == null || handle == 0) return;
+    _setPreroll!(handle, prerollMs);
+  }
+
+  /// Queues [path] to play after the current track without a gap (or with
+  /// the crossfade set by [setCrossfade]). [start] and [stop] empty the
+  /// queue, so enqueue after starting the first track.
+  int enqueue(int handle, String path) {
+    if (!isAvailable || _enqueue == null || handle == 0) return -1;
+    final ptr = path.toNativeUtf8();
+    final result = _enqueue!(handle, ptr.cast());
+    calloc.free(ptr);
+    return result;
+  }
+
+  /// Drops queued tracks that have not started decoding yet.
+  void clearQueue(int handle) {
+    if (!isAvailable || _clearQueue == null || handle == 0) return;
+    _clearQueue!(handle);
+  }
+
+  /// Equal-power crossfade between queued tracks, up to 1500 ms; 0 joins
+  /// them gaplessly.
+  void setCrossfade(int handle, double crossfadeMs) {
+    if (!isAvailable || _setCrossfade == null || handle == 0) return;
+    _setCrossfade!(handle, crossfadeMs);
+  }
+
+  /// 0 while the track passed to [start] plays, then one more per queued
+  /// track reached.
+  int trackIndex(int handle) {
+    if (!isAvailable || _getTrackIndex == null || handle == 0) return -1;
+    return _getTrackIndex!(handle);
+  }
+
+  /// Runs an unprocessed branch next to the processed one for A/B
+  /// comparison, at the processed tempo when [tempoMatched] is true or at
+  /// the original tempo otherwise. Enable before switching with [setMonitor].
+  void setCompare(
+    int handle, {
+    required bool enabled,
+    bool tempoMatched = true,
+  }) {
+    if (!isAvailable || _setCompare == null || handle == 0) return;
+    _setCompare!(handle, enabled ? 1 : 0, tempoMatched ? 1 : 0);
+  }
+
+  /// Hears the original ([dry] true) or the processed signal, switching at
+  /// the next audio buffer or crossfading over [fadeMs].
+  void setMonitor(int handle, {required bool dry, double fadeMs = 0}) {
+    if (!isAvailable || _setMonitor == null || handle == 0) return;
+    _setMonitor!(handle, dry ? 1 : 0, fadeMs);
+  }
+
+  /// Replaces the built-in reverb with convolution by the impulse response
+  /// WAV at [path], or switches back when [path] is empty. Only wet and tone
+  /// apply to convolution. Decodes the file on the calling thread; returns
+  /// 0 on success and -2 if the file cannot be read.
+  int setImpulseResponse(int handle, String path) {
+    if (!isAvailable || _setImpulse == null || handle == 0) return -1;
+    final ptr = path.toNativeUtf8();
+    final result = _setImpulse!(handle, ptr.cast());
+    calloc.free(ptr);
+    return result;
+  }
+
   void setTempo(int handle, double tempo) {
     if (!isAvailable || handle == 0) return;
     _setTempo!(handle, tempo);
@@ -130,6 +555,75 @@ class NativeAudioBridge {
     _setReverb!(handle, decay, tone, room, echoMs);
   }
 
+  /// Stereo spread of the built-in reverb: 0 keeps the wet signal mono, 1
+  /// (the default) gives each channel its own decorrelated reverb.
+  void setWidth(int handle, double width) {
+    if (!isAvailable || _setWidth == null || handle == 0) return;
+    _setWidth!(handle, width);
+  }
+
+  /// Time stretcher used from the next [start]: [stretchSoundTouch] or
+  /// [stretchPhaseVocoder], which also allows tempos down to 0.25.
+  void setStretchMode(int handle, int mode) {
+    if (!isAvailable || _setStretchMode == null || handle == 0) return;
+    _setStretchMode!(handle, mode);
+  }
+
+  /// Holds the engine at a quality tier, or with [qualityAuto] (the
+  /// default) lets it step down when callbacks run short of time and back
+  /// up when there is headroom.
+  void setQualityTier(int handle, int tier) {
+    if (!isAvailable || _setQualityTier == null || handle == 0) return;
+    _setQualityTier!(handle, tier);
+  }
+
+  /// The tier the engine is running at, -1 when unknown.
+  int qualityTier(int handle) {
+    if (!isAvailable || _getQualityTier == null || handle == 0) return -1;
+    return _getQualityTier!(handle);
+  }
+
+  /// Caps the engine's buffers at [bytes], 0 for no cap. The decode rings
+  /// give way first: they shrink towards the crossfade and pre-roll they
+  /// must hold, and a float ring switches to [ringFloat16]. Applies from the
+  /// next track or [start].
+  void setMemoryBudget(int handle, int bytes) {
+    if (!isAvailable || _setMemoryBudget == null || handle == 0) return;
+    _setMemoryBudget!(handle, bytes);
+  }
+
+  /// Decode ring storage from the next track or [start]: [ringFloat32] (the
+  /// default), [ringInt16] or [ringFloat16], both of which halve it.
+  void setRingFormat(int handle, int format) {
+    if (!isAvailable || _setRingFormat == null || handle == 0) return;
+    _setRingFormat!(handle, format);
+  }
+
+  /// What the engine's buffers hold; null when the engine is unavailable.
+  EngineMemory? engineMemory(int handle) {
+    if (!isAvailable || _getMemory == null || handle == 0) return null;
+    final raw = calloc<NativeEngineMemory>();
+    try {
+      if (_getMemory!(handle, raw) != 0) return null;
+      final m = raw.ref;
+      return EngineMemory(
+        budgetBytes: m.budgetBytes,
+        ringBytes: m.ringBytes,
+        chainBytes: m.chainBytes,
+        totalBytes: m.totalBytes,
+        ringMs: m.ringMs,
+        decodeSpeed: m.decodeSpeed,
+        ringFrames: m.ringFrames,
+        ringFormat: m.ringFormat,
+        arenaBytes: m.arenaBytes,
+        arenaPeakBytes: m.arenaPeakBytes,
+        arenaOverflows: m.arenaOverflows,
+      );
+    } finally {
+      calloc.free(raw);
+    }
+  }
+
   double positionMs(int handle) {
     if (!isAvailable || handle == 0) return 0;
     return _getPosition!(handle);
@@ -139,6 +633,668 @@ class NativeAudioBridge {
     if (!isAvailable || handle == 0) return 0;
     return _getDuration!(handle);
   }
+
+  /// Reads the position, output meters and spectrum the engine publishes
+  /// from its audio callback, straight from native memory. Drop the reader
+  /// when the handle is disposed: pooled engines are reused, so it would go
+  /// on reading whichever handle gets the engine next. Null when the engine
+  /// is unavailable.
+  TelemetryReader? telemetry(int handle) {
+    if (!isAvailable || _getTelemetry == null || handle == 0) return null;
+    final block = _getTelemetry!(handle);
+    if (block == ffi.nullptr) return null;
+    return TelemetryReader._(block);
+  }
+
+  /// Callback timing, underflow and buffer-fill counters since the engine
+  /// started (or since [resetEngineStats]).
+  EngineStats? engineStats(int handle) {
+    if (!isAvailable || _getStats == null || handle == 0) return null;
+    final raw = calloc<NativeEngineStats>();
+    try {
+      if (_getStats!(handle, raw) != 0) return null;
+      final s = raw.ref;
+      return EngineStats(
+        callbacks: s.callbacks,
+        framesRendered: s.framesRendered,
+        framesZeroFilled: s.framesZeroFilled,
+        underflowCallbacks: s.underflowCallbacks,
+        xrunCount: s.xrunCount,
+        framesPerBurst: s.framesPerBurst,
+        sampleRate: s.sampleRate,
+        ringFillFrames: s.ringFillFrames,
+        ringMinFillFrames: s.ringMinFillFrames,
+        ringCapacityFrames: s.ringCapacityFrames,
+        stretchBacklogFrames: s.stretchBacklogFrames,
+        qualityTier: s.qualityTier,
+        callbackP50Us: s.callbackP50Us,
+        callbackP99Us: s.callbackP99Us,
+        callbackMaxUs: s.callbackMaxUs,
+        budgetAverage: s.budgetAverage,
+        budgetMax: s.budgetMax,
+        startMs: s.startMs,
+        firstAudioMs: s.firstAudioMs,
+        framesBypassed: s.framesBypassed,
+        streamRecoveries: s.streamRecoveries,
+        recoveryMs: s.recoveryMs,
+        performanceCores: s.performanceCores,
+        decodeNice: s.decodeNice,
+        decodePrioritized: s.decodePrioritized != 0,
+        decodePinned: s.decodePinned != 0,
+        pinToPerformanceCores: s.pinToPerformanceCores != 0,
+      );
+    } finally {
+      calloc.free(raw);
+    }
+  }
+
+  void resetEngineStats(int handle) {
+    if (!isAvailable || _resetStats == null || handle == 0) return;
+    _resetStats!(handle);
+  }
+
+  bool get isSnippetRenderAvailable =>
+      _lib != null && _renderSnippet != null && _clearRenderCache != null;
+
+  /// Renders [lengthMs] of processed audio starting at [startMs] of the
+  /// source file entirely in native memory. Returns null when the file cannot
+  /// be decoded natively (the desktop build only reads WAV).
+  RenderedSnippet? renderSnippet(
+    String path, {
+    required double startMs,
+    required double lengthMs,
+    required double tempo,
+    required double pitchSemi,
+    required double wet,
+    required double decay,
+    required double tone,
+    required double room,
+    required double echoMs,
+    double width = 1.0,
+    int stretchMode = stretchSoundTouch,
+    int sampleRate = 48000,
+    int channels = 2,
+  }) {
+    if (!isSnippetRenderAvailable) return null;
+    final frames = (lengthMs * sampleRate / 1000).round();
+    if (frames <= 0) return null;
+    final params = calloc<RenderParams>();
+    final pathPtr = path.toNativeUtf8();
+    final out = malloc<ffi.Float>(frames * channels);
+    try {
+      params.ref
+        ..tempo = tempo
+        ..pitchSemitones = pitchSemi
+        ..wet = wet
+        ..decay = decay
+        ..tone = tone
+        ..room = room
+        ..echoMs = echoMs
+        ..sampleRate = sampleRate
+        ..channels = channels
+        ..width = width
+        ..stretchMode = stretchMode;
+      final audible =
+          _renderSnippet!(pathPtr.cast(), startMs, lengthMs, params, out, frames);
+      if (audible < 0) {
+        malloc.free(out);
+        return null;
+      }
+      return RenderedSnippet(
+        samples: out.asTypedList(
+          frames * channels,
+          finalizer: malloc.nativeFree,
+        ),
+        audibleFrames: audible,
+        sampleRate: sampleRate,
+        channels: channels,
+      );
+    } finally {
+      calloc.free(params);
+      calloc.free(pathPtr);
+    }
+  }
+
+  void clearSnippetCache() {
+    if (!isSnippetRenderAvailable) return;
+    _clearRenderCache!();
+  }
+
+  bool get isRenderStreamAvailable => _lib != null && _renderPull != null;
+
+  /// Opens a pull-driven render of [path]. Output keeps the source channel
+  /// count; [outputSampleRate] of 0 keeps the source rate. Without
+  /// [useDecodeThread], decoding happens inside [renderPull].
+  int openRenderFile(
+    String path, {
+    int outputSampleRate = 0,
+    bool useDecodeThread = false,
+  }) {
+    if (!isRenderStreamAvailable) return 0;
+    final ptr = path.toNativeUtf8();
+    final handle = _renderOpenFile!(
+      ptr.cast(),
+      outputSampleRate,
+      useDecodeThread ? 1 : 0,
+    );
+    calloc.free(ptr);
+    return handle;
+  }
+
+  /// Opens a pull-driven render whose input is fed with [renderFeed].
+  int openRenderPcm(
+    int sampleRate,
+    int channels, {
+    int outputSampleRate = 0,
+  }) {
+    if (!isRenderStreamAvailable) return 0;
+    return _renderOpenPcm!(sampleRate, channels, outputSampleRate);
+  }
+
+  ({int sampleRate, int channels})? renderFormat(int handle) {
+    if (!isRenderStreamAvailable || handle == 0) return null;
+    final values = calloc<ffi.Int32>(2);
+    try {
+      if (_renderGetFormat!(handle, values, values + 1) != 0) return null;
+      return (sampleRate: values[0], channels: values[1]);
+    } finally {
+      calloc.free(values);
+    }
+  }
+
+  /// Queues interleaved PCM without copying it. Returns the frames accepted.
+  int renderFeed(int handle, Float32List interleaved, int channels) {
+    if (!isRenderStreamAvailable || handle == 0) return -1;
+    return _renderFeed!(
+      handle,
+      interleaved.address,
+      interleaved.length ~/ channels,
+    );
+  }
+
+  void renderEndInput(int handle) {
+    if (!isRenderStreamAvailable || handle == 0) return;
+    _renderEndInput!(handle);
+  }
+
+  void renderSetParams(
+    int handle, {
+    required double tempo,
+    required double pitchSemi,
+    required double wet,
+    required double decay,
+    required double tone,
+    required double room,
+    required double echoMs,
+    double width = 1.0,
+    int stretchMode = stretchSoundTouch,
+  }) {
+    if (!isRenderStreamAvailable || handle == 0) return;
+    final params = calloc<RenderParams>();
+    params.ref
+      ..tempo = tempo
+      ..pitchSemitones = pitchSemi
+      ..wet = wet
+      ..decay = decay
+      ..tone = tone
+      ..room = room
+      ..echoMs = echoMs
+      ..width = width
+      ..stretchMode = stretchMode;
+    _renderSetParams!(handle, params);
+    calloc.free(params);
+  }
+
+  /// Convolves with the impulse response WAV at [path] instead of the
+  /// built-in reverb from the next [renderPull]; an empty [path] switches
+  /// back. Returns -2 if the file cannot be read.
+  int renderSetImpulse(int handle, String path) {
+    if (!isRenderStreamAvailable || _renderSetImpulse == null || handle == 0) {
+      return -1;
+    }
+    final ptr = path.toNativeUtf8();
+    final result = _renderSetImpulse!(handle, ptr.cast());
+    calloc.free(ptr);
+    return result;
+  }
+
+  /// Renders straight into [dst]; returns the frames written. This runs the
+  /// DSP (and inline decoding) on the calling thread, so call it from a
+  /// background isolate for anything longer than a few buffers.
+  int renderPull(int handle, RenderBuffer dst) {
+    if (!isRenderStreamAvailable || handle == 0) return -1;
+    return _renderPull!(handle, dst._pointer, dst.frames);
+  }
+
+  bool renderFinished(int handle) {
+    if (!isRenderStreamAvailable || handle == 0) return true;
+    return _renderFinished!(handle) != 0;
+  }
+
+  void renderClose(int handle) {
+    if (!isRenderStreamAvailable || handle == 0) return;
+    _renderClose!(handle);
+  }
+}
+
+/// Mirrors SlowReverbRenderParams in native_render.cpp.
+final class RenderParams extends ffi.Struct {
+  @ffi.Double()
+  external double tempo;
+  @ffi.Double()
+  external double pitchSemitones;
+  @ffi.Double()
+  external double wet;
+  @ffi.Double()
+  external double decay;
+  @ffi.Double()
+  external double tone;
+  @ffi.Double()
+  external double room;
+  @ffi.Double()
+  external double echoMs;
+  @ffi.Int32()
+  external int sampleRate;
+  @ffi.Int32()
+  external int channels;
+  @ffi.Double()
+  external double width;
+  @ffi.Int32()
+  external int stretchMode;
+}
+
+/// Mirrors TelemetryBlock in engine_telemetry.h. The audio callback
+/// rewrites it in place; read it through [TelemetryReader].
+final class NativeTelemetry extends ffi.Struct {
+  @ffi.Uint32()
+  external int sequence;
+  @ffi.Int32()
+  external int sampleRate;
+  @ffi.Int64()
+  external int frames;
+  @ffi.Double()
+  external double positionMs;
+  @ffi.Double()
+  external double durationMs;
+  @ffi.Int32()
+  external int channels;
+  @ffi.Array(8)
+  external ffi.Array<ffi.Float> peak;
+  @ffi.Array(8)
+  external ffi.Array<ffi.Float> rms;
+  @ffi.Float()
+  external double reverbRms;
+  @ffi.Int32()
+  external int spectrumBands;
+  @ffi.Array(16)
+  external ffi.Array<ffi.Float> spectrum;
+}
+
+/// Copies [NativeTelemetry] out of native memory without an FFI call, so it
+/// can run every frame.
+class TelemetryReader {
+  TelemetryReader._(this._block);
+
+  static const int _attempts = 4;
+
+  final ffi.Pointer<NativeTelemetry> _block;
+
+  /// A copy taken between two writes, or null when the audio thread kept
+  /// rewriting the block. Dart's loads carry no ordering, so on weakly
+  /// ordered CPUs a torn copy can in principle pass the sequence check; the
+  /// fields are independent levels and the next frame's read replaces it.
+  EngineTelemetry? read() {
+    final block = _block.ref;
+    for (var attempt = 0; attempt < _attempts; attempt++) {
+      final before = block.sequence;
+      if (before.isOdd) continue;
+      final channels = block.channels.clamp(0, 8);
+      final peak = Float32List(channels);
+      final rms = Float32List(channels);
+      for (var c = 0; c < channels; c++) {
+        peak[c] = block.peak[c];
+        rms[c] = block.rms[c];
+      }
+      final bands = block.spectrumBands.clamp(0, 16);
+      final spectrum = Float32List(bands);
+      for (var i = 0; i < bands; i++) {
+        spectrum[i] = block.spectrum[i];
+      }
+      final telemetry = EngineTelemetry(
+        sampleRate: block.sampleRate,
+        frames: block.frames,
+        positionMs: block.positionMs,
+        durationMs: block.durationMs,
+        peak: peak,
+        rms: rms,
+        reverbRms: block.reverbRms,
+        spectrum: spectrum,
+      );
+      if (block.sequence == before) return telemetry;
+    }
+    return null;
+  }
+}
+
+/// What the engine last published. Levels are linear amplitudes, 1.0 being
+/// full scale.
+class EngineTelemetry {
+  const EngineTelemetry({
+    required this.sampleRate,
+    required this.frames,
+    required this.positionMs,
+    required this.durationMs,
+    required this.peak,
+    required this.rms,
+    required this.reverbRms,
+    required this.spectrum,
+  });
+
+  final int sampleRate;
+
+  /// Output frames metered since the engine started; 0 until the first
+  /// callback.
+  final int frames;
+  final double positionMs;
+  final double durationMs;
+
+  /// One entry per output channel, up to eight: peak with a falling hold,
+  /// and RMS over about 300 ms. Empty until the first callback.
+  final Float32List peak;
+  final Float32List rms;
+
+  /// RMS of the reverb's wet output over about 300 ms.
+  final double reverbRms;
+
+  /// RMS of the output in log-spaced bands from 40 Hz to 16 kHz, held like
+  /// [peak].
+  final Float32List spectrum;
+}
+
+final class NativeEngineStats extends ffi.Struct {
+  @ffi.Int64()
+  external int callbacks;
+  @ffi.Int64()
+  external int framesRendered;
+  @ffi.Int64()
+  external int framesZeroFilled;
+  @ffi.Int64()
+  external int underflowCallbacks;
+  @ffi.Int32()
+  external int xrunCount;
+  @ffi.Int32()
+  external int framesPerBurst;
+  @ffi.Int32()
+  external int sampleRate;
+  @ffi.Int32()
+  external int ringFillFrames;
+  @ffi.Int32()
+  external int ringMinFillFrames;
+  @ffi.Int32()
+  external int ringCapacityFrames;
+  @ffi.Int32()
+  external int stretchBacklogFrames;
+  @ffi.Int32()
+  external int qualityTier;
+  @ffi.Double()
+  external double callbackP50Us;
+  @ffi.Double()
+  external double callbackP99Us;
+  @ffi.Double()
+  external double callbackMaxUs;
+  @ffi.Double()
+  external double budgetAverage;
+  @ffi.Double()
+  external double budgetMax;
+  @ffi.Double()
+  external double startMs;
+  @ffi.Double()
+  external double firstAudioMs;
+  @ffi.Int64()
+  external int framesBypassed;
+  @ffi.Double()
+  external double recoveryMs;
+  @ffi.Int32()
+  external int streamRecoveries;
+  @ffi.Int32()
+  external int reserved;
+  @ffi.Int64()
+  external int performanceCores;
+  @ffi.Int32()
+  external int decodeNice;
+  @ffi.Int32()
+  external int decodePrioritized;
+  @ffi.Int32()
+  external int decodePinned;
+  @ffi.Int32()
+  external int pinToPerformanceCores;
+}
+
+class EngineStats {
+  const EngineStats({
+    required this.callbacks,
+    required this.framesRendered,
+    required this.framesZeroFilled,
+    required this.underflowCallbacks,
+    required this.xrunCount,
+    required this.framesPerBurst,
+    required this.sampleRate,
+    required this.ringFillFrames,
+    required this.ringMinFillFrames,
+    required this.ringCapacityFrames,
+    required this.stretchBacklogFrames,
+    required this.qualityTier,
+    required this.callbackP50Us,
+    required this.callbackP99Us,
+    required this.callbackMaxUs,
+    required this.budgetAverage,
+    required this.budgetMax,
+    required this.startMs,
+    required this.firstAudioMs,
+    required this.framesBypassed,
+    required this.streamRecoveries,
+    required this.recoveryMs,
+    required this.performanceCores,
+    required this.decodeNice,
+    required this.decodePrioritized,
+    required this.decodePinned,
+    required this.pinToPerformanceCores,
+  });
+
+  final int callbacks;
+  final int framesRendered;
+  final int framesZeroFilled;
+  final int underflowCallbacks;
+
+  /// -1 when the output backend does not report xruns.
+  final int xrunCount;
+  final int framesPerBurst;
+  final int sampleRate;
+  final int ringFillFrames;
+  final int ringMinFillFrames;
+  final int ringCapacityFrames;
+  final int stretchBacklogFrames;
+
+  /// See [NativeAudioBridge.qualityTier].
+  final int qualityTier;
+  final double callbackP50Us;
+  final double callbackP99Us;
+  final double callbackMaxUs;
+
+  /// Callback time as a fraction of the audio it produced; above 1.0 the
+  /// callback cannot keep up.
+  final double budgetAverage;
+  final double budgetMax;
+
+  /// How long the start call blocked, -1 before it returned.
+  final double startMs;
+
+  /// From the start call to the first audible output sample, -1 until one
+  /// has played.
+  final double firstAudioMs;
+
+  /// Output frames rendered while silence bypassed the stretcher and the
+  /// reverb.
+  final int framesBypassed;
+
+  /// Output streams reopened since start after the device went away, e.g.
+  /// a headset unplugged or a Bluetooth route change.
+  final int streamRecoveries;
+
+  /// From the last stream loss to audio resuming, -1 before any recovery.
+  final double recoveryMs;
+
+  /// CPUs faster than the slowest cluster, as a bit mask; 0 when all cores
+  /// are alike or their frequencies are unknown.
+  final int performanceCores;
+
+  /// Nice value of the decoder threads; lower runs sooner.
+  final int decodeNice;
+
+  /// Whether the decoder threads got audio priority.
+  final bool decodePrioritized;
+
+  /// Whether the decoder threads are held to [performanceCores].
+  final bool decodePinned;
+
+  /// See [NativeAudioBridge.setPinToPerformanceCores].
+  final bool pinToPerformanceCores;
+
+  double get bypassMs =>
+      sampleRate > 0 ? framesBypassed * 1000.0 / sampleRate : 0.0;
+}
+
+final class NativeEngineMemory extends ffi.Struct {
+  @ffi.Int64()
+  external int budgetBytes;
+  @ffi.Int64()
+  external int ringBytes;
+  @ffi.Int64()
+  external int chainBytes;
+  @ffi.Int64()
+  external int totalBytes;
+  @ffi.Double()
+  external double ringMs;
+  @ffi.Double()
+  external double decodeSpeed;
+  @ffi.Int32()
+  external int ringFrames;
+  @ffi.Int32()
+  external int ringFormat;
+  @ffi.Int64()
+  external int arenaBytes;
+  @ffi.Int64()
+  external int arenaPeakBytes;
+  @ffi.Int64()
+  external int arenaOverflows;
+}
+
+class EngineMemory {
+  const EngineMemory({
+    required this.budgetBytes,
+    required this.ringBytes,
+    required this.chainBytes,
+    required this.totalBytes,
+    required this.ringMs,
+    required this.decodeSpeed,
+    required this.ringFrames,
+    required this.ringFormat,
+    required this.arenaBytes,
+    required this.arenaPeakBytes,
+    required this.arenaOverflows,
+  });
+
+  /// 0 when unlimited.
+  final int budgetBytes;
+
+  /// Both decode rings.
+  final int ringBytes;
+
+  /// Processing chains, convolution reverb and callback buffers, as
+  /// measured when they were last configured.
+  final int chainBytes;
+  final int totalBytes;
+
+  /// Length of the playing track's ring.
+  final double ringMs;
+
+  /// Decoding speed as a multiple of realtime, 0 until measured.
+  final double decodeSpeed;
+  final int ringFrames;
+
+  /// One of the NativeAudioBridge.ring* formats.
+  final int ringFormat;
+
+  /// The chains' arenas, part of [chainBytes]: bytes reserved, the most
+  /// their buffers needed at once, and allocations that did not fit and
+  /// went to the heap.
+  final int arenaBytes;
+  final int arenaPeakBytes;
+  final int arenaOverflows;
+}
+
+class NativeEngineEvent {
+  const NativeEngineEvent({
+    required this.handle,
+    required this.type,
+    required this.code,
+  });
+
+  /// Event types, mirroring kEvent* in native_audio.cpp.
+  static const int started = 1;
+  static const int stopped = 2;
+  static const int disposed = 3;
+  static const int ended = 4;
+
+  /// Start results carried in [code] for [started].
+  static const int startOk = 0;
+  static const int startUnknownHandle = -1;
+  static const int startDecoderFailed = -2;
+  static const int startOutputFailed = -3;
+
+  final int handle;
+  final int type;
+  final int code;
+}
+
+class RenderedSnippet {
+  RenderedSnippet({
+    required this.samples,
+    required this.audibleFrames,
+    required this.sampleRate,
+    required this.channels,
+  });
+
+  /// Interleaved samples; frames past [audibleFrames] are silence.
+  final Float32List samples;
+  final int audibleFrames;
+  final int sampleRate;
+  final int channels;
+
+  Duration get audibleDuration =>
+      Duration(microseconds: audibleFrames * 1000000 ~/ sampleRate);
+}
+
+/// Native memory that [NativeAudioBridge.renderPull] renders into, so a pull
+/// needs no copy. Freed once [samples] is garbage collected. Finalizable
+/// only to stay reachable, and keep [samples] so, until a pull that was
+/// handed it returns.
+class RenderBuffer implements ffi.Finalizable {
+  RenderBuffer._(this._pointer, this.frames, this.channels)
+      : samples = _pointer.asTypedList(
+          frames * channels,
+          finalizer: malloc.nativeFree,
+        );
+
+  factory RenderBuffer(int frames, int channels) =>
+      RenderBuffer._(malloc<ffi.Float>(frames * channels), frames, channels);
+
+  final ffi.Pointer<ffi.Float> _pointer;
+  final int frames;
+  final int channels;
+
+  /// Interleaved; a pull fills the first frames it returns.
+  final Float32List samples;
 }
 
 typedef _CreateNative = ffi.IntPtr Function();
@@ -148,11 +1304,77 @@ typedef _VoidHandleFn = void Function(int);
 typedef _StartNative = ffi.Int32 Function(
     ffi.IntPtr, ffi.Pointer<ffi.Int8>);
 typedef _StartFn = int Function(int, ffi.Pointer<ffi.Int8>);
+typedef _StartAsyncNative = ffi.Void Function(
+    ffi.IntPtr, ffi.Pointer<ffi.Int8>);
+typedef _StartAsyncFn = void Function(int, ffi.Pointer<ffi.Int8>);
+typedef _EventCallbackNative = ffi.Void Function(
+    ffi.IntPtr, ffi.Int32, ffi.Int32);
+typedef _SetEventCallbackNative = ffi.Void Function(
+    ffi.Pointer<ffi.NativeFunction<_EventCallbackNative>>);
+typedef _SetEventCallbackFn = void Function(
+    ffi.Pointer<ffi.NativeFunction<_EventCallbackNative>>);
 typedef _DoubleSetterNative = ffi.Void Function(ffi.IntPtr, ffi.Double);
 typedef _DoubleSetter = void Function(int, double);
+typedef _IntSetterNative = ffi.Void Function(ffi.IntPtr, ffi.Int32);
+typedef _IntSetter = void Function(int, int);
+typedef _IntSetter64Native = ffi.Void Function(ffi.IntPtr, ffi.Int64);
 typedef _ReverbSetterNative = ffi.Void Function(
     ffi.IntPtr, ffi.Double, ffi.Double, ffi.Double, ffi.Double);
 typedef _ReverbSetter = void Function(
     int, double, double, double, double);
 typedef _GetDoubleNative = ffi.Double Function(ffi.IntPtr);
 typedef _GetDouble = double Function(int);
+typedef _GetTelemetryNative = ffi.Pointer<NativeTelemetry> Function(
+    ffi.IntPtr);
+typedef _GetTelemetryFn = ffi.Pointer<NativeTelemetry> Function(int);
+typedef _GetStatsNative = ffi.Int32 Function(
+    ffi.IntPtr, ffi.Pointer<NativeEngineStats>);
+typedef _GetStatsFn = int Function(int, ffi.Pointer<NativeEngineStats>);
+typedef _GetMemoryNative = ffi.Int32 Function(
+    ffi.IntPtr, ffi.Pointer<NativeEngineMemory>);
+typedef _GetMemoryFn = int Function(int, ffi.Pointer<NativeEngineMemory>);
+typedef _GetIntNative = ffi.Int32 Function(ffi.IntPtr);
+typedef _GetInt = int Function(int);
+typedef _SetCompareNative = ffi.Void Function(
+    ffi.IntPtr, ffi.Int32, ffi.Int32);
+typedef _SetCompareFn = void Function(int, int, int);
+typedef _SetMonitorNative = ffi.Void Function(
+    ffi.IntPtr, ffi.Int32, ffi.Double);
+typedef _SetMonitorFn = void Function(int, int, double);
+typedef _PoolPrewarmNative = ffi.Int32 Function(
+    ffi.Int32, ffi.Int32, ffi.Int32);
+typedef _PoolPrewarmFn = int Function(int, int, int);
+typedef _RenderOpenFileNative = ffi.IntPtr Function(
+    ffi.Pointer<ffi.Int8>, ffi.Int32, ffi.Int32);
+typedef _RenderOpenFileFn = int Function(ffi.Pointer<ffi.Int8>, int, int);
+typedef _RenderOpenPcmNative = ffi.IntPtr Function(
+    ffi.Int32, ffi.Int32, ffi.Int32);
+typedef _RenderOpenPcmFn = int Function(int, int, int);
+typedef _RenderFeedNative = ffi.Int32 Function(
+    ffi.IntPtr, ffi.Pointer<ffi.Float>, ffi.Int32);
+typedef _RenderFeedFn = int Function(int, ffi.Pointer<ffi.Float>, int);
+typedef _RenderPullNative = ffi.Int32 Function(
+    ffi.IntPtr, ffi.Pointer<ffi.Float>, ffi.Int32);
+typedef _RenderPullFn = int Function(int, ffi.Pointer<ffi.Float>, int);
+typedef _RenderSetParamsNative = ffi.Void Function(
+    ffi.IntPtr, ffi.Pointer<RenderParams>);
+typedef _RenderSetParamsFn = void Function(int, ffi.Pointer<RenderParams>);
+typedef _RenderGetFormatNative = ffi.Int32 Function(
+    ffi.IntPtr, ffi.Pointer<ffi.Int32>, ffi.Pointer<ffi.Int32>);
+typedef _RenderGetFormatFn = int Function(
+    int, ffi.Pointer<ffi.Int32>, ffi.Pointer<ffi.Int32>);
+typedef _VoidNative = ffi.Void Function();
+typedef _VoidFn = void Function();
+typedef _SetFlagNative = ffi.Void Function(ffi.Int32);
+typedef _SetFlagFn = void Function(int);
+typedef _WriteTraceNative = ffi.Int32 Function(ffi.Pointer<ffi.Int8>);
+typedef _WriteTraceFn = int Function(ffi.Pointer<ffi.Int8>);
+typedef _RenderSnippetNative = ffi.Int32 Function(
+    ffi.Pointer<ffi.Int8>,
+    ffi.Double,
+    ffi.Double,
+    ffi.Pointer<RenderParams>,
+    ffi.Pointer<ffi.Float>,
+    ffi.Int32);
+typedef _RenderSnippetFn = int Function(ffi.Pointer<ffi.Int8>, double, double,
+    ffi.Pointer<RenderParams>, ffi.Pointer<ffi.Float>, int);